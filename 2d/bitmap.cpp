@@ -39,7 +39,7 @@ grs_bitmap* gr_create_bitmap(int w, int h)
 	newbm->bm_rowsize = w;
 	newbm->bm_selector = 0;
 
-	newbm->bm_data = (unsigned char*)mem_malloc(w * h * sizeof(unsigned char));
+	newbm->bm_data = (unsigned char*)mem_malloc_tag(w * h * sizeof(unsigned char), MEM_TAG_BITMAP);
 
 	return newbm;
 }
@@ -48,7 +48,7 @@ grs_bitmap* gr_create_bitmap_raw(int w, int h, unsigned char* raw_data)
 {
 	grs_bitmap* newbm;
 
-	newbm = (grs_bitmap*)mem_malloc(sizeof(grs_bitmap));
+	newbm = (grs_bitmap*)mem_pool_alloc(sizeof(grs_bitmap));
 	newbm->bm_x = 0;
 	newbm->bm_y = 0;
 	newbm->bm_w = w;
@@ -80,7 +80,7 @@ grs_bitmap* gr_create_sub_bitmap(grs_bitmap* bm, int x, int y, int w, int h)
 {
 	grs_bitmap* newbm;
 
-	newbm = (grs_bitmap*)mem_malloc(sizeof(grs_bitmap));
+	newbm = (grs_bitmap*)mem_pool_alloc(sizeof(grs_bitmap));
 	newbm->bm_x = x + bm->bm_x;
 	newbm->bm_y = y + bm->bm_y;
 	newbm->bm_w = w;
@@ -104,10 +104,10 @@ void gr_free_bitmap(grs_bitmap* bm)
 		mem_free(bm);
 }
 
+//Sub bitmaps and raw bitmaps only own their header, which comes from the pools
 void gr_free_sub_bitmap(grs_bitmap* bm)
 {
-	if (bm != NULL)
-		mem_free(bm);
+	mem_pool_free(bm, sizeof(grs_bitmap));
 }
 
 void build_colormap_good(uint8_t* palette, uint8_t* colormap, int* freq);
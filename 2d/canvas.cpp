@@ -37,7 +37,7 @@ grs_canvas* gr_create_canvas(int w, int h)
 	grs_canvas* newvar;
 
 	newvar = (grs_canvas*)mem_malloc(sizeof(grs_canvas));
-	data = (unsigned char*)mem_malloc(w * h * sizeof(unsigned char));
+	data = (unsigned char*)mem_malloc_tag(w * h * sizeof(unsigned char), MEM_TAG_BITMAP);
 
 	newvar->cv_bitmap.bm_x = 0;
 	newvar->cv_bitmap.bm_y = 0;
@@ -60,7 +60,7 @@ grs_canvas* gr_create_sub_canvas(grs_canvas* canv, int x, int y, int w, int h)
 {
 	grs_canvas* newvar;
 
-	newvar = (grs_canvas*)mem_malloc(sizeof(grs_canvas));
+	newvar = (grs_canvas*)mem_pool_alloc(sizeof(grs_canvas));
 
 	newvar->cv_bitmap.bm_x = x + canv->cv_bitmap.bm_x;
 	newvar->cv_bitmap.bm_y = y + canv->cv_bitmap.bm_y;
@@ -134,7 +134,7 @@ void gr_free_canvas(grs_canvas* canv)
 
 void gr_free_sub_canvas(grs_canvas* canv)
 {
-	mem_free(canv);
+	mem_pool_free(canv, sizeof(grs_canvas));
 }
 
 int gr_wait_for_retrace = 1;
@@ -27,6 +27,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "cfile/cfile.h"
 #include "platform/mono.h"
 #include "misc/byteswap.h"
+#include "2d/rle.h"
 
 #if defined(POLY_ACC)
 #include "poly_acc.h"
@@ -888,6 +889,208 @@ int gr_internal_color_string(int x, int y, const char* s)
 	return 0;
 }
 
+//Cache of rendered strings. A string drawn over a transparent background is rasterized once
+//into an RLE bitmap, keyed by its text, font and color, and drawn with one masked blit after that.
+//The HUD draws the same strings every frame, and unpacking the font a bit at a time is most of the cost.
+#define MAX_STRING_CACHE	64
+#define STRING_CACHE_LEN	64		//longer strings are always drawn directly
+
+typedef struct string_cache_element {
+	grs_font* font;
+	int fg_color;
+	uint32_t hash;
+	char text[STRING_CACHE_LEN];
+	grs_bitmap bm;
+	int data_size;				//allocated size of bm.bm_data
+	int last_used;
+} string_cache_element;
+
+int gr_string_cache_enabled = 1;
+
+static string_cache_element string_cache[MAX_STRING_CACHE];
+static int string_cache_counter = 0;
+static int string_cache_initialized = 0;
+
+extern int gr_bitblt_dest_step_shift;
+extern uint8_t* gr_bitblt_fade_table;
+
+static void string_cache_close()
+{
+	int i;
+
+	for (i = 0; i < MAX_STRING_CACHE; i++)
+	{
+		if (string_cache[i].bm.bm_data)
+			mem_free(string_cache[i].bm.bm_data);
+		string_cache[i].bm.bm_data = NULL;
+		string_cache[i].data_size = 0;
+		string_cache[i].font = NULL;
+	}
+}
+
+//Forgets the strings drawn in font, or all of them if font is NULL.
+static void string_cache_flush(grs_font* font)
+{
+	int i;
+
+	for (i = 0; i < MAX_STRING_CACHE; i++)
+		if (font == NULL || string_cache[i].font == font)
+		{
+			string_cache[i].font = NULL;
+			string_cache[i].last_used = 0;
+		}
+}
+
+//Returns the hash of s, or 0 if s can't be cached: too long, several lines or control codes.
+static uint32_t string_cache_hash(const char* s)
+{
+	uint32_t hash = 2166136261u;
+	int len;
+
+	for (len = 0; s[len]; len++)
+	{
+		if ((uint8_t)s[len] <= CC_UNDERLINE || s[len] == '\n' || len >= STRING_CACHE_LEN - 1)
+			return 0;
+		hash = (hash ^ (uint8_t)s[len]) * 16777619u;
+	}
+
+	return hash | 1;
+}
+
+//Draws s into entry's bitmap, with TRANSPARENCY_COLOR where the font has no bits.
+static void string_cache_render(string_cache_element* entry, const char* s)
+{
+	const uint8_t* text_ptr;
+	unsigned char* fp;
+	int x, w, r, i, bits, BitMask, width, spacing, letter, size;
+	uint8_t* dest;
+
+	//The last character can stick out past its spacing, so the bitmap is as wide as the widest extent.
+	for (x = 0, w = 0, text_ptr = (const uint8_t*)s; *text_ptr; text_ptr++)
+	{
+		get_char_width(text_ptr[0], text_ptr[1], &width, &spacing);
+		if (INFONT(*text_ptr - FMINCHAR) && x + width > w)
+			w = x + width;
+		x += spacing;
+	}
+
+	//gr_bitmap_rle_compress needs (w + 1) * h bytes to work in.
+	size = (w + 1) * FHEIGHT;
+	if (size > entry->data_size)
+	{
+		if (entry->bm.bm_data)
+			mem_free(entry->bm.bm_data);
+		entry->bm.bm_data = (uint8_t*)mem_malloc(size);
+		entry->data_size = size;
+	}
+
+	entry->bm.bm_x = entry->bm.bm_y = 0;
+	entry->bm.bm_w = entry->bm.bm_rowsize = w;
+	entry->bm.bm_h = FHEIGHT;
+	entry->bm.bm_type = BM_LINEAR;
+	entry->bm.bm_flags = BM_FLAG_TRANSPARENT;
+	memset(entry->bm.bm_data, TRANSPARENCY_COLOR, w * FHEIGHT);
+
+	for (x = 0, text_ptr = (const uint8_t*)s; *text_ptr; text_ptr++)
+	{
+		get_char_width(text_ptr[0], text_ptr[1], &width, &spacing);
+		letter = *text_ptr - FMINCHAR;
+
+		if (INFONT(letter))
+		{
+			if (FFLAGS & FT_PROPORTIONAL)
+				fp = FCHARS[letter];
+			else
+				fp = FDATA + letter * BITS_TO_BYTES(width) * FHEIGHT;
+
+			for (r = 0; r < FHEIGHT; r++)
+			{
+				dest = &entry->bm.bm_data[r * w + x];
+				BitMask = 0;
+				bits = 0;
+
+				for (i = 0; i < width; i++)
+				{
+					if (BitMask == 0) {
+						bits = *fp++;
+						BitMask = 0x80;
+					}
+					if (bits & BitMask)
+						dest[i] = FG_COLOR;
+					BitMask >>= 1;
+				}
+			}
+		}
+
+		x += spacing;
+	}
+
+	if (w > 0)
+		gr_bitmap_rle_compress(&entry->bm);
+}
+
+//Draws s from the cache, rendering it first if it isn't there. Returns 0 if s can't be drawn from the cache.
+static int string_cache_draw(int x, int y, const char* s)
+{
+	string_cache_element* entry;
+	uint32_t hash;
+	int i, least_recently_used;
+
+	if (!gr_string_cache_enabled || (FFLAGS & FT_COLOR) || BG_COLOR != -1 || FG_COLOR == TRANSPARENCY_COLOR)
+		return 0;
+	if (TYPE != BM_LINEAR || gr_bitblt_dest_step_shift || gr_bitblt_fade_table)
+		return 0;
+	hash = string_cache_hash(s);
+	if (!hash)
+		return 0;
+
+	if (!string_cache_initialized)
+	{
+		string_cache_initialized = 1;
+		atexit(string_cache_close);
+	}
+
+	string_cache_counter++;
+	if (string_cache_counter < 0)
+	{
+		string_cache_counter = 1;
+		string_cache_flush(NULL);
+	}
+
+	entry = NULL;
+	least_recently_used = 0;
+	for (i = 0; i < MAX_STRING_CACHE; i++)
+	{
+		string_cache_element* e = &string_cache[i];
+
+		if (e->hash == hash && e->font == FONT && e->fg_color == FG_COLOR && !strcmp(e->text, s))
+		{
+			entry = e;
+			break;
+		}
+		if (e->last_used < string_cache[least_recently_used].last_used)
+			least_recently_used = i;
+	}
+
+	if (!entry)
+	{
+		entry = &string_cache[least_recently_used];
+		entry->font = FONT;
+		entry->fg_color = FG_COLOR;
+		entry->hash = hash;
+		strcpy(entry->text, s);
+		string_cache_render(entry, s);
+	}
+	entry->last_used = string_cache_counter;
+
+	if (x == 0x8000)			//centered
+		x = get_centered_x((char*)s);
+
+	if (entry->bm.bm_w > 0)
+		gr_bitmapm(x, y, &entry->bm);
+	return 1;
+}
+
 int gr_string(int x, int y, const char* s)
 {
 	int w, h, aw;
@@ -895,6 +1098,9 @@ int gr_string(int x, int y, const char* s)
 
 	Assert(FONT != NULL);
 
+	if (string_cache_draw(x, y, s))
+		return 0;
+
 	if (x == 0x8000) {
 		if (y < 0) clipped |= 1;
 		gr_get_string_size(s, &w, &h, &aw);
@@ -946,6 +1152,9 @@ int gr_string(int x, int y, const char* s)
 
 int gr_ustring(int x, int y, const char* s)
 {
+	if (string_cache_draw(x, y, s))
+		return 0;
+
 	if (FFLAGS & FT_COLOR)
 	{
 		return gr_internal_color_string(x, y, s);
@@ -1051,6 +1260,7 @@ void gr_close_font(grs_font* font)
 		Assert(fontnum < MAX_OPEN_FONTS);	//did we find slot?
 
 		open_font[fontnum].ptr = NULL;
+		string_cache_flush(font);
 
 		if (font->ft_datablock)
 			mem_free(font->ft_datablock);
@@ -1096,7 +1306,7 @@ void gr_read_font(grs_font* font, CFILE* fp, int len)
 	if (font->ft_chars)
 		mem_free(font->ft_chars);
 
-	font->ft_datablock = (uint8_t*)mem_malloc(len);
+	font->ft_datablock = (uint8_t*)mem_malloc_tag(len, MEM_TAG_FONT);
 
 	font->ft_w = cfile_read_short(fp);
 	font->ft_h = cfile_read_short(fp);
@@ -1125,7 +1335,7 @@ void gr_read_font(grs_font* font, CFILE* fp, int len)
 		//font->ft_widths = (short*)(((int)font->ft_widths) + ((uint8_t*)font));
 		font->ft_widths = (short*)&font->ft_datablock[widthPtr];
 		font->ft_data = &font->ft_datablock[dataPtr];
-		font->ft_chars = (unsigned char**)mem_malloc(nchars * sizeof(unsigned char*));
+		font->ft_chars = (unsigned char**)mem_malloc_tag(nchars * sizeof(unsigned char*), MEM_TAG_FONT);
 		ptr = font->ft_data;
 
 		for (i = 0; i < nchars; i++)
@@ -1200,7 +1410,7 @@ grs_font * gr_init_font(const char* fontname)
 	if (file_id != 'NFSP')
 		Error("File %s is not a font file", fontname);
 
-	font = (grs_font*)mem_malloc(datasize);
+	font = (grs_font*)mem_malloc_tag(datasize, MEM_TAG_FONT);
 	memset(font, 0, sizeof(*font));
 
 	//printf("loading font %s\n", fontname);
@@ -24,7 +24,6 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "platform/mono.h"
 #include "fix/fix.h"
 #include "2d/palette.h"
-#include "misc/rand.h"
 
 extern int gr_installed;
 
@@ -39,8 +38,6 @@ uint8_t gr_palette_gamma = 0;
 int gr_palette_gamma_param = 0;
 uint8_t gr_palette_faded_out = 1;
 
-int Num_computed_colors = 0;
-
 int grd_fades_disabled = 0;
 
 void gr_palette_set_gamma(int gamma)
@@ -62,10 +59,12 @@ int gr_palette_get_gamma()
 	return gr_palette_gamma_param;
 }
 
+static void sync_inverse_maps();
+
 void gr_copy_palette(uint8_t* gr_palette, uint8_t* pal, int size)
 {
 	memcpy(gr_palette, pal, size);
-	Num_computed_colors = 0;
+	sync_inverse_maps();
 }
 
 void gr_use_palette_table(const char* filename)
@@ -89,105 +88,84 @@ void gr_use_palette_table(const char* filename)
 		gr_fade_table[i * 256 + 255] = 255;
 	}
 
-	Num_computed_colors = 0;	//[ISB] Flush palette cache.
+	sync_inverse_maps();	//[ISB] Flush palette cache.
 }
 
 #define SQUARE(x) ((x)*(x))
 
-#define	MAX_COMPUTED_COLORS	32
+//	Inverse color maps, from 6-bit r, g, b to the closest palette entry, for gr_palette and gr_current_pal.
+//	An entry is searched for the first time it's asked for, so when the palette changes the map only has to be emptied.
+#define INVERSE_MAP_EMPTY 255	//	never a search result, since the search stops before the transparent color
 
 typedef struct {
-	uint8_t	r, g, b, color_num;
-} color_record;
+	int	valid;
+	uint8_t	palette[254 * 3];	//	the colors the map was built from
+	uint8_t	map[64 * 64 * 64];
+} inverse_color_map;
 
-color_record Computed_colors[MAX_COMPUTED_COLORS];
+static inverse_color_map Inverse_map, Current_inverse_map;
 
-//	Add a computed color (by gr_find_closest_color) to list of computed colors in Computed_colors.
-//	If list wasn't full already, increment Num_computed_colors.
-//	If was full, replace a random one.
-void add_computed_color(int r, int g, int b, int color_num)
+//	Empty the map if the colors it was built from have changed.
+static void sync_inverse_map(inverse_color_map* imap, uint8_t* pal)
 {
-	int	add_index;
+	if (imap->valid && !memcmp(imap->palette, pal, sizeof(imap->palette)))
+		return;
 
-	if (Num_computed_colors < MAX_COMPUTED_COLORS) 
-	{
-		add_index = Num_computed_colors;
-		Num_computed_colors++;
-	}
-	else
-		add_index = (P_Rand() * MAX_COMPUTED_COLORS) >> 15;
-
-	Computed_colors[add_index].r = r;
-	Computed_colors[add_index].g = g;
-	Computed_colors[add_index].b = b;
-	Computed_colors[add_index].color_num = color_num;
+	memcpy(imap->palette, pal, sizeof(imap->palette));
+	memset(imap->map, INVERSE_MAP_EMPTY, sizeof(imap->map));
+	imap->valid = 1;
 }
 
-void init_computed_colors(void)
-{
-	int	i;
-
-	for (i = 0; i < MAX_COMPUTED_COLORS; i++)
-		Computed_colors[i].r = 255;		//	Make impossible to match.
-}
-
-int gr_find_closest_color(int r, int g, int b)
+static int search_palette(uint8_t* pal, int r, int g, int b)
 {
 	int i, j;
 	int best_value, best_index, value;
 
-	if (Num_computed_colors == 0)
-		init_computed_colors();
-
-	//	If we've already computed this color, return it!
-	for (i = 0; i < Num_computed_colors; i++)
-		if (r == Computed_colors[i].r)
-			if (g == Computed_colors[i].g)
-				if (b == Computed_colors[i].b) 
-				{
-					if (i > 4)
-					{
-						color_record	trec;
-						trec = Computed_colors[i - 1];
-						Computed_colors[i - 1] = Computed_colors[i];
-						Computed_colors[i] = trec;
-						return Computed_colors[i - 1].color_num;
-					}
-					return Computed_colors[i].color_num;
-				}
-
-	//	r &= 63;
-	//	g &= 63;
-	//	b &= 63;
-
-	best_value = SQUARE(r - gr_palette[0]) + SQUARE(g - gr_palette[1]) + SQUARE(b - gr_palette[2]);
+	best_value = SQUARE(r - pal[0]) + SQUARE(g - pal[1]) + SQUARE(b - pal[2]);
 	best_index = 0;
-	if (best_value == 0) 
-	{
-		add_computed_color(r, g, b, best_index);
+	if (best_value == 0)
 		return best_index;
-	}
+
 	j = 0;
 	// only go to 255, 'cause we dont want to check the transparent color.
 	for (i = 1; i < 254; i++) 
 	{
 		j += 3;
-		value = SQUARE(r - gr_palette[j]) + SQUARE(g - gr_palette[j + 1]) + SQUARE(b - gr_palette[j + 2]);
+		value = SQUARE(r - pal[j]) + SQUARE(g - pal[j + 1]) + SQUARE(b - pal[j + 2]);
 		if (value < best_value) 
 		{
-			if (value == 0) 
-			{
-				add_computed_color(r, g, b, i);
+			if (value == 0)
 				return i;
-			}
 			best_value = value;
 			best_index = i;
 		}
 	}
-	add_computed_color(r, g, b, best_index);
 	return best_index;
 }
 
+static int lookup_inverse_map(inverse_color_map* imap, uint8_t* pal, int r, int g, int b)
+{
+	int index;
+
+	//	Anything outside the 6-bit range isn't in the map, so just search for it.
+	if ((unsigned)r > 63 || (unsigned)g > 63 || (unsigned)b > 63)
+		return search_palette(pal, r, g, b);
+
+	if (!imap->valid)
+		sync_inverse_map(imap, pal);
+
+	index = (r << 12) | (g << 6) | b;
+	if (imap->map[index] == INVERSE_MAP_EMPTY)
+		imap->map[index] = search_palette(pal, r, g, b);
+
+	return imap->map[index];
+}
+
+int gr_find_closest_color(int r, int g, int b)
+{
+	return lookup_inverse_map(&Inverse_map, gr_palette, r, g, b);
+}
+
 int gr_find_closest_color_15bpp(int rgb)
 {
 	return gr_find_closest_color(((rgb >> 10) & 31) * 2, ((rgb >> 5) & 31) * 2, (rgb & 31) * 2);
@@ -195,36 +173,17 @@ int gr_find_closest_color_15bpp(int rgb)
 
 int gr_find_closest_color_current(int r, int g, int b)
 {
-	int i, j;
-	int best_value, best_index, value;
-
-	//	r &= 63;
-	//	g &= 63;
-	//	b &= 63;
+	return lookup_inverse_map(&Current_inverse_map, gr_current_pal, r, g, b);
+}
 
-	best_value = SQUARE(r - gr_current_pal[0]) + SQUARE(g - gr_current_pal[1]) + SQUARE(b - gr_current_pal[2]);
-	best_index = 0;
-	if (best_value == 0)
-		return best_index;
 
-	j = 0;
-	// only go to 255, 'cause we dont want to check the transparent color.
-	for (i = 1; i < 254; i++) 
-	{
-		j += 3;
-		value = SQUARE(r - gr_current_pal[j]) + SQUARE(g - gr_current_pal[j + 1]) + SQUARE(b - gr_current_pal[j + 2]);
-		if (value < best_value) 
-		{
-			if (value == 0)
-				return i;
-			best_value = value;
-			best_index = i;
-		}
-	}
-	return best_index;
+//	Called wherever the palette gets changed, to drop any colors that were looked up with the old one.
+static void sync_inverse_maps()
+{
+	sync_inverse_map(&Inverse_map, gr_palette);
+	sync_inverse_map(&Current_inverse_map, gr_current_pal);
 }
 
-
 static int last_r = 0, last_g = 0, last_b = 0;
 
 void gr_palette_step_up(int r, int g, int b)
@@ -280,7 +239,7 @@ void gr_palette_load(uint8_t* pal)
 	plat_write_palette(0, 255, &gr_current_pal[0]);
 	gr_palette_faded_out = 0;
 
-	init_computed_colors();
+	sync_inverse_maps();
 }
 
 int gr_palette_fade_out(uint8_t* pal, int nsteps, int allow_keys)
@@ -358,6 +317,7 @@ int gr_palette_fade_in(uint8_t* pal, int nsteps, int allow_keys)
 		fade_palette[i] = 0;
 		fade_palette_delta[i] = i2f(pal[i] + gr_palette_gamma) / nsteps;
 	}
+	sync_inverse_map(&Current_inverse_map, gr_current_pal);
 
 	for (j = 0; j < nsteps; j++) 
 	{
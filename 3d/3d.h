@@ -147,6 +147,13 @@ g3s_codes g3_check_codes(int nv, g3s_point** pointlist);
 //rotates a point. returns codes.  does not check if already rotated
 uint8_t g3_rotate_point(g3s_point* dest, vms_vector* src);
 
+//rotates a batch of points. dest[pointnums[i]] gets src[pointnums[i]], for each of the n entries
+void g3_rotate_point_list(g3s_point* dest, vms_vector* src, short* pointnums, int n);
+
+//codes a sphere. a bit is only set if the whole sphere is past that plane.
+//if near_z isn't NULL, it gets the closest the sphere can be in depth
+uint8_t g3_code_sphere(vms_vector* pos, fix rad, fix* near_z);
+
 //projects a point
 void g3_project_point(g3s_point* point);
 
@@ -0,0 +1,63 @@
+/*
+The code contained in this file is not the property of Parallax Software,
+and is not under the terms of the Parallax Software Source license.
+Instead, it is released under the terms of the MIT License,
+as described in copying.txt
+*/
+
+#include <stdlib.h>
+
+#include "3d/objsort.h"
+
+void sort_item_set(sort_item* item, int objnum, vms_vector* pos, vms_vector* eye, fix size, int weapon, int on_top)
+{
+	item->objnum = objnum;
+	//NOTE: maybe use depth, not dist - quicker computation
+	item->dist = vm_vec_dist_quick(pos, eye);
+	item->size = size;
+	item->weapon = weapon;
+	item->on_top = on_top;
+}
+
+fix sort_item_compare(const sort_item* a, const sort_item* b)
+{
+	fix delta_dist;
+
+	delta_dist = a->dist - b->dist;
+
+	if (abs(delta_dist) < (a->size + b->size)) //same position
+	{
+		//these two objects are in the same position.  see if one is a fireball
+		//or laser or something that should plot on top.  Don't do this for
+		//the afterburner blobs, though.
+
+		if (a->on_top)
+			if (!b->weapon)
+				return -1;	//a is weapon, b is not, so say a is closer
+			else;				//both are weapons 
+		else
+			if (b->on_top)
+				return 1;	//b is weapon, a is not, so say a is farther
+
+		//no special case, fall through to normal return
+	}
+
+	return delta_dist;	//return distance
+}
+
+//A segment rarely has more than a few objects in it, so insertion sort beats qsort here.
+//It's also stable, so objects in the same place keep the order of the segment's object list
+//from frame to frame rather than whatever qsort happened to leave.
+void sort_objects(sort_item* list, int n)
+{
+	int i, j;
+
+	for (i = 1; i < n; i++)
+	{
+		sort_item item = list[i];
+
+		for (j = i; j > 0 && sort_item_compare(&list[j - 1], &item) > 0; j--)
+			list[j] = list[j - 1];
+		list[j] = item;
+	}
+}
@@ -0,0 +1,33 @@
+/*
+The code contained in this file is not the property of Parallax Software,
+and is not under the terms of the Parallax Software Source license.
+Instead, it is released under the terms of the MIT License,
+as described in copying.txt
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "fix/fix.h"
+#include "vecmat/vecmat.h"
+
+//Depth sort of the objects in a segment, nearest first.
+//Everything the sort looks at is copied out of the object when it's added, so comparisons
+//don't go back to the object.
+typedef struct sort_item
+{
+	int objnum;
+	fix dist;
+	fix size;
+	uint8_t on_top;		//weapon or fireball that plots on top of things at the same position
+	uint8_t weapon;		//weapon or any fireball
+} sort_item;
+
+//Fills in item for an object of the given size at pos, as seen from eye.
+void sort_item_set(sort_item* item, int objnum, vms_vector* pos, vms_vector* eye, fix size, int weapon, int on_top);
+
+//Less than 0 if a is in front of b, more than 0 if it's behind.
+fix sort_item_compare(const sort_item* a, const sort_item* b);
+
+//Sorts list nearest first. Objects that compare the same keep their order.
+void sort_objects(sort_item* list, int n);
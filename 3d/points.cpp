@@ -53,6 +53,61 @@ uint8_t g3_rotate_point(g3s_point* dest, vms_vector* src)
 
 }
 
+//rotates a batch of points. dest[pointnums[i]] gets src[pointnums[i]], for each of the n entries
+void g3_rotate_point_list(g3s_point* dest, vms_vector* src, short* pointnums, int n)
+{
+	vms_vector tempv;
+	g3s_point* pnt;
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		pnt = &dest[pointnums[i]];
+
+		vm_vec_sub(&tempv, &src[pointnums[i]], &View_position);
+		vm_vec_rotate(&pnt->p3_vec, &tempv, &View_matrix);
+		pnt->p3_flags = 0;
+		g3_code_point(pnt);
+	}
+}
+
+//codes a sphere. a bit is only set if the whole sphere is past that plane.
+//if near_z isn't NULL, it gets the closest the sphere can be in depth
+uint8_t g3_code_sphere(vms_vector* pos, fix rad, fix* near_z)
+{
+	g3s_point pnt;
+	fix rx, ry, rz;
+	uint8_t cc = 0;
+
+	g3_rotate_point(&pnt, pos);
+
+	//The view matrix is scaled, so the sphere's extent differs per axis.
+	//Comparing the boxes around it keeps the test conservative.
+	rx = fixmul(rad, Matrix_scale.x);
+	ry = fixmul(rad, Matrix_scale.y);
+	rz = fixmul(rad, Matrix_scale.z);
+
+	if (pnt.p3_x - rx > pnt.p3_z + rz)
+		cc |= CC_OFF_RIGHT;
+
+	if (pnt.p3_y - ry > pnt.p3_z + rz)
+		cc |= CC_OFF_TOP;
+
+	if (pnt.p3_x + rx < -(pnt.p3_z + rz))
+		cc |= CC_OFF_LEFT;
+
+	if (pnt.p3_y + ry < -(pnt.p3_z + rz))
+		cc |= CC_OFF_BOT;
+
+	if (pnt.p3_z + rz <= 0)
+		cc |= CC_BEHIND;
+
+	if (near_z)
+		*near_z = pnt.p3_z - rz;
+
+	return cc;
+}
+
 //checks for overflow & divides if ok, fillig in r
 //returns true if div is ok, else false
 int checkmuldiv(fix* r, fix a, fix b, fix c)
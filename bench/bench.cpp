@@ -0,0 +1,1048 @@
+/*
+The code contained in this file is not the property of Parallax Software,
+and is not under the terms of the Parallax Software Source license.
+Instead, it is released under the terms of the MIT License,
+as described in copying.txt
+*/
+
+//Micro-benchmarks for the engine's inner loops.
+//Everything runs on synthetic data, so no game files are needed. Results are printed as
+//CSV, one line per benchmark: name,ns_per_op,iterations
+//
+//Usage: bench [-time <ms>] [-verify] [name filter...]
+//  -time    how long to run each benchmark for, default 200 ms
+//  -verify  instead of timing anything, check that vecmat gives the same results as the
+//           original out-of-line versions, that the batch versions match the single ones,
+//           that the palette's closest color lookups match searching the whole palette, and
+//           that the object sort puts objects in the same order as qsort.
+//           Exits with 1 if anything differs.
+//  Benchmarks whose name contains any of the filters are run, all of them if there's none.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include "fix/fix.h"
+#include "vecmat/vecmat.h"
+#include "3d/3d.h"
+#include "3d/globvars.h"
+#include "3d/objsort.h"
+#include "2d/gr.h"
+#include "2d/rle.h"
+#include "2d/palette.h"
+#include "texmap/texmap.h"
+#include "texmap/texmapl.h"
+#include "texmap/scanline.h"
+#include "mve/decoders.h"
+#include "cfile/cfile.h"
+
+extern uint8_t* dest_row_data;
+extern int loop_count;
+extern void fill_divide_table();
+
+//Sizes of the synthetic data sets. Each op of a benchmark covers one element of one of these.
+#define NUM_VECTORS 1024
+#define SCANLINE_WIDTH 320
+#define RLE_WIDTH 64
+#define RLE_ROWS 64
+#define MVE_WIDTH 320
+#define MVE_HEIGHT 200
+#define CFILE_SIZE (1024 * 1024)
+#define CFILE_BLOCK 4096
+#define NUM_SORT_ITEMS 400
+#define SORT_SEGMENT_ITEMS 8
+
+static volatile int Bench_sink;	//results go here so they aren't optimized away
+
+typedef struct bench_data
+{
+	std::vector<fix> fixes;
+	std::vector<vms_vector> vectors;
+	std::vector<g3s_point> points;
+	vms_matrix matrix;
+	std::vector<uint8_t> texture, scanline;
+	std::vector<uint8_t> rle_data, rle_dest;
+	std::vector<int> rle_offsets;
+	std::vector<uint8_t> mve_frames, mve_map, mve_data;
+	char cfile_name[64];
+	grs_font font;
+	std::vector<uint8_t> font_data;
+	int font_color;
+	grs_canvas* canvas;
+	std::vector<sort_item> sort_items, sort_work;
+} bench_data;
+
+static bench_data Data;
+
+//A benchmark runs its kernel over the data once per call and returns how many ops that was.
+typedef struct bench
+{
+	const char* name;
+	int (*run)();
+} bench;
+
+static uint32_t bench_rand_state = 1;
+
+static uint32_t bench_rand()
+{
+	bench_rand_state = bench_rand_state * 1103515245 + 12345;
+	return bench_rand_state >> 8;
+}
+
+static fix bench_rand_fix(fix range)
+{
+	return (fix)(bench_rand() % (uint32_t)(range * 2)) - range;
+}
+
+//-----------------------------------------------------------------------------
+// fix
+
+static int bench_fixmul()
+{
+	fix sum = 0;
+	for (int i = 0; i < NUM_VECTORS - 1; i++)
+		sum += fixmul(Data.fixes[i], Data.fixes[i + 1]);
+	Bench_sink = sum;
+	return NUM_VECTORS - 1;
+}
+
+static int bench_fixdiv()
+{
+	fix sum = 0;
+	for (int i = 0; i < NUM_VECTORS - 1; i++)
+		sum += fixdiv(Data.fixes[i], Data.fixes[i + 1] | 1);
+	Bench_sink = sum;
+	return NUM_VECTORS - 1;
+}
+
+static int bench_fix_sqrt()
+{
+	fix sum = 0;
+	for (int i = 0; i < NUM_VECTORS; i++)
+		sum += fix_sqrt(abs(Data.fixes[i]));
+	Bench_sink = sum;
+	return NUM_VECTORS;
+}
+
+//-----------------------------------------------------------------------------
+// vecmat
+
+static int bench_vm_vec_add()
+{
+	vms_vector dest;
+	fix sum = 0;
+	for (int i = 0; i < NUM_VECTORS - 1; i++)
+	{
+		vm_vec_add(&dest, &Data.vectors[i], &Data.vectors[i + 1]);
+		sum += dest.x ^ dest.y ^ dest.z;
+	}
+	Bench_sink = sum;
+	return NUM_VECTORS - 1;
+}
+
+static int bench_vm_vec_dotprod()
+{
+	fix sum = 0;
+	for (int i = 0; i < NUM_VECTORS - 1; i++)
+		sum += vm_vec_dotprod(&Data.vectors[i], &Data.vectors[i + 1]);
+	Bench_sink = sum;
+	return NUM_VECTORS - 1;
+}
+
+static int bench_vm_vec_crossprod()
+{
+	vms_vector dest;
+	fix sum = 0;
+	for (int i = 0; i < NUM_VECTORS - 1; i++)
+	{
+		vm_vec_crossprod(&dest, &Data.vectors[i], &Data.vectors[i + 1]);
+		sum += dest.x ^ dest.y ^ dest.z;
+	}
+	Bench_sink = sum;
+	return NUM_VECTORS - 1;
+}
+
+static int bench_vm_vec_mag()
+{
+	fix sum = 0;
+	for (int i = 0; i < NUM_VECTORS; i++)
+		sum += vm_vec_mag(&Data.vectors[i]);
+	Bench_sink = sum;
+	return NUM_VECTORS;
+}
+
+static int bench_vm_vec_mag_quick()
+{
+	fix sum = 0;
+	for (int i = 0; i < NUM_VECTORS; i++)
+		sum += vm_vec_mag_quick(&Data.vectors[i]);
+	Bench_sink = sum;
+	return NUM_VECTORS;
+}
+
+static int bench_vm_vec_dist()
+{
+	fix sum = 0;
+	for (int i = 0; i < NUM_VECTORS - 1; i++)
+		sum += vm_vec_dist(&Data.vectors[i], &Data.vectors[i + 1]);
+	Bench_sink = sum;
+	return NUM_VECTORS - 1;
+}
+
+static int bench_vm_vec_normalize()
+{
+	vms_vector dest;
+	fix sum = 0;
+	for (int i = 0; i < NUM_VECTORS; i++)
+		sum += vm_vec_copy_normalize(&dest, &Data.vectors[i]);
+	Bench_sink = sum;
+	return NUM_VECTORS;
+}
+
+static int bench_vm_vec_normalize_quick()
+{
+	vms_vector dest;
+	fix sum = 0;
+	for (int i = 0; i < NUM_VECTORS; i++)
+		sum += vm_vec_copy_normalize_quick(&dest, &Data.vectors[i]);
+	Bench_sink = sum;
+	return NUM_VECTORS;
+}
+
+static int bench_vm_vec_rotate()
+{
+	vms_vector dest;
+	fix sum = 0;
+	for (int i = 0; i < NUM_VECTORS; i++)
+	{
+		vm_vec_rotate(&dest, &Data.vectors[i], &Data.matrix);
+		sum += dest.x ^ dest.y ^ dest.z;
+	}
+	Bench_sink = sum;
+	return NUM_VECTORS;
+}
+
+static int bench_vm_vec_rotate_n()
+{
+	static vms_vector dest[NUM_VECTORS];
+	vm_vec_rotate_n(dest, Data.vectors.data(), NUM_VECTORS, &Data.matrix);
+	Bench_sink = dest[NUM_VECTORS / 2].z;
+	return NUM_VECTORS;
+}
+
+static int bench_vm_vec_dot_n()
+{
+	static fix dest[NUM_VECTORS];
+	vm_vec_dot_n(dest, Data.vectors.data(), NUM_VECTORS, &Data.matrix.fvec);
+	Bench_sink = dest[NUM_VECTORS / 2];
+	return NUM_VECTORS;
+}
+
+static int bench_vm_vec_dist_n()
+{
+	static fix dest[NUM_VECTORS];
+	vm_vec_dist_n(dest, Data.vectors.data(), NUM_VECTORS, &Data.vectors[0]);
+	Bench_sink = dest[NUM_VECTORS / 2];
+	return NUM_VECTORS;
+}
+
+static int bench_vm_matrix_x_matrix()
+{
+	vms_matrix dest;
+	vm_matrix_x_matrix(&dest, &Data.matrix, &View_matrix);
+	Bench_sink = dest.fvec.z;
+	return 1;
+}
+
+//-----------------------------------------------------------------------------
+// 3d
+
+static int bench_g3_rotate_point()
+{
+	int codes = 0;
+	for (int i = 0; i < NUM_VECTORS; i++)
+		codes += g3_rotate_point(&Data.points[i], &Data.vectors[i]);
+	Bench_sink = codes;
+	return NUM_VECTORS;
+}
+
+static int bench_g3_project_point()
+{
+	int flags = 0;
+	for (int i = 0; i < NUM_VECTORS; i++)
+	{
+		Data.points[i].p3_flags &= ~PF_PROJECTED;
+		g3_project_point(&Data.points[i]);
+		flags += Data.points[i].p3_flags;
+	}
+	Bench_sink = flags;
+	return NUM_VECTORS;
+}
+
+//-----------------------------------------------------------------------------
+// Texture mapper inner loops. One op is one pixel.
+
+static void setup_scanline(int perspective)
+{
+	pixptr = Data.texture.data();
+	dest_row_data = Data.scanline.data();
+	loop_count = SCANLINE_WIDTH - 1;
+	fx_u = F1_0 * 3;
+	fx_v = F1_0 * 7;
+	fx_du_dx = F1_0 / 5;
+	fx_dv_dx = F1_0 / 9;
+	fx_l = F1_0 * 20;
+	fx_dl_dx = -F1_0 / 32;
+	fx_z = perspective ? F1_0 * 10 : F1_0;
+	fx_dz_dx = perspective ? F1_0 / 64 : 0;
+	if (perspective)
+	{
+		//the perspective loops expect u and v premultiplied by z
+		fx_u = fixmul(fx_u, fx_z);
+		fx_v = fixmul(fx_v, fx_z);
+		fx_du_dx = fixmul(fx_du_dx, fx_z);
+		fx_dv_dx = fixmul(fx_dv_dx, fx_z);
+	}
+	tmap_flat_color = 17;
+	tmap_flat_shade_value = 12;
+}
+
+#define SCANLINE_BENCH(kernel, perspective) \
+static int bench_##kernel() \
+{ \
+	setup_scanline(perspective); \
+	kernel(); \
+	Bench_sink = Data.scanline[SCANLINE_WIDTH / 2]; \
+	return SCANLINE_WIDTH; \
+}
+
+SCANLINE_BENCH(c_tmap_scanline_flat, 0)
+SCANLINE_BENCH(c_tmap_scanline_shaded, 0)
+SCANLINE_BENCH(c_tmap_scanline_lin_nolight, 0)
+SCANLINE_BENCH(c_tmap_scanline_lin, 0)
+SCANLINE_BENCH(c_tmap_scanline_per_nolight, 1)
+SCANLINE_BENCH(c_tmap_scanline_per, 1)
+SCANLINE_BENCH(c_tmap_scanline_pln_nolight, 1)
+SCANLINE_BENCH(c_tmap_scanline_pln, 1)
+
+//-----------------------------------------------------------------------------
+// Strings in a synthetic 8x10 font over a transparent background, like the HUD draws them.
+// One op is one string.
+
+extern int gr_string_cache_enabled;
+
+static const char* Bench_strings[] = { "ENERGY: 100", "SHIELD: 87", "SCORE:  12345", "burn: 75%", "LASER LVL: 4" };
+#define NUM_BENCH_STRINGS (int)(sizeof(Bench_strings) / sizeof(Bench_strings[0]))
+
+static int bench_gr_string_common(int cached)
+{
+	gr_string_cache_enabled = cached;
+	gr_set_current_canvas(Data.canvas);
+	gr_set_curfont(&Data.font);
+	gr_set_fontcolor(Data.font_color, -1);
+	for (int i = 0; i < NUM_BENCH_STRINGS; i++)
+		gr_string(2 + i * 3, 4 + i * 12, Bench_strings[i]);
+	gr_string_cache_enabled = 1;
+	Bench_sink = Data.canvas->cv_bitmap.bm_data[8 * 320 + 10];
+	return NUM_BENCH_STRINGS;
+}
+
+static int bench_gr_string()
+{
+	return bench_gr_string_common(1);
+}
+
+static int bench_gr_string_uncached()
+{
+	return bench_gr_string_common(0);
+}
+
+//-----------------------------------------------------------------------------
+// RLE. One op is one decoded scanline.
+
+static int bench_gr_rle_decode()
+{
+	for (int i = 0; i < RLE_ROWS; i++)
+		gr_rle_decode(&Data.rle_data[Data.rle_offsets[i]], &Data.rle_dest[i * RLE_WIDTH]);
+	Bench_sink = Data.rle_dest[RLE_WIDTH + 1];
+	return RLE_ROWS;
+}
+
+//-----------------------------------------------------------------------------
+// MVE. One op is one decoded 8x8 block.
+
+static int bench_decodeFrame8()
+{
+	decodeFrame8((unsigned char*)g_vBackBuf1, Data.mve_map.data(), Data.mve_map.size(), Data.mve_data.data(), Data.mve_data.size());
+	Bench_sink = ((uint8_t*)g_vBackBuf1)[MVE_WIDTH * 4 + 4];
+	return (MVE_WIDTH / 8) * (MVE_HEIGHT / 8);
+}
+
+//-----------------------------------------------------------------------------
+// cfile. One op is one call.
+
+static int bench_cfread_block()
+{
+	CFILE* fp = cfopen(Data.cfile_name, "rb");
+	std::vector<uint8_t> block(CFILE_BLOCK);
+	int ops = 0;
+
+	if (!fp)
+		return 0;
+	while (cfread(block.data(), 1, CFILE_BLOCK, fp) == CFILE_BLOCK)
+		ops++;
+	cfclose(fp);
+	Bench_sink = block[0];
+	return ops;
+}
+
+static int bench_cfile_read_int()
+{
+	CFILE* fp = cfopen(Data.cfile_name, "rb");
+	int sum = 0;
+
+	if (!fp)
+		return 0;
+	for (int i = 0; i < CFILE_SIZE / 4; i++)
+		sum += cfile_read_int(fp);
+	cfclose(fp);
+	Bench_sink = sum;
+	return CFILE_SIZE / 4;
+}
+
+//-----------------------------------------------------------------------------
+// Object depth sort, the insertion sort the renderer uses against qsort, which it used before.
+// The _8 versions sort the objects in lists of 8, about as many as a busy segment has.
+// One op is one object.
+
+//Like sort_item_compare, but objects that compare the same go in the order they were added,
+//so qsort gives the same order as the insertion sort when the comparison is consistent.
+static int sort_item_qsort_compare(const void* a, const void* b)
+{
+	const sort_item* item_a = (const sort_item*)a;
+	const sort_item* item_b = (const sort_item*)b;
+	fix delta = sort_item_compare(item_a, item_b);
+
+	if (delta == 0)
+		return item_a->objnum - item_b->objnum;
+	return delta < 0 ? -1 : 1;
+}
+
+static void sort_items_insertion(sort_item* list, int n, int list_size)
+{
+	for (int i = 0; i < n; i += list_size)
+		sort_objects(&list[i], std::min(list_size, n - i));
+}
+
+static void sort_items_qsort(sort_item* list, int n, int list_size)
+{
+	for (int i = 0; i < n; i += list_size)
+		qsort(&list[i], std::min(list_size, n - i), sizeof(sort_item), sort_item_qsort_compare);
+}
+
+static int bench_sort_common(void (*sort)(sort_item* list, int n, int list_size), int list_size)
+{
+	Data.sort_work = Data.sort_items;
+	sort(Data.sort_work.data(), NUM_SORT_ITEMS, list_size);
+	Bench_sink = Data.sort_work[0].objnum;
+	return NUM_SORT_ITEMS;
+}
+
+static int bench_sort_objects() { return bench_sort_common(sort_items_insertion, NUM_SORT_ITEMS); }
+static int bench_sort_objects_qsort() { return bench_sort_common(sort_items_qsort, NUM_SORT_ITEMS); }
+static int bench_sort_objects_8() { return bench_sort_common(sort_items_insertion, SORT_SEGMENT_ITEMS); }
+static int bench_sort_objects_qsort_8() { return bench_sort_common(sort_items_qsort, SORT_SEGMENT_ITEMS); }
+
+//Objects scattered around the eye, a fifth of them weapons and a few afterburner blobs.
+static void make_sort_items(std::vector<sort_item>& items, int n)
+{
+	vms_vector eye = { 0, 0, 0 }, pos;
+
+	items.resize(n);
+	for (int i = 0; i < n; i++)
+	{
+		uint32_t kind = bench_rand() % 20;
+
+		vm_vec_make(&pos, bench_rand_fix(F1_0 * 200), bench_rand_fix(F1_0 * 200), bench_rand_fix(F1_0 * 200));
+		sort_item_set(&items[i], i, &pos, &eye, F1_0 + bench_rand() % (F1_0 * 4), kind < 5, kind < 4);
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+static bench Benches[] =
+{
+	{ "fixmul", bench_fixmul },
+	{ "fixdiv", bench_fixdiv },
+	{ "fix_sqrt", bench_fix_sqrt },
+	{ "vm_vec_add", bench_vm_vec_add },
+	{ "vm_vec_dotprod", bench_vm_vec_dotprod },
+	{ "vm_vec_crossprod", bench_vm_vec_crossprod },
+	{ "vm_vec_mag", bench_vm_vec_mag },
+	{ "vm_vec_mag_quick", bench_vm_vec_mag_quick },
+	{ "vm_vec_dist", bench_vm_vec_dist },
+	{ "vm_vec_normalize", bench_vm_vec_normalize },
+	{ "vm_vec_normalize_quick", bench_vm_vec_normalize_quick },
+	{ "vm_vec_rotate", bench_vm_vec_rotate },
+	{ "vm_vec_rotate_n", bench_vm_vec_rotate_n },
+	{ "vm_vec_dot_n", bench_vm_vec_dot_n },
+	{ "vm_vec_dist_n", bench_vm_vec_dist_n },
+	{ "vm_matrix_x_matrix", bench_vm_matrix_x_matrix },
+	{ "g3_rotate_point", bench_g3_rotate_point },
+	{ "g3_project_point", bench_g3_project_point },
+	{ "c_tmap_scanline_flat", bench_c_tmap_scanline_flat },
+	{ "c_tmap_scanline_shaded", bench_c_tmap_scanline_shaded },
+	{ "c_tmap_scanline_lin_nolight", bench_c_tmap_scanline_lin_nolight },
+	{ "c_tmap_scanline_lin", bench_c_tmap_scanline_lin },
+	{ "c_tmap_scanline_per_nolight", bench_c_tmap_scanline_per_nolight },
+	{ "c_tmap_scanline_per", bench_c_tmap_scanline_per },
+	{ "c_tmap_scanline_pln_nolight", bench_c_tmap_scanline_pln_nolight },
+	{ "c_tmap_scanline_pln", bench_c_tmap_scanline_pln },
+	{ "gr_string", bench_gr_string },
+	{ "gr_string_uncached", bench_gr_string_uncached },
+	{ "gr_rle_decode", bench_gr_rle_decode },
+	{ "decodeFrame8", bench_decodeFrame8 },
+	{ "cfread_4k", bench_cfread_block },
+	{ "cfile_read_int", bench_cfile_read_int },
+	{ "sort_objects", bench_sort_objects },
+	{ "sort_objects_qsort", bench_sort_objects_qsort },
+	{ "sort_objects_8", bench_sort_objects_8 },
+	{ "sort_objects_qsort_8", bench_sort_objects_qsort_8 },
+};
+
+//-----------------------------------------------------------------------------
+// -verify. The ref_ functions are the vecmat code from before it moved into the header.
+
+static fix ref_dot(const vms_vector* v0, const vms_vector* v1)
+{
+	int64_t q = 0;
+
+	fixmulaccum(&q, v0->x, v1->x);
+	fixmulaccum(&q, v0->y, v1->y);
+	fixmulaccum(&q, v0->z, v1->z);
+
+	return fixquadadjust(q);
+}
+
+static fix ref_dot3(fix x, fix y, fix z, const vms_vector* v)
+{
+	vms_vector t = { x, y, z };
+	return ref_dot(&t, v);
+}
+
+static fix ref_mag(const vms_vector* v)
+{
+	int64_t q = 0;
+
+	fixmulaccum(&q, v->x, v->x);
+	fixmulaccum(&q, v->y, v->y);
+	fixmulaccum(&q, v->z, v->z);
+
+	return quad_sqrt(q);
+}
+
+static fix ref_dist(const vms_vector* v0, const vms_vector* v1)
+{
+	vms_vector t = { v0->x - v1->x, v0->y - v1->y, v0->z - v1->z };
+	return ref_mag(&t);
+}
+
+static fix ref_mag_quick(const vms_vector* v)
+{
+	fix a, b, c, bc;
+
+	a = labs(v->x);
+	b = labs(v->y);
+	c = labs(v->z);
+
+	if (a < b) {
+		fix t = a; a = b; b = t;
+	}
+
+	if (b < c) {
+		fix t = b; b = c; c = t;
+
+		if (a < b) {
+			fix t = a; a = b; b = t;
+		}
+	}
+
+	bc = (b >> 2) + (c >> 3);
+
+	return a + bc + (bc >> 1);
+}
+
+static void ref_crossprod(vms_vector* dest, const vms_vector* src0, const vms_vector* src1)
+{
+	int64_t q;
+
+	q = 0;
+	fixmulaccum(&q, src0->y, src1->z);
+	fixmulaccum(&q, -src0->z, src1->y);
+	dest->x = fixquadadjust(q);
+
+	q = 0;
+	fixmulaccum(&q, src0->z, src1->x);
+	fixmulaccum(&q, -src0->x, src1->z);
+	dest->y = fixquadadjust(q);
+
+	q = 0;
+	fixmulaccum(&q, src0->x, src1->y);
+	fixmulaccum(&q, -src0->y, src1->x);
+	dest->z = fixquadadjust(q);
+}
+
+static void ref_rotate(vms_vector* dest, const vms_vector* src, const vms_matrix* m)
+{
+	dest->x = ref_dot(src, &m->rvec);
+	dest->y = ref_dot(src, &m->uvec);
+	dest->z = ref_dot(src, &m->fvec);
+}
+
+static void ref_matrix_x_matrix(vms_matrix* dest, const vms_matrix* src0, const vms_matrix* src1)
+{
+	dest->rvec.x = ref_dot3(src0->rvec.x, src0->uvec.x, src0->fvec.x, &src1->rvec);
+	dest->uvec.x = ref_dot3(src0->rvec.x, src0->uvec.x, src0->fvec.x, &src1->uvec);
+	dest->fvec.x = ref_dot3(src0->rvec.x, src0->uvec.x, src0->fvec.x, &src1->fvec);
+
+	dest->rvec.y = ref_dot3(src0->rvec.y, src0->uvec.y, src0->fvec.y, &src1->rvec);
+	dest->uvec.y = ref_dot3(src0->rvec.y, src0->uvec.y, src0->fvec.y, &src1->uvec);
+	dest->fvec.y = ref_dot3(src0->rvec.y, src0->uvec.y, src0->fvec.y, &src1->fvec);
+
+	dest->rvec.z = ref_dot3(src0->rvec.z, src0->uvec.z, src0->fvec.z, &src1->rvec);
+	dest->uvec.z = ref_dot3(src0->rvec.z, src0->uvec.z, src0->fvec.z, &src1->uvec);
+	dest->fvec.z = ref_dot3(src0->rvec.z, src0->uvec.z, src0->fvec.z, &src1->fvec);
+}
+
+static int Verify_failures;
+
+static void verify_fix(const char* what, int i, fix got, fix expected)
+{
+	if (got == expected)
+		return;
+	if (Verify_failures++ < 20)
+		fprintf(stderr, "%s [%d]: got %08x, expected %08x\n", what, i, (unsigned)got, (unsigned)expected);
+}
+
+static void verify_vector(const char* what, int i, const vms_vector& got, const vms_vector& expected)
+{
+	verify_fix(what, i, got.x, expected.x);
+	verify_fix(what, i, got.y, expected.y);
+	verify_fix(what, i, got.z, expected.z);
+}
+
+//Mostly random values over the whole range, which overflow and saturate a lot, with some
+//small ones and the edge cases mixed in.
+static fix verify_rand_fix()
+{
+	static const fix edges[] = { 0, 1, -1, F1_0, -F1_0, 0x7FFFFFFF, (fix)0x80000000, 0x7FFF, 0x8000, -0x8000 };
+	uint32_t r = bench_rand();
+
+	switch (r & 3)
+	{
+	case 0: return edges[(r >> 2) % (sizeof(edges) / sizeof(edges[0]))];
+	case 1: return bench_rand_fix(F1_0 * 200);
+	default: return (fix)((bench_rand() << 16) ^ bench_rand());
+	}
+}
+
+static int verify_vecmat()
+{
+	const int count = 100000;
+	std::vector<vms_vector> a(count), b(count), batch(count);
+	std::vector<fix> fixes(count);
+	vms_matrix m, m2;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		vm_vec_make(&a[i], verify_rand_fix(), verify_rand_fix(), verify_rand_fix());
+		vm_vec_make(&b[i], verify_rand_fix(), verify_rand_fix(), verify_rand_fix());
+		fixes[i] = verify_rand_fix();
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		vms_vector got, expected;
+		vms_matrix* mp = (vms_matrix*)&a[i / 3 * 3];
+
+		verify_fix("vm_vec_dot", i, vm_vec_dot(&a[i], &b[i]), ref_dot(&a[i], &b[i]));
+		verify_fix("vm_vec_mag", i, vm_vec_mag(&a[i]), ref_mag(&a[i]));
+		verify_fix("vm_vec_dist", i, vm_vec_dist(&a[i], &b[i]), ref_dist(&a[i], &b[i]));
+		verify_fix("vm_vec_mag_quick", i, vm_vec_mag_quick(&a[i]), ref_mag_quick(&a[i]));
+
+		vm_vec_crossprod(&got, &a[i], &b[i]);
+		ref_crossprod(&expected, &a[i], &b[i]);
+		verify_vector("vm_vec_crossprod", i, got, expected);
+
+		if (i + 3 <= count)
+		{
+			vm_vec_rotate(&got, &b[i], mp);
+			ref_rotate(&expected, &b[i], mp);
+			verify_vector("vm_vec_rotate", i, got, expected);
+		}
+
+		vm_vec_scale_add(&got, &a[i], &b[i], fixes[i]);
+		expected.x = a[i].x + fixmul(b[i].x, fixes[i]);
+		expected.y = a[i].y + fixmul(b[i].y, fixes[i]);
+		expected.z = a[i].z + fixmul(b[i].z, fixes[i]);
+		verify_vector("vm_vec_scale_add", i, got, expected);
+
+		got = a[i];
+		vm_vec_scale2(&got, fixes[i], b[i].x);
+		expected = a[i];
+		if (b[i].x != 0)
+			vm_vec_make(&expected, fixmuldiv(a[i].x, fixes[i], b[i].x), fixmuldiv(a[i].y, fixes[i], b[i].x), fixmuldiv(a[i].z, fixes[i], b[i].x));
+		verify_vector("vm_vec_scale2", i, got, expected);
+
+		if (i + 4 <= count)
+		{
+			vm_vec_avg4(&got, &a[i], &a[i + 1], &a[i + 2], &a[i + 3]);
+			expected.x = (a[i].x + a[i + 1].x + a[i + 2].x + a[i + 3].x) / 4;
+			expected.y = (a[i].y + a[i + 1].y + a[i + 2].y + a[i + 3].y) / 4;
+			expected.z = (a[i].z + a[i + 1].z + a[i + 2].z + a[i + 3].z) / 4;
+			verify_vector("vm_vec_avg4", i, got, expected);
+		}
+	}
+
+	for (i = 0; i + 6 <= count; i += 6)
+	{
+		ref_matrix_x_matrix(&m, (const vms_matrix*)&a[i], (const vms_matrix*)&a[i + 3]);
+		vm_matrix_x_matrix(&m2, (vms_matrix*)&a[i], (vms_matrix*)&a[i + 3]);
+		verify_vector("vm_matrix_x_matrix", i, m2.rvec, m.rvec);
+		verify_vector("vm_matrix_x_matrix", i, m2.uvec, m.uvec);
+		verify_vector("vm_matrix_x_matrix", i, m2.fvec, m.fvec);
+	}
+
+	//Batches of every length up to 9 at every offset, to cover the leftovers, then the whole array
+	m = *(const vms_matrix*)&b[0];
+	for (int n = 0; n <= 9; n++)
+	{
+		for (int start = 0; start < 4; start++)
+		{
+			int len = n == 9 ? count - start : n;
+
+			vm_vec_rotate_n(batch.data(), &a[start], len, &m);
+			for (i = 0; i < len; i++)
+			{
+				vms_vector expected;
+				ref_rotate(&expected, &a[start + i], &m);
+				verify_vector("vm_vec_rotate_n", start + i, batch[i], expected);
+			}
+
+			vm_vec_dot_n(fixes.data(), &a[start], len, &b[1]);
+			for (i = 0; i < len; i++)
+				verify_fix("vm_vec_dot_n", start + i, fixes[i], ref_dot(&a[start + i], &b[1]));
+
+			vm_vec_dist_n(fixes.data(), &a[start], len, &b[2]);
+			for (i = 0; i < len; i++)
+				verify_fix("vm_vec_dist_n", start + i, fixes[i], ref_dist(&a[start + i], &b[2]));
+		}
+	}
+
+	if (Verify_failures)
+		fprintf(stderr, "vecmat: %d mismatches\n", Verify_failures);
+	else
+		printf("vecmat: all results match\n");
+	return Verify_failures ? 1 : 0;
+}
+
+//The closest color search gr_find_closest_color did before it had inverse color maps.
+static int ref_find_closest_color(const uint8_t* pal, int r, int g, int b)
+{
+	int i, j;
+	int best_value, best_index, value;
+
+	best_value = (r - pal[0]) * (r - pal[0]) + (g - pal[1]) * (g - pal[1]) + (b - pal[2]) * (b - pal[2]);
+	best_index = 0;
+	for (i = 1, j = 3; i < 254 && best_value; i++, j += 3)
+	{
+		value = (r - pal[j]) * (r - pal[j]) + (g - pal[j + 1]) * (g - pal[j + 1]) + (b - pal[j + 2]) * (b - pal[j + 2]);
+		if (value < best_value)
+		{
+			best_value = value;
+			best_index = i;
+		}
+	}
+	return best_index;
+}
+
+static void verify_color(const char* what, int r, int g, int b, int got, int expected)
+{
+	if (got == expected)
+		return;
+	if (Verify_failures++ < 20)
+		fprintf(stderr, "%s(%d, %d, %d): got %d, expected %d\n", what, r, g, b, got, expected);
+}
+
+//Random palettes, half of them with repeated colors so ties have to go to the lowest index, looked up
+//over the whole 6-bit range and a little outside it. gr_palette and the current palette are set to
+//different palettes each time, so a map left over from the last one would show up.
+static int verify_palette()
+{
+	const int num_palettes = 4;
+	uint8_t pal[256 * 3], current_pal[256 * 3];
+	int p, i, r, g, b;
+
+	Verify_failures = 0;
+	for (p = 0; p < num_palettes; p++)
+	{
+		for (i = 0; i < 256 * 3; i++)
+		{
+			pal[i] = bench_rand() % 64;
+			current_pal[i] = bench_rand() % 64;
+		}
+		if (p & 1)
+		{
+			for (i = 0; i < 64; i++)
+			{
+				memcpy(&pal[(bench_rand() % 254) * 3], &pal[(bench_rand() % 254) * 3], 3);
+				memcpy(&current_pal[(bench_rand() % 254) * 3], &current_pal[(bench_rand() % 254) * 3], 3);
+			}
+		}
+		gr_copy_palette(gr_palette, pal, sizeof(pal));
+		gr_palette_load(current_pal);
+
+		for (r = -2; r < 66; r++)
+		{
+			for (g = -2; g < 66; g++)
+			{
+				for (b = -2; b < 66; b++)
+				{
+					verify_color("gr_find_closest_color", r, g, b, gr_find_closest_color(r, g, b), ref_find_closest_color(pal, r, g, b));
+					verify_color("gr_find_closest_color_current", r, g, b, gr_find_closest_color_current(r, g, b), ref_find_closest_color(current_pal, r, g, b));
+				}
+			}
+		}
+	}
+
+	if (Verify_failures)
+		fprintf(stderr, "palette: %d mismatches\n", Verify_failures);
+	else
+		printf("palette: all results match\n");
+	return Verify_failures ? 1 : 0;
+}
+
+//Objects in groups at the same spot, the groups far enough apart that only objects in the same group
+//count as being in the same position. A group mixes weapons that plot on top with other objects, but
+//not afterburner blobs, which make the comparison depend on which object comes first. That keeps the
+//comparison consistent, so qsort has only one right answer, and groups test that ties keep their order.
+static int verify_sort()
+{
+	const int num_lists = 200;
+	std::vector<sort_item> items(NUM_SORT_ITEMS), insertion, qsorted;
+	vms_vector eye = { 0, 0, 0 }, pos;
+	int list, list_size, i, j, group = 0;
+
+	Verify_failures = 0;
+	for (list = 0; list < num_lists; list++)
+	{
+		list_size = (list & 1) ? SORT_SEGMENT_ITEMS : NUM_SORT_ITEMS;
+
+		for (i = 0; i < NUM_SORT_ITEMS; )
+		{
+			int group_size = 1 + bench_rand() % 4;
+			fix dist = F1_0 * 10 * (1 + bench_rand() % 1000);
+
+			vm_vec_make(&pos, dist, 0, 0);
+			group++;
+			for (j = 0; j < group_size && i < NUM_SORT_ITEMS; j++, i++)
+			{
+				int weapon = bench_rand() % 3 == 0;
+				sort_item_set(&items[i], i, &pos, &eye, F1_0 + bench_rand() % (F1_0 * 3), weapon, weapon);
+			}
+		}
+
+		insertion = items;
+		qsorted = items;
+		sort_items_insertion(insertion.data(), NUM_SORT_ITEMS, list_size);
+		sort_items_qsort(qsorted.data(), NUM_SORT_ITEMS, list_size);
+		for (i = 0; i < NUM_SORT_ITEMS; i++)
+		{
+			if (insertion[i].objnum == qsorted[i].objnum)
+				continue;
+			if (Verify_failures++ < 20)
+				fprintf(stderr, "sort_objects list %d [%d]: got object %d, qsort has %d\n", list, i, insertion[i].objnum, qsorted[i].objnum);
+			break;
+		}
+	}
+
+	if (Verify_failures)
+		fprintf(stderr, "sort: %d mismatches\n", Verify_failures);
+	else
+		printf("sort: all results match\n");
+	return Verify_failures ? 1 : 0;
+}
+
+static void init_data()
+{
+	int i;
+	vms_angvec angles = { 0x1000, 0x2345, 0x0f00 };
+
+	Data.fixes.resize(NUM_VECTORS);
+	Data.vectors.resize(NUM_VECTORS);
+	Data.points.resize(NUM_VECTORS);
+	for (i = 0; i < NUM_VECTORS; i++)
+	{
+		Data.fixes[i] = bench_rand_fix(F1_0 * 100);
+		Data.vectors[i].x = bench_rand_fix(F1_0 * 200);
+		Data.vectors[i].y = bench_rand_fix(F1_0 * 200);
+		Data.vectors[i].z = bench_rand_fix(F1_0 * 200);
+	}
+	vm_angles_2_matrix(&Data.matrix, &angles);
+
+	//A view looking down +z from the origin, as g3_set_view_matrix would leave it
+	vm_vec_make(&View_position, 0, 0, 0);
+	vm_angles_2_matrix(&View_matrix, &angles);
+	Unscaled_matrix = View_matrix;
+	vm_vec_make(&Matrix_scale, F1_0, F1_0, F1_0);
+	vm_vec_make(&Window_scale, F1_0, F1_0 * 5 / 6, F1_0);
+	Canv_w2 = i2f(320) / 2;
+	Canv_h2 = i2f(200) / 2;
+
+	//Texture mapper: a 64x64 texture, and fade tables that shade by row
+	Data.texture.resize(64 * 64);
+	for (i = 0; i < 64 * 64; i++)
+		Data.texture[i] = bench_rand() % 254;
+	for (i = 0; i < 256 * 34; i++)
+		gr_fade_table[i] = (i & 255) * (i >> 8) / 34;
+	Data.scanline.resize(SCANLINE_WIDTH);
+	fill_divide_table();
+
+	//Strings: a fixed width font of random bits, drawn onto a 320x200 canvas
+	memset(&Data.font, 0, sizeof(Data.font));
+	Data.font.ft_w = 8;
+	Data.font.ft_h = 10;
+	Data.font.ft_baseline = 8;
+	Data.font.ft_minchar = 32;
+	Data.font.ft_maxchar = 126;
+	Data.font.ft_bytewidth = 1;
+	Data.font_data.resize((126 - 32 + 1) * 10);
+	for (i = 0; i < (int)Data.font_data.size(); i++)
+		Data.font_data[i] = bench_rand() & bench_rand();	//about a quarter of the bits set
+	Data.font.ft_data = Data.font_data.data();
+	Data.font_color = 47;
+	Data.canvas = gr_create_canvas(320, 200);
+
+	make_sort_items(Data.sort_items, NUM_SORT_ITEMS);
+
+	//RLE: a 64x64 bitmap with runs of random length
+	{
+		std::vector<uint8_t> raw(RLE_WIDTH);
+		Data.rle_data.resize(RLE_ROWS * RLE_WIDTH * 2 + 16);
+		Data.rle_dest.resize(RLE_ROWS * RLE_WIDTH + 16);
+		Data.rle_offsets.resize(RLE_ROWS);
+		int offset = 0;
+		for (int row = 0; row < RLE_ROWS; row++)
+		{
+			for (i = 0; i < RLE_WIDTH; )
+			{
+				int run = 1 + bench_rand() % 12;
+				uint8_t color = bench_rand() % 200;
+				for (; run > 0 && i < RLE_WIDTH; run--)
+					raw[i++] = color;
+			}
+			Data.rle_offsets[row] = offset;
+			offset += gr_rle_encode(RLE_WIDTH, raw.data(), &Data.rle_data[offset]);
+		}
+	}
+
+	//MVE: random block opcodes, except the ones that copy from elsewhere in the frame, which would need a real movie to stay in bounds.
+	{
+		static const int opcodes[] = { 0x0, 0x1, 0x7, 0x8, 0x9, 0xa, 0xb, 0xc, 0xd, 0xe, 0xf };
+		int num_blocks = (MVE_WIDTH / 8) * (MVE_HEIGHT / 8);
+
+		g_width = MVE_WIDTH;
+		g_height = MVE_HEIGHT;
+		Data.mve_frames.resize(MVE_WIDTH * MVE_HEIGHT * 2);
+		for (i = 0; i < (int)Data.mve_frames.size(); i++)
+			Data.mve_frames[i] = bench_rand();
+		g_vBackBuf1 = Data.mve_frames.data();
+		g_vBackBuf2 = Data.mve_frames.data() + MVE_WIDTH * MVE_HEIGHT;
+
+		Data.mve_map.resize(num_blocks / 2);
+		for (i = 0; i < num_blocks / 2; i++)
+			Data.mve_map[i] = opcodes[bench_rand() % 11] | (opcodes[bench_rand() % 11] << 4);
+		Data.mve_data.resize(num_blocks * 64);
+		for (i = 0; i < (int)Data.mve_data.size(); i++)
+			Data.mve_data[i] = bench_rand();
+	}
+
+	//cfile: a scratch file in the working directory
+	{
+		FILE* fp;
+		std::vector<uint8_t> contents(CFILE_SIZE);
+
+		snprintf(Data.cfile_name, sizeof(Data.cfile_name), "bench_cfile.tmp");
+		for (i = 0; i < CFILE_SIZE; i++)
+			contents[i] = bench_rand();
+		fp = fopen(Data.cfile_name, "wb");
+		if (fp)
+		{
+			fwrite(contents.data(), 1, CFILE_SIZE, fp);
+			fclose(fp);
+		}
+		else
+			fprintf(stderr, "Can't write %s, the cfile benchmarks will be skipped\n", Data.cfile_name);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int target_ms = 200, num_filters = 0;
+	char** filters = NULL;
+	int i, f;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-time") && i + 1 < argc)
+			target_ms = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-verify"))
+			return verify_vecmat() | verify_palette() | verify_sort();
+		else
+		{
+			filters = &argv[i];
+			num_filters = argc - i;
+			break;
+		}
+	}
+
+	init_data();
+
+	printf("name,ns_per_op,iterations\n");
+	for (i = 0; i < (int)(sizeof(Benches) / sizeof(Benches[0])); i++)
+	{
+		bench* b = &Benches[i];
+		int64_t ops = 0;
+		double elapsed_ns = 0;
+
+		if (num_filters)
+		{
+			for (f = 0; f < num_filters; f++)
+				if (strstr(b->name, filters[f]))
+					break;
+			if (f == num_filters)
+				continue;
+		}
+
+		//Warm up, then run in batches that double in size until the time is used up.
+		if (!b->run())
+			continue;
+		for (int batch = 1; elapsed_ns < target_ms * 1e6; batch *= 2)
+		{
+			auto start = std::chrono::steady_clock::now();
+			for (int j = 0; j < batch; j++)
+				ops += b->run();
+			elapsed_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		printf("%s,%.3f,%lld\n", b->name, elapsed_ns / ops, (long long)ops);
+	}
+
+	remove(Data.cfile_name);
+	return 0;
+}
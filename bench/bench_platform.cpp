@@ -0,0 +1,90 @@
+/*
+The code contained in this file is not the property of Parallax Software,
+and is not under the terms of the Parallax Software Source license.
+Instead, it is released under the terms of the MIT License,
+as described in copying.txt
+*/
+
+//A headless platform for the benchmarks. The engine library calls into these for
+//screen and movie sound output, none of which the benchmarks need.
+
+#include <stdio.h>
+#include "platform/platform.h"
+#include "platform/i_sound.h"
+
+int plat_create_window()
+{
+	return 0;
+}
+
+void plat_close_window()
+{
+}
+
+void plat_display_error(const char* msg)
+{
+	fprintf(stderr, "%s\n", msg);
+}
+
+int plat_check_gr_mode(int mode)
+{
+	return 0;
+}
+
+int plat_set_gr_mode(int mode)
+{
+	return 0;
+}
+
+void plat_write_palette(int start, int end, uint8_t* data)
+{
+}
+
+void plat_blank_palette()
+{
+}
+
+void plat_read_palette(uint8_t* dest)
+{
+}
+
+void plat_wait_for_vbl()
+{
+}
+
+void plat_present_canvas(int sync)
+{
+}
+
+void plat_blit_canvas(grs_canvas* canv)
+{
+}
+
+void plat_do_events()
+{
+}
+
+void mvesnd_init_audio(int format, int samplerate, int stereo)
+{
+}
+
+void mvesnd_queue_audio_buffer(int len, short* data)
+{
+}
+
+void mvesnd_close()
+{
+}
+
+void mvesnd_pause()
+{
+}
+
+void mvesnd_resume()
+{
+}
+
+int64_t mvesnd_get_position()
+{
+	return -1;
+}
@@ -390,12 +390,21 @@ char* cfgets(char* buf, size_t n, CFILE* fp)
 	return  t;
 }
 
+//Bytes read through cfread by each thread, for the startup timeline
+static thread_local int64_t cfile_thread_bytes_read = 0;
+
+int64_t cfile_bytes_read()
+{
+	return cfile_thread_bytes_read;
+}
+
 size_t cfread(void* buf, size_t elsize, size_t nelem, CFILE* fp)
 {
 	int i;
 	if ((int)(fp->raw_position + (elsize * nelem)) > fp->size) return EOF;
 	i = fread(buf, elsize, nelem, fp->file);
 	fp->raw_position += i * elsize;
+	cfile_thread_bytes_read += i * elsize;
 	return i;
 }
 
@@ -40,6 +40,9 @@ char* cfgets(char* buf, size_t n, CFILE* fp);
 
 int cfexist(const char* filename);	// Returns true if file exists on disk (1) or in hog (2).
 
+//Total bytes the calling thread has read with cfread.
+int64_t cfile_bytes_read();
+
 //[ISB] little endian reading functions
 uint8_t cfile_read_byte(CFILE* fp);
 short cfile_read_short(CFILE* fp);
@@ -31,32 +31,6 @@ void fixquadnegate(mQuad* q)
 	q->high = 0 - q->high - (q->low != 0);
 }
 
-//multiply two ints & add 64-bit result to 64-bit sum
-void fixmulaccum(int64_t*q, fix a, fix b)
-{
-	int64_t sum;
-
-	sum = (int64_t)a * (int64_t)b;
-	*q += sum;
-}
-
-//extract a fix from a mQuad product
-
-//parabolicus's version
-fix fixquadadjust(int64_t q)
-{
-	fix v = (fix)(q >> 16);
-	int32_t vh = q >> 48;
-	int signb = vh < 0;
-	int signv = v < 0;
-	if (signb != signv)
-	{
-		v = (fix)0x7FFFFFFF;
-		if (signb) v = -v;
-	}
-	return v;
-}
-
 //divide a mQuad by a fix, returning a fix
 uint32_t ufixdivquadlong(uint32_t nl, uint32_t nh, uint32_t d)
 {
@@ -98,10 +98,26 @@ constexpr fix fixmuldiv(fix a, fix b, fix c)
 }
 
 //multiply two fixes, and add 64-bit product to a mQuad
-void fixmulaccum(int64_t*q, fix a, fix b);
+constexpr void fixmulaccum(int64_t*q, fix a, fix b)
+{
+	*q += (int64_t)a * (int64_t)b;
+}
 
 //extract a fix from a mQuad product
-fix fixquadadjust(int64_t q);
+//parabolicus's version
+constexpr fix fixquadadjust(int64_t q)
+{
+	fix v = (fix)(q >> 16);
+	int32_t vh = q >> 48;
+	int signb = vh < 0;
+	int signv = v < 0;
+	if (signb != signv)
+	{
+		v = (fix)0x7FFFFFFF;
+		if (signb) v = -v;
+	}
+	return v;
+}
 
 //divide a mQuad by a long
 constexpr int32_t fixdivquadlong(int64_t n, uint32_t d)
@@ -524,7 +524,7 @@ int iff_parse_ilbm_pbm(FFILE* ifile, int32_t form_type, iff_bitmap_header* bmhea
 			}
 			else 
 			{
-				MALLOC( bmheader->raw_data, uint8_t, bmheader->w * bmheader->h );
+				MALLOC_TAG( bmheader->raw_data, uint8_t, bmheader->w * bmheader->h, MEM_TAG_BITMAP);
 				if (!bmheader->raw_data)
 					return IFF_NO_MEM;
 			}
@@ -541,7 +541,7 @@ int iff_parse_ilbm_pbm(FFILE* ifile, int32_t form_type, iff_bitmap_header* bmhea
 			bmheader->h = prev_bm->bm_h;
 			bmheader->type = prev_bm->bm_type;
 
-			MALLOC( bmheader->raw_data, uint8_t, bmheader->w * bmheader->h );
+			MALLOC_TAG( bmheader->raw_data, uint8_t, bmheader->w * bmheader->h, MEM_TAG_BITMAP);
 
 			memcpy(bmheader->raw_data, prev_bm->bm_data, bmheader->w * bmheader->h);
 			skip_chunk(ifile, len);
@@ -609,7 +609,7 @@ int convert_ilbm_to_pbm(iff_bitmap_header* bmheader)
 	int bytes_per_row, byteofs;
 	uint8_t checkmask, newbyte, setbit;
 
-	MALLOC( new_data, int8_t, bmheader->w * bmheader->h );
+	MALLOC_TAG( new_data, int8_t, bmheader->w * bmheader->h, MEM_TAG_BITMAP);
 	if (new_data == NULL) return IFF_NO_MEM;
 
 	destptr = new_data;
@@ -660,7 +660,7 @@ int convert_rgb15(grs_bitmap* bm, iff_bitmap_header* bmheader)
 
 	//        if ((new_data = malloc(bm->bm_w * bm->bm_h * 2)) == NULL)
 	//            {ret=IFF_NO_MEM; goto done;}
-	MALLOC(new_data, uint16_t, bm->bm_w * bm->bm_h * 2);
+	MALLOC_TAG(new_data, uint16_t, bm->bm_w * bm->bm_h * 2, MEM_TAG_BITMAP);
 	if (new_data == NULL)
 		return IFF_NO_MEM;
 
@@ -1214,7 +1214,7 @@ int iff_read_animbrush(char* ifilename, grs_bitmap** bm_list, int max_bitmaps, i
 
 			prev_bm = *n_bitmaps > 0 ? bm_list[*n_bitmaps - 1] : NULL;
 
-			MALLOC(bm_list[*n_bitmaps] , grs_bitmap, 1 );
+			MALLOC_TAG(bm_list[*n_bitmaps] , grs_bitmap, 1, MEM_TAG_BITMAP);
 			bm_list[*n_bitmaps]->bm_data = NULL;
 
 			ret = iff_parse_bitmap(&ifile, bm_list[*n_bitmaps], form_type, (int8_t*)(*n_bitmaps > 0 ? NULL : palette), prev_bm);
@@ -1081,7 +1081,7 @@ int newmenu_do3(const char* title, const char* subtitle, int nitems, newmenu_ite
 		// Save the background under the menu...
 		gr_bitmap(0, 0, bg.saved);
 		gr_free_bitmap(bg.saved);
-		mem_free(bg.background);
+		gr_free_sub_bitmap(bg.background);
 	}
 	else 
 	{
@@ -366,7 +366,7 @@ void show_bitmap_frame(void)
 
 		gr_bitmapm(0, 0, bitmap_ptr);
 		grd_curcanv = curcanv_save;
-		mem_free(bitmap_canv);
+		gr_free_sub_canvas(bitmap_canv);
 
 		switch (Animating_bitmap_type) 
 		{
@@ -399,7 +399,7 @@ void show_briefing_bitmap(grs_bitmap* bmp)
 	grd_curcanv = bitmap_canv;
 	gr_bitmapm(0, 0, bmp);
 	grd_curcanv = curcanv_save;
-	mem_free(bitmap_canv);
+	gr_free_sub_canvas(bitmap_canv);
 }
 
 //	-----------------------------------------------------------------------------
@@ -651,7 +651,7 @@ int show_briefing_message(int screen_num, char* message)
 			{
 				if (Robot_canv != NULL)
 				{
-					mem_free(Robot_canv); Robot_canv = NULL;
+					gr_free_sub_canvas(Robot_canv); Robot_canv = NULL;
 				}
 
 				init_spinning_robot();
@@ -663,7 +663,7 @@ int show_briefing_message(int screen_num, char* message)
 				//--grs_bitmap	*bitmap_ptr;
 				if (Robot_canv != NULL)
 				{
-					mem_free(Robot_canv); Robot_canv = NULL;
+					gr_free_sub_canvas(Robot_canv); Robot_canv = NULL;
 				}
 
 				get_message_name(&message, Bitmap_name);
@@ -675,7 +675,7 @@ int show_briefing_message(int screen_num, char* message)
 			{
 				if (Robot_canv != NULL)
 				{
-					mem_free(Robot_canv); Robot_canv = NULL;
+					gr_free_sub_canvas(Robot_canv); Robot_canv = NULL;
 				}
 
 				get_message_name(&message, Bitmap_name);
@@ -692,7 +692,7 @@ int show_briefing_message(int screen_num, char* message)
 
 				if (Robot_canv != NULL)
 				{
-					mem_free(Robot_canv); Robot_canv = NULL;
+					gr_free_sub_canvas(Robot_canv); Robot_canv = NULL;
 				}
 
 				get_message_name(&message, bitmap_name);
@@ -873,7 +873,7 @@ int show_briefing_message(int screen_num, char* message)
 
 	if (Robot_canv != NULL)
 	{
-		mem_free(Robot_canv); Robot_canv = NULL;
+		gr_free_sub_canvas(Robot_canv); Robot_canv = NULL;
 	}
 
 	return rval;
@@ -365,7 +365,7 @@ void do_ai_frame(object* obj)
 	Assert(obj->segnum != -1);
 	Assert(obj->id < N_robot_types);
 
-	obj_ref = objnum ^ FrameCount;
+	obj_ref = objnum ^ Tick_count;
 
 	if (ailp->next_fire > -F1_0 * 8)
 		ailp->next_fire -= FrameTime;
@@ -1095,7 +1095,7 @@ void do_ai_frame(object* obj)
 					; // -- mprintf((0, "Goal is RIGHT\n"));
 			}
 
-			vm_vec_scale(&goal_vector, 2 * (ConsoleObject->size + obj->size + (((objnum * 4 + FrameCount) & 63) << 12)));
+			vm_vec_scale(&goal_vector, 2 * (ConsoleObject->size + obj->size + (((objnum * 4 + Tick_count) & 63) << 12)));
 			vm_vec_add(&goal_point, &ConsoleObject->pos, &goal_vector);
 			make_random_vector(&rand_vec);
 			vm_vec_scale_add2(&goal_point, &rand_vec, F1_0 * 8);
@@ -1472,11 +1472,12 @@ void process_awareness_events(void)
 // ----------------------------------------------------------------------------------
 void set_player_awareness_all(void)
 {
-	int	i;
+	int	i, n;
 
 	process_awareness_events();
 
-	for (i = 0; i <= Highest_object_index; i++)
+	for (n = 0; n < num_objects; n++) {
+		i = free_obj_list[n];
 		if (Objects[i].control_type == CT_AI) {
 			if (New_awareness[Objects[i].segnum] > Ai_local_info[i].player_awareness_type) {
 				Ai_local_info[i].player_awareness_type = New_awareness[Objects[i].segnum];
@@ -1487,6 +1488,7 @@ void set_player_awareness_all(void)
 			if (New_awareness[Objects[i].segnum] > Ai_local_info[i].player_awareness_type)
 				Objects[i].ctype.ai_info.SUB_FLAGS &= ~SUB_FLAGS_CAMERA_AWAKE;
 		}
+	}
 }
 
 #ifndef NDEBUG
@@ -1539,7 +1541,7 @@ void do_ai_frame_all(void)
 
 	if (Ai_last_missile_camera != -1) {
 		//	Clear if supposed misisle camera is not a weapon, or just every so often, just in case.
-		if (((FrameCount & 0x0f) == 0) || (Objects[Ai_last_missile_camera].type != OBJ_WEAPON)) {
+		if (((Tick_count & 0x0f) == 0) || (Objects[Ai_last_missile_camera].type != OBJ_WEAPON)) {
 			int	i;
 
 			Ai_last_missile_camera = -1;
@@ -1579,7 +1581,7 @@ void init_robots_for_level(void)
 
 #include "cfile/cfile.h"
 
-int ai_save_state(FILE* fp)
+int ai_save_state(FILE* fp, int num_saved)
 {
 	/*fwrite(&Ai_initialized, sizeof(int), 1, fp);
 	fwrite(&Overall_agitation, sizeof(int), 1, fp);
@@ -1625,9 +1627,12 @@ int ai_save_state(FILE* fp)
 
 	int i;
 
+	if (num_saved < MAX_OBJECTS_LEGACY)
+		num_saved = MAX_OBJECTS_LEGACY;
+
 	file_write_int(fp, Ai_initialized);
 	file_write_int(fp, Overall_agitation);
-	for (i = 0; i < MAX_OBJECTS; i++)
+	for (i = 0; i < num_saved; i++)
 		P_WriteAILocals(&Ai_local_info[i], fp);
 	for (i = 0; i < MAX_POINT_SEGS; i++)
 		P_WriteSegPoint(&Point_segs[i], fp);
@@ -1682,12 +1687,16 @@ int ai_save_state(FILE* fp)
 	return 1;
 }
 
-int ai_restore_state(FILE* fp, int version)
+int ai_restore_state(FILE* fp, int version, int num_saved)
 {
 	int i;
+
+	if (num_saved < MAX_OBJECTS_LEGACY)
+		num_saved = MAX_OBJECTS_LEGACY;
+
 	Ai_initialized = file_read_int(fp);
 	Overall_agitation = file_read_int(fp);
-	for (i = 0; i < MAX_OBJECTS; i++)
+	for (i = 0; i < num_saved; i++)
 		P_ReadAILocals(&Ai_local_info[i], fp);
 	for (i = 0; i < MAX_POINT_SEGS; i++)
 		P_ReadSegPoint(&Point_segs[i], fp);
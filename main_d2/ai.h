@@ -320,8 +320,10 @@ extern void init_thief_for_level();
 
 extern int Escort_goal_object;
 
-extern int ai_save_state( FILE * fp );
-extern int ai_restore_state( FILE * fp, int version );
+//num_saved is the number of objects in the savegame. Up to MAX_OBJECTS_LEGACY, the AI info is laid out as it always was.
+//Only saves from version 23 on have more.
+extern int ai_save_state( FILE * fp, int num_saved );
+extern int ai_restore_state( FILE * fp, int version, int num_saved );
 
 extern int	Buddy_objnum, Buddy_allowed_to_talk;
 
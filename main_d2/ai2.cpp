@@ -1188,7 +1188,7 @@ void move_around_player(object *objp, vms_vector *vec_to_player, int fast_flag)
 			count++;
 		}
 
-	dir = (FrameCount + (count+1) * (objnum*8 + objnum*4 + objnum)) & dir_change;
+	dir = (Tick_count + (count+1) * (objnum*8 + objnum*4 + objnum)) & dir_change;
 	dir >>= (4+count);
 
 	Assert((dir >= 0) && (dir <= 3));
@@ -1268,7 +1268,7 @@ void move_away_from_player(object *objp, vms_vector *vec_to_player, int attack_t
 
 	if (attack_type) {
 		//	Get value in 0..3 to choose evasion direction.
-		objref = ((objp-Objects) ^ ((FrameCount + 3*(objp-Objects)) >> 5)) & 3;
+		objref = ((objp-Objects) ^ ((Tick_count + 3*(objp-Objects)) >> 5)) & 3;
 
 		switch (objref) {
 			case 0:	vm_vec_scale_add2(&pptr->velocity, &objp->orient.uvec, FrameTime << 5);	break;
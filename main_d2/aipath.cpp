@@ -508,10 +508,10 @@ int polish_path(object *objp, point_seg *psegs, int num_points)
 
 	//	Prevent the buddy from polishing his path twice in one frame, which can cause him to get hung up.  Pretty ugly, huh?
 	if (Robot_info[objp->id].companion)
-		if (FrameCount == Last_buddy_polish_path_frame)
+		if (Tick_count == Last_buddy_polish_path_frame)
 			return num_points;
 		else
-			Last_buddy_polish_path_frame = FrameCount;
+			Last_buddy_polish_path_frame = Tick_count;
 
 	// -- MK: 10/18/95: for (i=0; i<num_points-3; i++) {
 	for (i=0; i<2; i++) {
@@ -1087,7 +1087,7 @@ void ai_follow_path(object *objp, int player_visibility, int previous_visibility
 			vm_vec_scale(&objp->mtype.phys_info.velocity, vel_scale);
 
 			return;
-		} else if (!(FrameCount ^ ((objp-Objects) & 0x07))) {		//	Done 1/8 frames.
+		} else if (!(Tick_count ^ ((objp-Objects) & 0x07))) {		//	Done 1/8 frames.
 			//	If player on path (beyond point robot is now at), then create a new path.
 			point_seg	*curpsp = &Point_segs[aip->hide_index];
 			int			player_segnum = ConsoleObject->segnum;
@@ -1380,7 +1380,7 @@ void ai_path_garbage_collect(void)
 
 	// -- mprintf((0, "Garbage collection frame %i, last frame %i!  Old free index = %i ", FrameCount, Last_frame_garbage_collected, Point_segs_free_ptr - Point_segs));
 
-	Last_frame_garbage_collected = FrameCount;
+	Last_frame_garbage_collected = Tick_count;
 
 #if PATH_VALIDATION
 	validate_all_paths();
@@ -1447,7 +1447,7 @@ void ai_path_garbage_collect(void)
 void maybe_ai_path_garbage_collect(void)
 {
 	if (Point_segs_free_ptr - Point_segs > MAX_POINT_SEGS - MAX_PATH_LENGTH) {
-		if (Last_frame_garbage_collected+1 >= FrameCount) {
+		if (Last_frame_garbage_collected+1 >= Tick_count) {
 			//	This is kind of bad.  Garbage collected last frame or this frame.
 			//	Just destroy all paths.  Too bad for the robots.  They are memory wasteful.
 			ai_reset_all_paths();
@@ -1459,11 +1459,11 @@ void maybe_ai_path_garbage_collect(void)
 			mprintf((1, "Free records = %i/%i\n", MAX_POINT_SEGS - (Point_segs_free_ptr - Point_segs), MAX_POINT_SEGS));
 		}
 	} else if (Point_segs_free_ptr - Point_segs > 3*MAX_POINT_SEGS/4) {
-		if (Last_frame_garbage_collected + 16 < FrameCount) {
+		if (Last_frame_garbage_collected + 16 < Tick_count) {
 			ai_path_garbage_collect();
 		}
 	} else if (Point_segs_free_ptr - Point_segs > MAX_POINT_SEGS/2) {
-		if (Last_frame_garbage_collected + 256 < FrameCount) {
+		if (Last_frame_garbage_collected + 256 < Tick_count) {
 			ai_path_garbage_collect();
 		}
 	}
@@ -20,6 +20,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include <string.h>
 #include <math.h>
 #include <algorithm>
+#include <vector>
 
 #include "platform/platform.h"
 //#include "pa_enabl.h"                   //$$POLY_ACC
@@ -79,23 +80,11 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #define EF_NO_FADE		32		// An edge that doesn't fade with distance
 #define EF_TOO_FAR		64		// An edge that is too far away
 
-typedef struct Edge_info {
-	short verts[2];				// 4 bytes
-	uint8_t sides[4];				// 4 bytes
-	short segnum[4];			// 8 bytes	// This might not need to be stored... If you can access the normals of a side.
-	uint8_t flags;				// 1 bytes 	// See the EF_??? defines above.
-	uint8_t color;				// 1 bytes
-	uint8_t num_faces;			// 1 bytes	// 19 bytes...
-} Edge_info;
-
 //OLD BUT GOOD -- #define MAX_EDGES_FROM_VERTS(v)   ((v*5)/2)
 // THE following was determined by John by loading levels 1-14 and recording
 // numbers on 10/26/94. 
 //#define MAX_EDGES_FROM_VERTS(v)   (((v)*21)/10)
 #define MAX_EDGES_FROM_VERTS(v)		((v)*4)
-//#define MAX_EDGES (MAX_EDGES_FROM_VERTS(MAX_VERTICES))
-
-#define MAX_EDGES 6000		// Determined by loading all the levels by John & Mike, Feb 9, 1995
 
 #define	K_WALL_NORMAL_COLOR 			BM_XRGB( 29, 29, 29 )
 #define	K_WALL_DOOR_COLOR				BM_XRGB( 5, 27, 5 )
@@ -141,14 +130,37 @@ void init_automap_colors(void)
 uint8_t Automap_visited[MAX_SEGMENTS];
 
 // Edge list variables
+// Edges are kept in parallel arrays that grow as the level needs, instead of a fixed table of MAX_EDGES.
 static int Num_edges = 0;
-static int Max_edges;		//set each frame
-static int Highest_edge_index = -1;
-static Edge_info Edges[MAX_EDGES];
-static short DrawingListBright[MAX_EDGES];
-
-//static short DrawingListBright[MAX_EDGES];
-//static short Edge_used_list[MAX_EDGES];				//which entries in edge_list have been used
+static std::vector<short> Edge_verts;		//two per edge, lowest first
+static std::vector<uint8_t> Edge_sides;		//four per edge
+static std::vector<short> Edge_segnums;	//four per edge, the first is the segment that owns the edge
+static std::vector<uint8_t> Edge_flags;	//See the EF_??? defines above.
+static std::vector<uint8_t> Edge_color;
+static std::vector<uint8_t> Edge_num_faces;
+
+//Vertex pair to edge number. Open addressed, power of two sized and never more than half full.
+static std::vector<int> Edge_hash;
+
+//The edges that can be drawn, bucketed by the segment that owns them, so whole segments
+//can be culled before any of their edges are looked at. Rebuilt whenever the edge flags change.
+typedef struct automap_seg 
+{
+	vms_vector center;
+	fix rad;
+	int first_edge, num_edges;		//into Draw_edges
+	int first_vert, num_verts;		//into Draw_verts
+} automap_seg;
+
+static std::vector<automap_seg> Draw_segs;
+static std::vector<int> Draw_edges;
+static std::vector<short> Draw_verts;
+static std::vector<int> DrawingListBright;
+
+//Vertices to rotate this frame, and the frame each vertex was last rotated in
+static std::vector<short> Frame_verts;
+static int Vert_rotated[MAX_VERTICES];
+static int Automap_framecount = 0;
 
 // Map movement defines
 #define PITCH_DEFAULT 9000
@@ -723,10 +735,7 @@ void do_automap(int key_code)
 		digi_pause_digi_sounds();
 	}
 
-	Max_edges = std::min(MAX_EDGES_FROM_VERTS(Num_vertices), MAX_EDGES);			//make maybe smaller than max
-
-	mprintf((0, "Num_vertices=%d, Max_edges=%d, (MAX:%d)\n", Num_vertices, Max_edges, MAX_EDGES));
-	mprintf((0, "Allocated %d K for automap edge list\n", (sizeof(Edge_info) + sizeof(short)) * Max_edges / 1024));
+	mprintf((0, "Num_vertices=%d, expecting up to %d edges\n", Num_vertices, MAX_EDGES_FROM_VERTS(Num_vertices)));
 
 	if ((Current_display_mode != 0 && Current_display_mode != 2) || (Automap_always_hires && MenuHiresAvailable)) 
 	{
@@ -1077,101 +1086,186 @@ void do_automap(int key_code)
 		Automap_active = 0;
 }
 
+void automap_build_draw_lists(void);
+
 void adjust_segment_limit(int SegmentLimit)
 {
 	int i, e1;
-	Edge_info* e;
 
 	mprintf((0, "Seglimit: %d\n", SegmentLimit));
 
-	for (i = 0; i <= Highest_edge_index; i++) {
-		e = &Edges[i];
-		e->flags |= EF_TOO_FAR;
-		for (e1 = 0; e1 < e->num_faces; e1++) {
-			if (Automap_visited[e->segnum[e1]] <= SegmentLimit) {
-				e->flags &= (~EF_TOO_FAR);
+	for (i = 0; i < Num_edges; i++) 
+	{
+		Edge_flags[i] |= EF_TOO_FAR;
+		for (e1 = 0; e1 < Edge_num_faces[i]; e1++) 
+		{
+			if (Automap_visited[Edge_segnums[i * 4 + e1]] <= SegmentLimit) 
+			{
+				Edge_flags[i] &= (~EF_TOO_FAR);
 				break;
 			}
 		}
 	}
 
+	automap_build_draw_lists();
+}
+
+//Adds the vertices of a segment's edges to the list to rotate this frame, if they aren't already on it
+static void automap_add_frame_verts(automap_seg* as)
+{
+	int i, v;
+
+	for (i = 0; i < as->num_verts; i++) 
+	{
+		v = Draw_verts[as->first_vert + i];
+		if (Vert_rotated[v] != Automap_framecount) 
+		{
+			Vert_rotated[v] = Automap_framecount;
+			Frame_verts.push_back(v);
+		}
+	}
 }
 
 void draw_all_edges()
 {
-	g3s_codes cc;
-	int i, j, nbright;
-	uint8_t nfacing, nnfacing;
-	Edge_info* e;
+	int i, j, k, s, nbright;
+	uint8_t nfacing, nnfacing, cc;
 	vms_vector* tv1;
 	fix distance;
 	fix min_distance = 0x7fffffff;
 	g3s_point* p1, * p2;
+	automap_seg* as;
+	static std::vector<int> visible_segs, depth_segs;
+	static std::vector<fix> depth_seg_z;
 
+	Automap_framecount++;
+	if (Automap_framecount == 0) //wrap!
+	{
+		memset(Vert_rotated, 0, sizeof(Vert_rotated));
+		Automap_framecount = 1;
+	}
 
-	nbright = 0;
+	Frame_verts.clear();
+	visible_segs.clear();
+	depth_segs.clear();
+	depth_seg_z.clear();
 
-	for (i = 0; i <= Highest_edge_index; i++) 
+	// Cull whole segments before touching their edges. A segment behind the viewer still counts
+	// towards the closest distance, which then ends up clamped to 0 below.
+	for (s = 0; s < (int)Draw_segs.size(); s++) 
 	{
-		//e = &Edges[Edge_used_list[i]];
-		e = &Edges[i];
-		if (!(e->flags & EF_USED)) continue;
+		as = &Draw_segs[s];
+		cc = g3_code_sphere(&as->center, as->rad, &distance);
+		if (!cc) 
+		{
+			visible_segs.push_back(s);
+			automap_add_frame_verts(as);
+		}
+		else if (cc & CC_BEHIND)
+			min_distance = 0;
+		else 
+		{
+			depth_segs.push_back(s);
+			depth_seg_z.push_back(distance);
+		}
+	}
 
-		if (e->flags & EF_TOO_FAR) continue;
+	// Every vertex needed this frame gets rotated exactly once.
+	g3_rotate_point_list(Segment_points, Vertices, Frame_verts.data(), Frame_verts.size());
 
-		if (e->flags & EF_FRONTIER) {						// A line that is between what we have seen and what we haven't
-			if ((!(e->flags & EF_SECRET)) && (e->color == Wall_normal_color))
-				continue;		// If a line isn't secret and is normal color, then don't draw it
-		}
+	for (i = 0; i < (int)visible_segs.size(); i++) 
+	{
+		as = &Draw_segs[visible_segs[i]];
+		for (j = 0; j < as->num_edges; j++) 
+		{
+			int e = Draw_edges[as->first_edge + j];
+			short* verts = &Edge_verts[e * 2];
 
-		cc = rotate_list(2, e->verts);
-		distance = Segment_points[e->verts[1]].p3_z;
+			p1 = &Segment_points[verts[0]];
+			p2 = &Segment_points[verts[1]];
+			distance = p2->p3_z;
 
-		if (min_distance > distance)
-			min_distance = distance;
+			if (min_distance > distance)
+				min_distance = distance;
 
-		if (!cc.high) //all off screen?
-		{
-			nfacing = nnfacing = 0;
-			tv1 = &Vertices[e->verts[0]];
-			j = 0;
-			while (j < e->num_faces && (nfacing == 0 || nnfacing == 0)) {
+			if (!(p1->p3_codes & p2->p3_codes)) //all off screen?
+			{
+				nfacing = nnfacing = 0;
+				tv1 = &Vertices[verts[0]];
+				k = 0;
+				while (k < Edge_num_faces[e] && (nfacing == 0 || nnfacing == 0)) 
+				{
 #ifdef COMPACT_SEGS
-				vms_vector temp_v;
-				get_side_normal(&Segments[e->segnum[j]], e->sides[j], 0, &temp_v);
-				if (!g3_check_normal_facing(tv1, &temp_v))
+					vms_vector temp_v;
+					get_side_normal(&Segments[Edge_segnums[e * 4 + k]], Edge_sides[e * 4 + k], 0, &temp_v);
+					if (!g3_check_normal_facing(tv1, &temp_v))
 #else
-				if (!g3_check_normal_facing(tv1, &Segments[e->segnum[j]].sides[e->sides[j]].normals[0]))
+					if (!g3_check_normal_facing(tv1, &Segments[Edge_segnums[e * 4 + k]].sides[Edge_sides[e * 4 + k]].normals[0]))
 #endif
-					nfacing++;
-				else
-					nnfacing++;
-				j++;
-			}
-
-			if (nfacing && nnfacing) {
-				// a contour line
-				DrawingListBright[nbright++] = e - Edges;
-			}
-			else if (e->flags & (EF_DEFINING | EF_GRATE)) {
-				if (nfacing == 0) {
-					if (e->flags & EF_NO_FADE)
-						gr_setcolor(e->color);
+						nfacing++;
 					else
-						gr_setcolor(gr_fade_table[e->color + 256 * 8]);
-					g3_draw_line(&Segment_points[e->verts[0]], &Segment_points[e->verts[1]]);
+						nnfacing++;
+					k++;
+				}
+
+				if (nfacing && nnfacing) 
+				{
+					// a contour line
+					DrawingListBright.push_back(e);
 				}
-				else {
-					DrawingListBright[nbright++] = e - Edges;
+				else if (Edge_flags[e] & (EF_DEFINING | EF_GRATE)) 
+				{
+					if (nfacing == 0) 
+					{
+						if (Edge_flags[e] & EF_NO_FADE)
+							gr_setcolor(Edge_color[e]);
+						else
+							gr_setcolor(gr_fade_table[Edge_color[e] + 256 * 8]);
+						g3_draw_line(p1, p2);
+					}
+					else 
+					{
+						DrawingListBright.push_back(e);
+					}
 				}
 			}
 		}
 	}
 
+	// Segments off to the side aren't drawn, but their edges can still be the closest ones.
+	// Only look at them if their bounding sphere could beat what was found so far.
+	if (min_distance > 0) 
+	{
+		Frame_verts.clear();
+		for (i = 0; i < (int)depth_segs.size(); i++) 
+		{
+			as = &Draw_segs[depth_segs[i]];
+			if (depth_seg_z[i] < min_distance)
+				automap_add_frame_verts(as);
+			else
+				depth_segs[i] = -1;
+		}
+		g3_rotate_point_list(Segment_points, Vertices, Frame_verts.data(), Frame_verts.size());
+
+		for (i = 0; i < (int)depth_segs.size(); i++) 
+		{
+			if (depth_segs[i] == -1) continue;
+			as = &Draw_segs[depth_segs[i]];
+			for (j = 0; j < as->num_edges; j++) 
+			{
+				distance = Segment_points[Edge_verts[Draw_edges[as->first_edge + j] * 2 + 1]].p3_z;
+				if (min_distance > distance)
+					min_distance = distance;
+			}
+		}
+	}
+
 	///	mprintf( (0, "Min distance=%.2f, ViewDist=%.2f, Delta=%.2f\n", f2fl(min_distance), f2fl(ViewDist), f2fl(min_distance)- f2fl(ViewDist) ));
 
 	if (min_distance < 0) min_distance = 0;
 
+	nbright = DrawingListBright.size();
+
 	// Sort the bright ones using a shell sort
 	{
 		int t;
@@ -1183,8 +1277,8 @@ void draw_all_edges()
 				j = i - incr;
 				while (j >= 0) {
 					// compare element j and j+incr
-					v1 = Edges[DrawingListBright[j]].verts[0];
-					v2 = Edges[DrawingListBright[j + incr]].verts[0];
+					v1 = Edge_verts[DrawingListBright[j] * 2];
+					v2 = Edge_verts[DrawingListBright[j + incr] * 2];
 
 					if (Segment_points[v1].p3_z < Segment_points[v2].p3_z) {
 						// If not in correct order, them swap 'em
@@ -1204,29 +1298,30 @@ void draw_all_edges()
 	// Draw the bright ones
 	for (i = 0; i < nbright; i++) 
 	{
-		int color;
+		int color, e;
 		fix dist;
-		e = &Edges[DrawingListBright[i]];
-		p1 = &Segment_points[e->verts[0]];
-		p2 = &Segment_points[e->verts[1]];
+		e = DrawingListBright[i];
+		p1 = &Segment_points[Edge_verts[e * 2]];
+		p2 = &Segment_points[Edge_verts[e * 2 + 1]];
 		dist = p1->p3_z - min_distance;
 		// Make distance be 1.0 to 0.0, where 0.0 is 10 segments away;
 		if (dist < 0) dist = 0;
 		if (dist >= Automap_farthest_dist) continue;
 
-		if (e->flags & EF_NO_FADE) 
+		if (Edge_flags[e] & EF_NO_FADE) 
 		{
-			gr_setcolor(e->color);
+			gr_setcolor(Edge_color[e]);
 		}
 		else 
 		{
 			dist = F1_0 - fixdiv(dist, Automap_farthest_dist);
 			color = f2i(dist * 31);
-			gr_setcolor(gr_fade_table[e->color + color * 256]);
+			gr_setcolor(gr_fade_table[Edge_color[e] + color * 256]);
 		}
 		g3_draw_line(p1, p2);
 	}
 
+	DrawingListBright.clear();
 }
 
 
@@ -1236,59 +1331,57 @@ void draw_all_edges()
 //
 //==================================================================
 
-
-//finds edge, filling in edge_ptr. if found old edge, returns index, else return -1
-static int automap_find_edge(int v0, int v1, Edge_info** edge_ptr)
+static inline uint32_t automap_edge_hash(int v0, int v1)
 {
-	int32_t vv, evv;
-	short hash, oldhash;
-	int ret, ev0, ev1;
+	return ((uint32_t)v0 * 2654435761u) ^ ((uint32_t)v1 * 40503u);
+}
 
-	vv = (v1 << 16) + v0;
+//(re)allocates the edge hash with room for at least num_edges edges, and puts the existing edges back in
+static void automap_alloc_edge_hash(int num_edges)
+{
+	int i, size = 1024;
+	uint32_t mask, hash;
 
-	oldhash = hash = ((v0 * 5 + v1) % Max_edges);
+	while (size < num_edges * 2)
+		size *= 2;
 
-	ret = -1;
+	Edge_hash.assign(size, -1);
+	mask = size - 1;
 
-	while (ret == -1) {
-		ev0 = (int)(Edges[hash].verts[0]);
-		ev1 = (int)(Edges[hash].verts[1]);
-		evv = (ev1 << 16) + ev0;
-		if (Edges[hash].num_faces == 0) ret = 0;
-		else if (evv == vv) ret = 1;
-		else {
-			if (++hash == Max_edges) hash = 0;
-			if (hash == oldhash) Error("Edge list full!");
-		}
+	for (i = 0; i < Num_edges; i++) 
+	{
+		hash = automap_edge_hash(Edge_verts[i * 2], Edge_verts[i * 2 + 1]) & mask;
+		while (Edge_hash[hash] != -1)
+			hash = (hash + 1) & mask;
+		Edge_hash[hash] = i;
 	}
+}
 
-	*edge_ptr = &Edges[hash];
+//finds edge, filling in the hash slot it is in or would go in. returns edge number, or -1 if not found
+static int automap_find_edge(int v0, int v1, uint32_t* slot)
+{
+	uint32_t mask = Edge_hash.size() - 1;
+	uint32_t hash = automap_edge_hash(v0, v1) & mask;
+	int e;
 
-	if (ret == 0)
-		return -1;
-	else
-		return hash;
+	//the table is never more than half full, so this always ends
+	while ((e = Edge_hash[hash]) != -1) 
+	{
+		if (Edge_verts[e * 2] == v0 && Edge_verts[e * 2 + 1] == v1)
+			break;
+		hash = (hash + 1) & mask;
+	}
 
+	*slot = hash;
+	return e;
 }
 
 
 void add_one_edge(short va, short vb, uint8_t color, uint8_t side, short segnum, int hidden, int grate, int no_fade) {
-	int found;
-	Edge_info* e;
+	int e;
+	uint32_t slot;
 	short tmp;
 
-	if (Num_edges >= Max_edges) 
-	{
-		// GET JOHN! (And tell him that his 
-		// MAX_EDGES_FROM_VERTS formula is hosed.)
-		// If he's not around, save the mine, 
-		// and send him  mail so he can look 
-		// at the mine later. Don't modify it.
-		// This is important if this happens.
-		Int3();		// LOOK ABOVE!!!!!!
-		return;
-	}
-
 	if (va > vb) 
 	{
 		tmp = va;
@@ -1296,21 +1389,25 @@ void add_one_edge(short va, short vb, uint8_t color, uint8_t side, short segnum,
 		vb = tmp;
 	}
 
-	found = automap_find_edge(va, vb, &e);
+	if ((Num_edges + 1) * 2 > (int)Edge_hash.size())
+		automap_alloc_edge_hash((Num_edges + 1) * 2);
+
+	e = automap_find_edge(va, vb, &slot);
 
-	if (found == -1) 
+	if (e == -1) 
 	{
-		e->verts[0] = va;
-		e->verts[1] = vb;
-		e->color = color;
-		e->num_faces = 1;
-		e->flags = EF_USED | EF_DEFINING;			// Assume a normal line
-		e->sides[0] = side;
-		e->segnum[0] = segnum;
-		//Edge_used_list[Num_edges] = e-Edges;
-		if ((e - Edges) > Highest_edge_index)
-			Highest_edge_index = e - Edges;
-		Num_edges++;
+		e = Num_edges++;
+		Edge_hash[slot] = e;
+
+		Edge_verts.push_back(va);
+		Edge_verts.push_back(vb);
+		Edge_color.push_back(color);
+		Edge_num_faces.push_back(1);
+		Edge_flags.push_back(EF_USED | EF_DEFINING);			// Assume a normal line
+		Edge_sides.insert(Edge_sides.end(), 4, 0);
+		Edge_segnums.insert(Edge_segnums.end(), 4, -1);
+		Edge_sides[e * 4] = side;
+		Edge_segnums[e * 4] = segnum;
 	}
 	else 
 	{
@@ -1318,29 +1415,29 @@ void add_one_edge(short va, short vb, uint8_t color, uint8_t side, short segnum,
 
 		if (color != Wall_normal_color)
 			if (color != Wall_revealed_color)
-				e->color = color;
+				Edge_color[e] = color;
 
-		if (e->num_faces < 4) 
+		if (Edge_num_faces[e] < 4) 
 		{
-			e->sides[e->num_faces] = side;
-			e->segnum[e->num_faces] = segnum;
-			e->num_faces++;
+			Edge_sides[e * 4 + Edge_num_faces[e]] = side;
+			Edge_segnums[e * 4 + Edge_num_faces[e]] = segnum;
+			Edge_num_faces[e]++;
 		}
 	}
 
 	if (grate)
-		e->flags |= EF_GRATE;
+		Edge_flags[e] |= EF_GRATE;
 
 	if (hidden)
-		e->flags |= EF_SECRET;		// Mark this as a hidden edge
+		Edge_flags[e] |= EF_SECRET;		// Mark this as a hidden edge
 	if (no_fade)
-		e->flags |= EF_NO_FADE;
+		Edge_flags[e] |= EF_NO_FADE;
 }
 
 void add_one_unknown_edge(short va, short vb) 
 {
-	int found;
-	Edge_info* e;
+	int e;
+	uint32_t slot;
 	short tmp;
 
 	if (va > vb) {
@@ -1349,9 +1446,12 @@ void add_one_unknown_edge(short va, short vb)
 		vb = tmp;
 	}
 
-	found = automap_find_edge(va, vb, &e);
-	if (found != -1)
-		e->flags |= EF_FRONTIER;		// Mark as a border edge
+	if (Edge_hash.empty())
+		return;
+
+	e = automap_find_edge(va, vb, &slot);
+	if (e != -1)
+		Edge_flags[e] |= EF_FRONTIER;		// Mark as a border edge
 }
 
 #ifndef _GAMESEQ_H
@@ -1526,7 +1626,6 @@ void add_unknown_segment_edges(segment* seg)
 void automap_build_edge_list()
 {
 	int	i, e1, e2, s;
-	Edge_info* e;
 
 	Automap_cheat = 0;
 
@@ -1534,13 +1633,14 @@ void automap_build_edge_list()
 		Automap_cheat = 1;		// Damn cheaters...
 
 	// clear edge list
-	for (i = 0; i < Max_edges; i++) 
-	{
-		Edges[i].num_faces = 0;
-		Edges[i].flags = 0;
-	}
 	Num_edges = 0;
-	Highest_edge_index = -1;
+	Edge_verts.clear();
+	Edge_sides.clear();
+	Edge_segnums.clear();
+	Edge_flags.clear();
+	Edge_color.clear();
+	Edge_num_faces.clear();
+	automap_alloc_edge_hash(MAX_EDGES_FROM_VERTS(Num_vertices));
 
 	if (Automap_cheat || (Players[Player_num].flags & PLAYER_FLAGS_MAP_ALL)) 
 	{
@@ -1576,31 +1676,109 @@ void automap_build_edge_list()
 	}
 
 	// Find unnecessary lines (These are lines that don't have to be drawn because they have small curvature)
-	for (i = 0; i <= Highest_edge_index; i++) 
+	for (i = 0; i < Num_edges; i++) 
 	{
-		e = &Edges[i];
-		if (!(e->flags & EF_USED)) continue;
+		short* segnums = &Edge_segnums[i * 4];
+		uint8_t* sides = &Edge_sides[i * 4];
 
-		for (e1 = 0; e1 < e->num_faces; e1++) 
+		for (e1 = 0; e1 < Edge_num_faces[i]; e1++) 
 		{
-			for (e2 = 1; e2 < e->num_faces; e2++) 
+			for (e2 = 1; e2 < Edge_num_faces[i]; e2++) 
 			{
-				if ((e1 != e2) && (e->segnum[e1] != e->segnum[e2]))
+				if ((e1 != e2) && (segnums[e1] != segnums[e2]))
 				{
-					if (vm_vec_dot(&Segments[e->segnum[e1]].sides[e->sides[e1]].normals[0], &Segments[e->segnum[e2]].sides[e->sides[e2]].normals[0]) > (F1_0 - (F1_0 / 10))) 
+					if (vm_vec_dot(&Segments[segnums[e1]].sides[sides[e1]].normals[0], &Segments[segnums[e2]].sides[sides[e2]].normals[0]) > (F1_0 - (F1_0 / 10))) 
 					{
-						e->flags &= (~EF_DEFINING);
+						Edge_flags[i] &= (~EF_DEFINING);
 						break;
 					}
 				}
 			}
-			if (!(e->flags & EF_DEFINING))
+			if (!(Edge_flags[i] & EF_DEFINING))
 				break;
 		}
 	}
 
-	mprintf((0, "Automap used %d / %d edges\n", Num_edges, Max_edges));
+	mprintf((0, "Automap used %d edges, hash size %d\n", Num_edges, (int)Edge_hash.size()));
 
+	automap_build_draw_lists();
+}
+
+static int automap_edge_can_draw(int e)
+{
+	if (Edge_flags[e] & EF_TOO_FAR) 
+		return 0;
+
+	if (Edge_flags[e] & EF_FRONTIER) {					// A line that is between what we have seen and what we haven't
+		if ((!(Edge_flags[e] & EF_SECRET)) && (Edge_color[e] == Wall_normal_color))
+			return 0;		// If a line isn't secret and is normal color, then don't draw it
+	}
+
+	return 1;
+}
+
+//Buckets the edges that can draw by the segment that owns them, and works out a bounding sphere
+//and the vertex list for each segment that has any.
+void automap_build_draw_lists()
+{
+	int i, j, e, segnum, nv;
+	short* verts;
+	static std::vector<int> seg_first, seg_count;
+	automap_seg as;
+
+	seg_count.assign(Highest_segment_index + 2, 0);
+	seg_first.assign(Highest_segment_index + 2, 0);
+
+	for (e = 0; e < Num_edges; e++) 
+		if (automap_edge_can_draw(e))
+			seg_count[Edge_segnums[e * 4]]++;
+
+	for (i = 1; i <= Highest_segment_index + 1; i++)
+		seg_first[i] = seg_first[i - 1] + seg_count[i - 1];
+
+	Draw_edges.resize(seg_first[Highest_segment_index + 1]);
+	for (e = 0; e < Num_edges; e++) 
+		if (automap_edge_can_draw(e))
+			Draw_edges[seg_first[Edge_segnums[e * 4]]++] = e;
+
+	Draw_segs.clear();
+	Draw_verts.clear();
+
+	for (segnum = 0, j = 0; segnum <= Highest_segment_index; segnum++) 
+	{
+		if (seg_count[segnum] == 0) continue;
+
+		as.first_edge = j;
+		as.num_edges = seg_count[segnum];
+		j += seg_count[segnum];
+
+		//an edge's verts are always verts of the segment it came from, so this sphere covers them all
+		compute_segment_center(&as.center, &Segments[segnum]);
+		as.rad = 0;
+		for (i = 0; i < MAX_VERTICES_PER_SEGMENT; i++) 
+		{
+			fix dist = vm_vec_dist(&as.center, &Vertices[Segments[segnum].verts[i]]);
+			if (dist > as.rad)
+				as.rad = dist;
+		}
+
+		as.first_vert = Draw_verts.size();
+		for (i = 0; i < as.num_edges; i++) 
+		{
+			verts = &Edge_verts[Draw_edges[as.first_edge + i] * 2];
+			for (e = 0; e < 2; e++) 
+			{
+				for (nv = as.first_vert; nv < (int)Draw_verts.size(); nv++)
+					if (Draw_verts[nv] == verts[e])
+						break;
+				if (nv == (int)Draw_verts.size())
+					Draw_verts.push_back(verts[e]);
+			}
+		}
+		as.num_verts = Draw_verts.size() - as.first_vert;
+
+		Draw_segs.push_back(as);
+	}
 }
 
 char Marker_input[40];
@@ -32,11 +32,13 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "multi.h"
 #include "wall.h"
 #include "object.h"
+#include "fvi.h"
 #include "robot.h"
 #include "vclip.h"
 #include "fireball.h"
 #include "endlevel.h"
 #include "misc/rand.h"
+#include "state.h"
 
 //@@vms_vector controlcen_gun_points[MAX_CONTROLCEN_GUNS];
 //@@vms_vector controlcen_gun_dirs[MAX_CONTROLCEN_GUNS];
@@ -251,6 +253,8 @@ void do_controlcen_destroyed_stuff(object *objp)
 	if (Current_level_num < 0) 
 	{
 		int	rval;
+
+		state_wait_for_write();		//a save being written could be secret.sgc
 #if defined(CHOCOLATE_USE_LOCALIZED_PATHS)
 		char secretc_full_path[CHOCOLATE_MAX_FILE_PATH_SIZE];
 		get_full_file_path(secretc_full_path, "secret.sgc", CHOCOLATE_SAVE_DIR);
@@ -306,7 +310,7 @@ void do_controlcen_frame(object *obj)
 #endif
 
 	if (!(Control_center_been_hit || Control_center_player_been_seen)) {
-		if (!(FrameCount % 8)) {		//	Do every so often...
+		if (!(Tick_count % 8)) {		//	Do every so often...
 			vms_vector	vec_to_player;
 			fix			dist_to_player;
 			int			i;
@@ -474,6 +478,7 @@ void init_controlcen_for_level(void)
 //			mprintf((0, "Ghosting control center\n"));
 			Objects[cntrlcen_objnum].type = OBJ_GHOST;
 			Objects[cntrlcen_objnum].render_type = RT_NONE;
+			fvi_broadphase_update(cntrlcen_objnum);
 			Control_center_present = 0;
 		}
 	} else {
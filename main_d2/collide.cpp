@@ -446,7 +446,7 @@ int check_volatile_wall(object* obj, int segnum, int sidenum, vms_vector* hitpt)
 	else
 	{
 #ifdef TACTILE
-		if (TactileStick && !(FrameCount & 15))
+		if (TactileStick && !(Tick_count & 15))
 			Tactile_Xvibrate_clear();
 #endif
 
@@ -1574,6 +1574,7 @@ int do_boss_weapon_collision(object* robot, object* weapon, vms_vector* collisio
 					if (weapon->render_type == RT_POLYOBJ) {
 						Objects[new_obj].rtype.pobj_info.model_num = Weapon_info[Objects[new_obj].id].model_num;
 						Objects[new_obj].size = fixdiv(Polygon_models[Objects[new_obj].rtype.pobj_info.model_num].rad, Weapon_info[Objects[new_obj].id].po_len_to_width_ratio);
+						fvi_broadphase_update(new_obj);
 					}
 
 					Objects[new_obj].mtype.phys_info.mass = Weapon_info[weapon->type].mass;
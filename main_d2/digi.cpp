@@ -353,6 +353,7 @@ uint8_t * digi_lock_sound_data( int soundnum )
 		//if ( !i ) Error( "Error locking sound %d\n", soundnum );
 	}
 	digi_sound_locks[soundnum]++;
+	piggy_sound_page_in(soundnum);
 	return GameSounds[soundnum].data;
 }
 
@@ -488,6 +489,7 @@ int digi_start_sound(short soundnum, fix volume, int pan, int looping, int loop_
 	memset( &DigiSampleData, 0, sizeof(sampledata_t));
 
 	//Assert(GameSounds[soundnum].data != -1);
+	piggy_sound_page_in(soundnum);
 	
 	DigiSampleData.angle = pan;
 	DigiSampleData.volume = fixmuldiv(volume, digi_volume, F1_0);
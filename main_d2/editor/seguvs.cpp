@@ -35,6 +35,7 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "main_d2/bm.h"		//	Needed for TmapInfo
 #include "main_shared/effects.h"	//	Needed for effects_bm_num
 #include "main_d2/fvi.h"
+#include "main_d2/lightbake.h"
 
 void cast_all_light_in_mine(int quick_flag);
 
@@ -1153,457 +1154,17 @@ void copy_uvs_seg_to_seg(segment *destseg,segment *srcseg)
 	Segment2s[destseg->segnum].static_light = Segment2s[srcseg->segnum].static_light;
 }
 
-//	_________________________________________________________________________________________________________________________
-//	Maximum distance between a segment containing light to a segment to receive light.
-#define	LIGHT_DISTANCE_THRESHOLD	(F1_0*80)
-fix	Magical_light_constant = (F1_0*16);
-
-// int	Seg0, Seg1;
-
-//int	Bugseg = 27;
-
-typedef struct {
-	int8_t			flag, hit_type;
-	vms_vector	vector;
-} hash_info;
-
-#define	FVI_HASH_SIZE 8
-#define	FVI_HASH_AND_MASK (FVI_HASH_SIZE - 1)
-
-//	Note: This should be malloced.
-//			Also, the vector should not be 12 bytes, you should only care about some smaller portion of it.
-hash_info	fvi_cache[FVI_HASH_SIZE];
-int	Hash_hits=0, Hash_retries=0, Hash_calcs=0;
-int last_delta_light = 0, delta_light_count = 0;
-
-//	-----------------------------------------------------------------------------------------
-//	Set light from a light source.
-//	Light incident on a surface is defined by the light incident at its points.
-//	Light at a point = K * (V . N) / d
-//	where:
-//		K = some magical constant to make everything look good
-//		V = normalized vector from light source to point
-//		N = surface normal at point
-//		d = distance from light source to point
-//	(Note that the above equation can be simplified to K * (VV . N) / d^2 where VV = non-normalized V)
-//	Light intensity emitted from a light source is defined to be cast from four points.
-//	These four points are 1/64 of the way from the corners of the light source to the center
-//	of its segment.  By assuming light is cast from these points, rather than from on the
-//	light surface itself, light will be properly cast on the light surface.  Otherwise, the
-//	vector V would be the null vector.
-//	If quick_light set, then don't use find_vector_intersection
-void cast_light_from_side(segment *segp, int light_side, fix light_intensity, int quick_light)
-{
-	vms_vector	segment_center;
-	int			segnum,sidenum,vertnum, lightnum, start_delta_light;
-	uint8_t varg;
-
-	compute_segment_center(&segment_center, segp);
-
-	//[ISB] add this surface first
-	if (!quick_light)
-	{
-		Delta_lights[last_delta_light].segnum = segp - Segments;
-		Delta_lights[last_delta_light].sidenum = light_side;
-		varg = std::min(light_intensity * 4 / DL_SCALE, 255);
-		for (lightnum = 0; lightnum < 4; lightnum++)
-			Delta_lights[last_delta_light].vert_light[lightnum] = varg;
-
-		last_delta_light++;
-		delta_light_count++;
-		start_delta_light = last_delta_light;
-	}
-
-//mprintf((0, "From [%i %i %7.3f]:  ", segp-Segments, light_side, f2fl(light_intensity)));
-
-	//	Do for four lights, one just inside each corner of side containing light.
-	for (lightnum=0; lightnum<4; lightnum++) 
-	{
-		int			light_vertex_num, i;
-		vms_vector	vector_to_center;
-		vms_vector	light_location;
-		// fix			inverse_segment_magnitude;
-
-		light_vertex_num = segp->verts[Side_to_verts[light_side][lightnum]];
-		light_location = Vertices[light_vertex_num];
-
-
-	//	New way, 5/8/95: Move towards center irrespective of size of segment.
-	vm_vec_sub(&vector_to_center, &segment_center, &light_location);
-	vm_vec_normalize_quick(&vector_to_center);
-	vm_vec_add2(&light_location, &vector_to_center);
-
-// -- Old way, before 5/8/95 --		// -- This way was kind of dumb.  In larger segments, you move LESS towards the center.
-// -- Old way, before 5/8/95 --		//    Main problem, though, is vertices don't illuminate themselves well in oblong segments because the dot product is small.
-// -- Old way, before 5/8/95 --		vm_vec_sub(&vector_to_center, &segment_center, &light_location);
-// -- Old way, before 5/8/95 --		inverse_segment_magnitude = fixdiv(F1_0/5, vm_vec_mag(&vector_to_center));
-// -- Old way, before 5/8/95 --		vm_vec_scale_add(&light_location, &light_location, &vector_to_center, inverse_segment_magnitude);
-
-		for (segnum=0; segnum<=Highest_segment_index; segnum++) 
-		{
-			segment		*rsegp = &Segments[segnum];
-			vms_vector	r_segment_center;
-			fix			dist_to_rseg;
-
-			for (i=0; i<FVI_HASH_SIZE; i++)
-				fvi_cache[i].flag = 0;
-
-			//	efficiency hack (I hope!), for faraway segments, don't check each point.
-			compute_segment_center(&r_segment_center, rsegp);
-			dist_to_rseg = vm_vec_dist_quick(&r_segment_center, &segment_center);
-
-			if (dist_to_rseg <= LIGHT_DISTANCE_THRESHOLD) 
-			{
-				for (sidenum=0; sidenum<MAX_SIDES_PER_SEGMENT; sidenum++) 
-				{
-					if (WALL_IS_DOORWAY(rsegp, sidenum) != 0) 
-					{
-						side			*rsidep = &rsegp->sides[sidenum];
-						vms_vector	*side_normalp = &rsidep->normals[0];	//	kinda stupid? always use vector 0.
-						int delta_light_number = -1, dl_num;
-
-//mprintf((0, "[%i %i], ", rsegp-Segments, sidenum));
-						for (vertnum=0; vertnum<4; vertnum++) 
-						{
-							fix			distance_to_point, light_at_point, light_dot;
-							vms_vector	vert_location, vector_to_light;
-							int			abs_vertnum;
-
-							abs_vertnum = rsegp->verts[Side_to_verts[sidenum][vertnum]];
-							vert_location = Vertices[abs_vertnum];
-							distance_to_point = vm_vec_dist_quick(&vert_location, &light_location);
-							vm_vec_sub(&vector_to_light, &light_location, &vert_location);
-							vm_vec_normalize(&vector_to_light);
-
-							//	Hack: In oblong segments, it's possible to get a very small dot product
-							//	but the light source is very nearby (eg, illuminating light itself!).
-							light_dot = vm_vec_dot(&vector_to_light, side_normalp);
-							if (distance_to_point < F1_0)
-								if (light_dot > 0)
-									light_dot = (light_dot + F1_0)/2;
-
-							if (light_dot > 0) 
-							{
-								light_at_point = fixdiv(fixmul(light_dot, light_dot), distance_to_point);
-								light_at_point = fixmul(light_at_point, Magical_light_constant);
-								if (light_at_point >= 0) 
-								{
-									fvi_info	hit_data;
-									int		hit_type;
-									vms_vector	vert_location_1, r_vector_to_center;
-									fix		inverse_segment_magnitude;
-
-									vm_vec_sub(&r_vector_to_center, &r_segment_center, &vert_location);
-									inverse_segment_magnitude = fixdiv(F1_0/3, vm_vec_mag(&r_vector_to_center));
-									vm_vec_scale_add(&vert_location_1, &vert_location, &r_vector_to_center, inverse_segment_magnitude);
-									vert_location = vert_location_1;
-
-//if ((segp-Segments == 199) && (rsegp-Segments==199))
-//	Int3();
-// Seg0 = segp-Segments;
-// Seg1 = rsegp-Segments;
-									if (!quick_light) 
-									{
-										int hash_value = Side_to_verts[sidenum][vertnum];
-										hash_info	*hashp = &fvi_cache[hash_value];
-										while (1) 
-										{
-											if (hashp->flag) 
-											{
-												if ((hashp->vector.x == vector_to_light.x) && (hashp->vector.y == vector_to_light.y) && (hashp->vector.z == vector_to_light.z)) {
-//mprintf((0, "{CACHE %4x} ", hash_value));
-													hit_type = hashp->hit_type;
-													Hash_hits++;
-													break;
-												} 
-												else 
-												{
-													Int3();	// How is this possible?  Should be no hits!
-													Hash_retries++;
-													hash_value = (hash_value+1) & FVI_HASH_AND_MASK;
-													hashp = &fvi_cache[hash_value];
-												}
-											} 
-											else 
-											{
-//mprintf((0, "\nH:%04x ", hash_value));
-												fvi_query fq;
-
-												Hash_calcs++;
-												hashp->vector = vector_to_light;
-												hashp->flag = 1;
-
-												fq.p0						= &light_location;
-												fq.startseg				= segp-Segments;
-												fq.p1						= &vert_location;
-												fq.rad					= 0;
-												fq.thisobjnum			= -1;
-												fq.ignore_obj_list	= NULL;
-												fq.flags					= 0;
-
-												hit_type = find_vector_intersection(&fq,&hit_data);
-												hashp->hit_type = hit_type;
-												break;
-											}
-										}
-									} 
-									else
-										hit_type = HIT_NONE;
-//mprintf((0, "hit=%i ", hit_type));
-									switch (hit_type)
-									{
-										case HIT_NONE:
-											light_at_point = fixmul(light_at_point, light_intensity);
-											rsidep->uvls[vertnum].l += light_at_point;
-//mprintf((0, "(%5.2f) ", f2fl(light_at_point)));
-											if (rsidep->uvls[vertnum].l > F1_0)
-												rsidep->uvls[vertnum].l = F1_0;
-
-											if (!quick_light)
-											{
-												//Since there's 4 vertices casting light, need to account for each. 
-												//Slow search to find the delta light for this particular light source for the current segnum and sidenum
-												if (delta_light_number == -1)
-												{
-													for (dl_num = start_delta_light; dl_num < last_delta_light; dl_num++)
-													{
-														if (Delta_lights[dl_num].segnum == segnum && Delta_lights[dl_num].sidenum == sidenum)
-														{
-															delta_light_number = dl_num;
-															break;
-														}
-													}
-
-													//If none found, create a new one. 
-													if (delta_light_number == -1)
-													{
-														Delta_lights[last_delta_light].segnum = segnum;
-														Delta_lights[last_delta_light].sidenum = sidenum;
-														memset(Delta_lights[last_delta_light].vert_light, 0, sizeof(Delta_lights[last_delta_light].vert_light));
-														delta_light_number = last_delta_light;
-														last_delta_light++;
-														delta_light_count++;
-													}
-												}
-
-												varg = std::min((Delta_lights[delta_light_number].vert_light[vertnum] + light_at_point / DL_SCALE), 255);
-												Delta_lights[delta_light_number].vert_light[vertnum] = varg;
-											}
-											break;
-										case HIT_WALL:
-											break;
-										case HIT_OBJECT:
-											Int3();	// Hit object, should be ignoring objects!
-											break;
-										case HIT_BAD_P0:
-											Int3();	//	Ugh, this thing again, what happened, what does it mean?
-											break;
-									}
-								}	//	end if (light_at_point...
-							}	// end if (light_dot >...
-						}	//	end for (vertnum=0...
-					}	//	end if (rsegp...
-				}	//	end for (sidenum=0...
-			}	//	end if (dist_to_rseg...
-
-		}	//	end for (segnum=0...
-
-	}	//	end for (lightnum=0...
-
-//mprintf((0, "\n"));
-}
-
-
-//	------------------------------------------------------------------------------------------
-//	Zero all lighting values.
-void calim_zero_light_values(void)
-{
-	int	segnum, sidenum, vertnum;
-
-	for (segnum=0; segnum<=Highest_segment_index; segnum++) 
-	{
-		segment *segp = &Segments[segnum];
-		for (sidenum=0; sidenum<MAX_SIDES_PER_SEGMENT; sidenum++)
-		{
-			side	*sidep = &segp->sides[sidenum];
-			for (vertnum=0; vertnum<4; vertnum++)
-				sidep->uvls[vertnum].l = F1_0/64;	// Put a tiny bit of light here.
-		}
-		Segment2s[segnum].static_light = F1_0/64;
-	}
-
-	memset(Delta_lights, 0, sizeof(Delta_lights));
-}
-
-
-//	------------------------------------------------------------------------------------------
-//	Used in setting average light value in a segment, cast light from a side to the center
-//	of all segments.
-void cast_light_from_side_to_center(segment *segp, int light_side, fix light_intensity, int quick_light)
-{
-	vms_vector	segment_center;
-	int			segnum, lightnum;
-
-	compute_segment_center(&segment_center, segp);
-
-	//	Do for four lights, one just inside each corner of side containing light.
-	for (lightnum=0; lightnum<4; lightnum++) 
-	{
-		int			light_vertex_num;
-		vms_vector	vector_to_center;
-		vms_vector	light_location;
-
-		light_vertex_num = segp->verts[Side_to_verts[light_side][lightnum]];
-		light_location = Vertices[light_vertex_num];
-		vm_vec_sub(&vector_to_center, &segment_center, &light_location);
-		vm_vec_scale_add(&light_location, &light_location, &vector_to_center, F1_0/64);
-
-		for (segnum=0; segnum<=Highest_segment_index; segnum++)
-		{
-			segment		*rsegp = &Segments[segnum];
-			vms_vector	r_segment_center;
-			fix			dist_to_rseg;
-//if ((segp == &Segments[Bugseg]) && (rsegp == &Segments[Bugseg]))
-//	Int3();
-			compute_segment_center(&r_segment_center, rsegp);
-			dist_to_rseg = vm_vec_dist_quick(&r_segment_center, &segment_center);
-
-			if (dist_to_rseg <= LIGHT_DISTANCE_THRESHOLD)
-			{
-				fix	light_at_point;
-				if (dist_to_rseg > F1_0)
-					light_at_point = fixdiv(Magical_light_constant, dist_to_rseg);
-				else
-					light_at_point = Magical_light_constant;
-
-				if (light_at_point >= 0)
-				{
-					int		hit_type;
-
-					if (!quick_light) 
-					{
-						fvi_query fq;
-						fvi_info	hit_data;
-
-						fq.p0						= &light_location;
-						fq.startseg				= segp-Segments;
-						fq.p1						= &r_segment_center;
-						fq.rad					= 0;
-						fq.thisobjnum			= -1;
-						fq.ignore_obj_list	= NULL;
-						fq.flags					= 0;
-
-						hit_type = find_vector_intersection(&fq,&hit_data);
-					}
-					else
-						hit_type = HIT_NONE;
-
-					switch (hit_type) {
-						case HIT_NONE:
-							light_at_point = fixmul(light_at_point, light_intensity);
-							if (light_at_point >= F1_0)
-								light_at_point = F1_0-1;
-							Segment2s[rsegp->segnum].static_light += light_at_point;
-							if (Segment2s[segp->segnum].static_light < 0)	// if it went negative, saturate
-								Segment2s[segp->segnum].static_light = 0;
-							break;
-						case HIT_WALL:
-							break;
-						case HIT_OBJECT:
-							Int3();	// Hit object, should be ignoring objects!
-							break;
-						case HIT_BAD_P0:
-							Int3();	//	Ugh, this thing again, what happened, what does it mean?
-							break;
-					}
-				}	//	end if (light_at_point...
-			}	//	end if (dist_to_rseg...
-
-		}	//	end for (segnum=0...
-
-	}	//	end for (lightnum=0...
-
-}
-
-//	------------------------------------------------------------------------------------------
-//	Process all lights.
-void calim_process_all_lights(int quick_light)
-{
-	int	segnum, sidenum;
-	int destroyable;
-	dl_index* index;
-
-	Num_static_lights = 0;
-	delta_light_count = 0;
-	last_delta_light = 0;
-
-	for (segnum=0; segnum<=Highest_segment_index; segnum++) 
-	{
-		segment	*segp = &Segments[segnum];
-		mprintf((0, "."));
-		for (sidenum=0; sidenum<MAX_SIDES_PER_SEGMENT; sidenum++)
-		{
-			// if (!IS_CHILD(segp->children[sidenum])) {
-			if (WALL_IS_DOORWAY(segp, sidenum) != 0) 
-			{
-				side	*sidep = &segp->sides[sidenum];
-				fix	light_intensity;
-
-				light_intensity = TmapInfo[sidep->tmap_num].lighting + TmapInfo[sidep->tmap_num2 & 0x3fff].lighting;
-				//if (TmapInfo[sidep->tmap_num2 & 0x3fff].destroyed != -1 || (TmapInfo[sidep->tmap_num2 & 0x3fff].eclip_num != -1 && Effects[TmapInfo[sidep->tmap_num2 & 0x3fff].eclip_num].dest_bm_num != -1))
-				//	destroyable = 1; //[ISB] but then dynlights wouldn't be usable
-
-//				if (segp->sides[sidenum].wall_num != -1) {
-//					int	wall_num, bitmap_num, effect_num;
-//					wall_num = segp->sides[sidenum].wall_num;
-//					effect_num = Walls[wall_num].type;
-//					bitmap_num = effects_bm_num[effect_num];
-//
-//					light_intensity += TmapInfo[bitmap_num].lighting;
-//				}
-
-				if (light_intensity)
-				{
-					if (!quick_light)
-					{
-						index = &Dl_indices[Num_static_lights++];
-						index->count = 0;
-						index->segnum = segnum;
-						index->sidenum = sidenum;
-						index->index = last_delta_light;
-						delta_light_count = 0;
-					}
-					light_intensity /= 4;			// casting light from four spots, so divide by 4.
-					cast_light_from_side(segp, sidenum, light_intensity, quick_light);
-					cast_light_from_side_to_center(segp, sidenum, light_intensity, quick_light);
-					if (!quick_light)
-					{
-						index->count = delta_light_count;
-					}
-				}
-			}
-		}
-	}
-
-	if (!quick_light)
-	{
-		mprintf((0, "Num light sources: %d, Num deltas: %d\n", Num_static_lights, last_delta_light));
-	}
-}
-
 //	------------------------------------------------------------------------------------------
 //	Apply static light in mine.
-//	First, zero all light values.
-//	Then, for all light sources, cast their light.
+//	The lighting itself lives in lightbake.cpp, so it can be run without the editor.
 void cast_all_light_in_mine(int quick_flag)
 {
+	lightbake_tables tables;
 
 	validate_segment_all();
 
-	calim_zero_light_values();
-
-	calim_process_all_lights(quick_flag);
-
+	lightbake_cast_all(quick_flag, &tables);
+	lightbake_copy_tables(&tables);
 }
 
 // int	Fvit_num = 1000;
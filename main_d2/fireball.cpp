@@ -347,7 +347,7 @@ object *object_create_debris(object *parent, int subobj_num)
 				&parent->orient,Polygon_models[parent->rtype.pobj_info.model_num].submodel_rads[subobj_num],
 				CT_DEBRIS,MT_PHYSICS,RT_POLYOBJ);
 
-	if ((objnum < 0 ) && (Highest_object_index >= MAX_OBJECTS-1)) {
+	if ((objnum < 0 ) && (Highest_object_index >= Max_objects-1)) {
 		mprintf((1, "Can't create object in object_create_debris.\n"));
 		Int3();
 		return NULL;
@@ -927,7 +927,10 @@ int drop_powerup(int type, int id, int num, vms_vector *init_vel, vms_vector *po
 				obj = &Objects[objnum];
 
 				if (Robot_info[obj->id].flags & RIF_BIG_RADIUS && CurrentLogicVersion == LogicVer::SHAREWARE)
+				{
 					obj->size = (obj->size*3)/2;
+					fvi_broadphase_update(objnum);
+				}
 
 				//Set polygon-object-specific data 
 
@@ -22,6 +22,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 
 #include <string.h>
 #include <algorithm>
+#include <vector>
 
 #include "misc/error.h"
 #include "platform/mono.h"
@@ -681,19 +682,184 @@ fix check_vector_to_object(vms_vector *intp,vms_vector *p0,vms_vector *p1,fix ra
 }
 
 
+//The state below is per thread, so the light baker can trace from several threads.
 #define MAX_SEGS_VISITED 100
-int n_segs_visited;
-short segs_visited[MAX_SEGS_VISITED];
+thread_local int n_segs_visited;
+thread_local short segs_visited[MAX_SEGS_VISITED];
 
-int fvi_nest_count;
+thread_local int fvi_nest_count;
 
 //these vars are used to pass vars from fvi_sub() to find_vector_intersection()
-int fvi_hit_object;	// object number of object hit in last find_vector_intersection call.
-int fvi_hit_seg;		// what segment the hit point is in
-int fvi_hit_side;		// what side was hit
-int fvi_hit_side_seg;// what seg the hitside is in
-vms_vector wall_norm;	//ptr to surface normal of hit wall
-int fvi_hit_seg2;		// what segment the hit point is in
+thread_local int fvi_hit_object;	// object number of object hit in last find_vector_intersection call.
+thread_local int fvi_hit_seg;		// what segment the hit point is in
+thread_local int fvi_hit_side;		// what side was hit
+thread_local int fvi_hit_side_seg;// what seg the hitside is in
+thread_local vms_vector wall_norm;	//ptr to surface normal of hit wall
+thread_local int fvi_hit_seg2;		// what segment the hit point is in
+
+//Set while fvi_speculate runs a query, failed is set if the query did something it can't do ahead of time.
+static thread_local int fvi_speculating, fvi_speculation_failed;
+
+//Object broadphase. Each segment's objects, in the same order as the segment's object list
+//(newest at the back), as arrays of the values the bounding test needs.
+typedef struct fvi_seg_objects
+{
+	std::vector<short> objnum;
+	std::vector<uint8_t> type;
+	std::vector<fix> x, y, z, radius;
+} fvi_seg_objects;
+
+static fvi_seg_objects Fvi_seg_objects[MAX_SEGMENTS];
+static short Fvi_object_seg[MAX_OBJECTS];		//which list each object is in, or -1
+
+thread_local fvi_stats Fvi_stats;
+fvi_stats Fvi_stats_last_frame;
+
+//The box around a vector that an object has to touch to be looked at.
+typedef struct fvi_sweep_box
+{
+	fix minx, maxx, miny, maxy, minz, maxz;
+	int thistype;
+} fvi_sweep_box;
+
+//check_vector_to_sphere_1 reports hits for spheres centered up to sqrt(2) radii past the end of the vector,
+//so the box is padded by twice the combined radius, plus a little for rounding. Sizes only get smaller
+//in fvi_sub, so this never drops an object the full test would hit.
+static void fvi_make_sweep_box(fvi_sweep_box* box, vms_vector* p0, vms_vector* p1, fix rad, int thisobjnum)
+{
+	fix pad = rad * 2 + 16;
+
+	box->minx = std::min(p0->x, p1->x) - pad; box->maxx = std::max(p0->x, p1->x) + pad;
+	box->miny = std::min(p0->y, p1->y) - pad; box->maxy = std::max(p0->y, p1->y) + pad;
+	box->minz = std::min(p0->z, p1->z) - pad; box->maxz = std::max(p0->z, p1->z) + pad;
+	box->thistype = thisobjnum > -1 ? Objects[thisobjnum].type : -1;
+}
+
+static inline int fvi_sweep_box_candidate(fvi_sweep_box* box, fvi_seg_objects* list, int i)
+{
+	fix r = list->radius[i] * 2;
+
+	if (list->x[i] + r < box->minx || list->x[i] - r > box->maxx ||
+		list->y[i] + r < box->miny || list->y[i] - r > box->maxy ||
+		list->z[i] + r < box->minz || list->z[i] - r > box->maxz)
+		return 0;
+	if (box->thistype != -1 &&
+		CollisionResult[box->thistype][list->type[i]] == RESULT_NOTHING &&
+		CollisionResult[list->type[i]][box->thistype] == RESULT_NOTHING)
+		return 0;
+	return 1;
+}
+
+static void fvi_broadphase_remove(int objnum)
+{
+	int segnum = Fvi_object_seg[objnum];
+	fvi_seg_objects* list = &Fvi_seg_objects[segnum];
+	int i, n = list->objnum.size();
+
+	for (i = 0; i < n; i++)
+		if (list->objnum[i] == objnum)
+			break;
+	Assert(i < n);
+	if (i < n)
+	{
+		list->objnum.erase(list->objnum.begin() + i);
+		list->type.erase(list->type.begin() + i);
+		list->x.erase(list->x.begin() + i);
+		list->y.erase(list->y.begin() + i);
+		list->z.erase(list->z.begin() + i);
+		list->radius.erase(list->radius.begin() + i);
+	}
+	Fvi_object_seg[objnum] = -1;
+}
+
+void fvi_broadphase_reset()
+{
+	for (int i = 0; i < MAX_SEGMENTS; i++)
+	{
+		fvi_seg_objects* list = &Fvi_seg_objects[i];
+		list->objnum.clear(); list->type.clear();
+		list->x.clear(); list->y.clear(); list->z.clear(); list->radius.clear();
+	}
+	for (int i = 0; i < MAX_OBJECTS; i++)
+		Fvi_object_seg[i] = -1;
+}
+
+void fvi_broadphase_link(int objnum, int segnum)
+{
+	object* obj = &Objects[objnum];
+	fvi_seg_objects* list = &Fvi_seg_objects[segnum];
+
+	if (Fvi_object_seg[objnum] != -1)
+		fvi_broadphase_remove(objnum);
+
+	list->objnum.push_back(objnum);
+	list->type.push_back(obj->type);
+	list->x.push_back(obj->pos.x);
+	list->y.push_back(obj->pos.y);
+	list->z.push_back(obj->pos.z);
+	list->radius.push_back(obj->size);
+	Fvi_object_seg[objnum] = segnum;
+}
+
+void fvi_broadphase_unlink(int objnum)
+{
+	if (Fvi_object_seg[objnum] != -1)
+		fvi_broadphase_remove(objnum);
+}
+
+void fvi_broadphase_update(int objnum)
+{
+	object* obj = &Objects[objnum];
+	int segnum = Fvi_object_seg[objnum];
+	fvi_seg_objects* list;
+	int i, n;
+
+	if (segnum == -1)
+		return;
+
+	list = &Fvi_seg_objects[segnum];
+	n = list->objnum.size();
+	for (i = 0; i < n; i++)
+		if (list->objnum[i] == objnum)
+		{
+			list->type[i] = obj->type;
+			list->x[i] = obj->pos.x;
+			list->y[i] = obj->pos.y;
+			list->z[i] = obj->pos.z;
+			list->radius[i] = obj->size;
+			break;
+		}
+}
+
+void fvi_broadphase_new_frame()
+{
+	Fvi_stats_last_frame = Fvi_stats;
+	memset(&Fvi_stats, 0, sizeof(Fvi_stats));
+
+	for (int segnum = 0; segnum <= Highest_segment_index; segnum++)
+	{
+		fvi_seg_objects* list = &Fvi_seg_objects[segnum];
+		int n = list->objnum.size();
+
+		for (int i = 0; i < n; i++)
+		{
+			object* obj = &Objects[list->objnum[i]];
+			list->type[i] = obj->type;
+			list->x[i] = obj->pos.x;
+			list->y[i] = obj->pos.y;
+			list->z[i] = obj->pos.z;
+			list->radius[i] = obj->size;
+		}
+	}
+}
+
+int fvi_broadphase_segment_objects(int segnum, const short** objnums)
+{
+	fvi_seg_objects* list = &Fvi_seg_objects[segnum];
+
+	*objnums = list->objnum.data();
+	return list->objnum.size();
+}
 
 int fvi_sub(vms_vector *intp,int *ints,vms_vector *p0,int startseg,vms_vector *p1,fix rad,short thisobjnum,int *ignore_obj_list,int flags,int *seglist,int *n_segs,int entry_seg);
 
@@ -899,7 +1065,27 @@ int fvi_sub(vms_vector *intp,int *ints,vms_vector *p0,int startseg,vms_vector *p
 
 	//first, see if vector hit any objects in this segment
 	if (flags & FQ_CHECK_OBJS)
-		for (objnum=seg->objects;objnum!=-1;objnum=Objects[objnum].next)
+	{
+		//Broadphase: skip objects outside the box around the vector, and types that can't collide with this object,
+		//before looking at the objects themselves.
+		fvi_seg_objects* list = &Fvi_seg_objects[startseg];
+		fvi_sweep_box box;
+		int i;
+
+		fvi_make_sweep_box(&box, p0, p1, rad, thisobjnum);
+
+		Fvi_stats.segments++;
+		Fvi_stats.objects += list->objnum.size();
+
+		for (i = list->objnum.size() - 1; i >= 0; i--)
+		{
+			if (!fvi_sweep_box_candidate(&box, list, i))
+				continue;
+
+			Fvi_stats.candidates++;
+			objnum = list->objnum[i];
+			Assert(Objects[objnum].segnum == startseg);
+
 			if (	!(Objects[objnum].flags & OF_SHOULD_BE_DEAD) &&
 				 	!(thisobjnum == objnum ) &&
 				 	(ignore_obj_list==NULL || !obj_in_list(objnum,ignore_obj_list)) &&
@@ -929,6 +1115,7 @@ int fvi_sub(vms_vector *intp,int *ints,vms_vector *p0,int startseg,vms_vector *p
 						((Game_mode&GM_MULTI_COOP) &&  Objects[objnum].type == OBJ_WEAPON && Objects[objnum].ctype.laser_info.parent_type == OBJ_PLAYER)))
 					fudged_rad = rad/2;	//(rad*3)/4;
 
+				Fvi_stats.narrowphase++;
 				d = check_vector_to_object(&hit_point,p0,p1,fudged_rad,&Objects[objnum],&Objects[thisobjnum]);
 
 				if (d)          //we have intersection
@@ -940,6 +1127,8 @@ int fvi_sub(vms_vector *intp,int *ints,vms_vector *p0,int startseg,vms_vector *p
 						hit_type=HIT_OBJECT;
 					}
 			}
+		}
+	}
 
 	if (	(thisobjnum > -1 ) && (CollisionResult[Objects[thisobjnum].type][OBJ_WALL] == RESULT_NOTHING ) )
 		rad = 0;		//HACK - ignore when edges hit walls
@@ -1302,6 +1491,12 @@ int check_trans_wall(vms_vector *pnt,segment *seg,int sidenum,int facenum)
 
 //	Assert(WALL_IS_DOORWAY(seg,sidenum) == WID_TRANSPARENT_WALL);
 
+	//The texture cache and page-ins can only be used from the main thread.
+	if (fvi_speculating) {
+		fvi_speculation_failed = 1;
+		return 0;
+	}
+
 	find_hitpoint_uv(&u,&v,NULL,pnt,seg,sidenum,facenum);	//	Don't compute light value.
 
 	if (side->tmap_num2 != 0)	{
@@ -1400,3 +1595,214 @@ int object_intersects_wall(object *objp)
 }
 
 
+
+//	-----------------------------------------------------------------------------------------------------------
+//Speculative queries.
+//fvi_hit_side_seg and wall_norm are only set by some queries, and the next query on the thread can pass
+//on what an earlier one left in them. They're set to values no query produces before speculating, to tell
+//whether the query set them. Everything else find_vector_intersection keeps between calls is reset by every query.
+#define FVI_UNSET_SEG		-0x8000
+#define FVI_UNSET_NORM		0x7fffffff
+
+static void fvi_snapshot_object(std::vector<fvi_object_snapshot>* objects, int objnum)
+{
+	object* obj = &Objects[objnum];
+	fvi_object_snapshot snap;
+
+	snap.objnum = objnum;
+	snap.type = obj->type;
+	snap.id = obj->id;
+	snap.flags = obj->flags;
+	snap.signature = obj->signature;
+	snap.pos = obj->pos;
+	snap.size = obj->size;
+	snap.parent_type = obj->ctype.laser_info.parent_type;
+	snap.parent_num = obj->ctype.laser_info.parent_num;
+	snap.parent_signature = obj->ctype.laser_info.parent_signature;
+	snap.creation_time = obj->ctype.laser_info.creation_time;
+	objects->push_back(snap);
+}
+
+//Records the state of everything a query that went through spec->segs could have looked at.
+//For objects that's the querying object and the ones the broadphase lets through, in the order fvi_sub sees them.
+static void fvi_take_snapshot(fvi_speculative* spec, std::vector<fvi_side_snapshot>* sides, std::vector<fvi_object_snapshot>* objects)
+{
+	fvi_sweep_box box;
+	int i, sidenum;
+
+	sides->clear();
+	objects->clear();
+
+	fvi_make_sweep_box(&box, &spec->p0, &spec->p1, spec->rad, spec->thisobjnum);
+
+	if (spec->thisobjnum > -1)
+		fvi_snapshot_object(objects, spec->thisobjnum);
+
+	for (short segnum : spec->segs)
+	{
+		segment* seg = &Segments[segnum];
+
+		for (sidenum = 0; sidenum < MAX_SIDES_PER_SEGMENT; sidenum++)
+		{
+			side* sidep = &seg->sides[sidenum];
+			fvi_side_snapshot snap;
+
+			snap.wall_num = sidep->wall_num;
+			snap.tmap_num = sidep->tmap_num;
+			snap.tmap_num2 = sidep->tmap_num2;
+			snap.wall_type = snap.wall_flags = snap.wall_state = 0;
+			if (sidep->wall_num != -1)
+			{
+				snap.wall_type = Walls[sidep->wall_num].type;
+				snap.wall_flags = Walls[sidep->wall_num].flags;
+				snap.wall_state = Walls[sidep->wall_num].state;
+			}
+			sides->push_back(snap);
+		}
+
+		if (spec->flags & FQ_CHECK_OBJS)
+		{
+			fvi_seg_objects* list = &Fvi_seg_objects[segnum];
+
+			for (i = list->objnum.size() - 1; i >= 0; i--)
+				if (fvi_sweep_box_candidate(&box, list, i))
+					fvi_snapshot_object(objects, list->objnum[i]);
+		}
+	}
+}
+
+int fvi_speculate(fvi_query* fq, fvi_speculative* spec)
+{
+	int save_hit_side_seg = fvi_hit_side_seg;
+	vms_vector save_wall_norm = wall_norm;
+
+	Assert(fq->ignore_obj_list == NULL || fq->ignore_obj_list[0] == -1);
+
+	spec->p0 = *fq->p0;
+	spec->p1 = *fq->p1;
+	spec->startseg = fq->startseg;
+	spec->rad = fq->rad;
+	spec->thisobjnum = fq->thisobjnum;
+	spec->flags = fq->flags;
+
+	fvi_hit_side_seg = FVI_UNSET_SEG;
+	wall_norm.x = wall_norm.y = wall_norm.z = FVI_UNSET_NORM;
+	n_segs_visited = 0;		//not set if p0 is bad
+
+	fvi_speculating = 1;
+	fvi_speculation_failed = 0;
+	spec->hit_type = find_vector_intersection(fq, &spec->hit_info);
+	fvi_speculating = 0;
+
+	spec->sets_hit_side_seg = fvi_hit_side_seg != FVI_UNSET_SEG;
+	spec->hit_side_seg = fvi_hit_side_seg;
+	spec->sets_wall_norm = wall_norm.x != FVI_UNSET_NORM;
+	spec->wall_norm = wall_norm;
+	spec->segs.assign(segs_visited, segs_visited + n_segs_visited);
+
+	fvi_hit_side_seg = save_hit_side_seg;
+	wall_norm = save_wall_norm;
+
+	if (fvi_speculation_failed)
+		return 0;
+
+	fvi_take_snapshot(spec, &spec->sides, &spec->objects);
+	return 1;
+}
+
+int fvi_speculation_valid(fvi_speculative* spec, fvi_query* fq)
+{
+	static thread_local std::vector<fvi_side_snapshot> sides;
+	static thread_local std::vector<fvi_object_snapshot> objects;
+
+	if (memcmp(&spec->p0, fq->p0, sizeof(vms_vector)) || memcmp(&spec->p1, fq->p1, sizeof(vms_vector)) ||
+		spec->startseg != fq->startseg || spec->rad != fq->rad || spec->thisobjnum != fq->thisobjnum ||
+		spec->flags != fq->flags || (fq->ignore_obj_list && fq->ignore_obj_list[0] != -1))
+		return 0;
+
+	fvi_take_snapshot(spec, &sides, &objects);
+
+	if (sides.size() != spec->sides.size() || objects.size() != spec->objects.size())
+		return 0;
+
+	for (size_t i = 0; i < sides.size(); i++)
+	{
+		fvi_side_snapshot* a = &sides[i], * b = &spec->sides[i];
+		if (a->wall_num != b->wall_num || a->tmap_num != b->tmap_num || a->tmap_num2 != b->tmap_num2 ||
+			a->wall_type != b->wall_type || a->wall_flags != b->wall_flags || a->wall_state != b->wall_state)
+			return 0;
+	}
+
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		fvi_object_snapshot* a = &objects[i], * b = &spec->objects[i];
+		if (a->objnum != b->objnum || a->type != b->type || a->id != b->id || a->flags != b->flags ||
+			a->signature != b->signature || a->size != b->size ||
+			a->pos.x != b->pos.x || a->pos.y != b->pos.y || a->pos.z != b->pos.z ||
+			a->parent_type != b->parent_type || a->parent_num != b->parent_num ||
+			a->parent_signature != b->parent_signature || a->creation_time != b->creation_time)
+			return 0;
+	}
+
+	return 1;
+}
+
+int fvi_use_speculation(fvi_speculative* spec, fvi_info* hit_data)
+{
+	*hit_data = spec->hit_info;
+
+	if (spec->hit_type != HIT_BAD_P0)
+	{
+		if (spec->sets_hit_side_seg)
+			fvi_hit_side_seg = spec->hit_side_seg;
+		else
+			hit_data->hit_side_seg = fvi_hit_side_seg;
+
+		if (spec->sets_wall_norm)
+			wall_norm = spec->wall_norm;
+		else
+			hit_data->hit_wallnorm = wall_norm;
+	}
+
+	return spec->hit_type;
+}
+
+int fvi_check_speculation(fvi_speculative* spec, fvi_query* fq)
+{
+	int save_hit_side_seg = fvi_hit_side_seg;
+	vms_vector save_wall_norm = wall_norm;
+	int real_hit_side_seg;
+	vms_vector real_wall_norm;
+	fvi_info real, speculated;
+	int i, match;
+
+	find_vector_intersection(fq, &real);
+	real_hit_side_seg = fvi_hit_side_seg;
+	real_wall_norm = wall_norm;
+
+	fvi_hit_side_seg = save_hit_side_seg;
+	wall_norm = save_wall_norm;
+	fvi_use_speculation(spec, &speculated);
+
+	match = real.hit_type == speculated.hit_type &&
+		!memcmp(&real.hit_pnt, &speculated.hit_pnt, sizeof(vms_vector)) &&
+		real.hit_seg == speculated.hit_seg &&
+		real.hit_side == speculated.hit_side &&
+		real.hit_side_seg == speculated.hit_side_seg &&
+		real.hit_object == speculated.hit_object;
+
+	//a bad p0 leaves the rest of hit_data and the state alone
+	if (match && real.hit_type != HIT_BAD_P0)
+		match = real.n_segs == speculated.n_segs &&
+			!memcmp(&real.hit_wallnorm, &speculated.hit_wallnorm, sizeof(vms_vector)) &&
+			real_hit_side_seg == fvi_hit_side_seg && !memcmp(&real_wall_norm, &wall_norm, sizeof(vms_vector));
+
+	if (match && real.hit_type != HIT_BAD_P0 && (fq->flags & FQ_GET_SEGLIST))
+		for (i = 0; i < real.n_segs && match; i++)
+			match = real.seglist[i] == speculated.seglist[i];
+
+	fvi_hit_side_seg = save_hit_side_seg;
+	wall_norm = save_wall_norm;
+
+	return match;
+}
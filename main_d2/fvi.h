@@ -13,6 +13,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 
 #pragma once
 
+#include <vector>
 #include "vecmat/vecmat.h"
 #include "segment.h"
 #include "object.h"
@@ -75,3 +76,94 @@ void find_hitpoint_uv(fix *u,fix *v,fix *l, vms_vector *pnt,segment *seg,int sid
 
 //Returns true if the object is through any walls
 int object_intersects_wall(object *objp);
+
+//Broadphase for collisions against objects. Each segment keeps its objects in compact arrays of
+//position, size and type, which fvi_sub checks before looking at the objects themselves.
+//obj_link and obj_unlink keep the lists current, and object_move_all refreshes every entry once per frame
+//and each object again after it moves. Code that moves, resizes or changes the type of an object anywhere
+//else should call fvi_broadphase_update, or collisions with it can be missed until the next frame.
+void fvi_broadphase_link(int objnum, int segnum);
+void fvi_broadphase_unlink(int objnum);
+void fvi_broadphase_update(int objnum);
+
+//Empties every segment's list. Call when clearing Segments[].objects directly.
+void fvi_broadphase_reset();
+
+//Refreshes every entry and starts a new set of counters.
+void fvi_broadphase_new_frame();
+
+//Points objnums at the objects in segnum's list and returns how many there are. The pointer is good
+//until an object is linked to or unlinked from that segment.
+int fvi_broadphase_segment_objects(int segnum, const short** objnums);
+
+typedef struct fvi_stats
+{
+	int segments;		//segments checked for objects
+	int objects;		//objects in those segments
+	int candidates;		//objects that passed the broadphase
+	int narrowphase;	//calls to check_vector_to_object
+} fvi_stats;
+
+//Fvi_stats counts the queries run on this thread. Fvi_stats_last_frame is the main thread's count for the last frame.
+extern thread_local fvi_stats Fvi_stats;
+extern fvi_stats Fvi_stats_last_frame;
+
+//Speculative queries. fvi_speculate runs a query ahead of time, possibly on another thread, and
+//records everything the answer depended on that can change during a frame: the walls and textures of the
+//segments it went through, and the objects in them that the broadphase let through. If the same query is
+//asked later and none of that has changed, fvi_use_speculation gives exactly what find_vector_intersection
+//would have. Only Segments, Walls and Objects may be read while speculating, nothing may change them.
+typedef struct fvi_side_snapshot
+{
+	short wall_num;
+	short tmap_num, tmap_num2;
+	uint8_t wall_type, wall_flags, wall_state;
+} fvi_side_snapshot;
+
+typedef struct fvi_object_snapshot
+{
+	short objnum;
+	uint8_t type, id, flags;
+	int signature;
+	vms_vector pos;
+	fix size;
+	short parent_type, parent_num;
+	int parent_signature;
+	fix creation_time;
+} fvi_object_snapshot;
+
+typedef struct fvi_speculative
+{
+	//the query
+	vms_vector p0, p1;
+	int startseg;
+	fix rad;
+	short thisobjnum;
+	int flags;
+
+	//the answer
+	int hit_type;
+	fvi_info hit_info;
+	int sets_hit_side_seg, hit_side_seg;		//state later queries on the thread can see
+	int sets_wall_norm;
+	vms_vector wall_norm;
+
+	//what it depended on
+	std::vector<short> segs;
+	std::vector<fvi_side_snapshot> sides;
+	std::vector<fvi_object_snapshot> objects;
+} fvi_speculative;
+
+//Runs the query into spec. The query can't have an ignore list. Leaves this thread's fvi state alone.
+//Returns 0 if the query can't be answered ahead of time (it needed to look at a texture).
+int fvi_speculate(fvi_query* fq, fvi_speculative* spec);
+
+//Returns 1 if fq is the query in spec and running it now would give the same answer.
+int fvi_speculation_valid(fvi_speculative* spec, fvi_query* fq);
+
+//Fills in hit_data and this thread's fvi state as find_vector_intersection would have. Returns the hit type.
+int fvi_use_speculation(fvi_speculative* spec, fvi_info* hit_data);
+
+//Runs the query for real and returns 1 if the answer and the state left behind match the speculated ones.
+//This thread's fvi state is left as it was, so call fvi_use_speculation afterwards.
+int fvi_check_speculation(fvi_speculative* spec, fvi_query* fq);
@@ -26,6 +26,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include <string.h>
 #include <stdarg.h>
 #include <ctype.h>
+#include <algorithm>
 
 #include "misc/rand.h"
 
@@ -42,6 +43,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "iff/iff.h"
 #include "2d/pcx.h"
 #include "platform/timer.h"
+#include "platform/jobs.h"
 #include "render.h"
 #include "laser.h"
 #include "screens.h"
@@ -76,6 +78,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "network.h"
 #include "gamefont.h"
 #include "endlevel.h"
+#include "terrain.h"
 #include "joydefs.h"
 #include "kconfig.h"
 #include "platform/mouse.h"
@@ -102,6 +105,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 //#include "rbaudio.h" //[ISB] ugh
 #include "robot.h"
 #include "playsave.h"
+#include "platform/capture.h"
 #include "fix/fix.h"
 
 #ifdef MWPROFILER
@@ -793,6 +797,8 @@ int Movie_fixed_frametime;
 #define Movie_fixed_frametime	0
 #endif
 
+void set_min_trackable_dot();
+
 void calc_frame_time()
 {
 	fix timer_value,last_frametime = FrameTime;
@@ -804,8 +810,15 @@ void calc_frame_time()
 	timer_value = timer_get_fixed_seconds();
 	FrameTime = timer_value - last_timer_value;
 
+	job_end_frame();
+	mem_frame_reset();
+	lighting_end_frame();
+	render_end_frame();
+	terrain_end_frame();
+	input_end_frame();
+
 	#ifndef RELEASE
-	if (Saving_movie_frames || Movie_fixed_frametime)
+	if (Movie_fixed_frametime)
 	{
 		if (FrameTime > f1_0/15)
 			mprintf((0,"slow frame: %x\n",FrameTime));
@@ -880,8 +893,13 @@ void calc_frame_time()
 	stop_count = start_count = 0;
 	#endif
 
-	//	Set value to determine whether homing missile can see target.
-	//	The lower frametime is, the more likely that it can see its target.
+	set_min_trackable_dot();
+}
+
+//	Set value to determine whether homing missile can see target.
+//	The lower frametime is, the more likely that it can see its target.
+void set_min_trackable_dot()
+{
 	if (FrameTime <= F1_0/64)
 		Min_trackable_dot = MIN_TRACKABLE_DOT;	// -- 3*(F1_0 - MIN_TRACKABLE_DOT)/4 + MIN_TRACKABLE_DOT;
 	else if (FrameTime < F1_0/32)
@@ -890,7 +908,6 @@ void calc_frame_time()
 		Min_trackable_dot = MIN_TRACKABLE_DOT + F1_0/64 - F1_0/16 - FrameTime;	// -- fixmul(F1_0 - MIN_TRACKABLE_DOT, F1_0-4*FrameTime) + MIN_TRACKABLE_DOT;
 	else
 		Min_trackable_dot = MIN_TRACKABLE_DOT + F1_0/64 - F1_0/8;
-
 }
 
 //--unused-- int Auto_flythrough=0;  //if set, start flythough automatically
@@ -1987,99 +2004,45 @@ extern void do_seismic_stuff(void);
 
 #ifndef RELEASE
 int Saving_movie_frames=0;
-int __Movie_frame_num=0;
-
-#define MAX_MOVIE_BUFFER_FRAMES 250
-#define MOVIE_FRAME_SIZE	(320 * 200)
-
-uint8_t *Movie_frame_buffer;
-int Movie_frame_counter;
-uint8_t Movie_pal[768];
-char movie_path[50] = ".\\";
-
-grs_bitmap Movie_bm;
-
-void flush_movie_buffer()
-{
-	char savename[128];
-	int f;
-
-	stop_time();
 
-	mprintf((0,"Flushing movie buffer..."));
-
-	Movie_bm.bm_data = Movie_frame_buffer;
-
-	for (f=0;f<Movie_frame_counter;f++) 
-	{
-		sprintf(savename, "%sfrm%04d.pcx",movie_path,__Movie_frame_num);
-		__Movie_frame_num++;
-		pcx_write_bitmap(savename,&Movie_bm,Movie_pal);
-		Movie_bm.bm_data += MOVIE_FRAME_SIZE;
-
-		if (f % 5 == 0)
-			mprintf((0,"%3d/%3d\10\10\10\10\10\10\10",f,Movie_frame_counter));
-	}
-
-	Movie_frame_counter=0;
-
-	mprintf((0,"done   \n"));
-
-	start_time();
-}
+char movie_filename[50] = "capture.avi";
 
 void toggle_movie_saving()
 {
 	int exit;
+	int fps = 30, t;
+	grs_bitmap* screen = &grd_curscreen->sc_canvas.cv_bitmap;
 
-	Saving_movie_frames = !Saving_movie_frames;
-
-	if (Saving_movie_frames) {
+	if (!Saving_movie_frames) {
 		newmenu_item m[1];
 
-		m[0].type=NM_TYPE_INPUT; m[0].text_len = 50; m[0].text = movie_path;
-		exit = newmenu_do( NULL, "Directory for movie frames?" , 1, &(m[0]), NULL );
+		m[0].type=NM_TYPE_INPUT; m[0].text_len = 50; m[0].text = movie_filename;
+		exit = newmenu_do( NULL, "Movie file? (.avi, .y4m or raw)" , 1, &(m[0]), NULL );
 
 		if (exit==-1) 
-		{
-			Saving_movie_frames = 0;
 			return;
-		}
 
-		while (isspace(movie_path[strlen(movie_path)-1]))
-			movie_path[strlen(movie_path)-1] = 0;
-		if (movie_path[strlen(movie_path)-1]!='\\' && movie_path[strlen(movie_path)-1]!=':')
-			strcat(movie_path,"\\");
+		while (strlen(movie_filename) && isspace(movie_filename[strlen(movie_filename)-1]))
+			movie_filename[strlen(movie_filename)-1] = 0;
 
+		if ((t = FindArg("-capturefps")) && t + 1 < Num_args)
+			fps = atoi(Args[t + 1]);
 
-		if (!Movie_frame_buffer) 
+		if (capture_start(movie_filename, capture_format_from_filename(movie_filename), screen->bm_w, screen->bm_h, fps))
 		{
-			Movie_frame_buffer = (uint8_t*)mem_malloc(MAX_MOVIE_BUFFER_FRAMES * MOVIE_FRAME_SIZE);
-			if (!Movie_frame_buffer) 
-			{
-				Int3();
-				Saving_movie_frames=0;
-			}
-
-			Movie_frame_counter=0;
-
-			Movie_bm.bm_x = Movie_bm.bm_y = 0;
-			Movie_bm.bm_w = 320;
-			Movie_bm.bm_h = 200;
-			Movie_bm.bm_type = BM_LINEAR;
-			Movie_bm.bm_flags = 0;
-			Movie_bm.bm_rowsize = 320;
-			//Movie_bm.bm_handle = 0; //[ISB] ara ara?
+			nm_messagebox(NULL, 1, TXT_OK, "Can't start capturing to\n%s", movie_filename);
+			return;
+		}
 
-			gr_palette_read(Movie_pal);		//get actual palette from the hardware
+		Saving_movie_frames = 1;
 
-			if (Newdemo_state == ND_STATE_PLAYBACK)
-				Newdemo_do_interpolate = 0;
-		}
+		if (Newdemo_state == ND_STATE_PLAYBACK)
+			Newdemo_do_interpolate = 0;
 	}
 	else 
 	{
-		flush_movie_buffer();
+		capture_stop();
+		Saving_movie_frames = 0;
 
 		if (Newdemo_state == ND_STATE_PLAYBACK)
 			Newdemo_do_interpolate = 1;
@@ -2089,13 +2052,11 @@ void toggle_movie_saving()
 
 void save_movie_frame()
 {
-	memcpy(Movie_frame_buffer+Movie_frame_counter*MOVIE_FRAME_SIZE,grd_curscreen->sc_canvas.cv_bitmap.bm_data,MOVIE_FRAME_SIZE);
-
-	Movie_frame_counter++;
-
-	if (Movie_frame_counter == MAX_MOVIE_BUFFER_FRAMES)
-		flush_movie_buffer();
+	uint8_t pal[768];
+	grs_bitmap* screen = &grd_curscreen->sc_canvas.cv_bitmap;
 
+	gr_palette_read(pal);		//get actual palette from the hardware, so fades are captured
+	capture_frame(screen->bm_data, screen->bm_w, screen->bm_h, screen->bm_rowsize, pal);
 }
 
 #endif
@@ -2138,42 +2099,11 @@ extern time_t t_current_time, t_saved_time;
 
 void flicker_lights();
 
-void GameLoop(int RenderFlag, int ReadControlsFlag )
+//	------------------------------------------------------------------------------------
+//The first part of a simulation tick, which the original game ran before rendering.
+static void game_tick_start()
 {
-	//[ISB] Okay I really don't want to track all the changes and mini loops and shit
-	//so the game loop will ensure the mouse is always in relative mode
-	plat_set_mouse_relative_mode(1);
-
-	#ifndef	NDEBUG
-	//	Used to slow down frame rate for testing things.
-	//	RenderFlag = 1; // DEBUG
-	if (Debug_slowdown) 
-	{
-		int	h, i, j=0;
-
-		for (h=0; h<Debug_slowdown; h++)
-			for (i=0; i<1000; i++)
-				j += i;
-	}
-	#endif
-
-	#ifdef WINDOWS
-	{
-		static int desc_dead_countdown=100;   /*  used if player shouldn't be playing */
-
-		if (desc_id_exit_num) {				 // are we supposed to be checking
-			if (!(--desc_dead_countdown)) {// if so, at zero, then pull the plug
-				char time_str[32], time_str2[32];
-			
-				_ctime(&t_saved_time, time_str);
-				_ctime(&t_current_time, time_str2);
-
-				Error ("EXPIRES %s.  YOUR TIME %s.\n", time_str, time_str2);
-				Error ("Loading overlay -- error number: %d\n", (int)desc_id_exit_num);
-			}
-		}
-	}
-	#endif
+		Tick_count++;
 
 		#ifndef RELEASE
 		if (FindArg("-invulnerability"))
@@ -2235,27 +2165,11 @@ void GameLoop(int RenderFlag, int ReadControlsFlag )
         }
 
 		#endif
+}
 
-		if (RenderFlag) 
-		{
-			if (force_cockpit_redraw) {			//screen need redrawing?
-				init_cockpit();
-				force_cockpit_redraw=0;
-			}
-			game_render_frame();
-			//show_extra_views();		//missile view, buddy bot, etc.
-
-			#ifndef RELEASE
-			if (Saving_movie_frames)
-				save_movie_frame();
-			#endif
-
-		}
-
-		//mprintf(0,"Velocity %2.2f\n", f2fl(vm_vec_mag(&ConsoleObject->phys_info.velocity)));
-
-		calc_frame_time();
-
+//The rest of a simulation tick, after FrameTime has been set.
+static void game_tick_finish(int ReadControlsFlag)
+{
 		dead_player_frame();
 		if (Newdemo_state != ND_STATE_PLAYBACK)
 			do_controlcen_dead_frame();
@@ -2442,7 +2356,211 @@ void GameLoop(int RenderFlag, int ReadControlsFlag )
 	flicker_lights();
 
 	//!!hoard_light_pulse();		//do cool hoard light pulsing
+}
+
+//	------------------------------------------------------------------------------------
+static void game_loop_render()
+{
+	if (force_cockpit_redraw) {			//screen need redrawing?
+		init_cockpit();
+		force_cockpit_redraw=0;
+	}
+	game_render_frame();
+	//show_extra_views();		//missile view, buddy bot, etc.
+
+	#ifndef RELEASE
+	if (Saving_movie_frames)
+		save_movie_frame();
+	#endif
+}
+
+//	------------------------------------------------------------------------------------
+//Fixed timestep mode. The simulation runs in ticks of exactly 1/Fixed_tick_rate seconds,
+//as many as real time calls for, and each rendered frame shows the objects part way between
+//the last two ticks. That way the game plays the same at any frame rate.
+
+int Fixed_tick_rate = 0;
+static fix Tick_accumulator = 0;
+
+//Where each object was at the start of the last tick
+typedef struct tick_object_state
+{
+	vms_vector pos;
+	vms_matrix orient;
+	int signature;
+	short segnum;
+} tick_object_state;
+
+static tick_object_state Tick_prev_state[MAX_OBJECTS];
+static tick_object_state Tick_cur_state[MAX_OBJECTS];	//the real state, while the interpolated one is being rendered
+static int Tick_prev_level = 0x7fffffff;
+static int Tick_prev_highest = -1;
+
+static void tick_save_object_states()
+{
+	int i;
+
+	for (i = 0; i <= Highest_object_index; i++)
+	{
+		object* obj = &Objects[i];
+		tick_object_state* state = &Tick_prev_state[i];
+
+		if (obj->type == OBJ_NONE)
+			continue;
+
+		state->pos = obj->pos;
+		state->orient = obj->orient;
+		state->signature = obj->signature;
+		state->segnum = obj->segnum;
+	}
+	Tick_prev_highest = Highest_object_index;
+	Tick_prev_level = Current_level_num;
+}
+
+//Moves every object that's been around for the whole tick to where it was alpha of the way through it.
+static void tick_interpolate_objects(fix alpha)
+{
+	int i;
+
+	if (Tick_prev_level != Current_level_num)
+	{
+		Tick_prev_highest = -1;
+		return;
+	}
+
+	for (i = 0; i <= Tick_prev_highest; i++)
+	{
+		object* obj = &Objects[i];
+		tick_object_state* prev = &Tick_prev_state[i];
+		vms_vector fvec, uvec;
+
+		//Objects that are new, or have left their segment, are drawn where they are.
+		//An interpolated position could be outside the segment that's used to draw them.
+		if (obj->type == OBJ_NONE || obj->signature != prev->signature || obj->segnum != prev->segnum)
+		{
+			Tick_cur_state[i].signature = -1;
+			continue;
+		}
+
+		Tick_cur_state[i].pos = obj->pos;
+		Tick_cur_state[i].orient = obj->orient;
+		Tick_cur_state[i].signature = obj->signature;
+
+		vm_vec_sub(&fvec, &obj->pos, &prev->pos);
+		vm_vec_scale_add(&obj->pos, &prev->pos, &fvec, alpha);
+
+		if (memcmp(&obj->orient, &prev->orient, sizeof(vms_matrix)))
+		{
+			vm_vec_sub(&fvec, &obj->orient.fvec, &prev->orient.fvec);
+			vm_vec_scale_add(&fvec, &prev->orient.fvec, &fvec, alpha);
+			vm_vec_sub(&uvec, &obj->orient.uvec, &prev->orient.uvec);
+			vm_vec_scale_add(&uvec, &prev->orient.uvec, &uvec, alpha);
+			vm_vector_2_matrix(&obj->orient, &fvec, &uvec, NULL);
+		}
+	}
+}
+
+static void tick_restore_objects()
+{
+	int i;
+
+	for (i = 0; i <= Tick_prev_highest; i++)
+	{
+		if (Tick_cur_state[i].signature == -1 || Objects[i].signature != Tick_cur_state[i].signature)
+			continue;
+
+		Objects[i].pos = Tick_cur_state[i].pos;
+		Objects[i].orient = Tick_cur_state[i].orient;
+	}
+}
+
+static void game_loop_fixed(int RenderFlag, int ReadControlsFlag)
+{
+	fix tick = F1_0 / Fixed_tick_rate;
+
+	if (RenderFlag)
+	{
+		tick_interpolate_objects(fixdiv(Tick_accumulator, tick));
+		game_loop_render();
+		tick_restore_objects();
+	}
+
+	calc_frame_time();
+
+	//Use the real frame time, but like the variable mode, don't try to catch up on more than 1/5 of a second.
+	if (RealFrameTime > 0)
+		Tick_accumulator += std::min(RealFrameTime, F1_0 / 5);
+
+	while (Tick_accumulator >= tick)
+	{
+		Tick_accumulator -= tick;
+
+		FrameTime = tick;
+		set_min_trackable_dot();
+		tick_save_object_states();
+
+		game_tick_start();
+		game_tick_finish(ReadControlsFlag);
+
+		if (Function_mode != FMODE_GAME)
+			break;
+	}
+}
+
+void GameLoop(int RenderFlag, int ReadControlsFlag )
+{
+	//[ISB] Okay I really don't want to track all the changes and mini loops and shit
+	//so the game loop will ensure the mouse is always in relative mode
+	plat_set_mouse_relative_mode(1);
+
+	#ifndef	NDEBUG
+	//	Used to slow down frame rate for testing things.
+	//	RenderFlag = 1; // DEBUG
+	if (Debug_slowdown) 
+	{
+		int	h, i, j=0;
+
+		for (h=0; h<Debug_slowdown; h++)
+			for (i=0; i<1000; i++)
+				j += i;
+	}
+	#endif
+
+	#ifdef WINDOWS
+	{
+		static int desc_dead_countdown=100;   /*  used if player shouldn't be playing */
+
+		if (desc_id_exit_num) {				 // are we supposed to be checking
+			if (!(--desc_dead_countdown)) {// if so, at zero, then pull the plug
+				char time_str[32], time_str2[32];
+			
+				_ctime(&t_saved_time, time_str);
+				_ctime(&t_current_time, time_str2);
+
+				Error ("EXPIRES %s.  YOUR TIME %s.\n", time_str, time_str2);
+				Error ("Loading overlay -- error number: %d\n", (int)desc_id_exit_num);
+			}
+		}
+	}
+	#endif
+
+	//Demos record a frame each time one's drawn, with the objects as drawn, so they keep to the variable length ticks.
+	if (Fixed_tick_rate && Newdemo_state != ND_STATE_RECORDING && Newdemo_state != ND_STATE_PLAYBACK)
+	{
+		game_loop_fixed(RenderFlag, ReadControlsFlag);
+		return;
+	}
+
+	game_tick_start();
+
+	if (RenderFlag)
+		game_loop_render();
+
+	//mprintf(0,"Velocity %2.2f\n", f2fl(vm_vec_mag(&ConsoleObject->phys_info.velocity)));
+
+	calc_frame_time();
 
+	game_tick_finish(ReadControlsFlag);
 }
 
 //!!extern int Goal_blue_segnum,Goal_red_segnum;
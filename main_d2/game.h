@@ -228,3 +228,11 @@ void enable_flicker(int segnum,int sidenum);
 int add_flicker(int segnum,int sidenum,fix delay,uint32_t mask);
 
 extern int FPSLimit;
+
+//Simulation ticks per second in fixed timestep mode, or 0 to run one tick per frame of whatever length it took.
+//Set with -fixedtick.
+extern int Fixed_tick_rate;
+
+//How many simulation ticks have run. Code that spreads work over several ticks uses this rather
+//than FrameCount, which counts rendered frames and so depends on the frame rate in fixed timestep mode.
+extern int Tick_count;
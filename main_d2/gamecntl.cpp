@@ -1336,6 +1336,21 @@ int HandleSystemKey(int key)
 		break;
 
 
+	case KEY_SHIFTED + KEY_ALTED + KEY_F2:
+		if (!Player_is_dead && !(Game_mode & GM_MULTI))
+			state_quicksave();
+		break;
+
+	case KEY_SHIFTED + KEY_ALTED + KEY_F3:
+		if (!Player_is_dead && !(Game_mode & GM_MULTI))
+		{
+			full_palette_save();
+			state_quickload(0);
+			if (Game_paused)
+				do_game_pause();
+		}
+		break;
+
 	case KEY_F4 + KEY_SHIFTED:
 		do_escort_menu();
 		break;
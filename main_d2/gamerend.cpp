@@ -25,6 +25,8 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "inferno.h"
 #include "misc/error.h"
 #include "platform/mono.h"
+#include "platform/jobs.h"
+#include "platform/key.h"
 #include "2d/gr.h"
 #include "2d/palette.h"
 #include "2d/ibitblt.h"
@@ -43,6 +45,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "stringtable.h"
 #include "multi.h"
 #include "endlevel.h"
+#include "terrain.h"
 #include "cntrlcen.h"
 #include "powerup.h"
 #include "laser.h"
@@ -50,6 +53,8 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "automap.h"
 #include "mission.h" //for mission number
 #include "gameseq.h" //for level number
+#include "fvi.h"
+#include "lighting.h"
 
 #if defined(POLY_ACC)
 #include "poly_acc.h"
@@ -195,6 +200,55 @@ void show_framerate()
 
 	ftoa(temp, rate);	// Convert fixed to string
 	gr_printf(grd_curcanv->cv_w - (8 * GAME_FONT->ft_w), grd_curcanv->cv_h - 5 * (GAME_FONT->ft_h + GAME_FONT->ft_h / 4), "FPS: %s ", temp);
+#ifndef NDEBUG
+	//render lists last frame: segments walked / portals clipped, points rotated / reused from an earlier window
+	gr_printf(grd_curcanv->cv_w - (22 * GAME_FONT->ft_w), grd_curcanv->cv_h - 6 * (GAME_FONT->ft_h + GAME_FONT->ft_h / 4), "Segs: %d/%d %d/%d ",
+		Render_list_stats_last_frame.segments, Render_list_stats_last_frame.portals, Render_list_stats_last_frame.rotated, Render_list_stats_last_frame.reused);
+
+	//time each window took to render last frame
+	{
+		char views[MAX_RENDERED_WINDOWS * 12 + 1];
+		int i, len = 0;
+
+		for (i = 0; i < MAX_RENDERED_WINDOWS; i++)
+			if (Render_view_stats_last_frame[i].views)
+				len += sprintf(views + len, " %dus", Render_view_stats_last_frame[i].us);
+		views[len] = '\0';
+		gr_printf(grd_curcanv->cv_w - ((8 + len) * GAME_FONT->ft_w), grd_curcanv->cv_h - 7 * (GAME_FONT->ft_h + GAME_FONT->ft_h / 4), "Views:%s ", views);
+	}
+
+	//object collision tests last frame: objects in the segments checked / broadphase candidates / narrowphase tests
+	gr_printf(grd_curcanv->cv_w - (18 * GAME_FONT->ft_w), grd_curcanv->cv_h - 4 * (GAME_FONT->ft_h + GAME_FONT->ft_h / 4), "FVI: %d/%d/%d ",
+		Fvi_stats_last_frame.objects, Fvi_stats_last_frame.candidates, Fvi_stats_last_frame.narrowphase);
+
+	//job system last frame: jobs run, and how busy each thread was
+	if (Job_stats_last_frame.num_threads > 1)
+	{
+		char busy[MAX_JOB_THREADS * 5 + 1];
+		int i, jobs = 0, len = 0;
+
+		for (i = 0; i < Job_stats_last_frame.num_threads; i++)
+		{
+			jobs += Job_stats_last_frame.jobs[i];
+			if (i < 8)		//as many as fit
+				len += sprintf(busy + len, " %d%%", Job_stats_last_frame.busy_percent[i]);
+		}
+		gr_printf(grd_curcanv->cv_w - ((12 + len) * GAME_FONT->ft_w), grd_curcanv->cv_h - 3 * (GAME_FONT->ft_h + GAME_FONT->ft_h / 4), "Jobs: %d%s ", jobs, busy);
+	}
+
+	//dynamic lighting last frame: light-vertex pairs evaluated / pairs without the clustering, vertices shared between views
+	gr_printf(grd_curcanv->cv_w - (26 * GAME_FONT->ft_w), grd_curcanv->cv_h - 2 * (GAME_FONT->ft_h + GAME_FONT->ft_h / 4), "Light: %d/%d %d ",
+		Dynamic_light_stats_last_frame.pairs, Dynamic_light_stats_last_frame.brute_pairs, Dynamic_light_stats_last_frame.shared_verts);
+
+	//input events last frame: count / average and worst wait in ms between happening and being read
+	gr_printf(grd_curcanv->cv_w - (22 * GAME_FONT->ft_w), grd_curcanv->cv_h - 1 * (GAME_FONT->ft_h + GAME_FONT->ft_h / 4), "Input: %d %d/%dms ",
+		Input_latency_stats_last_frame.events, (int)(f2fl(Input_latency_stats_last_frame.avg_delay) * 1000), (int)(f2fl(Input_latency_stats_last_frame.max_delay) * 1000));
+
+	//exit sequence terrain last frame: triangles drawn, cells at full detail / in merged blocks, cells and blocks culled
+	if (Terrain_stats_last_frame.cells || Terrain_stats_last_frame.blocks || Terrain_stats_last_frame.culled)
+		gr_printf(grd_curcanv->cv_w - (30 * GAME_FONT->ft_w), grd_curcanv->cv_h - 8 * (GAME_FONT->ft_h + GAME_FONT->ft_h / 4), "Terrain: %d %d/%d %d ",
+			Terrain_stats_last_frame.triangles, Terrain_stats_last_frame.cells, Terrain_stats_last_frame.blocks, Terrain_stats_last_frame.culled);
+#endif
 	//   if ( !( q++ % 30 ) )
 	//      mprintf( (0,"fps: %s\n", temp ) );
 }
@@ -19,6 +19,8 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "platform/posixstub.h"
 #include "platform/mono.h"
 #include "platform/key.h"
+#include "platform/timer.h"
+#include "platform/platform_filesys.h"
 #include "2d/gr.h"
 #include "2d/palette.h"
 #include "newmenu.h"
@@ -33,6 +35,7 @@ void do_load_save_levels(int save);
 #endif
 #include "misc/error.h"
 #include "object.h"
+#include "fvi.h"
 #include "game.h"
 #include "screens.h"
 #include "wall.h"
@@ -56,6 +59,7 @@ void do_load_save_levels(int save);
 #include "gamepal.h"
 #include "laser.h"
 #include "misc/byteswap.h"
+#include "levelcache.h"
 
 char Gamesave_current_filename[128];
 
@@ -1210,8 +1214,8 @@ int load_game_data(CFILE* LoadFile)
 		if (cfseek(LoadFile, game_fileinfo.object_offset, SEEK_SET))
 			Error("Error seeking to object_offset in gamesave.c");
 
-		if (game_fileinfo.object_howmany > MAX_OBJECTS)
-			Error("Level contains over MAX_OBJECTS(%d) objects.", MAX_OBJECTS);
+		if (game_fileinfo.object_howmany > Max_objects)
+			Error("Level contains over Max_objects(%d) objects.", Max_objects);
 
 		for (i = 0; i < game_fileinfo.object_howmany; i++)
 		{
@@ -1552,6 +1556,7 @@ int load_game_data(CFILE* LoadFile)
 	//========================= UPDATE VARIABLES ======================
 
 	reset_objects(game_fileinfo.object_howmany);
+	fvi_broadphase_reset();
 
 	for (i = 0; i < MAX_OBJECTS; i++) 
 	{
@@ -1744,6 +1749,96 @@ extern	int	Slide_segs_computed;
 
 int no_old_level_file_error = 0;
 
+#ifndef EDITOR
+extern fix Fuelcen_max_amount;
+
+//Fills in the list of everything load_level produces, in the order it's stored in a cache file.
+static int level_cache_get_blocks(levelcache_block* blocks)
+{
+	int n = 0;
+
+#define CACHE_BLOCK(var, len) do { blocks[n].ptr = (void*)(var); blocks[n].size = (len); n++; } while (0)
+	CACHE_BLOCK(&game_top_fileinfo, sizeof(game_top_fileinfo));
+	CACHE_BLOCK(&game_fileinfo, sizeof(game_fileinfo));
+	CACHE_BLOCK(Gamesave_current_filename, sizeof(Gamesave_current_filename));
+	CACHE_BLOCK(Current_level_name, sizeof(Current_level_name));
+	CACHE_BLOCK(Current_level_palette, sizeof(Current_level_palette));
+	CACHE_BLOCK(&Gamesave_num_org_robots, sizeof(Gamesave_num_org_robots));
+	CACHE_BLOCK(&Gamesave_num_players, sizeof(Gamesave_num_players));
+	CACHE_BLOCK(&N_save_pof_names, sizeof(N_save_pof_names));
+	CACHE_BLOCK(Save_pof_names, sizeof(Save_pof_names));
+	CACHE_BLOCK(&Base_control_center_explosion_time, sizeof(Base_control_center_explosion_time));
+	CACHE_BLOCK(&Reactor_strength, sizeof(Reactor_strength));
+	CACHE_BLOCK(&Num_flickering_lights, sizeof(Num_flickering_lights));
+	CACHE_BLOCK(Flickering_lights, sizeof(flickering_light) * MAX_FLICKERING_LIGHTS);
+	CACHE_BLOCK(&Secret_return_segment, sizeof(Secret_return_segment));
+	CACHE_BLOCK(&Secret_return_orient, sizeof(Secret_return_orient));
+	CACHE_BLOCK(&Num_vertices, sizeof(Num_vertices));
+	CACHE_BLOCK(&Num_segments, sizeof(Num_segments));
+	CACHE_BLOCK(&Highest_vertex_index, sizeof(Highest_vertex_index));
+	CACHE_BLOCK(&Highest_segment_index, sizeof(Highest_segment_index));
+	CACHE_BLOCK(Vertices, sizeof(vms_vector) * MAX_VERTICES);
+	CACHE_BLOCK(Segments, sizeof(segment) * MAX_SEGMENTS);
+	CACHE_BLOCK(Segment2s, sizeof(segment2) * MAX_SEGMENTS);
+	CACHE_BLOCK(&Object_next_signature, sizeof(Object_next_signature));
+	CACHE_BLOCK(Objects, sizeof(object) * Max_objects);
+	CACHE_BLOCK(&Num_walls, sizeof(Num_walls));
+	CACHE_BLOCK(Walls, sizeof(Walls));
+	CACHE_BLOCK(&Num_open_doors, sizeof(Num_open_doors));
+	CACHE_BLOCK(ActiveDoors, sizeof(ActiveDoors));
+	CACHE_BLOCK(&Num_triggers, sizeof(Num_triggers));
+	CACHE_BLOCK(Triggers, sizeof(Triggers));
+	CACHE_BLOCK(&ControlCenterTriggers, sizeof(ControlCenterTriggers));
+	CACHE_BLOCK(&Num_robot_centers, sizeof(Num_robot_centers));
+	CACHE_BLOCK(RobotCenters, sizeof(RobotCenters));
+	CACHE_BLOCK(&Num_fuelcenters, sizeof(Num_fuelcenters));
+	CACHE_BLOCK(Station, sizeof(Station));
+	CACHE_BLOCK(&Num_static_lights, sizeof(Num_static_lights));
+	CACHE_BLOCK(Dl_indices, sizeof(Dl_indices));
+	CACHE_BLOCK(Delta_lights, sizeof(Delta_lights));
+	CACHE_BLOCK(Light_subtracted, sizeof(Light_subtracted));
+#undef CACHE_BLOCK
+
+	Assert(n <= LEVELCACHE_MAX_BLOCKS);
+	return n;
+}
+
+//Builds the key a cache file must match. The data checksum covers the game data
+//verify_object and the matcen/fuelcen setup look at while loading.
+static int level_cache_get_key(levelcache_key* key, const char* filename, levelcache_block* blocks, int num_blocks)
+{
+	uint32_t crc = 0;
+	int i;
+
+	memset(key, 0, sizeof(*key));
+	if (!levelcache_hash_source(key, filename))
+		return 0;
+
+	crc = levelcache_crc(&CurrentDataVersion, sizeof(CurrentDataVersion), crc);
+	crc = levelcache_crc(&Difficulty_level, sizeof(Difficulty_level), crc);
+	crc = levelcache_crc(&Fuelcen_max_amount, sizeof(Fuelcen_max_amount), crc);
+	crc = levelcache_crc(&N_robot_types, sizeof(N_robot_types), crc);
+	crc = levelcache_crc(Robot_info, sizeof(robot_info) * N_robot_types, crc);
+	crc = levelcache_crc(&N_weapon_types, sizeof(N_weapon_types), crc);
+	crc = levelcache_crc(Weapon_info, sizeof(weapon_info) * N_weapon_types, crc);
+	crc = levelcache_crc(Powerup_info, sizeof(Powerup_info), crc);
+	crc = levelcache_crc(TmapInfo, sizeof(TmapInfo), crc);
+	crc = levelcache_crc(WallAnims, sizeof(WallAnims), crc);
+	crc = levelcache_crc(&N_polygon_models, sizeof(N_polygon_models), crc);
+	crc = levelcache_crc(Pof_names, sizeof(Pof_names), crc);
+	for (i = 0; i < N_polygon_models; i++)
+		crc = levelcache_crc(&Polygon_models[i].rad, sizeof(Polygon_models[i].rad), crc);
+	key->data_crc = crc;
+
+	crc = 0;
+	for (i = 0; i < num_blocks; i++)
+		crc = levelcache_crc(&blocks[i].size, sizeof(blocks[i].size), crc);
+	key->layout_crc = crc;
+
+	return 1;
+}
+#endif
+
 //loads a level (.LVL) file from disk
 //returns 0 if success, else error code
 int load_level(char* filename_passed)
@@ -1755,6 +1850,13 @@ int load_level(char* filename_passed)
 	char filename[128];
 	int sig, version, minedata_offset, gamedata_offset;
 	int mine_err, game_err, i;
+	uint64_t start_time = I_GetUS();
+#ifndef EDITOR
+	levelcache_block cache_blocks[LEVELCACHE_MAX_BLOCKS];
+	levelcache_key cache_key;
+	char cache_filename[CHOCOLATE_MAX_FILE_PATH_SIZE];
+	int num_cache_blocks = 0, use_cache = 0;
+#endif
 
 	Slide_segs_computed = 0;
 
@@ -1795,6 +1897,34 @@ int load_level(char* filename_passed)
 	}
 #endif
 
+#ifndef EDITOR
+	//Network games adjust the powerup counts while loading, and the demo data is laid out differently.
+	if (levelcache_enabled() && !(Game_mode & GM_NETWORK) && CurrentDataVersion != DataVer::DEMO)
+	{
+		num_cache_blocks = level_cache_get_blocks(cache_blocks);
+		use_cache = level_cache_get_key(&cache_key, filename, cache_blocks, num_cache_blocks);
+	}
+
+	if (use_cache)
+	{
+		levelcache_get_filename(cache_filename, sizeof(cache_filename), filename);
+		if (levelcache_read(cache_filename, &cache_key, cache_blocks, num_cache_blocks))
+		{
+			special_reset_objects();	//the object lists are rebuilt rather than cached
+			reset_debris_count();
+
+			//The segment object lists come back from the cache, but the broadphase doesn't
+			fvi_broadphase_reset();
+			for (i = 0; i <= Highest_object_index; i++)
+				if (Objects[i].type != OBJ_NONE && Objects[i].segnum != -1)
+					fvi_broadphase_link(i, Objects[i].segnum);
+
+			mprintf((0, "Loaded %s from level cache in %d us\n", filename, (int)(I_GetUS() - start_time)));
+			return 0;
+		}
+	}
+#endif
+
 	LoadFile = cfopen(filename, "rb");
 
 	if (!LoadFile)
@@ -1931,6 +2061,13 @@ int load_level(char* filename_passed)
 	if (CurrentDataVersion != DataVer::DEMO)
 		set_ambient_sound_flags();
 
+	mprintf((0, "Parsed %s in %d us\n", filename, (int)(I_GetUS() - start_time)));
+
+#ifndef EDITOR
+	if (use_cache && !levelcache_write(cache_filename, &cache_key, cache_blocks, num_cache_blocks))
+		mprintf((1, "Can't write level cache %s\n", cache_filename));
+#endif
+
 #ifdef EDITOR
 	write_game_text_file(filename);
 	if (Errors_in_mine)
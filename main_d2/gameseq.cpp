@@ -871,7 +871,7 @@ void load_bitmap_replacements(char* level_name)
 		}
 
 		bitmap_data_size = cfilelength(ifile) - cftell(ifile) - (BITMAP_HEADER_SIZE * n_bitmaps);
-		MALLOC(Bitmap_replacement_data, uint8_t, bitmap_data_size);
+		MALLOC_TAG(Bitmap_replacement_data, uint8_t, bitmap_data_size, MEM_TAG_BITMAP);
 
 		for (i = 0; i < n_bitmaps; i++)
 		{
@@ -951,6 +951,21 @@ void LoadLevel(int level_num, int page_in_textures)
 	
 #endif
 
+	//Dump what the last level did to memory, and start counting for this one
+	if (Mem_stats_dump)
+	{
+		if (Current_level_num != 0)
+		{
+			char title[64];
+			snprintf(title, sizeof(title), "during level %d", Current_level_num);
+			mem_print_stats(stderr, title);
+		}
+		mem_stats_reset_period();
+	}
+
+	//multiplayer games keep the original object limit, so everyone's object numbers fit the same packets
+	obj_set_max_objects((Game_mode & GM_MULTI) ? MAX_OBJECTS_LEGACY : Max_objects_single);
+
 	load_ret = load_level(level_name);		//actually load the data from disk!
 
 	if (load_ret)
@@ -843,10 +843,112 @@ extern char HUD_messages[HUD_MAX_NUM][HUD_MESSAGE_LENGTH + 5];
 extern fix ThisLevelTime;
 extern fix Omega_charge;
 
+//The gauges of the full screen HUD are retained between frames. Each one is drawn into its own
+//canvas, which is only redrawn when the inputs the gauge passes to hud_layer_begin change, and
+//is otherwise composited into the frame with one masked blit.
+#define HUD_LAYER_MAX_INPUTS	12
+
+typedef struct hud_layer
+{
+	grs_canvas* canv;
+	int x, y;			//where the layer goes in the frame
+	grs_font* font;		//the font and color are inputs of every layer
+	int fg_color;
+	int num_inputs;		//-1 when the layer must be redrawn
+	int inputs[HUD_LAYER_MAX_INPUTS];
+} hud_layer;
+
+#define HUD_LAYER_SCORE			0
+#define HUD_LAYER_ENERGY		1
+#define HUD_LAYER_SHIELD		2
+#define HUD_LAYER_AFTERBURNER	3
+#define HUD_LAYER_WEAPONS		4
+#define HUD_LAYER_KEYS			5
+#define HUD_LAYER_LIVES			6
+#define NUM_HUD_LAYERS			7
+
+static hud_layer Hud_layers[NUM_HUD_LAYERS];
+static grs_canvas* Hud_layer_frame_canv;
+
+static void hud_layers_invalidate()
+{
+	int i;
+
+	for (i = 0; i < NUM_HUD_LAYERS; i++)
+		Hud_layers[i].num_inputs = -1;
+}
+
+static void hud_layers_close()
+{
+	int i;
+
+	for (i = 0; i < NUM_HUD_LAYERS; i++)
+	{
+		if (Hud_layers[i].canv)
+			gr_free_canvas(Hud_layers[i].canv);
+		Hud_layers[i].canv = NULL;
+		Hud_layers[i].num_inputs = -1;
+	}
+}
+
+//Starts the layer, which is w by h and goes at x, y in the frame. Returns 1 if it has to be
+//redrawn: its canvas is then current, cleared to transparent and with the font and colors of
+//the frame's canvas, and the caller draws the gauge at 0, 0. Either way the caller finishes
+//with hud_layer_end.
+static int hud_layer_begin(int layernum, int x, int y, int w, int h, const int* inputs, int num_inputs)
+{
+	hud_layer* layer = &Hud_layers[layernum];
+
+	layer->x = x;
+	layer->y = y;
+
+	Assert(num_inputs <= HUD_LAYER_MAX_INPUTS);
+	w = std::max(w, 1);
+	h = std::max(h, 1);
+
+	if (layer->canv && layer->canv->cv_w == w && layer->canv->cv_h == h &&
+		layer->font == grd_curcanv->cv_font && layer->fg_color == grd_curcanv->cv_font_fg_color &&
+		layer->num_inputs == num_inputs && !memcmp(layer->inputs, inputs, num_inputs * sizeof(int)))
+		return 0;
+
+	if (!layer->canv || layer->canv->cv_w != w || layer->canv->cv_h != h)
+	{
+		if (layer->canv)
+			gr_free_canvas(layer->canv);
+		layer->canv = gr_create_canvas(w, h);
+	}
+	layer->font = grd_curcanv->cv_font;
+	layer->fg_color = grd_curcanv->cv_font_fg_color;
+	layer->num_inputs = num_inputs;
+	memcpy(layer->inputs, inputs, num_inputs * sizeof(int));
+
+	layer->canv->cv_font = grd_curcanv->cv_font;
+	layer->canv->cv_font_fg_color = grd_curcanv->cv_font_fg_color;
+	layer->canv->cv_font_bg_color = grd_curcanv->cv_font_bg_color;
+
+	Hud_layer_frame_canv = grd_curcanv;
+	gr_set_current_canvas(layer->canv);
+	gr_clear_canvas(TRANSPARENCY_COLOR);
+
+	return 1;
+}
+
+//Composites the layer into the frame.
+static void hud_layer_end(int layernum)
+{
+	hud_layer* layer = &Hud_layers[layernum];
+
+	if (grd_curcanv == layer->canv)
+		gr_set_current_canvas(Hud_layer_frame_canv);
+
+	gr_bitmapm(layer->x, layer->y, &layer->canv->cv_bitmap);
+}
+
 void hud_show_score()
 {
 	char	score_str[20];
 	int	w, h, aw;
+	int	inputs[2];
 
 	if ((HUD_nmessages > 0) && (strlen(HUD_messages[hud_first]) > 38))
 		return;
@@ -855,11 +957,15 @@ void hud_show_score()
 
 	if (((Game_mode & GM_MULTI) && !(Game_mode & GM_MULTI_COOP)))
 	{
-		sprintf(score_str, "%s: %5d", TXT_KILLS, Players[Player_num].net_kills_total);
+		inputs[0] = 1;
+		inputs[1] = Players[Player_num].net_kills_total;
+		sprintf(score_str, "%s: %5d", TXT_KILLS, inputs[1]);
 	}
 	else
 	{
-		sprintf(score_str, "%s: %5d", TXT_SCORE, Players[Player_num].score);
+		inputs[0] = 0;
+		inputs[1] = Players[Player_num].score;
+		sprintf(score_str, "%s: %5d", TXT_SCORE, inputs[1]);
 	}
 
 	gr_get_string_size(score_str, &w, &h, &aw);
@@ -868,7 +974,9 @@ void hud_show_score()
 		Color_0_31_0 = gr_getcolor(0, 31, 0);
 	gr_set_fontcolor(Color_0_31_0, -1);
 
-	gr_printf(grd_curcanv->cv_w - w - LHX(2), 3, score_str);
+	if (hud_layer_begin(HUD_LAYER_SCORE, grd_curcanv->cv_w - w - LHX(2), 3, w, h, inputs, 2))
+		gr_printf(0, 0, score_str);
+	hud_layer_end(HUD_LAYER_SCORE);
 }
 
 void hud_show_timer_count()
@@ -1192,25 +1300,31 @@ void hud_show_keys(void)
 {
 	int y = 3 * Line_spacing;
 	int dx = GAME_FONT->ft_w + GAME_FONT->ft_w / 2;
+	int keys = Players[Player_num].flags & (PLAYER_FLAGS_BLUE_KEY | PLAYER_FLAGS_GOLD_KEY | PLAYER_FLAGS_RED_KEY);
+	grs_bitmap* blue, * gold, * red;
 
-	if (Players[Player_num].flags & PLAYER_FLAGS_BLUE_KEY) 
-	{
-		PAGE_IN_GAUGE(KEY_ICON_BLUE);
-		gr_ubitmapm(2, y, &GameBitmaps[GET_GAUGE_INDEX(KEY_ICON_BLUE)]);
-	}
+	if (!keys)
+		return;
 
-	if (Players[Player_num].flags & PLAYER_FLAGS_GOLD_KEY) 
-	{
-		PAGE_IN_GAUGE(KEY_ICON_YELLOW);
-		gr_ubitmapm(2 + dx, y, &GameBitmaps[GET_GAUGE_INDEX(KEY_ICON_YELLOW)]);
-	}
+	PAGE_IN_GAUGE(KEY_ICON_BLUE);
+	PAGE_IN_GAUGE(KEY_ICON_YELLOW);
+	PAGE_IN_GAUGE(KEY_ICON_RED);
+	blue = &GameBitmaps[GET_GAUGE_INDEX(KEY_ICON_BLUE)];
+	gold = &GameBitmaps[GET_GAUGE_INDEX(KEY_ICON_YELLOW)];
+	red = &GameBitmaps[GET_GAUGE_INDEX(KEY_ICON_RED)];
 
-	if (Players[Player_num].flags & PLAYER_FLAGS_RED_KEY) 
+	if (hud_layer_begin(HUD_LAYER_KEYS, 2, y, 2 * dx + red->bm_w, std::max(std::max(blue->bm_h, gold->bm_h), red->bm_h), &keys, 1))
 	{
-		PAGE_IN_GAUGE(KEY_ICON_RED);
-		gr_ubitmapm(2 + 2 * dx, y, &GameBitmaps[GET_GAUGE_INDEX(KEY_ICON_RED)]);
-	}
+		if (keys & PLAYER_FLAGS_BLUE_KEY)
+			gr_ubitmapm(0, 0, blue);
+
+		if (keys & PLAYER_FLAGS_GOLD_KEY)
+			gr_ubitmapm(dx, 0, gold);
 
+		if (keys & PLAYER_FLAGS_RED_KEY)
+			gr_ubitmapm(2 * dx, 0, red);
+	}
+	hud_layer_end(HUD_LAYER_KEYS);
 }
 
 extern grs_bitmap Orb_icons[2];
@@ -1290,13 +1404,20 @@ void hud_show_flag(void)
 
 void hud_show_energy(void)
 {
+	char	energy_str[32];
+	int	w, h, aw;
+	int	energy = f2ir(Players[Player_num].energy);
+	int	y = grd_curcanv->cv_h - ((Game_mode & GM_MULTI) ? 5 : 1) * Line_spacing;
+
 	//gr_set_current_canvas(&VR_render_sub_buffer[0]);	//render off-screen
 	gr_set_curfont(GAME_FONT);
 	gr_set_fontcolor(gr_getcolor(0, 31, 0), -1);
-	if (Game_mode & GM_MULTI)
-		gr_printf(2, grd_curcanv->cv_h - 5 * Line_spacing, "%s: %i", TXT_ENERGY, f2ir(Players[Player_num].energy));
-	else
-		gr_printf(2, grd_curcanv->cv_h - Line_spacing, "%s: %i", TXT_ENERGY, f2ir(Players[Player_num].energy));
+
+	sprintf(energy_str, "%s: %i", TXT_ENERGY, energy);
+	gr_get_string_size(energy_str, &w, &h, &aw);
+	if (hud_layer_begin(HUD_LAYER_ENERGY, 2, y, w, h, &energy, 1))
+		gr_printf(0, 0, "%s", energy_str);
+	hud_layer_end(HUD_LAYER_ENERGY);
 
 	if (Newdemo_state == ND_STATE_RECORDING) 
 	{
@@ -1312,7 +1433,9 @@ void hud_show_energy(void)
 
 void hud_show_afterburner(void)
 {
-	int y;
+	char	burn_str[16];
+	int	w, h, aw;
+	int	y, percent;
 
 	if (!(Players[Player_num].flags & PLAYER_FLAGS_AFTERBURNER))
 		return;		//don't draw if don't have
@@ -1322,7 +1445,12 @@ void hud_show_afterburner(void)
 
 	y = (Game_mode & GM_MULTI) ? (-8 * Line_spacing) : (-3 * Line_spacing);
 
-	gr_printf(2, grd_curcanv->cv_h + y, "burn: %d%%", fixmul(Afterburner_charge, 100));
+	percent = fixmul(Afterburner_charge, 100);
+	sprintf(burn_str, "burn: %d%%", percent);
+	gr_get_string_size(burn_str, &w, &h, &aw);
+	if (hud_layer_begin(HUD_LAYER_AFTERBURNER, 2, grd_curcanv->cv_h + y, w, h, &percent, 1))
+		gr_printf(0, 0, "%s", burn_str);
+	hud_layer_end(HUD_LAYER_AFTERBURNER);
 
 	if (Newdemo_state == ND_STATE_RECORDING) 
 	{
@@ -1422,10 +1550,12 @@ void draw_primary_ammo_info(int ammo_count)
 
 void hud_show_weapons(void)
 {
-	int	w, h, aw;
+	int	h, aw;
 	int	y;
 	char* weapon_name;
-	char	weapon_str[32];
+	char	weapon_str[32], secondary_str[32];
+	int	primary_w, secondary_w, layer_w, bomb_x;
+	int	inputs[9];
 
 	//	gr_set_current_canvas(&VR_render_sub_buffer[0]);	//render off-screen
 	gr_set_curfont(GAME_FONT);
@@ -1477,8 +1607,7 @@ void hud_show_weapons(void)
 	default:						Int3();	weapon_str[0] = 0;	break;
 	}
 
-	gr_get_string_size(weapon_str, &w, &h, &aw);
-	gr_printf(grd_curcanv->cv_bitmap.bm_w - 5 - w, y - 2 * Line_spacing, weapon_str);
+	gr_get_string_size(weapon_str, &primary_w, &h, &aw);
 
 	if (Primary_weapon == VULCAN_INDEX) 
 	{
@@ -1502,9 +1631,8 @@ void hud_show_weapons(void)
 
 	weapon_name = SECONDARY_WEAPON_NAMES_VERY_SHORT(Secondary_weapon);
 
-	sprintf(weapon_str, "%s %d", weapon_name, Players[Player_num].secondary_ammo[Secondary_weapon]);
-	gr_get_string_size(weapon_str, &w, &h, &aw);
-	gr_printf(grd_curcanv->cv_bitmap.bm_w - 5 - w, y - Line_spacing, weapon_str);
+	sprintf(secondary_str, "%s %d", weapon_name, Players[Player_num].secondary_ammo[Secondary_weapon]);
+	gr_get_string_size(secondary_str, &secondary_w, &h, &aw);
 
 	if (Players[Player_num].secondary_ammo[Secondary_weapon] != old_ammo_count[1]) 
 	{
@@ -1513,7 +1641,27 @@ void hud_show_weapons(void)
 		old_ammo_count[1] = Players[Player_num].secondary_ammo[Secondary_weapon];
 	}
 
-	show_bomb_count(grd_curcanv->cv_bitmap.bm_w - (3 * GAME_FONT->ft_w + (FontHires ? 0 : 2)), y - 3 * Line_spacing, -1, 1);
+	//The layer runs to the right edge of the canvas and covers the bomb count and both weapon lines.
+	bomb_x = 3 * GAME_FONT->ft_w + (FontHires ? 0 : 2);
+	layer_w = std::max(std::max(primary_w, secondary_w) + 5, bomb_x);
+
+	inputs[0] = Primary_weapon;
+	inputs[1] = Players[Player_num].flags & PLAYER_FLAGS_QUAD_LASERS;
+	inputs[2] = Players[Player_num].laser_level;
+	inputs[3] = (Primary_weapon == VULCAN_INDEX || Primary_weapon == GAUSS_INDEX) ? Players[Player_num].primary_ammo[VULCAN_INDEX] : 0;
+	inputs[4] = (Primary_weapon == OMEGA_INDEX) ? Omega_charge : 0;
+	inputs[5] = Secondary_weapon;
+	inputs[6] = Players[Player_num].secondary_ammo[Secondary_weapon];
+	inputs[7] = which_bomb();
+	inputs[8] = Players[Player_num].secondary_ammo[inputs[7]];
+
+	if (hud_layer_begin(HUD_LAYER_WEAPONS, grd_curcanv->cv_bitmap.bm_w - layer_w, y - 3 * Line_spacing, layer_w, 2 * Line_spacing + h, inputs, 9))
+	{
+		gr_printf(layer_w - 5 - primary_w, Line_spacing, weapon_str);
+		gr_printf(layer_w - 5 - secondary_w, 2 * Line_spacing, secondary_str);
+		show_bomb_count(layer_w - bomb_x, 0, -1, 1);	//last, since it sets its own color
+	}
+	hud_layer_end(HUD_LAYER_WEAPONS);
 }
 
 void hud_show_cloak_invuln(void)
@@ -1550,24 +1698,25 @@ void hud_show_cloak_invuln(void)
 
 void hud_show_shield(void)
 {
+	char	shield_str[32];
+	int	w, h, aw;
+	int	shield;
+	int	y = grd_curcanv->cv_h - ((Game_mode & GM_MULTI) ? 6 : 2) * Line_spacing;
+
 	//	gr_set_current_canvas(&VR_render_sub_buffer[0]);	//render off-screen
 	gr_set_curfont(GAME_FONT);
 	gr_set_fontcolor(gr_getcolor(0, 31, 0), -1);
 
 	if (Players[Player_num].shields >= 0) 
-	{
-		if (Game_mode & GM_MULTI)
-			gr_printf(2, grd_curcanv->cv_h - 6 * Line_spacing, "%s: %i", TXT_SHIELD, f2ir(Players[Player_num].shields));
-		else
-			gr_printf(2, grd_curcanv->cv_h - 2 * Line_spacing, "%s: %i", TXT_SHIELD, f2ir(Players[Player_num].shields));
-	}
+		shield = f2ir(Players[Player_num].shields);
 	else 
-	{
-		if (Game_mode & GM_MULTI)
-			gr_printf(2, grd_curcanv->cv_h - 6 * Line_spacing, "%s: 0", TXT_SHIELD);
-		else
-			gr_printf(2, grd_curcanv->cv_h - 2 * Line_spacing, "%s: 0", TXT_SHIELD);
-	}
+		shield = 0;
+
+	sprintf(shield_str, "%s: %i", TXT_SHIELD, shield);
+	gr_get_string_size(shield_str, &w, &h, &aw);
+	if (hud_layer_begin(HUD_LAYER_SHIELD, 2, y, w, h, &shield, 1))
+		gr_printf(0, 0, "%s", shield_str);
+	hud_layer_end(HUD_LAYER_SHIELD);
 
 	if (Newdemo_state == ND_STATE_RECORDING) 
 	{
@@ -1595,12 +1744,23 @@ void hud_show_lives()
 	else if (Players[Player_num].lives > 1) 
 	{
 		grs_bitmap* bm;
+		char	lives_str[16];
+		int	w, h, aw;
+		int	lives = Players[Player_num].lives - 1;
+
 		gr_set_curfont(GAME_FONT);
 		gr_set_fontcolor(gr_getcolor(0, 20, 0), -1);
 		PAGE_IN_GAUGE(GAUGE_LIVES);
 		bm = &GameBitmaps[GET_GAUGE_INDEX(GAUGE_LIVES)];
-		gr_ubitmapm(10, 3, bm);
-		gr_printf(10 + bm->bm_w + bm->bm_w / 2, 4, "x %d", Players[Player_num].lives - 1);
+
+		sprintf(lives_str, "x %d", lives);
+		gr_get_string_size(lives_str, &w, &h, &aw);
+		if (hud_layer_begin(HUD_LAYER_LIVES, 10, 3, bm->bm_w + bm->bm_w / 2 + w, std::max((int)bm->bm_h, h + 1), &lives, 1))
+		{
+			gr_ubitmapm(0, 0, bm);
+			gr_printf(bm->bm_w + bm->bm_w / 2, 1, "%s", lives_str);
+		}
+		hud_layer_end(HUD_LAYER_LIVES);
 	}
 
 }
@@ -1802,6 +1962,7 @@ void close_gauge_canvases()
 	gr_free_canvas(Canv_RightEnergyGauge);
 	gr_free_canvas(Canv_NumericalGauge);
 	gr_free_canvas(Canv_AfterburnerGauge);
+	hud_layers_close();
 }
 
 void init_gauges()
@@ -1833,6 +1994,8 @@ void init_gauges()
 	cloak_fade_state = 0;
 
 	weapon_box_user[0] = weapon_box_user[1] = WBU_WEAPON;
+
+	hud_layers_invalidate();
 }
 
 void draw_energy_bar(int energy)
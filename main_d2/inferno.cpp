@@ -33,11 +33,14 @@ char copyright[] = "DESCENT II  COPYRIGHT (C) 1994-1996 PARALLAX SOFTWARE CORPOR
 #include "platform/mono.h"
 #include "platform/key.h"
 #include "platform/timer.h"
+#include "platform/jobs.h"
+#include "platform/timeline.h"
 #include "3d/3d.h"
 #include "bm.h"
 #include "inferno.h"
 #include "misc/error.h"
 #include "game.h"
+#include "physics.h"
 #include "segment.h"		//for Side_to_verts
 #include "mem/mem.h"
 #include "segpoint.h"
@@ -75,6 +78,10 @@ char copyright[] = "DESCENT II  COPYRIGHT (C) 1994-1996 PARALLAX SOFTWARE CORPOR
 #include "gamepal.h"
 #include "mission.h"
 #include "movie.h"
+#include "state.h"
+#include "lightbake.h"
+#include "terrain.h"
+#include "platform/capture.h"
 #include "main_shared/compbit.h"
 #include "misc/types.h"
 
@@ -491,11 +498,20 @@ char	Auto_file[128] = "";
 
 void show_order_form();
 
+//Returns the position of a headless option like -lightbake if it was given with a level name, or 0
+static int headless_arg(const char* option)
+{
+	int t = FindArg(option);
+
+	return (t && t + 1 < Num_args) ? t : 0;
+}
+
 int D_DescentMain(int argc, const char** argv)
 {
 	int i, t;		//note: don't change these without changing stack lockdown code below
 	uint8_t title_pal[768];
 	int num_text_strings = 649;
+	int phase = timeline_begin("Platform and hog");	//see -timeline
 #if defined(CHOCOLATE_USE_LOCALIZED_PATHS)
 	char hogfile_full_path[CHOCOLATE_MAX_FILE_PATH_SIZE];
 	init_all_platform_localized_paths();
@@ -508,11 +524,15 @@ int D_DescentMain(int argc, const char** argv)
 
 	InitArgs(argc, argv);
 
-	int initStatus = plat_init();
-	if (initStatus)
+	//Baking lighting and checking the sweeps run headless, so they don't bring up the platform layer
+	if (!headless_arg("-lightbake") && !headless_arg("-moveverify"))
 	{
-		Error("Error initalizing graphics library, code %d\n", initStatus);
-		return 1;
+		int initStatus = plat_init();
+		if (initStatus)
+		{
+			Error("Error initalizing graphics library, code %d\n", initStatus);
+			return 1;
+		}
 	}
 
 	if (FindArg("-verbose"))
@@ -549,6 +569,7 @@ int D_DescentMain(int argc, const char** argv)
 	}
 
 	load_text(num_text_strings);
+	timeline_end(phase);
 
 	//print out the banner title
 	printf("\nDESCENT 2 %s v%d.%d", VERSION_TYPE, Version_major, Version_minor);
@@ -595,17 +616,80 @@ int D_DescentMain(int argc, const char** argv)
 		Skip_briefing_screens = 1;
 #endif
 
+	//Run the simulation at a fixed rate, independent of the frame rate
+	int tickParam = FindArg("-fixedtick");
+	if (tickParam && tickParam < (Num_args - 1))
+	{
+		Fixed_tick_rate = atoi(Args[tickParam + 1]);
+		if (Fixed_tick_rate < 5)
+			Fixed_tick_rate = 5;
+		if (Fixed_tick_rate > 150)
+			Fixed_tick_rate = 150;
+		if (Inferno_verbose) printf("Simulating at %d ticks per second\n", Fixed_tick_rate);
+	}
+
+	//Run all object sweeps in place instead of precomputing them as jobs
+	if (FindArg("-nomovejobs"))
+		Phys_sweep_jobs = 0;
+	if (FindArg("-movecheck"))
+		Phys_sweep_check = 1;
+
+	//Print memory stats for every level
+	if (FindArg("-memstats"))
+		Mem_stats_dump = 1;
+
 	//[ISB] Allow the user to configure the FPS limit, if desired
+	//With a fixed tick the simulation no longer depends on the frame rate, so it can go higher.
 	int limitParam = FindArg("-fpslimit");
 	if (limitParam && limitParam < (Num_args - 1))
 	{
+		int maxFPS = Fixed_tick_rate ? 1000 : 150;
 		FPSLimit = atoi(Args[limitParam + 1]);
-		if (FPSLimit < 4) FPSLimit = 4; if (FPSLimit > 150) FPSLimit = 150;
+		if (FPSLimit < 4) FPSLimit = 4; if (FPSLimit > maxFPS) FPSLimit = maxFPS;
 	}
 	if (Inferno_verbose) printf("Setting FPS Limit %d\n", FPSLimit);
 
+	//Single player games can be allowed more objects than the original limit
+	int maxObjectsParam = FindArg("-maxobjects");
+	if (maxObjectsParam && maxObjectsParam < (Num_args - 1))
+	{
+		Max_objects_single = atoi(Args[maxObjectsParam + 1]);
+		if (Max_objects_single < MAX_OBJECTS_LEGACY)
+			Max_objects_single = MAX_OBJECTS_LEGACY;
+		if (Max_objects_single > MAX_OBJECTS)
+			Max_objects_single = MAX_OBJECTS;
+	}
+
+	//Draw the exit sequence terrain with less detail past this many cells from the viewer
+	int terrainLodParam = FindArg("-terrainlod");
+	if (terrainLodParam && terrainLodParam < (Num_args - 1))
+	{
+		Terrain_lod_distance = atoi(Args[terrainLodParam + 1]);
+		if (Terrain_lod_distance < 0) Terrain_lod_distance = 0;
+	}
+
 	Lighting_on = 1;
 
+	//Bake the static lighting of a level, or check the precomputed object sweeps against running them
+	//in place, and exit. These only need the game data, so they're done before any graphics or sound is set up.
+	if (headless_arg("-lightbake") || headless_arg("-moveverify"))
+	{
+		int jobThreadsParam = FindArg("-jobthreads");
+		int outParam = FindArg("-lightbakeout");
+		int result;
+
+		job_init((jobThreadsParam && jobThreadsParam < (Num_args - 1)) ? atoi(Args[jobThreadsParam + 1]) : 0);
+		gr_use_palette_table(DEFAULT_PALETTE);
+		bm_init();
+
+		if ((t = headless_arg("-lightbake")) != 0)
+			result = lightbake_run(Args[t + 1], (outParam && outParam < (Num_args - 1)) ? Args[outParam + 1] : NULL, FindArg("-quick") != 0, FindArg("-compare") != 0);
+		else
+			result = phys_sweep_verify(Args[headless_arg("-moveverify") + 1]);
+		set_exit_message("");
+		return(result);
+	}
+
 	check_memory();
 
 	if (init_graphics()) return 1;
@@ -626,6 +710,7 @@ int D_DescentMain(int argc, const char** argv)
 	if (!WVIDEO_running)
 		mprintf((0, "WVIDEO_running = %d\n", WVIDEO_running));
 
+	phase = timeline_begin("Config and input");
 	verbose("%s", TXT_VERBOSE_1);
 	ReadConfigFile();
 
@@ -637,6 +722,10 @@ int D_DescentMain(int argc, const char** argv)
 	verbose("\n%s", TXT_VERBOSE_2);
 	timer_init();
 
+	//Threads for the job system, counting the main thread. By default one per core.
+	int jobThreadsParam = FindArg("-jobthreads");
+	job_init((jobThreadsParam && jobThreadsParam < (Num_args - 1)) ? atoi(Args[jobThreadsParam + 1]) : 0);
+
 	verbose("\n%s", TXT_VERBOSE_3);
 	key_init();
 
@@ -654,8 +743,10 @@ Here:
 	do_joystick_init();
 
 	verbose("\n%s", TXT_VERBOSE_11);
+	timeline_end(phase);
 
 	//------------ Init sound ---------------
+	phase = timeline_begin("Sound");
 	if (!FindArg("-disablesound"))
 	{
 		if (digi_init())
@@ -668,6 +759,8 @@ Here:
 		verbose("\n%s", TXT_SOUND_DISABLED);
 	}
 
+	timeline_end(phase);
+
 #ifdef NETWORK
 	do_network_init();
 #endif
@@ -692,11 +785,13 @@ Here:
 #endif
 
 	// Load the palette stuff. Returns non-zero if error.
+	phase = timeline_begin("Palette and fonts");
 	mprintf((0, "\nInitializing palette system..."));
 	gr_use_palette_table(DEFAULT_PALETTE);
 
 	mprintf((0, "\nInitializing font system..."));
 	gamefont_init();	// must load after palette data loaded.
+	timeline_end(phase);
 
 	//determine whether we're using high-res menus & movies
 #if !defined(POLY_ACC)
@@ -709,8 +804,17 @@ Here:
 
 	mprintf((0, "\nInitializing movie libraries..."));
 
+	phase = timeline_begin("Movie libraries");
 	if (CurrentDataVersion == DataVer::FULL)
 		init_movies();		//init movie libraries
+	timeline_end(phase);
+
+	if ((t = FindArg("-mvebench")) != 0 && t + 1 < Num_args)
+	{
+		benchmark_movie(Args[t + 1]);
+		set_exit_message("");
+		return(0);
+	}
 
 	mprintf((0, "\nGoing into graphics mode..."));
 	verbose("\nSetting graphics mode...");
@@ -719,6 +823,7 @@ Here:
 #else
 	gr_set_mode(MovieHires ? SM_640x480V : SM_320x200C);
 #endif
+	phase = timeline_begin("Intro");
 	if (CurrentDataVersion == DataVer::FULL)
 	{
 #ifndef RELEASE
@@ -819,9 +924,12 @@ Here:
 		show_title_screen("logo.pcx", 1, 1);
 	}
 
+	timeline_end(phase);
+
 	//PA_DFX(pa_splash());
 
 	mprintf((0, "\nShowing loading screen..."));
+	phase = timeline_begin("Loading screen");
 	{
 		//grs_bitmap title_bm;
 		int pcx_error;
@@ -850,12 +958,16 @@ Here:
 			Error("Couldn't load pcx file '%s', PCX load error: %s\n", filename, pcx_errormsg(pcx_error));
 	}
 
+	timeline_end(phase);
+
 	mprintf((0, "\nDoing bm_init..."));
+	phase = timeline_begin("Game data");
 #ifdef EDITOR
 	bm_init_use_tbl();
 #else
 	bm_init();
 #endif
+	timeline_end(phase);
 
 #ifdef EDITOR
 	if (FindArg("-hoarddata") != 0) 
@@ -932,6 +1044,7 @@ Here:
 		return(0);
 
 	mprintf((0, "\nInitializing 3d system..."));
+	phase = timeline_begin("Game systems");
 	g3_init();
 
 	mprintf((0, "\nInitializing texture caching system..."));
@@ -941,6 +1054,7 @@ Here:
 	set_screen_mode(SCREEN_MENU);
 
 	init_game();
+	timeline_end(phase);
 
 	//	If built with editor, option to auto-load a level and quit game
 	//	to write certain data.
@@ -960,7 +1074,11 @@ Here:
 	}
 	else
 #endif
+	{
+		//Startup is done once the first menu is up
+		timeline_print(FindArg("-timeline"));
 		do_register_player(title_pal);
+	}
 
 	gr_palette_fade_out(title_pal, 32, 0);
 
@@ -1058,6 +1176,10 @@ Here:
 		}
 	}
 
+	state_wait_for_write();
+	state_free_quick_snapshots();
+	capture_stop();		//finish a movie capture that was still running
+
 	WriteConfigFile();
 	plat_save_chocolate_cfg();
 
@@ -12,6 +12,9 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 */
 
 #include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
 
 //[ISB] stupid stuff
 //[Future ISB] good comment btw I guess they forgot fix or something.h
@@ -24,6 +27,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "misc/args.h"
 #include "segment.h"
 #include "fvi.h"
+#include "gameseg.h"
 #include "segpoint.h"
 #include "misc/error.h"
 #include "platform/mono.h"
@@ -213,6 +217,7 @@ int create_weapon_object(int weapon_type,int segnum,vms_vector *position)
 	{
 		obj->rtype.pobj_info.model_num = Weapon_info[obj->id].model_num;
 		obj->size = fixdiv(Polygon_models[obj->rtype.pobj_info.model_num].rad,Weapon_info[obj->id].po_len_to_width_ratio);
+		fvi_broadphase_update(objnum);
 	}
 
 	obj->mtype.phys_info.mass = Weapon_info[weapon_type].mass;
@@ -386,6 +391,7 @@ void create_omega_blobs(int firing_segnum, vms_vector *firing_pos, vms_vector *g
 			vm_vec_scale(&objp->mtype.phys_info.velocity, F1_0*4);
 
 			objp->size = Weapon_info[objp->id].blob_size;
+			fvi_broadphase_update(blob_objnum);
 
 			objp->shields = fixmul(OMEGA_DAMAGE_SCALE*FrameTime, Weapon_info[objp->id].strength[Difficulty_level]);
 	
@@ -437,7 +443,7 @@ void omega_charge_frame(void)
 	}
 
 	//	Don't charge while firing.
-	if ((Last_omega_fire_frame == FrameCount) || (Last_omega_fire_frame == FrameCount-1))
+	if ((Last_omega_fire_frame == Tick_count) || (Last_omega_fire_frame == Tick_count-1))
 		return;
 
 	if (Players[Player_num].energy) {
@@ -489,7 +495,7 @@ void do_omega_stuff(object *parent_objp, vms_vector *firing_pos, object *weapon_
 		//	Ensure that the lightning cannon can be fired next frame.
 		Next_laser_fire_time = GameTime+1;
 
-		Last_omega_fire_frame = FrameCount;
+		Last_omega_fire_frame = Tick_count;
 	}
 
 	weapon_objp->ctype.laser_info.parent_type = OBJ_PLAYER;
@@ -726,7 +732,10 @@ int Laser_create_new( vms_vector * direction, vms_vector * position, int segnum,
 			} else
 				mprintf((0, "Warning: Laser tip outside mine.  Laser not being moved to end of gun.\n"));
 		} else
+		{
 			obj->pos = end_pos;
+			fvi_broadphase_update(objnum);
+		}
 	}
 
 	//	Here's where to fix the problem with objects which are moving backwards imparting higher velocity to their weaponfire.
@@ -843,6 +852,354 @@ int object_to_object_visibility(object *obj1, object *obj2, int trans_type)
 
 fix	Min_trackable_dot = MIN_TRACKABLE_DOT;
 
+//	-----------------------------------------------------------------------------------------------------------
+//	Homing target index.  Everything a homing weapon can lock on to, by kind, for searches that can't just look at
+//	the segments near the tracker (see below).  It is rebuilt the first time it's needed each frame,
+//	and obj_create adds new objects to it, so it always has every object that is trackable right now.  Entries can go
+//	stale when an object dies, so the searches check the live object.  Ghosts are kept with the players since they
+//	turn back into players without going through obj_create.
+#define	HOMING_KIND_PLAYER	0
+#define	HOMING_KIND_ROBOT		1
+#define	HOMING_KIND_PROX		2
+#define	NUM_HOMING_KINDS		3
+
+static short	Homing_index[NUM_HOMING_KINDS][MAX_OBJECTS];
+static int		Homing_index_count[NUM_HOMING_KINDS];
+static int		Homing_index_valid = 0;
+static fix		Homing_index_time;
+
+static int homing_kind(object *objp)
+{
+	switch (objp->type)
+	{
+	case OBJ_PLAYER:
+	case OBJ_GHOST:
+		return HOMING_KIND_PLAYER;
+	case OBJ_ROBOT:
+		return HOMING_KIND_ROBOT;
+	case OBJ_WEAPON:
+		if ((objp->id == PROXIMITY_ID) || (objp->id == SUPERPROX_ID))
+			return HOMING_KIND_PROX;
+		break;
+	}
+	return -1;
+}
+
+static void homing_index_build()
+{
+	int	objnum, kind;
+
+	for (kind=0; kind<NUM_HOMING_KINDS; kind++)
+		Homing_index_count[kind] = 0;
+
+	for (objnum=0; objnum<=Highest_object_index; objnum++)
+	{
+		kind = homing_kind(&Objects[objnum]);
+		if (kind != -1)
+			Homing_index[kind][Homing_index_count[kind]++] = objnum;
+	}
+
+	Homing_index_valid = 1;
+	Homing_index_time = GameTime;
+}
+
+static void homing_index_update()
+{
+	if (!Homing_index_valid || (Homing_index_time != GameTime))
+		homing_index_build();
+}
+
+void homing_index_add(int objnum)
+{
+	int	kind;
+
+	if (!Homing_index_valid)
+		return;
+
+	kind = homing_kind(&Objects[objnum]);
+	if (kind == -1)
+		return;
+
+	//	Slots reused within a frame can leave duplicates, so this can fill up.  Just rebuild next time.
+	if (Homing_index_count[kind] >= MAX_OBJECTS)
+		Homing_index_valid = 0;
+	else
+		Homing_index[kind][Homing_index_count[kind]++] = objnum;
+}
+
+//	-----------------------------------------------------------------------------------------------------------
+//	Homing targets by segment.  A target that passes the visibility test is at the end of a line of sight that starts
+//	in the tracker's segment, stays within the tracking distance and only goes through connected segments.  So a
+//	search only needs the objects in the connected segments whose bounding spheres come that close, which it gets
+//	from the broadphase lists.  Objects can be a little outside their segment, which the slack covers.
+//	Several searches in a tick often start from the same spot (smart missile blobs, or track_track_goal testing its
+//	goal and then searching), so the segments a search reaches, the distance and direction to each target, and the
+//	visibility tests are all kept for the rest of the tick.
+#define	HOMING_SEGMENT_SLACK				(F1_0*10)
+#define	HOMING_REACH_CACHE_SIZE			16
+#define	HOMING_VISIBILITY_CACHE_SIZE	256		//	must be a power of 2
+
+static vms_vector	Homing_seg_center[MAX_SEGMENTS];
+static fix			Homing_seg_radius[MAX_SEGMENTS];
+static int			Homing_seg_bounds_valid = 0;
+static int			Homing_seg_visited[MAX_SEGMENTS];
+static int			Homing_seg_visit;
+
+//	The segments a search from pos can reach, starting in segnum.
+typedef struct homing_reach
+{
+	int			id;				//	never reused, so the target vectors can tell searches apart
+	int			tick;
+	int			segnum;
+	vms_vector	pos;
+	fix			dist;
+	int			first, count;	//	in Homing_reach_segs
+} homing_reach;
+
+static homing_reach			Homing_reaches[HOMING_REACH_CACHE_SIZE];
+static int						Homing_reach_next;
+static int						Homing_reach_id;
+static std::vector<short>	Homing_reach_segs;
+static int						Homing_reach_segs_tick = -1;
+
+//	The distance and quick-normalized direction to a target from the position of the search with id reach_id.
+typedef struct homing_target_vec
+{
+	int			reach_id;
+	vms_vector	pos;
+	fix			dist;
+	vms_vector	dir;
+} homing_target_vec;
+
+static homing_target_vec	Homing_target_vecs[MAX_OBJECTS];
+
+static short	Homing_targets[NUM_HOMING_KINDS * MAX_OBJECTS];
+
+//	A visibility test done this tick, filed by tracker segment and target.
+typedef struct homing_visibility_entry
+{
+	int			tick;
+	short			tracker_seg, target;
+	int			target_sig;
+	vms_vector	tracker_pos, target_pos;
+	int			visible;
+} homing_visibility_entry;
+
+static homing_visibility_entry	Homing_visibility_cache[HOMING_VISIBILITY_CACHE_SIZE];
+
+void homing_index_reset()
+{
+	int	i;
+
+	Homing_index_valid = 0;
+	Homing_seg_bounds_valid = 0;
+	Homing_reach_segs_tick = -1;
+	for (i=0; i<HOMING_REACH_CACHE_SIZE; i++)
+		Homing_reaches[i].tick = -1;
+	for (i=0; i<HOMING_VISIBILITY_CACHE_SIZE; i++)
+		Homing_visibility_cache[i].tick = -1;
+}
+
+static void homing_seg_bounds_build()
+{
+	int	segnum, v;
+
+	for (segnum=0; segnum<=Highest_segment_index; segnum++)
+	{
+		segment	*segp = &Segments[segnum];
+		fix		radius = 0;
+
+		compute_segment_center(&Homing_seg_center[segnum], segp);
+		for (v=0; v<MAX_VERTICES_PER_SEGMENT; v++)
+			radius = std::max(radius, vm_vec_dist(&Vertices[segp->verts[v]], &Homing_seg_center[segnum]));
+		Homing_seg_radius[segnum] = radius + HOMING_SEGMENT_SLACK;
+	}
+
+	Homing_seg_bounds_valid = 1;
+}
+
+static int homing_seg_in_reach(int segnum, vms_vector *pos, fix dist)
+{
+	return vm_vec_dist(pos, &Homing_seg_center[segnum]) <= dist + Homing_seg_radius[segnum];
+}
+
+//	Return the segments a search from pos for targets up to dist away can reach, finding them if this tick hasn't
+//	already.  Returns NULL if the tracker's segment isn't near pos, in which case the search uses the whole index.
+static homing_reach *homing_reach_get(vms_vector *pos, object *tracker, fix dist)
+{
+	homing_reach	*reach;
+	int				i, segnum, sidenum, child;
+
+	if (tracker->segnum < 0)
+		return NULL;
+
+	if (!Homing_seg_bounds_valid)
+		homing_seg_bounds_build();
+
+	//	The line of sight starts at the tracker, which need not be at pos.
+	dist += vm_vec_dist(pos, &tracker->pos);
+
+	for (i=0; i<HOMING_REACH_CACHE_SIZE; i++)
+	{
+		reach = &Homing_reaches[i];
+		if ((reach->tick == Tick_count) && (reach->segnum == tracker->segnum) && (reach->dist == dist) && !memcmp(&reach->pos, pos, sizeof(vms_vector)))
+			return reach;
+	}
+
+	if (!homing_seg_in_reach(tracker->segnum, pos, dist))
+		return NULL;
+
+	if (Homing_reach_segs_tick != Tick_count)
+	{
+		Homing_reach_segs.clear();
+		Homing_reach_segs_tick = Tick_count;
+	}
+
+	reach = &Homing_reaches[Homing_reach_next];
+	Homing_reach_next = (Homing_reach_next + 1) % HOMING_REACH_CACHE_SIZE;
+	reach->id = ++Homing_reach_id;
+	reach->tick = Tick_count;
+	reach->segnum = tracker->segnum;
+	reach->pos = *pos;
+	reach->dist = dist;
+	reach->first = Homing_reach_segs.size();
+
+	//	Breadth first through the connected segments in reach.  Walls are ignored, since some can be seen through.
+	Homing_seg_visit++;
+	Homing_seg_visited[tracker->segnum] = Homing_seg_visit;
+	Homing_reach_segs.push_back(tracker->segnum);
+	for (i=reach->first; i<(int)Homing_reach_segs.size(); i++)
+	{
+		segnum = Homing_reach_segs[i];
+		for (sidenum=0; sidenum<MAX_SIDES_PER_SEGMENT; sidenum++)
+		{
+			child = Segments[segnum].children[sidenum];
+			if (!IS_CHILD(child) || (Homing_seg_visited[child] == Homing_seg_visit))
+				continue;
+
+			Homing_seg_visited[child] = Homing_seg_visit;
+			if (homing_seg_in_reach(child, pos, dist))
+				Homing_reach_segs.push_back(child);
+		}
+	}
+	reach->count = Homing_reach_segs.size() - reach->first;
+
+	return reach;
+}
+
+//	Fill Homing_targets with the objects of the kinds in scan_kind that a search might track, and return how many.
+//	Without a reach that's everything in the index, which can have stale entries and duplicates.
+static int homing_gather(homing_reach *reach, int *scan_kind)
+{
+	int			i, j, n, kind, num_targets = 0;
+	const short	*objnums;
+
+	if (!reach)
+	{
+		homing_index_update();
+		for (kind=0; kind<NUM_HOMING_KINDS; kind++)
+			if (scan_kind[kind])
+				for (i=0; i<Homing_index_count[kind]; i++)
+					Homing_targets[num_targets++] = Homing_index[kind][i];
+		return num_targets;
+	}
+
+	for (i=0; i<reach->count; i++)
+	{
+		n = fvi_broadphase_segment_objects(Homing_reach_segs[reach->first + i], &objnums);
+		for (j=0; j<n; j++)
+		{
+			kind = homing_kind(&Objects[objnums[j]]);
+			if ((kind != -1) && scan_kind[kind])
+				Homing_targets[num_targets++] = objnums[j];
+		}
+	}
+
+	return num_targets;
+}
+
+//	Set dir to the quick-normalized direction from pos to Objects[objnum] and return the distance, the way the
+//	searches always measured them.  Kept for the rest of the tick when the search has a reach.
+static fix homing_target_dir(homing_reach *reach, vms_vector *pos, int objnum, vms_vector *dir)
+{
+	homing_target_vec	*tv = &Homing_target_vecs[objnum];
+	object				*objp = &Objects[objnum];
+	fix					dist;
+
+	if (reach && (tv->reach_id == reach->id) && !memcmp(&tv->pos, &objp->pos, sizeof(vms_vector)))
+	{
+		*dir = tv->dir;
+		return tv->dist;
+	}
+
+	vm_vec_sub(dir, &objp->pos, pos);
+	dist = vm_vec_normalize_quick(dir);
+
+	if (reach)
+	{
+		tv->reach_id = reach->id;
+		tv->pos = objp->pos;
+		tv->dist = dist;
+		tv->dir = *dir;
+	}
+
+	return dist;
+}
+
+static int homing_visibility(object *tracker, object *objp)
+{
+	int								target = objp-Objects;
+	homing_visibility_entry		*entry = &Homing_visibility_cache[((tracker->segnum * 37) ^ target) & (HOMING_VISIBILITY_CACHE_SIZE-1)];
+
+	if ((entry->tick == Tick_count) && (entry->tracker_seg == tracker->segnum) && (entry->target == target) && (entry->target_sig == objp->signature) &&
+		!memcmp(&entry->tracker_pos, &tracker->pos, sizeof(vms_vector)) && !memcmp(&entry->target_pos, &objp->pos, sizeof(vms_vector)))
+		return entry->visible;
+
+	entry->visible = object_to_object_visibility(tracker, objp, FQ_TRANSWALL);
+	entry->tick = Tick_count;
+	entry->tracker_seg = tracker->segnum;
+	entry->target = target;
+	entry->target_sig = objp->signature;
+	entry->tracker_pos = tracker->pos;
+	entry->target_pos = objp->pos;
+
+	return entry->visible;
+}
+
+//	Targets that passed the distance and cone tests, waiting for a visibility test.
+typedef struct homing_candidate
+{
+	short	objnum;
+	fix	dot;
+} homing_candidate;
+
+static homing_candidate	Homing_candidates[MAX_OBJECTS];
+static int	Homing_candidate_stamp[MAX_OBJECTS];
+static int	Homing_query_stamp;
+
+//	Return the candidate with the highest dot that tracker can see, or -1.  Visibility is tested best first, so
+//	usually only one fvi call is made.  On equal dots the lowest object number wins, as it did when the searches
+//	walked the object list in order and kept the first best one.
+static int homing_pick_visible(object *tracker, homing_candidate *cands, int num_cands)
+{
+	int	i, best;
+
+	while (num_cands > 0)
+	{
+		best = 0;
+		for (i=1; i<num_cands; i++)
+			if ((cands[i].dot > cands[best].dot) || ((cands[i].dot == cands[best].dot) && (cands[i].objnum < cands[best].objnum)))
+				best = i;
+
+		if (homing_visibility(tracker, &Objects[cands[best].objnum]))
+			return cands[best].objnum;
+
+		cands[best] = cands[--num_cands];
+	}
+
+	return -1;
+}
+
 //	-----------------------------------------------------------------------------------------------------------
 //	Return true if weapon *tracker is able to track object Objects[track_goal], else return false.
 //	In order for the object to be trackable, it must be within a reasonable turning radius for the missile
@@ -893,7 +1250,7 @@ int object_is_trackable(int track_goal, object *tracker, fix *dot)
 	{
 		int	rval;
 		//	dot is in legal range, now see if object is visible
-		rval =  object_to_object_visibility(tracker, objp, FQ_TRANSWALL);
+		rval =  homing_visibility(tracker, objp);
 //mprintf((0, " TRACK "));
 		return rval;
 	}
@@ -934,7 +1291,7 @@ int call_find_homing_object_complete(object *tracker, vms_vector *curpos)
 
 //	--------------------------------------------------------------------------------------------
 //	Find object to home in on.
-//	Scan list of objects rendered last frame, find one that satisfies function of nearness to center and distance.
+//	Scan the homing target index, find one that satisfies function of nearness to center and distance.
 int find_homing_object(vms_vector *curpos, object *tracker)
 {
 	int	i;
@@ -963,112 +1320,158 @@ int find_homing_object(vms_vector *curpos, object *tracker)
 				best_objnum = ConsoleObject - Objects;
 		} else 
 		{
-			int	window_num = -1;
-			fix	dist, max_trackable_dist;
-
-			//	Find the window which has the forward view.
-			for (i=0; i<MAX_RENDERED_WINDOWS; i++)
-				if (Window_rendered_data[i].frame >= FrameCount-1)
-					if (Window_rendered_data[i].viewer == ConsoleObject)
-						if (!Window_rendered_data[i].rear_view) 
-						{
-							window_num = i;
-							break;
-						}
-
-			//	Couldn't find suitable view from this frame, so do complete search.
-			if (window_num == -1)
-			{
-				mprintf((0, "Note: Calling find_homing_object_complete because no suitable rendered window.\n"));
-				return call_find_homing_object_complete(tracker, curpos);
-			}
+			int				num_cands = 0, num_targets;
+			fix				dist, max_trackable_dist;
+			int				scan_kind[NUM_HOMING_KINDS] = { 0, 1, 0 };
+			homing_reach	*reach;
 
 			max_trackable_dist = MAX_TRACKABLE_DIST;
 			if (tracker->id == OMEGA_ID)
 				max_trackable_dist = OMEGA_MAX_TRACKABLE_DIST;
 
-			//	Not in network mode and fired by player.
-			for (i=Window_rendered_data[window_num].num_objects-1; i>=0; i--) 
+			//	Not in network mode and fired by player.  This used to look only at the objects rendered in the forward
+			//	view last frame.  The index has every robot, and the visibility test stands in for having been drawn.
+			reach = homing_reach_get(curpos, tracker, max_trackable_dist);
+			num_targets = homing_gather(reach, scan_kind);
+			Homing_query_stamp++;
+
+			for (i=0; i<num_targets; i++) 
 			{
-				fix			dot; //, dist;
+				fix			dot;
 				vms_vector	vec_to_curobj;
-				int			objnum = Window_rendered_data[window_num].rendered_objects[i];
+				int			objnum = Homing_targets[i];
 				object		*curobjp = &Objects[objnum];
 
-				if (objnum == Players[Player_num].objnum)
+				if ((curobjp->type != OBJ_ROBOT) || (objnum > Highest_object_index))
 					continue;
 
 				//	Can't track AI object if he's cloaked.
-				if (curobjp->type == OBJ_ROBOT) 
-				{
-					if (curobjp->ctype.ai_info.CLOAKED)
-						continue;
+				if (curobjp->ctype.ai_info.CLOAKED)
+					continue;
 
-					//	Your missiles don't track your escort.
-					if (Robot_info[curobjp->id].companion)
-						if (tracker->ctype.laser_info.parent_type == OBJ_PLAYER)
-							continue;
-				}
+				//	Your missiles don't track your escort.
+				if (Robot_info[curobjp->id].companion)
+					if (tracker->ctype.laser_info.parent_type == OBJ_PLAYER)
+						continue;
 
-				vm_vec_sub(&vec_to_curobj, &curobjp->pos, curpos);
-				dist = vm_vec_normalize_quick(&vec_to_curobj);
+				dist = homing_target_dir(reach, curpos, objnum, &vec_to_curobj);
 				if (dist < max_trackable_dist)
 				{
 					dot = vm_vec_dot(&vec_to_curobj, &tracker->orient.fvec);
 
-					// mprintf(0, "Object %i: dist = %7.3f, dot = %7.3f\n", objnum, f2fl(dist), f2fl(dot));
-
 					//	Note: This uses the constant, not-scaled-by-frametime value, because it is only used
 					//	to determine if an object is initially trackable.  find_homing_object is called on subsequent
 					//	frames to determine if the object remains trackable.
-					// mprintf((0, "find_homing_object:  [%3i] %7.3f, min = %7.3f\n", curobjp-Objects, f2fl(dot), f2fl(MIN_TRACKABLE_DOT)));
-					if (dot > cur_min_trackable_dot) 
-					{
-						if (dot > max_dot) 
-						{
-							if (object_to_object_visibility(tracker, &Objects[objnum], FQ_TRANSWALL))
-							{
-								max_dot = dot;
-								best_objnum = objnum;
-							}
-						}
-					} else if (dot > F1_0 - (F1_0 - cur_min_trackable_dot)*2) 
+					if ((dot <= cur_min_trackable_dot) && (dot > F1_0 - (F1_0 - cur_min_trackable_dot)*2)) 
 					{
 						vm_vec_normalize(&vec_to_curobj);
 						dot = vm_vec_dot(&vec_to_curobj, &tracker->orient.fvec);
-						if (dot > cur_min_trackable_dot)
-						{
-							if (dot > max_dot)
-							{
-								if (object_to_object_visibility(tracker, &Objects[objnum], FQ_TRANSWALL))
-								{
-									max_dot = dot;
-									best_objnum = objnum;
-								}
-							}
-						}
+					}
+
+					if ((dot > cur_min_trackable_dot) && (Homing_candidate_stamp[objnum] != Homing_query_stamp))
+					{
+						Homing_candidate_stamp[objnum] = Homing_query_stamp;
+						Homing_candidates[num_cands].objnum = objnum;
+						Homing_candidates[num_cands].dot = dot;
+						num_cands++;
 					}
 				}
 			}
+
+			best_objnum = homing_pick_visible(tracker, Homing_candidates, num_cands);
 		}
 	}
 	// mprintf(0, "Selecting object #%i\n=n", best_objnum);
 	return best_objnum;
 }
 
+//	--------------------------------------------------------------------------------------------
+//	Add Objects[objnum] to the candidates if tracker could track it.  Helper for find_homing_object_complete.
+static void homing_consider(int objnum, homing_reach *reach, vms_vector *curpos, object *tracker, int track_obj_type1, int track_obj_type2,
+	fix max_trackable_dist, fix min_trackable_dot, int *num_cands)
+{
+	int			is_proximity = 0;
+	fix			dot, dist;
+	vms_vector	vec_to_curobj;
+	object		*curobjp = &Objects[objnum];
+
+	if (objnum > Highest_object_index)
+		return;
+
+	if ((curobjp->type != track_obj_type1) && (curobjp->type != track_obj_type2))
+		if ((curobjp->type == OBJ_WEAPON) && ((curobjp->id == PROXIMITY_ID) || (curobjp->id == SUPERPROX_ID))) 
+		{
+			if (curobjp->ctype.laser_info.parent_signature != tracker->ctype.laser_info.parent_signature)
+				is_proximity = 1;
+			else
+				return;
+		} else
+			return;
+
+	if (objnum == tracker->ctype.laser_info.parent_num) // Don't track shooter
+		return;
+
+	//	Don't track cloaked players.
+	if (curobjp->type == OBJ_PLAYER)
+	{
+		if (Players[curobjp->id].flags & PLAYER_FLAGS_CLOAKED)
+			return;
+		// Don't track teammates in team games
+		#ifdef NETWORK
+		if ((Game_mode & GM_TEAM) && (Objects[tracker->ctype.laser_info.parent_num].type == OBJ_PLAYER) && (get_team(curobjp->id) == get_team(Objects[tracker->ctype.laser_info.parent_num].id)))
+			return;
+		#endif
+	}
+
+	//	Can't track AI object if he's cloaked.
+	if (curobjp->type == OBJ_ROBOT) 
+	{
+		if (curobjp->ctype.ai_info.CLOAKED)
+			return;
+
+		//	Your missiles don't track your escort.
+		if (Robot_info[curobjp->id].companion)
+			if (tracker->ctype.laser_info.parent_type == OBJ_PLAYER)
+				return;
+	}
+
+	dist = homing_target_dir(reach, curpos, objnum, &vec_to_curobj);
+
+	if (dist < max_trackable_dist)
+	{
+		dot = vm_vec_dot(&vec_to_curobj, &tracker->orient.fvec);
+		if (is_proximity)
+			dot = ((dot << 3) + dot) >> 3;		//	I suspect Watcom would be too stupid to figure out the obvious...
+
+		//	Note: This uses the constant, not-scaled-by-frametime value, because it is only used
+		//	to determine if an object is initially trackable.  find_homing_object is called on subsequent
+		//	frames to determine if the object remains trackable.
+		// mprintf((0, "fho_complete:        [%3i] %7.3f, min = %7.3f\n", curobjp-Objects, f2fl(dot), f2fl(MIN_TRACKABLE_DOT)));
+		if ((dot > min_trackable_dot) && (Homing_candidate_stamp[objnum] != Homing_query_stamp))
+		{
+			Homing_candidate_stamp[objnum] = Homing_query_stamp;
+			Homing_candidates[*num_cands].objnum = objnum;
+			Homing_candidates[*num_cands].dot = dot;
+			(*num_cands)++;
+		}
+	}
+}
+
 //	--------------------------------------------------------------------------------------------
 //	Find object to home in on.
-//	Scan list of objects rendered last frame, find one that satisfies function of nearness to center and distance.
+//	Scan the homing target index, find one that satisfies function of nearness to center and distance.
 //	Can track two kinds of objects.  If you are only interested in one type, set track_obj_type2 to NULL
 //	Always track proximity bombs.  --MK, 06/14/95
 //	Make homing objects not track parent's prox bombs.
 int find_homing_object_complete(vms_vector *curpos, object *tracker, int track_obj_type1, int track_obj_type2)
 {
-	int	objnum;
-	fix	max_dot = -F1_0*2;
-	int	best_objnum = -1;
-	fix	max_trackable_dist;
+	int				i;
+	int				num_cands = 0, num_targets;
+	fix				max_trackable_dist;
+	homing_reach	*reach;
 	fix	min_trackable_dot;
+	int	scan_kind[NUM_HOMING_KINDS];
+	int	scan_all = 0;
 
 	//	Contact Mike: This is a bad and stupid thing.  Who called this routine with an illegal laser type??
 	Assert((Weapon_info[tracker->id].homing_flag) || (tracker->id == OMEGA_ID));
@@ -1082,80 +1485,31 @@ int find_homing_object_complete(vms_vector *curpos, object *tracker, int track_o
 		min_trackable_dot = OMEGA_MIN_TRACKABLE_DOT;
 	}
 
-	for (objnum=0; objnum<=Highest_object_index; objnum++)
-	{
-		int			is_proximity = 0;
-		fix			dot, dist;
-		vms_vector	vec_to_curobj;
-		object		*curobjp = &Objects[objnum];
-
-		if ((curobjp->type != track_obj_type1) && (curobjp->type != track_obj_type2))
-			if ((curobjp->type == OBJ_WEAPON) && ((curobjp->id == PROXIMITY_ID) || (curobjp->id == SUPERPROX_ID))) 
-			{
-				if (curobjp->ctype.laser_info.parent_signature != tracker->ctype.laser_info.parent_signature)
-					is_proximity = 1;
-				else
-					continue;
-			} else
-				continue;
-
-		if (objnum == tracker->ctype.laser_info.parent_num) // Don't track shooter
-			continue;
-
-		//	Don't track cloaked players.
-		if (curobjp->type == OBJ_PLAYER)
-		{
-			if (Players[curobjp->id].flags & PLAYER_FLAGS_CLOAKED)
-				continue;
-			// Don't track teammates in team games
-			#ifdef NETWORK
-			if ((Game_mode & GM_TEAM) && (Objects[tracker->ctype.laser_info.parent_num].type == OBJ_PLAYER) && (get_team(curobjp->id) == get_team(Objects[tracker->ctype.laser_info.parent_num].id)))
-				continue;
-			#endif
-		}
-
-		//	Can't track AI object if he's cloaked.
-		if (curobjp->type == OBJ_ROBOT) 
-		{
-			if (curobjp->ctype.ai_info.CLOAKED)
-				continue;
-
-			//	Your missiles don't track your escort.
-			if (Robot_info[curobjp->id].companion)
-				if (tracker->ctype.laser_info.parent_type == OBJ_PLAYER)
-					continue;
-		}
-
-		vm_vec_sub(&vec_to_curobj, &curobjp->pos, curpos);
-		dist = vm_vec_mag_quick(&vec_to_curobj);
+	//	track_track_goal passes the type of whatever now sits in the old goal's slot, which can be anything.
+	//	The index only has players, robots and prox bombs, so other types still look at every object.
+	scan_kind[HOMING_KIND_PLAYER] = (track_obj_type1 == OBJ_PLAYER) || (track_obj_type2 == OBJ_PLAYER);
+	scan_kind[HOMING_KIND_ROBOT] = (track_obj_type1 == OBJ_ROBOT) || (track_obj_type2 == OBJ_ROBOT);
+	scan_kind[HOMING_KIND_PROX] = 1;
+	if (((track_obj_type1 != -1) && (track_obj_type1 != OBJ_PLAYER) && (track_obj_type1 != OBJ_ROBOT)) ||
+		((track_obj_type2 != -1) && (track_obj_type2 != OBJ_PLAYER) && (track_obj_type2 != OBJ_ROBOT)))
+		scan_all = 1;
 
-		if (dist < max_trackable_dist)
-		{
-			vm_vec_normalize_quick(&vec_to_curobj);
-			dot = vm_vec_dot(&vec_to_curobj, &tracker->orient.fvec);
-			if (is_proximity)
-				dot = ((dot << 3) + dot) >> 3;		//	I suspect Watcom would be too stupid to figure out the obvious...
-
-			//	Note: This uses the constant, not-scaled-by-frametime value, because it is only used
-			//	to determine if an object is initially trackable.  find_homing_object is called on subsequent
-			//	frames to determine if the object remains trackable.
-			// mprintf((0, "fho_complete:        [%3i] %7.3f, min = %7.3f\n", curobjp-Objects, f2fl(dot), f2fl(MIN_TRACKABLE_DOT)));
-			if (dot > min_trackable_dot) 
-			{
-				// mprintf(0, "Object %i: dist = %7.3f, dot = %7.3f\n", objnum, f2fl(dist), f2fl(dot));
-				if (dot > max_dot)
-				{
-					if (object_to_object_visibility(tracker, &Objects[objnum], FQ_TRANSWALL)) {
-						max_dot = dot;
-						best_objnum = objnum;
-					}
-				}
-			}
-		}
+	if (scan_all)
+	{
+		Homing_query_stamp++;
+		for (i=0; i<=Highest_object_index; i++)
+			homing_consider(i, NULL, curpos, tracker, track_obj_type1, track_obj_type2, max_trackable_dist, min_trackable_dot, &num_cands);
+	}
+	else
+	{
+		reach = homing_reach_get(curpos, tracker, max_trackable_dist);
+		num_targets = homing_gather(reach, scan_kind);
+		Homing_query_stamp++;
+		for (i=0; i<num_targets; i++)
+			homing_consider(Homing_targets[i], reach, curpos, tracker, track_obj_type1, track_obj_type2, max_trackable_dist, min_trackable_dot, &num_cands);
 	}
-	// -- mprintf((0, "Selecting object #%i in find_homing_object_complete\n\n", best_objnum));
 
-	return best_objnum;
+	return homing_pick_visible(tracker, Homing_candidates, num_cands);
 }
 
 //	------------------------------------------------------------------------------------------------------------
@@ -1165,12 +1519,12 @@ int find_homing_object_complete(vms_vector *curpos, object *tracker, int track_o
 int track_track_goal(int track_goal, object *tracker, fix *dot)
 {
 	//	Every 8 frames for each object, scan all objects.
-	if (object_is_trackable(track_goal, tracker, dot) && ((((tracker-Objects) ^ FrameCount) % 8) != 0)) 
+	if (object_is_trackable(track_goal, tracker, dot) && ((((tracker-Objects) ^ Tick_count) % 8) != 0)) 
 	{
 		//mprintf((0, "ttg: QO"));
 		return track_goal;
 	}
-	else if ((((tracker-Objects) ^ FrameCount) % 4) == 0) 
+	else if ((((tracker-Objects) ^ Tick_count) % 4) == 0) 
 	{
 		int	rval = -2;
 
@@ -1459,7 +1813,7 @@ void Laser_do_weapon_sequence(object *obj)
 	}
 
 	//delete weapons that are not moving
-	if (	!((FrameCount ^ obj->signature) & 3) &&
+	if (	!((Tick_count ^ obj->signature) & 3) &&
 			(obj->id != FLARE_ID) &&
 			(Weapon_info[obj->id].speed[Difficulty_level] > 0) &&
 			(vm_vec_mag_quick(&obj->mtype.phys_info.velocity) < F2_0)) {
@@ -2122,7 +2476,7 @@ void create_smart_children(object *objp, int num_smart_children)
 		if (CurrentLogicVersion == LogicVer::SHAREWARE) //[ISB] SW always used code in above check, but this isn't always safe so try a safe emulation. 
 		{
 			parent_type = objp->ctype.ai_info.behavior | (objp->ctype.ai_info.flags[0] << 8);
-			parent_num = MAX_OBJECTS-1;
+			parent_num = MAX_OBJECTS_LEGACY-1;
 		}
 		else
 		{
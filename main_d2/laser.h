@@ -121,6 +121,11 @@ void release_guided_missile(int player_num);
 extern void create_smart_children(object *objp, int count);
 extern int object_to_object_visibility(object *obj1, object *obj2, int trans_type);
 
+//Keep the homing target index up to date. Call homing_index_add when an object is created outside the
+//frame's rebuild, and homing_index_reset when the object list is replaced wholesale.
+void homing_index_add(int objnum);
+void homing_index_reset();
+
 extern int		Muzzle_queue_index;
 
 typedef struct muzzle_info 
@@ -0,0 +1,242 @@
+/*
+The code contained in this file is not the property of Parallax Software,
+and is not under the terms of the Parallax Software Source license.
+Instead, it is released under the terms of the MIT License,
+as described in copying.txt
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "platform/platform_filesys.h"
+#include "platform/posixstub.h"
+#include "platform/mono.h"
+#include "cfile/cfile.h"
+#include "misc/args.h"
+#include "misc/error.h"
+#include "inferno.h"
+#include "mission.h"
+#include "levelcache.h"
+
+#define LEVELCACHE_DIR "levelcache"
+
+static const char levelcache_id[4] = { 'D', 'L', 'V', 'C' };
+
+typedef struct levelcache_header
+{
+	char id[4];
+	int version;
+	levelcache_key key;
+	int num_blocks;
+	uint32_t payload_size;
+	uint32_t payload_crc;
+} levelcache_header;
+
+static int levelcache_on = -1;
+
+int levelcache_enabled()
+{
+	if (levelcache_on == -1)
+		levelcache_on = FindArg("-levelcache") ? 1 : 0;
+
+	return levelcache_on;
+}
+
+//FNV-1a. Not cryptographic, but more than enough to spot a changed level.
+uint32_t levelcache_crc(const void* data, size_t len, uint32_t crc)
+{
+	const uint8_t* p = (const uint8_t*)data;
+
+	if (crc == 0)
+		crc = 2166136261u;
+
+	while (len--)
+	{
+		crc ^= *p++;
+		crc *= 16777619u;
+	}
+
+	return crc;
+}
+
+void levelcache_get_filename(char* buf, size_t bufsize, const char* levelname)
+{
+	char mission[64], level[64], name[136];
+	const char* p;
+	char* dot;
+
+	//Mission filenames can carry a path, only keep the name.
+	p = Current_mission_filename ? Current_mission_filename : "";
+	if (strrchr(p, '/')) p = strrchr(p, '/') + 1;
+	if (strrchr(p, '\\')) p = strrchr(p, '\\') + 1;
+	strncpy(mission, p, sizeof(mission) - 1);
+	mission[sizeof(mission) - 1] = '\0';
+
+	strncpy(level, levelname, sizeof(level) - 1);
+	level[sizeof(level) - 1] = '\0';
+	dot = strrchr(level, '.');
+	if (dot) *dot = '\0';
+
+	snprintf(name, sizeof(name), "%s-%s.lvc", mission, level);
+	_strlwr(name);
+
+#if defined(CHOCOLATE_USE_LOCALIZED_PATHS)
+	char subpath[CHOCOLATE_MAX_FILE_PATH_SIZE];
+	snprintf(subpath, sizeof(subpath), "%s%c%s", CHOCOLATE_SAVE_DIR, PLATFORM_PATH_SEPARATOR, LEVELCACHE_DIR);
+	get_full_file_path(buf, name, subpath);
+#else
+	snprintf(buf, bufsize, "%s%c%s", LEVELCACHE_DIR, PLATFORM_PATH_SEPARATOR, name);
+#endif
+}
+
+int levelcache_hash_source(levelcache_key* key, const char* levelname)
+{
+	CFILE* fp;
+	int len;
+	std::vector<uint8_t> data;
+
+	fp = cfopen(levelname, "rb");
+	if (!fp) return 0;
+
+	len = cfilelength(fp);
+	if (len <= 0)
+	{
+		cfclose(fp);
+		return 0;
+	}
+
+	data.resize(len);
+	if (cfread(data.data(), 1, len, fp) != (size_t)len)
+	{
+		cfclose(fp);
+		return 0;
+	}
+	cfclose(fp);
+
+	key->source_size = len;
+	key->source_crc = levelcache_crc(data.data(), len, 0);
+	return 1;
+}
+
+int levelcache_read(const char* filename, levelcache_key* key, levelcache_block* blocks, int num_blocks)
+{
+	FILE* fp;
+	long len;
+	size_t payload_size, offset;
+	int i;
+	levelcache_header* header;
+	std::vector<uint8_t> data;
+
+	fp = fopen(filename, "rb");
+	if (!fp) return 0;
+
+	fseek(fp, 0, SEEK_END);
+	len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	if (len < (long)sizeof(levelcache_header))
+	{
+		fclose(fp);
+		return 0;
+	}
+
+	data.resize(len);
+	if (fread(data.data(), 1, len, fp) != (size_t)len)
+	{
+		fclose(fp);
+		return 0;
+	}
+	fclose(fp);
+
+	header = (levelcache_header*)data.data();
+	if (memcmp(header->id, levelcache_id, 4) || header->version != LEVELCACHE_VERSION)
+		return 0;
+
+	if (memcmp(&header->key, key, sizeof(*key)) || header->num_blocks != num_blocks)
+	{
+		mprintf((0, "levelcache: %s is stale\n", filename));
+		return 0;
+	}
+
+	payload_size = 0;
+	for (i = 0; i < num_blocks; i++)
+		payload_size += blocks[i].size;
+
+	if (header->payload_size != payload_size || len != (long)(sizeof(levelcache_header) + payload_size))
+		return 0;
+
+	if (levelcache_crc(data.data() + sizeof(levelcache_header), payload_size, 0) != header->payload_crc)
+	{
+		mprintf((1, "levelcache: %s is damaged\n", filename));
+		return 0;
+	}
+
+	offset = sizeof(levelcache_header);
+	for (i = 0; i < num_blocks; i++)
+	{
+		memcpy(blocks[i].ptr, data.data() + offset, blocks[i].size);
+		offset += blocks[i].size;
+	}
+
+	return 1;
+}
+
+int levelcache_write(const char* filename, levelcache_key* key, levelcache_block* blocks, int num_blocks)
+{
+	FILE* fp;
+	int i, ok;
+	size_t offset;
+	char temp_filename[CHOCOLATE_MAX_FILE_PATH_SIZE + 4];
+	char dir[CHOCOLATE_MAX_FILE_PATH_SIZE];
+	char* separator_pos;
+	levelcache_header header;
+	std::vector<uint8_t> data;
+
+	memcpy(header.id, levelcache_id, 4);
+	header.version = LEVELCACHE_VERSION;
+	header.key = *key;
+	header.num_blocks = num_blocks;
+	header.payload_size = 0;
+	for (i = 0; i < num_blocks; i++)
+		header.payload_size += blocks[i].size;
+
+	//Build the whole file in memory, so it goes out in one write.
+	data.resize(sizeof(header) + header.payload_size);
+	offset = sizeof(header);
+	for (i = 0; i < num_blocks; i++)
+	{
+		memcpy(data.data() + offset, blocks[i].ptr, blocks[i].size);
+		offset += blocks[i].size;
+	}
+	header.payload_crc = levelcache_crc(data.data() + sizeof(header), header.payload_size, 0);
+	memcpy(data.data(), &header, sizeof(header));
+
+	strncpy(dir, filename, CHOCOLATE_MAX_FILE_PATH_SIZE - 1);
+	dir[CHOCOLATE_MAX_FILE_PATH_SIZE - 1] = '\0';
+	separator_pos = strrchr(dir, PLATFORM_PATH_SEPARATOR);
+	if (separator_pos)
+	{
+		*separator_pos = '\0';
+		mkdir_recursive(dir);
+	}
+
+	snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", filename);
+	fp = fopen(temp_filename, "wb");
+	if (!fp)
+	{
+		mprintf((1, "levelcache: can't create %s\n", temp_filename));
+		return 0;
+	}
+
+	ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+	ok &= fclose(fp) == 0;
+
+	if (ok)
+		ok = replace_file(temp_filename, filename) == 0;
+	if (!ok)
+		_unlink(temp_filename);
+
+	return ok;
+}
@@ -0,0 +1,53 @@
+/*
+The code contained in this file is not the property of Parallax Software,
+and is not under the terms of the Parallax Software Source license.
+Instead, it is released under the terms of the MIT License,
+as described in copying.txt
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include "misc/types.h"
+
+//Precompiled level cache.
+//A cache file holds the runtime arrays a level load produces, in their in-memory layout,
+//so a level can be brought back with a single read and a memcpy per array. Cache files
+//are keyed on a checksum of the source level file and of the game data the loader
+//consults, and are ignored whenever either changes.
+
+#define LEVELCACHE_VERSION 1
+#define LEVELCACHE_MAX_BLOCKS 64
+
+typedef struct levelcache_block
+{
+	void* ptr;
+	size_t size;
+} levelcache_block;
+
+typedef struct levelcache_key
+{
+	uint32_t source_crc;	//checksum of the raw .rl2/.rdl
+	int source_size;
+	uint32_t data_crc;		//checksum of the game data the loader consults
+	uint32_t layout_crc;	//checksum of the block sizes, catches struct and MAX_ changes
+} levelcache_key;
+
+//Returns 1 if the cache is enabled (-levelcache).
+int levelcache_enabled();
+
+//Builds the cache filename for a level of the current mission.
+void levelcache_get_filename(char* buf, size_t bufsize, const char* levelname);
+
+//Checksum helper, chain by passing the previous result as crc.
+uint32_t levelcache_crc(const void* data, size_t len, uint32_t crc);
+
+//Fills in key->source_crc and key->source_size from the level file. Returns 0 if it can't be read.
+int levelcache_hash_source(levelcache_key* key, const char* levelname);
+
+//Reads a cache file into the blocks. Returns 1 on a valid hit, 0 if the file is missing,
+//stale or damaged, in which case none of the blocks are touched.
+int levelcache_read(const char* filename, levelcache_key* key, levelcache_block* blocks, int num_blocks);
+
+//Writes the blocks out to a cache file. Returns 1 on success.
+int levelcache_write(const char* filename, levelcache_key* key, levelcache_block* blocks, int num_blocks);
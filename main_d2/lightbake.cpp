@@ -0,0 +1,1152 @@
+/*
+THE COMPUTER CODE CONTAINED HEREIN IS THE SOLE PROPERTY OF PARALLAX
+SOFTWARE CORPORATION ("PARALLAX").  PARALLAX, IN DISTRIBUTING THE CODE TO
+END-USERS, AND SUBJECT TO ALL OF THE TERMS AND CONDITIONS HEREIN, GRANTS A
+ROYALTY-FREE, PERPETUAL LICENSE TO SUCH END-USERS FOR USE BY SUCH END-USERS
+IN USING, DISPLAYING,  AND CREATING DERIVATIVE WORKS THEREOF, SO LONG AS
+SUCH USE, DISPLAY OR CREATION IS FOR NON-COMMERCIAL, ROYALTY OR REVENUE
+FREE PURPOSES.  IN NO EVENT SHALL THE END-USER USE THE COMPUTER CODE
+CONTAINED HEREIN FOR REVENUE-BEARING PURPOSES.  THE END-USER UNDERSTANDS
+AND AGREES TO THE TERMS HEREIN AND ACCEPTS THE SAME BY USE OF THIS FILE.
+COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "main_d2/inferno.h"
+#include "main_d2/segment.h"
+#include "main_d2/gameseg.h"
+#include "main_d2/gamesave.h"
+#include "main_d2/wall.h"
+#include "main_d2/bm.h"		//	Needed for TmapInfo
+#include "main_d2/fvi.h"
+#include "main_d2/lightbake.h"
+#include "cfile/cfile.h"
+#include "fix/fix.h"
+#include "platform/mono.h"
+#include "platform/posixstub.h"
+#include "platform/timer.h"
+#include "platform/jobs.h"
+#include "misc/error.h"
+
+extern int Doing_lighting_hack_flag;	//	If set, don't mprintf warning messages in gameseg.c/find_point_seg
+
+//	_________________________________________________________________________________________________________________________
+//	Maximum distance between a segment containing light to a segment to receive light.
+#define	LIGHT_DISTANCE_THRESHOLD	(F1_0*80)
+fix	Magical_light_constant = (F1_0*16);
+
+typedef struct {
+	int8_t			flag, hit_type;
+	vms_vector	vector;
+} hash_info;
+
+#define	FVI_HASH_SIZE 8
+#define	FVI_HASH_AND_MASK (FVI_HASH_SIZE - 1)
+
+//	Note: This should be malloced.
+//			Also, the vector should not be 12 bytes, you should only care about some smaller portion of it.
+hash_info	fvi_cache[FVI_HASH_SIZE];
+int	Hash_hits=0, Hash_retries=0, Hash_calcs=0;
+int last_delta_light = 0, delta_light_count = 0;
+
+static delta_light* new_delta_light(lightbake_tables* tables)
+{
+	tables->deltas.push_back(delta_light());
+	return &tables->deltas.back();
+}
+
+//	-----------------------------------------------------------------------------------------
+//	Set light from a light source.
+//	Light incident on a surface is defined by the light incident at its points.
+//	Light at a point = K * (V . N) / d
+//	where:
+//		K = some magical constant to make everything look good
+//		V = normalized vector from light source to point
+//		N = surface normal at point
+//		d = distance from light source to point
+//	(Note that the above equation can be simplified to K * (VV . N) / d^2 where VV = non-normalized V)
+//	Light intensity emitted from a light source is defined to be cast from four points.
+//	These four points are 1/64 of the way from the corners of the light source to the center
+//	of its segment.  By assuming light is cast from these points, rather than from on the
+//	light surface itself, light will be properly cast on the light surface.  Otherwise, the
+//	vector V would be the null vector.
+//	If quick_light set, then don't use find_vector_intersection
+void cast_light_from_side(segment *segp, int light_side, fix light_intensity, int quick_light, lightbake_tables* tables)
+{
+	vms_vector	segment_center;
+	int			segnum,sidenum,vertnum, lightnum, start_delta_light;
+	uint8_t varg;
+	delta_light* dl;
+
+	compute_segment_center(&segment_center, segp);
+
+	//[ISB] add this surface first
+	if (!quick_light)
+	{
+		dl = new_delta_light(tables);
+		dl->segnum = segp - Segments;
+		dl->sidenum = light_side;
+		varg = std::min(light_intensity * 4 / DL_SCALE, 255);
+		for (lightnum = 0; lightnum < 4; lightnum++)
+			dl->vert_light[lightnum] = varg;
+
+		last_delta_light++;
+		delta_light_count++;
+		start_delta_light = last_delta_light;
+	}
+
+	//	Do for four lights, one just inside each corner of side containing light.
+	for (lightnum=0; lightnum<4; lightnum++)
+	{
+		int			light_vertex_num, i;
+		vms_vector	vector_to_center;
+		vms_vector	light_location;
+
+		light_vertex_num = segp->verts[Side_to_verts[light_side][lightnum]];
+		light_location = Vertices[light_vertex_num];
+
+		//	New way, 5/8/95: Move towards center irrespective of size of segment.
+		vm_vec_sub(&vector_to_center, &segment_center, &light_location);
+		vm_vec_normalize_quick(&vector_to_center);
+		vm_vec_add2(&light_location, &vector_to_center);
+
+		for (segnum=0; segnum<=Highest_segment_index; segnum++)
+		{
+			segment		*rsegp = &Segments[segnum];
+			vms_vector	r_segment_center;
+			fix			dist_to_rseg;
+
+			for (i=0; i<FVI_HASH_SIZE; i++)
+				fvi_cache[i].flag = 0;
+
+			//	efficiency hack (I hope!), for faraway segments, don't check each point.
+			compute_segment_center(&r_segment_center, rsegp);
+			dist_to_rseg = vm_vec_dist_quick(&r_segment_center, &segment_center);
+
+			if (dist_to_rseg <= LIGHT_DISTANCE_THRESHOLD)
+			{
+				for (sidenum=0; sidenum<MAX_SIDES_PER_SEGMENT; sidenum++)
+				{
+					if (WALL_IS_DOORWAY(rsegp, sidenum) != 0)
+					{
+						side			*rsidep = &rsegp->sides[sidenum];
+						vms_vector	*side_normalp = &rsidep->normals[0];	//	kinda stupid? always use vector 0.
+						int delta_light_number = -1, dl_num;
+
+						for (vertnum=0; vertnum<4; vertnum++)
+						{
+							fix			distance_to_point, light_at_point, light_dot;
+							vms_vector	vert_location, vector_to_light;
+							int			abs_vertnum;
+
+							abs_vertnum = rsegp->verts[Side_to_verts[sidenum][vertnum]];
+							vert_location = Vertices[abs_vertnum];
+							distance_to_point = vm_vec_dist_quick(&vert_location, &light_location);
+							vm_vec_sub(&vector_to_light, &light_location, &vert_location);
+							vm_vec_normalize(&vector_to_light);
+
+							//	Hack: In oblong segments, it's possible to get a very small dot product
+							//	but the light source is very nearby (eg, illuminating light itself!).
+							light_dot = vm_vec_dot(&vector_to_light, side_normalp);
+							if (distance_to_point < F1_0)
+								if (light_dot > 0)
+									light_dot = (light_dot + F1_0)/2;
+
+							if (light_dot > 0)
+							{
+								light_at_point = fixdiv(fixmul(light_dot, light_dot), distance_to_point);
+								light_at_point = fixmul(light_at_point, Magical_light_constant);
+								if (light_at_point >= 0)
+								{
+									fvi_info	hit_data;
+									int		hit_type;
+									vms_vector	vert_location_1, r_vector_to_center;
+									fix		inverse_segment_magnitude;
+
+									vm_vec_sub(&r_vector_to_center, &r_segment_center, &vert_location);
+									inverse_segment_magnitude = fixdiv(F1_0/3, vm_vec_mag(&r_vector_to_center));
+									vm_vec_scale_add(&vert_location_1, &vert_location, &r_vector_to_center, inverse_segment_magnitude);
+									vert_location = vert_location_1;
+
+									if (!quick_light)
+									{
+										int hash_value = Side_to_verts[sidenum][vertnum];
+										hash_info	*hashp = &fvi_cache[hash_value];
+										while (1)
+										{
+											if (hashp->flag)
+											{
+												if ((hashp->vector.x == vector_to_light.x) && (hashp->vector.y == vector_to_light.y) && (hashp->vector.z == vector_to_light.z)) {
+													hit_type = hashp->hit_type;
+													Hash_hits++;
+													break;
+												}
+												else
+												{
+													Int3();	// How is this possible?  Should be no hits!
+													Hash_retries++;
+													hash_value = (hash_value+1) & FVI_HASH_AND_MASK;
+													hashp = &fvi_cache[hash_value];
+												}
+											}
+											else
+											{
+												fvi_query fq;
+
+												Hash_calcs++;
+												hashp->vector = vector_to_light;
+												hashp->flag = 1;
+
+												fq.p0						= &light_location;
+												fq.startseg				= segp-Segments;
+												fq.p1						= &vert_location;
+												fq.rad					= 0;
+												fq.thisobjnum			= -1;
+												fq.ignore_obj_list	= NULL;
+												fq.flags					= 0;
+
+												hit_type = find_vector_intersection(&fq,&hit_data);
+												hashp->hit_type = hit_type;
+												break;
+											}
+										}
+									}
+									else
+										hit_type = HIT_NONE;
+
+									switch (hit_type)
+									{
+										case HIT_NONE:
+											light_at_point = fixmul(light_at_point, light_intensity);
+											rsidep->uvls[vertnum].l += light_at_point;
+											if (rsidep->uvls[vertnum].l > F1_0)
+												rsidep->uvls[vertnum].l = F1_0;
+
+											if (!quick_light)
+											{
+												//Since there's 4 vertices casting light, need to account for each.
+												//Slow search to find the delta light for this particular light source for the current segnum and sidenum
+												if (delta_light_number == -1)
+												{
+													for (dl_num = start_delta_light; dl_num < last_delta_light; dl_num++)
+													{
+														if (tables->deltas[dl_num].segnum == segnum && tables->deltas[dl_num].sidenum == sidenum)
+														{
+															delta_light_number = dl_num;
+															break;
+														}
+													}
+
+													//If none found, create a new one.
+													if (delta_light_number == -1)
+													{
+														dl = new_delta_light(tables);
+														dl->segnum = segnum;
+														dl->sidenum = sidenum;
+														memset(dl->vert_light, 0, sizeof(dl->vert_light));
+														delta_light_number = last_delta_light;
+														last_delta_light++;
+														delta_light_count++;
+													}
+												}
+
+												varg = std::min((tables->deltas[delta_light_number].vert_light[vertnum] + light_at_point / DL_SCALE), 255);
+												tables->deltas[delta_light_number].vert_light[vertnum] = varg;
+											}
+											break;
+										case HIT_WALL:
+											break;
+										case HIT_OBJECT:
+											Int3();	// Hit object, should be ignoring objects!
+											break;
+										case HIT_BAD_P0:
+											Int3();	//	Ugh, this thing again, what happened, what does it mean?
+											break;
+									}
+								}	//	end if (light_at_point...
+							}	// end if (light_dot >...
+						}	//	end for (vertnum=0...
+					}	//	end if (rsegp...
+				}	//	end for (sidenum=0...
+			}	//	end if (dist_to_rseg...
+
+		}	//	end for (segnum=0...
+
+	}	//	end for (lightnum=0...
+}
+
+//	------------------------------------------------------------------------------------------
+//	Zero all lighting values.
+void calim_zero_light_values(void)
+{
+	int	segnum, sidenum, vertnum;
+
+	for (segnum=0; segnum<=Highest_segment_index; segnum++)
+	{
+		segment *segp = &Segments[segnum];
+		for (sidenum=0; sidenum<MAX_SIDES_PER_SEGMENT; sidenum++)
+		{
+			side	*sidep = &segp->sides[sidenum];
+			for (vertnum=0; vertnum<4; vertnum++)
+				sidep->uvls[vertnum].l = F1_0/64;	// Put a tiny bit of light here.
+		}
+		Segment2s[segnum].static_light = F1_0/64;
+	}
+
+	memset(Delta_lights, 0, sizeof(Delta_lights));
+}
+
+//	------------------------------------------------------------------------------------------
+//	Used in setting average light value in a segment, cast light from a side to the center
+//	of all segments.
+void cast_light_from_side_to_center(segment *segp, int light_side, fix light_intensity, int quick_light)
+{
+	vms_vector	segment_center;
+	int			segnum, lightnum;
+
+	compute_segment_center(&segment_center, segp);
+
+	//	Do for four lights, one just inside each corner of side containing light.
+	for (lightnum=0; lightnum<4; lightnum++)
+	{
+		int			light_vertex_num;
+		vms_vector	vector_to_center;
+		vms_vector	light_location;
+
+		light_vertex_num = segp->verts[Side_to_verts[light_side][lightnum]];
+		light_location = Vertices[light_vertex_num];
+		vm_vec_sub(&vector_to_center, &segment_center, &light_location);
+		vm_vec_scale_add(&light_location, &light_location, &vector_to_center, F1_0/64);
+
+		for (segnum=0; segnum<=Highest_segment_index; segnum++)
+		{
+			segment		*rsegp = &Segments[segnum];
+			vms_vector	r_segment_center;
+			fix			dist_to_rseg;
+
+			compute_segment_center(&r_segment_center, rsegp);
+			dist_to_rseg = vm_vec_dist_quick(&r_segment_center, &segment_center);
+
+			if (dist_to_rseg <= LIGHT_DISTANCE_THRESHOLD)
+			{
+				fix	light_at_point;
+				if (dist_to_rseg > F1_0)
+					light_at_point = fixdiv(Magical_light_constant, dist_to_rseg);
+				else
+					light_at_point = Magical_light_constant;
+
+				if (light_at_point >= 0)
+				{
+					int		hit_type;
+
+					if (!quick_light)
+					{
+						fvi_query fq;
+						fvi_info	hit_data;
+
+						fq.p0						= &light_location;
+						fq.startseg				= segp-Segments;
+						fq.p1						= &r_segment_center;
+						fq.rad					= 0;
+						fq.thisobjnum			= -1;
+						fq.ignore_obj_list	= NULL;
+						fq.flags					= 0;
+
+						hit_type = find_vector_intersection(&fq,&hit_data);
+					}
+					else
+						hit_type = HIT_NONE;
+
+					switch (hit_type) {
+						case HIT_NONE:
+							light_at_point = fixmul(light_at_point, light_intensity);
+							if (light_at_point >= F1_0)
+								light_at_point = F1_0-1;
+							Segment2s[segnum].static_light += light_at_point;
+							if (Segment2s[segp-Segments].static_light < 0)	// if it went negative, saturate
+								Segment2s[segp-Segments].static_light = 0;
+							break;
+						case HIT_WALL:
+							break;
+						case HIT_OBJECT:
+							Int3();	// Hit object, should be ignoring objects!
+							break;
+						case HIT_BAD_P0:
+							Int3();	//	Ugh, this thing again, what happened, what does it mean?
+							break;
+					}
+				}	//	end if (light_at_point...
+			}	//	end if (dist_to_rseg...
+
+		}	//	end for (segnum=0...
+
+	}	//	end for (lightnum=0...
+
+}
+
+//	------------------------------------------------------------------------------------------
+//	Process all lights.
+void calim_process_all_lights(int quick_light, lightbake_tables* tables)
+{
+	int	segnum, sidenum;
+	dl_index* index;
+
+	tables->indices.clear();
+	tables->deltas.clear();
+	delta_light_count = 0;
+	last_delta_light = 0;
+
+	for (segnum=0; segnum<=Highest_segment_index; segnum++)
+	{
+		segment	*segp = &Segments[segnum];
+		mprintf((0, "."));
+		for (sidenum=0; sidenum<MAX_SIDES_PER_SEGMENT; sidenum++)
+		{
+			if (WALL_IS_DOORWAY(segp, sidenum) != 0)
+			{
+				side	*sidep = &segp->sides[sidenum];
+				fix	light_intensity;
+
+				light_intensity = TmapInfo[sidep->tmap_num].lighting + TmapInfo[sidep->tmap_num2 & 0x3fff].lighting;
+
+				if (light_intensity)
+				{
+					int index_num = 0;
+					if (!quick_light)
+					{
+						index_num = tables->indices.size();
+						tables->indices.push_back(dl_index());
+						index = &tables->indices[index_num];
+						index->count = 0;
+						index->segnum = segnum;
+						index->sidenum = sidenum;
+						index->index = last_delta_light;
+						delta_light_count = 0;
+					}
+					light_intensity /= 4;			// casting light from four spots, so divide by 4.
+					cast_light_from_side(segp, sidenum, light_intensity, quick_light, tables);
+					cast_light_from_side_to_center(segp, sidenum, light_intensity, quick_light);
+					if (!quick_light)
+					{
+						tables->indices[index_num].count = delta_light_count;
+					}
+				}
+			}
+		}
+	}
+
+	if (!quick_light)
+	{
+		mprintf((0, "Num light sources: %d, Num deltas: %d\n", (int)tables->indices.size(), last_delta_light));
+	}
+}
+
+//	------------------------------------------------------------------------------------------
+//	Apply static light in mine.
+//	First, zero all light values.
+//	Then, for all light sources, cast their light.
+void lightbake_cast_all_serial(int quick_light, lightbake_tables* tables)
+{
+	calim_zero_light_values();
+
+	calim_process_all_lights(quick_light, tables);
+}
+
+//	------------------------------------------------------------------------------------------
+//Threaded version.
+//Each light source only reads the mine, so the sources are handed out as jobs. A thread
+//records what its lights would add into its own buffers, and once all threads are done the
+//additions are applied in the original light order. The additions saturate as they go, so
+//applying them in order is what keeps the result identical to the serial algorithm.
+//find_vector_intersection keeps its state in thread_local globals for this.
+
+typedef struct bake_light
+{
+	short segnum;
+	int8_t sidenum;
+	fix intensity;
+} bake_light;
+
+typedef struct bake_vert_light
+{
+	int uvl;			//(segnum * MAX_SIDES_PER_SEGMENT + sidenum) * 4 + vertnum
+	fix amount;
+} bake_vert_light;
+
+typedef struct bake_center_light
+{
+	short segnum;
+	fix amount;
+} bake_center_light;
+
+typedef struct bake_thread_buffer
+{
+	std::vector<bake_vert_light> vert_lights;
+	std::vector<bake_center_light> center_lights;
+	std::vector<delta_light> deltas;
+} bake_thread_buffer;
+
+//Where the additions of one light source ended up.
+typedef struct bake_light_result
+{
+	int thread;
+	size_t vert_start, vert_end;
+	size_t center_start, center_end;
+	size_t delta_start, delta_end;
+} bake_light_result;
+
+//A segment close enough to a light source to get any of its light.
+typedef struct bake_near_segment
+{
+	short segnum;
+	fix dist;
+	vms_vector center;
+} bake_near_segment;
+
+//Same as cast_light_from_side and cast_light_from_side_to_center, recording into buf instead of changing the mine.
+static void bake_cast_light(bake_light* light, int quick_light, bake_thread_buffer* buf)
+{
+	segment* segp = &Segments[light->segnum];
+	int light_side = light->sidenum;
+	fix light_intensity = light->intensity;
+	vms_vector segment_center;
+	int segnum, sidenum, vertnum, lightnum, i;
+	size_t start_delta_light = 0;
+	hash_info cache[FVI_HASH_SIZE];
+	delta_light dl;
+	job_scratch_mark mark = job_scratch_get_mark();
+	bake_near_segment* near_segs;
+	int num_near = 0, near_num;
+
+	compute_segment_center(&segment_center, segp);
+
+	//Both passes below visit the same segments for each of the 4 light points, so find them once.
+	near_segs = (bake_near_segment*)job_scratch_alloc(sizeof(bake_near_segment) * (Highest_segment_index + 1));
+	for (segnum = 0; segnum <= Highest_segment_index; segnum++)
+	{
+		bake_near_segment* near_seg = &near_segs[num_near];
+
+		compute_segment_center(&near_seg->center, &Segments[segnum]);
+		near_seg->dist = vm_vec_dist_quick(&near_seg->center, &segment_center);
+		if (near_seg->dist > LIGHT_DISTANCE_THRESHOLD)
+			continue;
+
+		near_seg->segnum = segnum;
+		num_near++;
+	}
+
+	if (!quick_light)
+	{
+		dl.segnum = light->segnum;
+		dl.sidenum = light_side;
+		dl.dummy = 0;
+		memset(dl.vert_light, std::min(light_intensity * 4 / DL_SCALE, 255), sizeof(dl.vert_light));
+		buf->deltas.push_back(dl);
+		start_delta_light = buf->deltas.size();
+	}
+
+	for (lightnum = 0; lightnum < 4; lightnum++)
+	{
+		vms_vector vector_to_center;
+		vms_vector light_location = Vertices[segp->verts[Side_to_verts[light_side][lightnum]]];
+
+		vm_vec_sub(&vector_to_center, &segment_center, &light_location);
+		vm_vec_normalize_quick(&vector_to_center);
+		vm_vec_add2(&light_location, &vector_to_center);
+
+		for (near_num = 0; near_num < num_near; near_num++)
+		{
+			segment* rsegp = &Segments[near_segs[near_num].segnum];
+			vms_vector r_segment_center = near_segs[near_num].center;
+
+			segnum = near_segs[near_num].segnum;
+
+			for (i = 0; i < FVI_HASH_SIZE; i++)
+				cache[i].flag = 0;
+
+			for (sidenum = 0; sidenum < MAX_SIDES_PER_SEGMENT; sidenum++)
+			{
+				side* rsidep;
+				size_t delta_light_number = (size_t)-1;
+
+				if (WALL_IS_DOORWAY(rsegp, sidenum) == 0)
+					continue;
+
+				rsidep = &rsegp->sides[sidenum];
+				for (vertnum = 0; vertnum < 4; vertnum++)
+				{
+					fix distance_to_point, light_at_point, light_dot, inverse_segment_magnitude;
+					vms_vector vert_location, vector_to_light, r_vector_to_center;
+					int hit_type;
+
+					vert_location = Vertices[rsegp->verts[Side_to_verts[sidenum][vertnum]]];
+					distance_to_point = vm_vec_dist_quick(&vert_location, &light_location);
+					vm_vec_sub(&vector_to_light, &light_location, &vert_location);
+					vm_vec_normalize(&vector_to_light);
+
+					light_dot = vm_vec_dot(&vector_to_light, &rsidep->normals[0]);
+					if (distance_to_point < F1_0)
+						if (light_dot > 0)
+							light_dot = (light_dot + F1_0) / 2;
+
+					if (light_dot <= 0)
+						continue;
+
+					light_at_point = fixdiv(fixmul(light_dot, light_dot), distance_to_point);
+					light_at_point = fixmul(light_at_point, Magical_light_constant);
+					if (light_at_point < 0)
+						continue;
+
+					vm_vec_sub(&r_vector_to_center, &r_segment_center, &vert_location);
+					inverse_segment_magnitude = fixdiv(F1_0 / 3, vm_vec_mag(&r_vector_to_center));
+					vm_vec_scale_add(&vert_location, &vert_location, &r_vector_to_center, inverse_segment_magnitude);
+
+					hit_type = HIT_NONE;
+					if (!quick_light)
+					{
+						int hash_value = Side_to_verts[sidenum][vertnum];
+						hash_info* hashp = &cache[hash_value];
+
+						//Probe exactly like the serial cache, since a hit reuses another query's result.
+						while (hashp->flag && (hashp->vector.x != vector_to_light.x || hashp->vector.y != vector_to_light.y || hashp->vector.z != vector_to_light.z))
+						{
+							hash_value = (hash_value + 1) & FVI_HASH_AND_MASK;
+							hashp = &cache[hash_value];
+						}
+
+						if (hashp->flag)
+							hit_type = hashp->hit_type;
+						else
+						{
+							fvi_query fq;
+							fvi_info hit_data;
+
+							fq.p0 = &light_location;
+							fq.startseg = light->segnum;
+							fq.p1 = &vert_location;
+							fq.rad = 0;
+							fq.thisobjnum = -1;
+							fq.ignore_obj_list = NULL;
+							fq.flags = 0;
+
+							hit_type = find_vector_intersection(&fq, &hit_data);
+							hashp->vector = vector_to_light;
+							hashp->flag = 1;
+							hashp->hit_type = hit_type;
+						}
+					}
+
+					if (hit_type != HIT_NONE)
+						continue;
+
+					light_at_point = fixmul(light_at_point, light_intensity);
+					buf->vert_lights.push_back({ (segnum * MAX_SIDES_PER_SEGMENT + sidenum) * 4 + vertnum, light_at_point });
+
+					if (!quick_light)
+					{
+						if (delta_light_number == (size_t)-1)
+						{
+							for (delta_light_number = start_delta_light; delta_light_number < buf->deltas.size(); delta_light_number++)
+							{
+								if (buf->deltas[delta_light_number].segnum == segnum && buf->deltas[delta_light_number].sidenum == sidenum)
+									break;
+							}
+
+							if (delta_light_number == buf->deltas.size())
+							{
+								dl.segnum = segnum;
+								dl.sidenum = sidenum;
+								dl.dummy = 0;
+								memset(dl.vert_light, 0, sizeof(dl.vert_light));
+								buf->deltas.push_back(dl);
+							}
+						}
+
+						buf->deltas[delta_light_number].vert_light[vertnum] = std::min((buf->deltas[delta_light_number].vert_light[vertnum] + light_at_point / DL_SCALE), 255);
+					}
+				}
+			}
+		}
+	}
+
+	//Now the light cast to the segment centers.
+	for (lightnum = 0; lightnum < 4; lightnum++)
+	{
+		vms_vector vector_to_center;
+		vms_vector light_location = Vertices[segp->verts[Side_to_verts[light_side][lightnum]]];
+
+		vm_vec_sub(&vector_to_center, &segment_center, &light_location);
+		vm_vec_scale_add(&light_location, &light_location, &vector_to_center, F1_0 / 64);
+
+		for (near_num = 0; near_num < num_near; near_num++)
+		{
+			vms_vector r_segment_center = near_segs[near_num].center;
+			fix dist_to_rseg = near_segs[near_num].dist, light_at_point;
+
+			segnum = near_segs[near_num].segnum;
+
+			if (dist_to_rseg > F1_0)
+				light_at_point = fixdiv(Magical_light_constant, dist_to_rseg);
+			else
+				light_at_point = Magical_light_constant;
+
+			if (light_at_point < 0)
+				continue;
+
+			if (!quick_light)
+			{
+				fvi_query fq;
+				fvi_info hit_data;
+
+				fq.p0 = &light_location;
+				fq.startseg = light->segnum;
+				fq.p1 = &r_segment_center;
+				fq.rad = 0;
+				fq.thisobjnum = -1;
+				fq.ignore_obj_list = NULL;
+				fq.flags = 0;
+
+				if (find_vector_intersection(&fq, &hit_data) != HIT_NONE)
+					continue;
+			}
+
+			light_at_point = fixmul(light_at_point, light_intensity);
+			if (light_at_point >= F1_0)
+				light_at_point = F1_0 - 1;
+			buf->center_lights.push_back({ (short)segnum, light_at_point });
+		}
+	}
+
+	job_scratch_release(mark);
+}
+
+void lightbake_cast_all(int quick_light, lightbake_tables* tables)
+{
+	std::vector<bake_light> lights;
+	std::vector<bake_light_result> results;
+	std::vector<bake_thread_buffer> buffers;
+	int segnum, sidenum, i;
+	size_t j;
+
+	calim_zero_light_values();
+	tables->indices.clear();
+	tables->deltas.clear();
+
+	//Gather the light sources in the order the serial algorithm visits them.
+	for (segnum = 0; segnum <= Highest_segment_index; segnum++)
+	{
+		segment* segp = &Segments[segnum];
+		for (sidenum = 0; sidenum < MAX_SIDES_PER_SEGMENT; sidenum++)
+		{
+			if (WALL_IS_DOORWAY(segp, sidenum) != 0)
+			{
+				side* sidep = &segp->sides[sidenum];
+				fix light_intensity = TmapInfo[sidep->tmap_num].lighting + TmapInfo[sidep->tmap_num2 & 0x3fff].lighting;
+
+				if (light_intensity)
+					lights.push_back({ (short)segnum, (int8_t)sidenum, light_intensity / 4 });
+			}
+		}
+	}
+
+	results.resize(lights.size());
+	buffers.resize(job_num_threads());
+
+	//One light per job, since they take very different amounts of time.
+	job_parallel_for(0, lights.size(), 1, [&](int start, int end)
+	{
+		int thread_num = job_thread_index();
+		bake_thread_buffer* buf = &buffers[thread_num];
+
+		for (int light_num = start; light_num < end; light_num++)
+		{
+			bake_light_result* result = &results[light_num];
+
+			result->thread = thread_num;
+			result->vert_start = buf->vert_lights.size();
+			result->center_start = buf->center_lights.size();
+			result->delta_start = buf->deltas.size();
+			bake_cast_light(&lights[light_num], quick_light, buf);
+			result->vert_end = buf->vert_lights.size();
+			result->center_end = buf->center_lights.size();
+			result->delta_end = buf->deltas.size();
+		}
+	});
+
+	//Apply everything in light order.
+	for (i = 0; i < (int)lights.size(); i++)
+	{
+		bake_light_result* result = &results[i];
+		bake_thread_buffer* buf = &buffers[result->thread];
+
+		if (!quick_light)
+		{
+			dl_index index;
+			index.segnum = lights[i].segnum;
+			index.sidenum = lights[i].sidenum;
+			index.count = result->delta_end - result->delta_start;
+			index.index = tables->deltas.size();
+			tables->indices.push_back(index);
+			tables->deltas.insert(tables->deltas.end(), buf->deltas.begin() + result->delta_start, buf->deltas.begin() + result->delta_end);
+		}
+
+		for (j = result->vert_start; j < result->vert_end; j++)
+		{
+			bake_vert_light* vl = &buf->vert_lights[j];
+			uvl* uvlp = &Segments[vl->uvl / (MAX_SIDES_PER_SEGMENT * 4)].sides[(vl->uvl / 4) % MAX_SIDES_PER_SEGMENT].uvls[vl->uvl % 4];
+
+			uvlp->l += vl->amount;
+			if (uvlp->l > F1_0)
+				uvlp->l = F1_0;
+		}
+
+		for (j = result->center_start; j < result->center_end; j++)
+		{
+			Segment2s[buf->center_lights[j].segnum].static_light += buf->center_lights[j].amount;
+			if (Segment2s[lights[i].segnum].static_light < 0)	// if it went negative, saturate
+				Segment2s[lights[i].segnum].static_light = 0;
+		}
+	}
+
+	if (!quick_light)
+		mprintf((0, "Num light sources: %d, Num deltas: %d\n", (int)tables->indices.size(), (int)tables->deltas.size()));
+}
+
+void lightbake_copy_tables(lightbake_tables* tables)
+{
+	size_t num_deltas = std::min(tables->deltas.size(), (size_t)MAX_DELTA_LIGHTS);
+
+	Num_static_lights = std::min(tables->indices.size(), (size_t)MAX_DL_INDICES);
+	if (Num_static_lights)
+		memcpy(Dl_indices, &tables->indices[0], Num_static_lights * sizeof(dl_index));
+
+	memset(Delta_lights, 0, sizeof(Delta_lights));
+	if (num_deltas)
+		memcpy(Delta_lights, &tables->deltas[0], num_deltas * sizeof(delta_light));
+
+	if (Num_static_lights < (int)tables->indices.size() || num_deltas < tables->deltas.size())
+		mprintf((1, "Warning: %d light sources and %d delta lights don't fit in %d and %d.\n", (int)tables->indices.size(), (int)tables->deltas.size(), MAX_DL_INDICES, MAX_DELTA_LIGHTS));
+}
+
+//	------------------------------------------------------------------------------------------
+//Writing the level back.
+//Only the light values change, so rather than needing the editor's level writer, the original
+//file is copied with the vertex and segment light patched in place, and the delta light tables,
+//which save_game_data always writes last, replaced.
+
+static int get_short(std::vector<uint8_t>& data, size_t offset)
+{
+	return (short)(data[offset] | (data[offset + 1] << 8));
+}
+
+static int get_int(std::vector<uint8_t>& data, size_t offset)
+{
+	return (int)(data[offset] | (data[offset + 1] << 8) | (data[offset + 2] << 16) | ((uint32_t)data[offset + 3] << 24));
+}
+
+static void put_short(std::vector<uint8_t>& data, size_t offset, int value)
+{
+	data[offset] = value & 255;
+	data[offset + 1] = (value >> 8) & 255;
+}
+
+static void put_int(std::vector<uint8_t>& data, size_t offset, int value)
+{
+	put_short(data, offset, value & 0xffff);
+	put_short(data, offset + 2, (value >> 16) & 0xffff);
+}
+
+//The offsets come from the file, so check each access against its size before making it.
+static bool in_file(std::vector<uint8_t>& data, size_t offset, size_t count)
+{
+	return offset <= data.size() && count <= data.size() - offset;
+}
+
+static int level_truncated(const char* src)
+{
+	printf("%s is truncated\n", src);
+	return 1;
+}
+
+//Offsets into the game data's fileinfo, see write_game_fileinfo.
+#define FILEINFO_DL_INDICES_OFFSET 119
+#define FILEINFO_DL_INDICES_HOWMANY 123
+#define FILEINFO_DELTA_LIGHT_OFFSET 131
+#define FILEINFO_DELTA_LIGHT_HOWMANY 135
+
+int lightbake_write_level(const char* src, const char* dest, lightbake_tables* tables)
+{
+	CFILE* fp;
+	FILE* out;
+	std::vector<uint8_t> data;
+	size_t offset, dl_indices_offset;
+	int minedata_offset, gamedata_offset, num_vertices, num_segments;
+	int segnum, sidenum, i;
+	short children[MAX_SIDES_PER_SEGMENT];
+	uint8_t bit_mask, wall_mask;
+	dl_index* index;
+	delta_light* dl;
+
+	fp = cfopen(src, "rb");
+	if (!fp)
+	{
+		printf("Can't open %s\n", src);
+		return 1;
+	}
+	data.resize(cfilelength(fp));
+	if (data.size() < 16 || cfread(&data[0], 1, data.size(), fp) != data.size())
+	{
+		cfclose(fp);
+		printf("Can't read %s\n", src);
+		return 1;
+	}
+	cfclose(fp);
+
+	if (get_int(data, 0) != 'PLVL')
+	{
+		printf("%s isn't a level\n", src);
+		return 1;
+	}
+	minedata_offset = get_int(data, 8);
+	gamedata_offset = get_int(data, 12);
+
+	//Walk the compiled mine data the way load_mine_data_compiled reads it.
+	offset = (size_t)minedata_offset + 1;
+	if (minedata_offset < 0 || !in_file(data, offset, 4))
+		return level_truncated(src);
+	num_vertices = get_short(data, offset);
+	num_segments = get_short(data, offset + 2);
+	if (num_segments != Num_segments)
+	{
+		printf("%s has %d segments, the loaded mine has %d\n", src, num_segments, Num_segments);
+		return 1;
+	}
+	offset += 4 + num_vertices * 12;
+
+	for (segnum = 0; segnum < num_segments; segnum++)
+	{
+		if (!in_file(data, offset, 1))
+			return level_truncated(src);
+		bit_mask = data[offset++];
+		for (sidenum = 0; sidenum < MAX_SIDES_PER_SEGMENT; sidenum++)
+		{
+			children[sidenum] = -1;
+			if (bit_mask & (1 << sidenum))
+			{
+				if (!in_file(data, offset, 2))
+					return level_truncated(src);
+				children[sidenum] = get_short(data, offset);
+				offset += 2;
+			}
+		}
+		offset += MAX_VERTICES_PER_SEGMENT * 2;
+
+		if (!in_file(data, offset, 1))
+			return level_truncated(src);
+		wall_mask = data[offset++];
+		uint8_t wall_nums[MAX_SIDES_PER_SEGMENT];
+		for (sidenum = 0; sidenum < MAX_SIDES_PER_SEGMENT; sidenum++)
+		{
+			wall_nums[sidenum] = 255;
+			if (wall_mask & (1 << sidenum))
+			{
+				if (!in_file(data, offset, 1))
+					return level_truncated(src);
+				wall_nums[sidenum] = data[offset++];
+			}
+		}
+
+		for (sidenum = 0; sidenum < MAX_SIDES_PER_SEGMENT; sidenum++)
+		{
+			if (children[sidenum] != -1 && wall_nums[sidenum] == 255)
+				continue;
+
+			if (!in_file(data, offset, 2))
+				return level_truncated(src);
+			if (get_short(data, offset) & 0x8000)
+				offset += 2;
+			offset += 2;
+
+			for (i = 0; i < 4; i++)
+			{
+				fix l = Segments[segnum].sides[sidenum].uvls[i].l;
+				if (!in_file(data, offset, 6))
+					return level_truncated(src);
+				put_short(data, offset + 4, std::min(std::max(l, 0) >> 1, 0xffff));
+				offset += 6;
+			}
+		}
+	}
+
+	for (segnum = 0; segnum < num_segments; segnum++)
+	{
+		if (!in_file(data, offset, 8))
+			return level_truncated(src);
+		put_int(data, offset + 4, Segment2s[segnum].static_light);
+		offset += 8;
+	}
+
+	//The delta light tables must be the last thing in the file for them to be replaced.
+	offset = (size_t)gamedata_offset;
+	if (gamedata_offset < 0 || !in_file(data, offset, FILEINFO_DELTA_LIGHT_HOWMANY + 4))
+		return level_truncated(src);
+	if (get_short(data, offset) != 0x6705 || get_short(data, offset + 2) < 29)
+	{
+		printf("%s has no delta light tables\n", src);
+		return 1;
+	}
+	dl_indices_offset = (size_t)(uint32_t)get_int(data, offset + FILEINFO_DL_INDICES_OFFSET);
+	if (dl_indices_offset > data.size())
+		return level_truncated(src);
+	if (dl_indices_offset + get_int(data, offset + FILEINFO_DL_INDICES_HOWMANY) * 6 != (size_t)get_int(data, offset + FILEINFO_DELTA_LIGHT_OFFSET) ||
+		get_int(data, offset + FILEINFO_DELTA_LIGHT_OFFSET) + get_int(data, offset + FILEINFO_DELTA_LIGHT_HOWMANY) * 8 != (int)data.size())
+	{
+		printf("%s has data after the delta light tables, can't rewrite it\n", src);
+		return 1;
+	}
+
+	put_int(data, offset + FILEINFO_DL_INDICES_HOWMANY, tables->indices.size());
+	put_int(data, offset + FILEINFO_DELTA_LIGHT_OFFSET, dl_indices_offset + tables->indices.size() * 6);
+	put_int(data, offset + FILEINFO_DELTA_LIGHT_HOWMANY, tables->deltas.size());
+	data.resize(dl_indices_offset);
+
+	out = fopen(dest, "wb");
+	if (!out)
+	{
+		printf("Can't write %s\n", dest);
+		return 1;
+	}
+	fwrite(&data[0], 1, data.size(), out);
+	for (index = tables->indices.data(); index < tables->indices.data() + tables->indices.size(); index++)
+	{
+		file_write_short(out, index->segnum);
+		file_write_byte(out, index->sidenum);
+		file_write_byte(out, index->count);
+		file_write_short(out, index->index);
+	}
+	for (dl = tables->deltas.data(); dl < tables->deltas.data() + tables->deltas.size(); dl++)
+	{
+		file_write_short(out, dl->segnum);
+		file_write_byte(out, dl->sidenum);
+		file_write_byte(out, dl->dummy);
+		for (i = 0; i < 4; i++)
+			file_write_byte(out, dl->vert_light[i]);
+	}
+	fclose(out);
+
+	return 0;
+}
+
+//	------------------------------------------------------------------------------------------
+//Checks the current mine and tables against a copy made after a serial bake.
+static int compare_bake(std::vector<fix>& ref_lights, lightbake_tables* ref, lightbake_tables* tables)
+{
+	int segnum, sidenum, vertnum, n = 0, mismatches = 0;
+
+	for (segnum = 0; segnum <= Highest_segment_index; segnum++)
+	{
+		for (sidenum = 0; sidenum < MAX_SIDES_PER_SEGMENT; sidenum++)
+			for (vertnum = 0; vertnum < 4; vertnum++)
+				if (Segments[segnum].sides[sidenum].uvls[vertnum].l != ref_lights[n++])
+					mismatches++;
+		if (Segment2s[segnum].static_light != ref_lights[n++])
+			mismatches++;
+	}
+	if (mismatches)
+		printf("%d light values differ\n", mismatches);
+
+	if (ref->indices.size() != tables->indices.size() || ref->deltas.size() != tables->deltas.size() ||
+		(ref->indices.size() && memcmp(&ref->indices[0], &tables->indices[0], ref->indices.size() * sizeof(dl_index))) ||
+		(ref->deltas.size() && memcmp(&ref->deltas[0], &tables->deltas[0], ref->deltas.size() * sizeof(delta_light))))
+	{
+		printf("Delta light tables differ\n");
+		mismatches++;
+	}
+
+	return mismatches;
+}
+
+static void save_light_values(std::vector<fix>& lights)
+{
+	int segnum, sidenum, vertnum;
+
+	lights.clear();
+	for (segnum = 0; segnum <= Highest_segment_index; segnum++)
+	{
+		for (sidenum = 0; sidenum < MAX_SIDES_PER_SEGMENT; sidenum++)
+			for (vertnum = 0; vertnum < 4; vertnum++)
+				lights.push_back(Segments[segnum].sides[sidenum].uvls[vertnum].l);
+		lights.push_back(Segment2s[segnum].static_light);
+	}
+}
+
+int lightbake_run(const char* levelname, const char* outname, int quick_light, int compare)
+{
+	char filename[128];
+	lightbake_tables tables, ref;
+	std::vector<fix> ref_lights;
+	uint64_t start_time, serial_time = 0, threaded_time;
+	int result = 0;
+
+	if (CurrentDataVersion == DataVer::DEMO)
+	{
+		printf("The demo's levels can't be baked\n");
+		return 1;
+	}
+
+	//load_level looks for the name in upper case
+	strncpy(filename, levelname, sizeof(filename) - 1);
+	filename[sizeof(filename) - 1] = 0;
+	_strupr(filename);
+
+	if (load_level(filename))
+	{
+		printf("Can't load %s\n", levelname);
+		return 1;
+	}
+
+	validate_segment_all();
+	Doing_lighting_hack_flag = 1;
+
+	if (compare)
+	{
+		start_time = I_GetUS();
+		lightbake_cast_all_serial(quick_light, &ref);
+		serial_time = I_GetUS() - start_time;
+		save_light_values(ref_lights);
+	}
+
+	start_time = I_GetUS();
+	lightbake_cast_all(quick_light, &tables);
+	threaded_time = I_GetUS() - start_time;
+
+	Doing_lighting_hack_flag = 0;
+
+	printf("%s: %d segments, %d light sources, %d delta lights\n", levelname, Num_segments, (int)tables.indices.size(), (int)tables.deltas.size());
+	if (compare)
+	{
+		printf("serial: %.3f seconds, %d threads: %.3f seconds\n", serial_time / 1000000.0, job_num_threads(), threaded_time / 1000000.0);
+		if (compare_bake(ref_lights, &ref, &tables))
+		{
+			printf("Threaded bake doesn't match the serial one\n");
+			return 1;
+		}
+		printf("Threaded bake matches the serial one\n");
+	}
+	else
+		printf("%d threads: %.3f seconds\n", job_num_threads(), threaded_time / 1000000.0);
+
+	lightbake_copy_tables(&tables);
+
+	if (!outname)
+		outname = levelname;
+	result = lightbake_write_level(filename, outname, &tables);
+	if (!result)
+		printf("Wrote %s\n", outname);
+
+	return result;
+}
@@ -0,0 +1,45 @@
+/*
+THE COMPUTER CODE CONTAINED HEREIN IS THE SOLE PROPERTY OF PARALLAX
+SOFTWARE CORPORATION ("PARALLAX").  PARALLAX, IN DISTRIBUTING THE CODE TO
+END-USERS, AND SUBJECT TO ALL OF THE TERMS AND CONDITIONS HEREIN, GRANTS A
+ROYALTY-FREE, PERPETUAL LICENSE TO SUCH END-USERS FOR USE BY SUCH END-USERS
+IN USING, DISPLAYING,  AND CREATING DERIVATIVE WORKS THEREOF, SO LONG AS
+SUCH USE, DISPLAY OR CREATION IS FOR NON-COMMERCIAL, ROYALTY OR REVENUE
+FREE PURPOSES.  IN NO EVENT SHALL THE END-USER USE THE COMPUTER CODE
+CONTAINED HEREIN FOR REVENUE-BEARING PURPOSES.  THE END-USER UNDERSTANDS
+AND AGREES TO THE TERMS HEREIN AND ACCEPTS THE SAME BY USE OF THIS FILE.
+COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
+*/
+
+#pragma once
+
+#include <vector>
+#include "main_d2/segment.h"
+
+//Static light baking, moved out of the editor so it can run headless.
+//Vertex light and segment static light are written straight into the mine. The
+//delta light tables are returned separately, since a big level can produce more
+//entries than Dl_indices and Delta_lights hold (see handle_overflow_delta_light).
+typedef struct lightbake_tables
+{
+	std::vector<dl_index> indices;
+	std::vector<delta_light> deltas;
+} lightbake_tables;
+
+//The original serial algorithm, kept as the reference the threaded one is checked against.
+void lightbake_cast_all_serial(int quick_light, lightbake_tables* tables);
+
+//Same results as lightbake_cast_all_serial, bit for bit, with the light sources run as jobs.
+void lightbake_cast_all(int quick_light, lightbake_tables* tables);
+
+//Copies the tables into Dl_indices/Delta_lights, as much of them as fits.
+void lightbake_copy_tables(lightbake_tables* tables);
+
+//Writes a copy of the compiled level src to dest, with the light values and tables of the current mine.
+//Returns 0 on success.
+int lightbake_write_level(const char* src, const char* dest, lightbake_tables* tables);
+
+//The -lightbake command: loads a level, bakes it and writes it to outname (or back to levelname).
+//With compare set, it also runs the serial algorithm and checks the results match.
+//Returns 0 on success.
+int lightbake_run(const char* levelname, const char* outname, int quick_light, int compare);
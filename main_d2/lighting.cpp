@@ -122,53 +122,121 @@ int lighting_cache_visible(int vertnum, int segnum, int objnum, vms_vector* obj_
 #define	HEADLIGHT_CONE_DOT	(F1_0*9/10)
 #define	HEADLIGHT_SCALE		(F1_0*10)
 
+//Clustered dynamic lighting. The old code ran every bright light over every rendered vertex.
+//Now every rendered vertex belongs to the first rendered segment that uses it, and every segment only
+//runs the lights that can reach the bounding sphere of its own vertices. A light's reach is how far
+//vm_vec_dist_quick can be from it and still pass the distance test, so the light ends up on exactly
+//the vertices it did before.
+
+typedef struct dynamic_light_source
+{
+	vms_vector	pos;
+	fix			intensity;
+	fix			obji_64;
+	int			objnum;
+	int			headlight_shift;
+	fix			max_headlight_dist;
+	int64_t		reach;			//true distance past which no vertex can be lit
+} dynamic_light_source;
+
+//The lights of all objects, muzzle flashes, etc, too bright to only light their own segment
+#define MAX_DYNAMIC_LIGHTS	(MAX_OBJECTS + MUZZLE_QUEUE_MAX)
+static dynamic_light_source Dynamic_lights[MAX_DYNAMIC_LIGHTS];
+static int Num_dynamic_lights;
+
+//The vertices each rendered segment lights this frame, ie the ones it owns that the frame parity picked.
+static int Light_seg_first[MAX_RENDER_SEGS + 1];
+static short Light_verts[MAX_VERTICES];
+
+dynamic_light_stats Dynamic_light_stats;
+dynamic_light_stats Dynamic_light_stats_last_frame;
+
+//Dynamic light is per vertex, not per view, so when several windows are rendered in a frame a
+//vertex is only lit by the first one that renders it. Each set_dynamic_light call is a pass, and
+//Vertex_light_pass says which pass last lit each vertex.
+static int Light_pass;
+static int Light_frame = -1, Light_frame_first_pass;
+static int Vertex_light_pass[MAX_VERTICES];
+static int Vertex_seen_pass[MAX_VERTICES];		//which pass last looked at each vertex
+
+//Whether an earlier view this frame already lit the vertex.
+static inline int vertex_lit_earlier(int vertnum)
+{
+	return Vertex_light_pass[vertnum] >= Light_frame_first_pass && Vertex_light_pass[vertnum] != Light_pass;
+}
+
 // ----------------------------------------------------------------------------------------------
-void apply_light(fix obj_intensity, int obj_seg, vms_vector* obj_pos, int n_render_vertices, short* render_vertices, int objnum)
+//	Lights the vertices of a segment (not necessarily rendered) with a dim light, the way the old code did.
+static void apply_light_own_segment(fix obj_intensity, int obj_seg, vms_vector* obj_pos, fix obji_64)
 {
-	int	vv;
+	short* vp = Segments[obj_seg].verts;
+	int vv;
+
+	for (vv = 0; vv < MAX_VERTICES_PER_SEGMENT; vv++)
+	{
+		int			vertnum;
+		vms_vector* vertpos;
+		fix			dist;
+
+		vertnum = vp[vv];
+		if (((vertnum ^ FrameCount) & 1) && !vertex_lit_earlier(vertnum))
+		{
+			Dynamic_light_stats.pairs++;
+			Dynamic_light_stats.brute_pairs++;
+			vertpos = &Vertices[vertnum];
+			dist = vm_vec_dist_quick(obj_pos, vertpos);
+			dist = fixmul(dist / 4, dist / 4);
+			if (dist < abs(obji_64)) {
+				if (dist < MIN_LIGHT_DIST)
+					dist = MIN_LIGHT_DIST;
+
+				Dynamic_light[vertnum] += fixdiv(obj_intensity, dist);
+			}
+		}
+	}
+}
 
+// ----------------------------------------------------------------------------------------------
+//	Lights a segment directly if the light is dim, else queues it for apply_clustered_lights.
+void apply_light(fix obj_intensity, int obj_seg, vms_vector* obj_pos, int objnum)
+{
 	if (obj_intensity)
 	{
 		fix	obji_64 = obj_intensity * 64;
 
 		// for pretty dim sources, only process vertices in object's own segment.
 		//	12/04/95, MK, markers only cast light in own segment.
-		if ((abs(obji_64) <= F1_0 * 8) || (Objects[objnum].type == OBJ_MARKER))
+		if ((abs(obji_64) <= F1_0 * 8) || (objnum != -1 && Objects[objnum].type == OBJ_MARKER))
+			apply_light_own_segment(obj_intensity, obj_seg, obj_pos, obji_64);
+		else
 		{
-			short* vp = Segments[obj_seg].verts;
+			dynamic_light_source* light;
+			int64_t max_dist;
 
-			for (vv = 0; vv < MAX_VERTICES_PER_SEGMENT; vv++)
-			{
-				int			vertnum;
-				vms_vector* vertpos;
-				fix			dist;
+			//A non-positive intensity can't light anything in the old mode
+			if (CurrentLogicVersion < LogicVer::FULL_1_0 && obji_64 <= 0)
+				return;
 
-				vertnum = vp[vv];
-				if ((vertnum ^ FrameCount) & 1)
-				{
-					vertpos = &Vertices[vertnum];
-					dist = vm_vec_dist_quick(obj_pos, vertpos);
-					dist = fixmul(dist / 4, dist / 4);
-					if (dist < abs(obji_64)) {
-						if (dist < MIN_LIGHT_DIST)
-							dist = MIN_LIGHT_DIST;
-
-						Dynamic_light[vertnum] += fixdiv(obj_intensity, dist);
-					}
-				}
+			if (Num_dynamic_lights >= MAX_DYNAMIC_LIGHTS)
+			{
+				Int3();
+				return;
 			}
-		}
-		else
-		{
-			int	headlight_shift = 0;
-			fix	max_headlight_dist = F1_0 * 200;
+
+			light = &Dynamic_lights[Num_dynamic_lights++];
+			light->pos = *obj_pos;
+			light->intensity = obj_intensity;
+			light->obji_64 = obji_64;
+			light->objnum = objnum;
+			light->headlight_shift = 0;
+			light->max_headlight_dist = F1_0 * 200;
 
 			if (CurrentLogicVersion >= LogicVer::FULL_1_0)
 			{
-				if (Objects[objnum].type == OBJ_PLAYER)
+				if (objnum != -1 && Objects[objnum].type == OBJ_PLAYER)
 					if (Players[Objects[objnum].id].flags & PLAYER_FLAGS_HEADLIGHT_ON)
 					{
-						headlight_shift = 3;
+						light->headlight_shift = 3;
 						if (Objects[objnum].id != Player_num)
 						{
 							vms_vector	tvec;
@@ -188,89 +256,156 @@ void apply_light(fix obj_intensity, int obj_seg, vms_vector* obj_pos, int n_rend
 
 							fate = find_vector_intersection(&fq, &hit_data);
 							if (fate != HIT_NONE)
-								max_headlight_dist = vm_vec_mag_quick(vm_vec_sub(&tvec, &hit_data.hit_pnt, &Objects[objnum].pos)) + F1_0 * 4;
+								light->max_headlight_dist = vm_vec_mag_quick(vm_vec_sub(&tvec, &hit_data.hit_pnt, &Objects[objnum].pos)) + F1_0 * 4;
 						}
 					}
 
+				max_dist = (int64_t)abs(obji_64) << light->headlight_shift;
+			}
+			else
+				max_dist = obji_64;
 
-				// -- for (vv=FrameCount&1; vv<n_render_vertices; vv+=2) {
-				for (vv = 0; vv < n_render_vertices; vv++)
-				{
-					int			vertnum;
-					vms_vector* vertpos;
-					fix			dist;
-					int			apply_light;
+			//vm_vec_dist_quick is never less than 0.9 of the true distance, less a little rounding
+			light->reach = max_dist + max_dist / 8 + F1_0;
+		}
+	}
+}
 
-					vertnum = render_vertices[vv];
-					if ((vertnum ^ FrameCount) & 1)
-					{
-						vertpos = &Vertices[vertnum];
-						dist = vm_vec_dist_quick(obj_pos, vertpos);
-						apply_light = 0;
+// ----------------------------------------------------------------------------------------------
+//	Runs a bright light over some of the vertices of a segment.
+static void apply_light_to_vertices(dynamic_light_source* light, int n, short* verts)
+{
+	fix vx[MAX_VERTICES_PER_SEGMENT], vy[MAX_VERTICES_PER_SEGMENT], vz[MAX_VERTICES_PER_SEGMENT];
+	fix dists[MAX_VERTICES_PER_SEGMENT];
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		vx[i] = Vertices[verts[i]].x;
+		vy[i] = Vertices[verts[i]].y;
+		vz[i] = Vertices[verts[i]].z;
+	}
+
+	//vm_vec_dist_quick for all of them, with min and max instead of the swaps so it vectorizes
+	for (i = 0; i < n; i++)
+	{
+		fix a = abs(light->pos.x - vx[i]);
+		fix b = abs(light->pos.y - vy[i]);
+		fix c = abs(light->pos.z - vz[i]);
+		fix hi = std::max(a, std::max(b, c));
+		fix mid = std::max(std::min(a, b), std::min(std::max(a, b), c));
+		fix lo = std::min(a, std::min(b, c));
+		fix bc = (mid >> 2) + (lo >> 3);
+		dists[i] = hi + bc + (bc >> 1);
+	}
+
+	Dynamic_light_stats.pairs += n;
+
+	if (CurrentLogicVersion >= LogicVer::FULL_1_0)
+	{
+		fix abs_obji_64 = abs(light->obji_64);
+
+		for (i = 0; i < n; i++)
+		{
+			int vertnum = verts[i];
+			fix dist = dists[i];
 
-						if ((dist >> headlight_shift) < abs(obji_64))
+			if ((dist >> light->headlight_shift) < abs_obji_64)
+			{
+				if (dist < MIN_LIGHT_DIST)
+					dist = MIN_LIGHT_DIST;
+
+				if (light->headlight_shift)
+				{
+					fix			dot;
+					vms_vector	vec_to_point;
+
+					vm_vec_sub(&vec_to_point, &Vertices[vertnum], &light->pos);
+					vm_vec_normalize_quick(&vec_to_point);		//	MK, Optimization note: You compute distance about 15 lines up, this is partially redundant
+					dot = vm_vec_dot(&vec_to_point, &Objects[light->objnum].orient.fvec);
+					if (dot < F1_0 / 2)
+						Dynamic_light[vertnum] += fixdiv(light->intensity, fixmul(HEADLIGHT_SCALE, dist));	//	Do the normal thing, but darken around headlight.
+					else
+					{
+						if (Game_mode & GM_MULTI)
 						{
-							if (dist < MIN_LIGHT_DIST)
-								dist = MIN_LIGHT_DIST;
-
-							//if (Use_fvi_lighting) {
-							//	if (lighting_cache_visible(vertnum, obj_seg, objnum, obj_pos, obj_seg, vertpos)) {
-							//		apply_light = 1;
-							//	}
-							//} else
-							apply_light = 1;
-
-							if (apply_light)
-							{
-								if (headlight_shift)
-								{
-									fix			dot;
-									vms_vector	vec_to_point;
-
-									vm_vec_sub(&vec_to_point, vertpos, obj_pos);
-									vm_vec_normalize_quick(&vec_to_point);		//	MK, Optimization note: You compute distance about 15 lines up, this is partially redundant
-									dot = vm_vec_dot(&vec_to_point, &Objects[objnum].orient.fvec);
-									if (dot < F1_0 / 2)
-										Dynamic_light[vertnum] += fixdiv(obj_intensity, fixmul(HEADLIGHT_SCALE, dist));	//	Do the normal thing, but darken around headlight.
-									else
-									{
-										if (Game_mode & GM_MULTI)
-										{
-											if (dist < max_headlight_dist)
-												Dynamic_light[vertnum] += fixmul(fixmul(dot, dot), obj_intensity) / 8;
-										}
-										else
-											Dynamic_light[vertnum] += fixmul(fixmul(dot, dot), obj_intensity) / 8;
-									}
-								}
-								else
-									Dynamic_light[vertnum] += fixdiv(obj_intensity, dist);
-							}
+							if (dist < light->max_headlight_dist)
+								Dynamic_light[vertnum] += fixmul(fixmul(dot, dot), light->intensity) / 8;
 						}
+						else
+							Dynamic_light[vertnum] += fixmul(fixmul(dot, dot), light->intensity) / 8;
 					}
 				}
+				else
+					Dynamic_light[vertnum] += fixdiv(light->intensity, dist);
 			}
-			else
+		}
+	}
+	else
+	{
+		for (i = 0; i < n; i++)
+		{
+			fix dist = dists[i];
+
+			if (dist < light->obji_64)
 			{
-				for (vv = FrameCount & 1; vv < n_render_vertices; vv += 2) 
-				{
-					int			vertnum;
-					vms_vector* vertpos;
-					fix			dist;
+				if (dist < MIN_LIGHT_DIST)
+					dist = MIN_LIGHT_DIST;
 
-					vertnum = render_vertices[vv];
-					vertpos = &Vertices[vertnum];
-					dist = vm_vec_dist_quick(obj_pos, vertpos);
+				Dynamic_light[verts[i]] += fixdiv(light->intensity, dist);
+			}
+		}
+	}
+}
 
-					if (dist < obji_64) 
-					{
-						if (dist < MIN_LIGHT_DIST)
-							dist = MIN_LIGHT_DIST;
+// ----------------------------------------------------------------------------------------------
+//	Runs the queued bright lights over the rendered segments they can reach.
+static void apply_clustered_lights(int n_render_segs)
+{
+	int render_seg, i, j;
 
-						Dynamic_light[vertnum] += fixdiv(obj_intensity, dist);
-					}
-				}
+	for (render_seg = 0; render_seg < n_render_segs; render_seg++)
+	{
+		int			first = Light_seg_first[render_seg];
+		int			n = Light_seg_first[render_seg + 1] - first;
+		vms_vector	center;
+		int64_t		radius;
+
+		if (n == 0)
+			continue;
+
+		//Bounding sphere of the vertices this segment lights
+		vm_vec_zero(&center);
+		for (i = 0; i < n; i++)
+			vm_vec_add2(&center, &Vertices[Light_verts[first + i]]);
+		center.x /= n; center.y /= n; center.z /= n;
+
+		radius = 0;
+		for (i = 0; i < n; i++)
+		{
+			int64_t dist = vm_vec_dist(&center, &Vertices[Light_verts[first + i]]);
+			if (dist > radius)
+				radius = dist;
+		}
+
+		for (j = 0; j < Num_dynamic_lights; j++)
+		{
+			dynamic_light_source* light = &Dynamic_lights[j];
+			int64_t reach = light->reach + radius + 1;
+			int64_t dx = (int64_t)light->pos.x - center.x;
+			int64_t dy = (int64_t)light->pos.y - center.y;
+			int64_t dz = (int64_t)light->pos.z - center.z;
+
+			//Anything out of the box around the sphere can't reach it, so the squares below can't overflow
+			if (reach < 0x40000000)
+			{
+				if (dx >= reach || dx <= -reach || dy >= reach || dy <= -reach || dz >= reach || dz <= -reach)
+					continue;
+				if (dx * dx + dy * dy + dz * dz >= reach * reach)
+					continue;
 			}
+
+			apply_light_to_vertices(light, n, &Light_verts[first]);
 		}
 	}
 }
@@ -279,7 +414,7 @@ void apply_light(fix obj_intensity, int obj_seg, vms_vector* obj_pos, int n_rend
 #define	FLASH_SCALE					(3*F1_0/FLASH_LEN_FIXED_SECONDS)
 
 // ----------------------------------------------------------------------------------------------
-void cast_muzzle_flash_light(int n_render_vertices, short* render_vertices)
+void cast_muzzle_flash_light()
 {
 	fix current_time;
 	int	i;
@@ -293,7 +428,7 @@ void cast_muzzle_flash_light(int n_render_vertices, short* render_vertices)
 		{
 			time_since_flash = current_time - Muzzle_data[i].create_time;
 			if (time_since_flash < FLASH_LEN_FIXED_SECONDS)
-				apply_light((FLASH_LEN_FIXED_SECONDS - time_since_flash) * FLASH_SCALE, Muzzle_data[i].segnum, &Muzzle_data[i].pos, n_render_vertices, render_vertices, -1);
+				apply_light((FLASH_LEN_FIXED_SECONDS - time_since_flash) * FLASH_SCALE, Muzzle_data[i].segnum, &Muzzle_data[i].pos, -1);
 			else
 				Muzzle_data[i].create_time = 0;		// turn off this muzzle flash
 		}
@@ -432,9 +567,7 @@ void set_dynamic_light(void)
 {
 	int	vv;
 	int	objnum;
-	int	n_render_vertices;
-	short	render_vertices[MAX_VERTICES];
-	int8_t	render_vertex_flags[MAX_VERTICES];
+	int	n_render_vertices, n_light_verts;
 	int	render_seg, segnum, v;
 	int8_t	new_lighting_objects[MAX_OBJECTS];
 
@@ -446,12 +579,27 @@ void set_dynamic_light(void)
 	//if (Use_fvi_lighting)
 	//	mprintf((0, "hits = %8i, misses = %8i, lookups = %8i, hit ratio = %7.4f\n", Cache_hits, Cache_lookups - Cache_hits, Cache_lookups, (float) Cache_hits / Cache_lookups));
 
-	memset(render_vertex_flags, 0, Highest_vertex_index + 1);
+	Light_pass++;
+	if (Light_pass <= 0) //wrap!
+	{
+		memset(Vertex_light_pass, 0, sizeof(Vertex_light_pass));
+		memset(Vertex_seen_pass, 0, sizeof(Vertex_seen_pass));
+		Light_pass = 1;
+		Light_frame = -1;
+	}
+	if (Light_frame != FrameCount)
+	{
+		Light_frame = FrameCount;
+		Light_frame_first_pass = Light_pass;
+	}
 
 	//	Create list of vertices that need to be looked at for setting of ambient light.
+	//	Also sort the ones lit this frame by the segment that added them first.
 	n_render_vertices = 0;
+	n_light_verts = 0;
 	for (render_seg = 0; render_seg < N_render_segs; render_seg++)
 	{
+		Light_seg_first[render_seg] = n_light_verts;
 		segnum = Render_list[render_seg];
 		if (segnum != -1)
 		{
@@ -464,37 +612,41 @@ void set_dynamic_light(void)
 					Int3();		//invalid vertex number
 					continue;	//ignore it, and go on to next one
 				}
-				if (!render_vertex_flags[vnum])
+				if (Vertex_seen_pass[vnum] != Light_pass)
 				{
-					render_vertex_flags[vnum] = 1;
-					render_vertices[n_render_vertices++] = vnum;
+					int lit;
+
+					//the new code lights odd or even vertex numbers, the old code odd or even positions in the list
+					if (CurrentLogicVersion >= LogicVer::FULL_1_0)
+						lit = (vnum ^ FrameCount) & 1;
+					else
+						lit = ((n_render_vertices ^ FrameCount) & 1) == 0;
+					if (lit)
+					{
+						if (vertex_lit_earlier(vnum))
+							Dynamic_light_stats.shared_verts++;
+						else
+						{
+							Light_verts[n_light_verts++] = vnum;
+							Vertex_light_pass[vnum] = Light_pass;
+						}
+					}
+
+					Vertex_seen_pass[vnum] = Light_pass;
+					n_render_vertices++;
 				}
 			}
 		}
 	}
+	Light_seg_first[N_render_segs] = n_light_verts;
 
-	if (CurrentLogicVersion >= LogicVer::FULL_1_0)
-	{
-		for (vv = 0; vv < n_render_vertices; vv++)
-		{
-			int	vertnum;
+	//the vertices lit this pass are the ones that get cleared, in both orders
+	for (vv = 0; vv < n_light_verts; vv++)
+		Dynamic_light[Light_verts[vv]] = 0;
 
-			vertnum = render_vertices[vv];
-			Assert(vertnum >= 0 && vertnum <= Highest_vertex_index);
-			if ((vertnum ^ FrameCount) & 1)
-				Dynamic_light[vertnum] = 0;
-		}
-	}
-	else
-	{
-		for (vv = FrameCount & 1; vv < n_render_vertices; vv += 2) 
-		{
-			Assert(render_vertices[vv] >= 0 && render_vertices[vv] <= Highest_vertex_index);
-			Dynamic_light[render_vertices[vv]] = 0;
-		}
-	}
+	Num_dynamic_lights = 0;
 
-	cast_muzzle_flash_light(n_render_vertices, render_vertices);
+	cast_muzzle_flash_light();
 
 	for (objnum = 0; objnum <= Highest_object_index; objnum++)
 		new_lighting_objects[objnum] = 0;
@@ -519,7 +671,7 @@ void set_dynamic_light(void)
 
 			if (obj_intensity)
 			{
-				apply_light(obj_intensity, obj->segnum, objpos, n_render_vertices, render_vertices, obj - Objects);
+				apply_light(obj_intensity, obj->segnum, objpos, obj - Objects);
 				new_lighting_objects[objnum] = 1;
 			}
 
@@ -544,7 +696,7 @@ void set_dynamic_light(void)
 
 				if (obj_intensity)
 				{
-					apply_light(obj_intensity, obj->segnum, objpos, n_render_vertices, render_vertices, objnum);
+					apply_light(obj_intensity, obj->segnum, objpos, objnum);
 					Lighting_objects[objnum] = 1;
 				}
 				else
@@ -558,6 +710,17 @@ void set_dynamic_light(void)
 			Lighting_objects[objnum] = new_lighting_objects[objnum];
 		}
 	}
+
+	apply_clustered_lights(N_render_segs);
+
+	Dynamic_light_stats.lights += Num_dynamic_lights;
+	Dynamic_light_stats.brute_pairs += Num_dynamic_lights * n_light_verts;
+}
+
+void lighting_end_frame()
+{
+	Dynamic_light_stats_last_frame = Dynamic_light_stats;
+	memset(&Dynamic_light_stats, 0, sizeof(Dynamic_light_stats));
 }
 
 // ---------------------------------------------------------
@@ -642,6 +805,7 @@ fix compute_seg_dynamic_light(int segnum)
 
 fix object_light[MAX_OBJECTS];
 int object_sig[MAX_OBJECTS];
+int object_light_frame[MAX_OBJECTS];	//FrameCount + 1 when object_light was last ramped
 object* old_viewer;
 int reset_lighting_hack;
 
@@ -649,6 +813,14 @@ int reset_lighting_hack;
 
 void start_lighting_frame(object* viewer)
 {
+	static int last_frame = -1;
+
+	//Only the first view of a frame counts. The rear view or a missile camera changed the viewer
+	//every frame, which kept resetting the ramp in the main view.
+	if (FrameCount == last_frame)
+		return;
+	last_frame = FrameCount;
+
 	reset_lighting_hack = (viewer != old_viewer);
 	old_viewer = viewer;
 }
@@ -674,7 +846,9 @@ fix compute_object_light(object* obj, vms_vector* rotated_pnt)
 	//return light;
 	//Now, maybe return different value to smooth transitions
 
-	if (!reset_lighting_hack && object_sig[objnum] == obj->signature)
+	if (object_light_frame[objnum] == FrameCount + 1 && object_sig[objnum] == obj->signature)
+		light = object_light[objnum];		//an earlier view already ramped it this frame
+	else if (!reset_lighting_hack && object_sig[objnum] == obj->signature)
 	{
 		fix delta_light, frame_delta;
 
@@ -693,6 +867,7 @@ fix compute_object_light(object* obj, vms_vector* rotated_pnt)
 		object_sig[objnum] = obj->signature;
 		object_light[objnum] = light;
 	}
+	object_light_frame[objnum] = FrameCount + 1;
 
 	//Next, add in headlight on this object
 
@@ -21,6 +21,20 @@ extern fix	Dynamic_light[MAX_VERTICES];
 
 extern void set_dynamic_light(void);
 
+//Dynamic lighting work, summed over the views rendered in a frame
+typedef struct dynamic_light_stats
+{
+	int lights;			//lights too bright to only light their own segment
+	int pairs;			//light-vertex distances evaluated
+	int brute_pairs;	//what it would have taken to run every bright light over every rendered vertex
+	int shared_verts;	//vertices a later view didn't relight because an earlier one had
+} dynamic_light_stats;
+
+extern dynamic_light_stats Dynamic_light_stats_last_frame;
+
+//Call once a frame to move the counters into Dynamic_light_stats_last_frame.
+void lighting_end_frame();
+
 //Compute the lighting from the headlight for a given vertex on a face.
 //Takes:
 //  point - the 3d coords of the point
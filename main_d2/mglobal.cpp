@@ -30,6 +30,9 @@ fix GameTime = 0;			//	Time in game, in seconds
 //How many frames we've rendered
 int FrameCount = 0;
 
+//How many simulation ticks have run
+int Tick_count = 0;
+
 //	This is the global mine which create_new_mine returns.
 segment	Segments[MAX_SEGMENTS];
 segment2	Segment2s[MAX_SEGMENTS];
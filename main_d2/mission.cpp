@@ -15,6 +15,8 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <vector>
+#include <algorithm>
 
 #include "cfile/cfile.h"
 #include "platform/platform_filesys.h"
@@ -27,6 +29,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "platform/mono.h"
 #include "misc/error.h"
 #include "platform/findfile.h"
+#include "levelcache.h"
 
 mle Mission_list[MAX_MISSIONS];
 
@@ -351,6 +354,238 @@ int read_mission_file(char *filename,int count,int location)
 	return 0;
 }
 
+//Mission index.
+//With a large add-on collection, parsing every .mn2 each time a mission menu opens takes seconds.
+//What read_mission_file finds out about each file in the missions directory is kept in an index,
+//keyed on the file's name, size and modification time. The index is read once, only new or
+//changed files get parsed, and it's written back when a scan changed it.
+
+#define MISSION_INDEX_FILENAME "missions.idx"
+#define MISSION_INDEX_VERSION 1
+
+static const char mission_index_id[4] = { 'D', 'M', 'I', 'X' };
+
+typedef struct mission_index_header
+{
+	char id[4];
+	int version;
+	int hoard;				//HoardEquipped() when the index was built, it changes which names are read
+	int num_entries;
+	uint32_t crc;			//of the entries
+} mission_index_header;
+
+typedef struct mission_index_entry
+{
+	char file[FILENAME_LEN];	//name in the missions directory, with extension
+	uint32_t size;			//as FileFindNext saw the file when it was read
+	uint32_t time;
+	char mission_name[MISSION_NAME_LEN + 1];
+	uint8_t anarchy_only_flag;
+	uint8_t valid;			//what read_mission_file returned
+	uint8_t pad;
+} mission_index_entry;
+
+static std::vector<mission_index_entry> Mission_index;		//sorted on file
+static std::vector<mission_index_entry> Mission_index_scan;	//files found by the scan in progress
+static int Mission_index_loaded = 0;
+static int Mission_index_hoard = -1;
+static int Mission_index_dirty;
+
+static bool mission_index_less(const mission_index_entry& a, const mission_index_entry& b)
+{
+	return strcmp(a.file, b.file) < 0;
+}
+
+static void mission_index_get_filename(char* buf)
+{
+#if defined(CHOCOLATE_USE_LOCALIZED_PATHS)
+	get_full_file_path(buf, MISSION_INDEX_FILENAME, CHOCOLATE_CONFIG_DIR);
+#else
+	strcpy(buf, MISSION_INDEX_FILENAME);
+#endif
+}
+
+//Reads the index file in one go. A missing, damaged or out of date index is just empty.
+static void mission_index_load()
+{
+	char filename[CHOCOLATE_MAX_FILE_PATH_SIZE];
+	FILE* fp;
+	long len;
+	mission_index_header* header;
+	std::vector<uint8_t> data;
+
+	Mission_index_loaded = 1;
+	Mission_index.clear();
+
+	mission_index_get_filename(filename);
+	fp = fopen(filename, "rb");
+	if (!fp) return;
+
+	fseek(fp, 0, SEEK_END);
+	len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	if (len < (long)sizeof(mission_index_header))
+	{
+		fclose(fp);
+		return;
+	}
+
+	data.resize(len);
+	if (fread(data.data(), 1, len, fp) != (size_t)len)
+	{
+		fclose(fp);
+		return;
+	}
+	fclose(fp);
+
+	header = (mission_index_header*)data.data();
+	if (memcmp(header->id, mission_index_id, 4) || header->version != MISSION_INDEX_VERSION || header->num_entries < 0 ||
+		len != (long)(sizeof(mission_index_header) + header->num_entries * sizeof(mission_index_entry)))
+		return;
+
+	if (levelcache_crc(data.data() + sizeof(mission_index_header), header->num_entries * sizeof(mission_index_entry), 0) != header->crc)
+	{
+		mprintf((1, "mission index %s is damaged\n", filename));
+		return;
+	}
+
+	Mission_index.resize(header->num_entries);
+	memcpy(Mission_index.data(), data.data() + sizeof(mission_index_header), header->num_entries * sizeof(mission_index_entry));
+	Mission_index_hoard = header->hoard;
+
+	std::sort(Mission_index.begin(), Mission_index.end(), mission_index_less);
+}
+
+static void mission_index_save()
+{
+	char filename[CHOCOLATE_MAX_FILE_PATH_SIZE], temp_filename[CHOCOLATE_MAX_FILE_PATH_SIZE + 4];
+	FILE* fp;
+	int ok;
+	mission_index_header header;
+
+	memcpy(header.id, mission_index_id, 4);
+	header.version = MISSION_INDEX_VERSION;
+	header.hoard = Mission_index_hoard;
+	header.num_entries = (int)Mission_index.size();
+	header.crc = levelcache_crc(Mission_index.data(), Mission_index.size() * sizeof(mission_index_entry), 0);
+
+	mission_index_get_filename(filename);
+	snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", filename);
+	fp = fopen(temp_filename, "wb");
+	if (!fp)
+	{
+		mprintf((1, "Can't create mission index %s\n", temp_filename));
+		return;
+	}
+
+	ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+	if (!Mission_index.empty())
+		ok &= fwrite(Mission_index.data(), sizeof(mission_index_entry), Mission_index.size(), fp) == Mission_index.size();
+	ok &= fclose(fp) == 0;
+
+	if (ok)
+		ok = replace_file(temp_filename, filename) == 0;
+	if (!ok)
+		_unlink(temp_filename);
+}
+
+static void mission_index_begin_scan()
+{
+	int hoard = HoardEquipped();
+
+	if (!Mission_index_loaded)
+		mission_index_load();
+
+	if (hoard != Mission_index_hoard)
+	{
+		Mission_index.clear();
+		Mission_index_hoard = hoard;
+	}
+
+	Mission_index_scan.clear();
+	Mission_index_dirty = 0;
+}
+
+//The scan's files become the index, so missions that were removed drop out of it. A scan that
+//stopped at MAX_MISSIONS keeps the entries it didn't get to.
+static void mission_index_end_scan(int complete)
+{
+	std::vector<mission_index_entry>::iterator it;
+
+	std::sort(Mission_index_scan.begin(), Mission_index_scan.end(), mission_index_less);
+
+	if (!complete)
+	{
+		size_t num_scanned = Mission_index_scan.size();
+
+		for (it = Mission_index.begin(); it != Mission_index.end(); ++it)
+			if (!std::binary_search(Mission_index_scan.begin(), Mission_index_scan.begin() + num_scanned, *it, mission_index_less))
+				Mission_index_scan.push_back(*it);
+
+		std::sort(Mission_index_scan.begin(), Mission_index_scan.end(), mission_index_less);
+	}
+
+	if (Mission_index_scan.size() != Mission_index.size())
+		Mission_index_dirty = 1;
+
+	Mission_index.swap(Mission_index_scan);
+	Mission_index_scan.clear();
+
+	if (Mission_index_dirty)
+		mission_index_save();
+}
+
+//Fills in Mission_list[count] for a file in the missions directory like read_mission_file does,
+//from the index if the file hasn't changed since it was last read. Returns 1 if the file read ok.
+static int read_indexed_mission_file(FILEFINDSTRUCT* find, int count)
+{
+	mission_index_entry entry;
+	char temp[FILENAME_LEN], *t;
+	std::vector<mission_index_entry>::iterator it;
+
+	if (strlen(find->name) >= sizeof(entry.file))
+		return read_mission_file(find->name, count, ML_MISSIONDIR);
+
+	memset(&entry, 0, sizeof(entry));
+	strcpy(entry.file, find->name);
+	entry.size = find->size;
+	entry.time = find->time;
+
+	it = std::lower_bound(Mission_index.begin(), Mission_index.end(), entry, mission_index_less);
+
+	if (it != Mission_index.end() && !strcmp(it->file, entry.file) && it->size == entry.size && it->time == entry.time)
+	{
+		entry = *it;
+
+		if (entry.valid)
+		{
+			strcpy(temp, entry.file);
+			if ((t = strchr(temp, '.')) != NULL)
+				*t = 0;
+
+			strncpy(Mission_list[count].filename, temp, 9);
+			memcpy(Mission_list[count].mission_name, entry.mission_name, sizeof(entry.mission_name));
+			Mission_list[count].anarchy_only_flag = entry.anarchy_only_flag;
+			Mission_list[count].location = ML_MISSIONDIR;
+		}
+	}
+	else
+	{
+		entry.valid = read_mission_file(find->name, count, ML_MISSIONDIR);
+		if (entry.valid)
+		{
+			memcpy(entry.mission_name, Mission_list[count].mission_name, sizeof(entry.mission_name));
+			entry.anarchy_only_flag = Mission_list[count].anarchy_only_flag;
+		}
+
+		Mission_index_dirty = 1;
+	}
+
+	Mission_index_scan.push_back(entry);
+
+	return entry.valid;
+}
 
 //fills in the global list of missions.  Returns the number of missions
 //in the list.  If anarchy_mode set, don't include non-anarchy levels.
@@ -398,6 +633,8 @@ int build_mission_list(int anarchy_mode)
 
 	special_count = count=1;
 
+	mission_index_begin_scan();
+
 	if( !FileFindFirst( search_name, &find ) )
 	{
 		do	
@@ -405,7 +642,7 @@ int build_mission_list(int anarchy_mode)
 			if (_strfcmp(find.name,BUILTIN_MISSION)==0)
 				continue;		//skip the built-in
 
-			if (read_mission_file(find.name,count,ML_MISSIONDIR)) 
+			if (read_indexed_mission_file(&find,count)) 
 			{
 				if (anarchy_mode || !Mission_list[count].anarchy_only_flag)
 					count++;
@@ -415,6 +652,8 @@ int build_mission_list(int anarchy_mode)
 		FileFindClose();
 	}
 
+	mission_index_end_scan(count < MAX_MISSIONS);
+
 	//move vertigo to top of mission list
 	{
 		int i;
@@ -31,6 +31,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "bm.h"
 
 morph_data morph_objects[MAX_MORPH_OBJECTS];
+static int Morph_recorded_frame[MAX_MORPH_OBJECTS];	//FrameCount + 1 when the demo last got each one
 
 //returns ptr to data for this object, or NULL if none
 morph_data *find_morph_data(object *obj)
@@ -288,6 +289,7 @@ void morph_start(object *obj)
 		return;
 
 	md = &morph_objects[i];
+	Morph_recorded_frame[i] = 0;
 
 	Assert(obj->render_type == RT_POLYOBJ);
 
@@ -430,8 +432,12 @@ void draw_morph_object(object *obj)
 	g3_done_instance();
 
 	#ifdef NEWDEMO
-	if (Newdemo_state == ND_STATE_RECORDING)
+	//Once a frame, not once for each view that draws it
+	if (Newdemo_state == ND_STATE_RECORDING && Morph_recorded_frame[md - morph_objects] != FrameCount + 1)
+	{
+		Morph_recorded_frame[md - morph_objects] = FrameCount + 1;
 		newdemo_record_morph_frame(md);
+	}
 	#endif
 
 }
@@ -83,7 +83,7 @@ int Num_subtitles;
 // ----------------------------------------------------------------------
 void* MPlayAlloc(unsigned size)
 {
-	return mem_malloc(size);
+	return mem_malloc_tag(size, MEM_TAG_MOVIE);
 }
 
 void MPlayFree(void* p)
@@ -697,9 +697,9 @@ int InitRobotMovie(const char* filename)
 	for (i = 0; i < 50; i++)
 	{
 		if (MenuHires)
-			RoboBuffer[i] = mem_malloc(65000L);
+			RoboBuffer[i] = mem_malloc_tag(65000L, MEM_TAG_MOVIE);
 		else
-			RoboBuffer[i] = mem_malloc(17000L);
+			RoboBuffer[i] = mem_malloc_tag(17000L, MEM_TAG_MOVIE);
 
 		if (RoboBuffer[i] == NULL)
 		{
@@ -825,7 +825,7 @@ int init_subtitles(const char* filename)
 
 	size = cfilelength(ifile);
 
-	MALLOC(subtitle_raw_data, uint8_t, size + 1);
+	MALLOC_TAG(subtitle_raw_data, uint8_t, size + 1, MEM_TAG_MOVIE);
 
 	read_count = cfread(subtitle_raw_data, 1, size, ifile);
 
@@ -1314,6 +1314,29 @@ int open_movie_file(const char* filename, int must_have)
 	return -1;		//couldn't find it
 }
 
+void benchmark_movie(const char* filename)
+{
+	int filehndl, frames;
+	uint64_t us;
+
+	filehndl = open_movie_file(filename, 0);
+	if (filehndl == -1)
+	{
+		printf("Cannot open movie file <%s>\n", filename);
+		return;
+	}
+
+	if (MVE_rmBenchmark(filehndl, &frames, &us))
+		printf("Cannot decode movie file <%s>\n", filename);
+	else
+	{
+		printf("%s: %d frames in %.3f seconds, %.1f frames/sec\n", filename, frames, us / 1000000.0, us ? frames * 1000000.0 / us : 0.0);
+		mprintf((0, "%s: %d frames in %.3f seconds\n", filename, frames, us / 1000000.0));
+	}
+
+	_close(filehndl);
+}
+
 //sets the file position to the start of this already-open file
 int reset_movie_file(int handle)
 {
@@ -33,6 +33,9 @@ int RotateRobot();
 //find and initialize the movie libraries
 void init_movies();
 
+//decodes a movie as fast as possible and prints the frame rate, for -mvebench
+void benchmark_movie(const char *filename);
+
 int init_subtitles(const char *filename);
 void close_subtitles();
 
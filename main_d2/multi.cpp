@@ -567,6 +567,7 @@ multi_make_player_ghost(int playernum)
 	obj->render_type = RT_NONE;
 	obj->movement_type = MT_NONE;
 	multi_reset_player_object(obj);
+	fvi_broadphase_update(Players[playernum].objnum);
 
 	if (Game_mode & GM_MULTI_ROBOTS)
 		multi_strip_robots(playernum);
@@ -594,6 +595,7 @@ multi_make_ghost_player(int playernum)
 	obj->type = OBJ_PLAYER;
 	obj->movement_type = MT_PHYSICS;
 	multi_reset_player_object(obj);
+	fvi_broadphase_update(Players[playernum].objnum);
 }
 
 int multi_get_kill_list(int* plist)
@@ -5162,6 +5164,7 @@ void multi_quick_sound_hack(int num)
 {
 	int length, i;
 	num = digi_xlat_sound(num);
+	piggy_sound_page_in(num);
 	length = GameSounds[num].length;
 	ReversedSound.data = (uint8_t*)malloc(length);
 	ReversedSound.length = length;
@@ -5264,7 +5267,7 @@ void init_hoard_data()
 		int bitmap_num = Num_bitmap_files;
 
 		//Allocate memory for bitmaps
-		MALLOC(bitmap_data, uint8_t, n_orb_frames * orb_w * orb_h + n_goal_frames * 64 * 64);
+		MALLOC_TAG(bitmap_data, uint8_t, n_orb_frames * orb_w * orb_h + n_goal_frames * 64 * 64, MEM_TAG_BITMAP);
 
 		//Create orb vclip
 		orb_vclip = Num_vclips++;
@@ -5339,7 +5342,7 @@ void init_hoard_data()
 		if (first_time)
 		{
 			uint8_t* bitmap_data;
-			MALLOC(bitmap_data, uint8_t, icon_w * icon_h);
+			MALLOC_TAG(bitmap_data, uint8_t, icon_w * icon_h, MEM_TAG_BITMAP);
 			init_bitmap(&Orb_icons[i], icon_w, icon_h, BM_FLAG_TRANSPARENT, bitmap_data);
 		}
 		cfread(palette, 3, 256, ifile);
@@ -5365,7 +5368,7 @@ void init_hoard_data()
 			}
 
 			GameSounds[Num_sound_files + i].length = len;
-			GameSounds[Num_sound_files + i].data = (uint8_t*)mem_malloc(len);
+			GameSounds[Num_sound_files + i].data = (uint8_t*)mem_malloc_tag(len, MEM_TAG_SOUND);
 			cfread(GameSounds[Num_sound_files + i].data, 1, len, ifile);
 
 			if (digi_sample_rate == SAMPLE_RATE_11K) 
@@ -2344,6 +2344,7 @@ void network_read_object_packet(uint8_t* data)
 				obj->attached_obj = -1;
 				if (segnum > -1)
 					obj_link(obj - Objects, segnum);
+				homing_index_add(objnum);
 				if (obj_owner == my_pnum)
 					map_objnum_local_to_local(objnum);
 				else if (obj_owner != -1)
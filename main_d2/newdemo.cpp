@@ -1628,8 +1628,11 @@ int newdemo_read_frame_information()
 	done = 0;
 
 	if (Newdemo_vcr_state != ND_STATE_PAUSED)
+	{
 		for (segnum = 0; segnum <= Highest_segment_index; segnum++)
 			Segments[segnum].objects = -1;
+		fvi_broadphase_reset();
+	}
 
 	reset_objects(1);
 	Players[Player_num].homing_object_dist = -F1_0;
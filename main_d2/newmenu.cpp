@@ -20,6 +20,8 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include <string.h>
 #include <stdarg.h>
 #include <ctype.h>
+#include <vector>
+#include <algorithm>
 
 #include "platform/posixstub.h"
 #include "platform/platform.h"
@@ -54,6 +56,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "player.h"
 #include "newdemo.h"
 #include "kconfig.h"
+#include "state.h"
 
 #if defined (TACTILE)
 #include "tactile.h"
@@ -1187,7 +1190,7 @@ RePaintNewmenu4:
 
 			if (!filename) {
 				gr_free_bitmap(bg.saved);
-				mem_free(bg.background);
+				gr_free_sub_bitmap(bg.background);
 			}
 			else
 				gr_free_bitmap(bg.background);
@@ -1906,7 +1909,7 @@ RePaintNewmenu4:
 		gr_bitmap(0, 0, bg.saved);
 		WIN(DDGRUNLOCK(dd_grd_curcanv));
 		gr_free_bitmap(bg.saved);
-		mem_free(bg.background);
+		gr_free_sub_bitmap(bg.background);
 	}
 	else
 	{
@@ -2002,32 +2005,28 @@ int nm_messagebox(const char* title, int nchoices, ...)
 	return newmenu_do(title, nm_text, nchoices, nm_message_items, NULL);
 }
 
+//Sorts an index of the entries, then moves each entry into place once
 void newmenu_file_sort(int n, char* list)
 {
-	int i, j, incr;
-	char t[14];
+	int i;
 
-	incr = n / 2;
-	while (incr > 0)
-	{
-		for (i = incr; i < n; i++)
+	if (n < 2)
+		return;
+
+	std::vector<int> order(n);
+	std::vector<char> sorted(n * 14);
+
+	for (i = 0; i < n; i++)
+		order[i] = i;
+
+	std::stable_sort(order.begin(), order.end(), [list](int a, int b)
 		{
-			j = i - incr;
-			while (j >= 0)
-			{
-				if (strncmp(&list[j * 14], &list[(j + incr) * 14], 12) > 0)
-				{
-					memcpy(t, &list[j * 14], FILENAME_LEN);
-					memcpy(&list[j * 14], &list[(j + incr) * 14], FILENAME_LEN);
-					memcpy(&list[(j + incr) * 14], t, FILENAME_LEN);
-					j -= incr;
-				}
-				else
-					break;
-			}
-		}
-		incr = incr / 2;
-	}
+			return strncmp(&list[a * 14], &list[b * 14], 12) < 0;
+		});
+
+	for (i = 0; i < n; i++)
+		memcpy(&sorted[i * 14], &list[order[i] * 14], 14);
+	memcpy(list, sorted.data(), n * 14);
 }
 
 void delete_player_saved_games(char* name)
@@ -2038,6 +2037,8 @@ void delete_player_saved_games(char* name)
 #endif
 	char filename[16];
 
+	state_wait_for_write();		//don't let a save still being written come back after it's deleted
+
 	for (i = 0; i < 10; i++)
 	{
 #if defined(CHOCOLATE_USE_LOCALIZED_PATHS)
@@ -28,6 +28,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "bm.h"
 //#include "error.h"
 #include "platform/mono.h"
+#include "mem/mem.h"
 #include "3d/3d.h"
 #include "segment.h"
 #include "texmap/texmap.h"
@@ -97,7 +98,12 @@ uint8_t CollisionResult[MAX_OBJECT_TYPES][MAX_OBJECT_TYPES];
 
 object* ConsoleObject;					//the object that is the player
 
-static short free_obj_list[MAX_OBJECTS];
+short free_obj_list[MAX_OBJECTS];
+static short obj_list_pos[MAX_OBJECTS];	//where each slot is in free_obj_list
+static uint64_t obj_used_bits[(MAX_OBJECTS + 63) / 64];	//which slots are allocated, for walking them in objnum order
+
+int Max_objects = MAX_OBJECTS_LEGACY;
+int Max_objects_single = MAX_OBJECTS_LEGACY;
 
 //Data for objects
 
@@ -350,19 +356,23 @@ void draw_cloaked_object(object * obj, fix light, fix * glow, fix cloak_start_ti
 	{
 		static int cloak_delta = 0, cloak_dir = 1;
 		static fix cloak_timer = 0;
+		static int cloak_frame = -1;
 
-		//note, if more than one cloaked object is visible at once, the
-		//pulse rate will change!
-
-		cloak_timer -= FrameTime;
-		while (cloak_timer < 0) 
+		//The pulse steps once a frame, however many cloaked objects and views draw it. It used to
+		//step for every cloaked object drawn, so the rear view or a second cloaked object sped it up.
+		if (cloak_frame != FrameCount)
 		{
-			cloak_timer += Cloak_fadeout_duration / 12;
+			cloak_frame = FrameCount;
+			cloak_timer -= FrameTime;
+			while (cloak_timer < 0) 
+			{
+				cloak_timer += Cloak_fadeout_duration / 12;
 
-			cloak_delta += cloak_dir;
+				cloak_delta += cloak_dir;
 
-			if (cloak_delta == 0 || cloak_delta == 4)
-				cloak_dir = -cloak_dir;
+				if (cloak_delta == 0 || cloak_delta == 4)
+					cloak_dir = -cloak_dir;
+			}
 		}
 
 		cloak_value = CLOAKED_FADE_LEVEL - cloak_delta;
@@ -406,40 +416,30 @@ void draw_cloaked_object(object * obj, fix light, fix * glow, fix cloak_start_ti
 
 }
 
-//draw an object which renders as a polygon model
-void draw_polygon_object(object* obj)
+//Engine glow and headlight state of each object, worked out by the first view of a frame to draw it
+typedef struct object_glow
 {
-	fix light;
-	int	imsave;
-	fix engine_glow_value[2];		//element 0 is for engine glow, 1 for headlight
+	int frame;			//FrameCount + 1 when glow was set
+	int signature;
+	fix glow[2];
+} object_glow;
 
-	light = compute_object_light(obj, NULL);
-
-	//	If option set for bright players in netgame, brighten them!
-#ifdef NETWORK
-	if (Game_mode & GM_MULTI)
-		if (Netgame.BrightPlayers)
-			light = F1_0;
-#endif
-
-	//make robots brighter according to robot glow field
-	if (obj->type == OBJ_ROBOT)
-		light += (Robot_info[obj->id].glow << 12);		//convert 4:4 to 16:16
-
-	if (obj->type == OBJ_WEAPON)
-		if (obj->id == FLARE_ID)
-			light += F1_0 * 2;
-
-	if (obj->type == OBJ_MARKER)
-		light += F1_0 * 2;
+static object_glow Object_glow[MAX_OBJECTS];
 
+static void get_engine_glow(object* obj, fix* engine_glow_value)
+{
+	object_glow* cached = &Object_glow[obj - Objects];
 
-	imsave = Interpolation_method;
-	if (Linear_tmap_polygon_objects)
-		Interpolation_method = 1;
+	if (cached->frame == FrameCount + 1 && cached->signature == obj->signature)
+	{
+		engine_glow_value[0] = cached->glow[0];
+		engine_glow_value[1] = cached->glow[1];
+		return;
+	}
 
 	//set engine glow value
 	engine_glow_value[0] = f1_0 / 5;
+	engine_glow_value[1] = -3;
 	if (obj->movement_type == MT_PHYSICS) 
 	{
 		if (obj->mtype.phys_info.flags & PF_USES_THRUST && obj->type == OBJ_PLAYER && obj->id == Player_num) 
@@ -466,6 +466,46 @@ void draw_polygon_object(object* obj)
 			engine_glow_value[1] = -3;			//don't draw
 	}
 
+	cached->frame = FrameCount + 1;
+	cached->signature = obj->signature;
+	cached->glow[0] = engine_glow_value[0];
+	cached->glow[1] = engine_glow_value[1];
+}
+
+//draw an object which renders as a polygon model
+void draw_polygon_object(object* obj)
+{
+	fix light;
+	int	imsave;
+	fix engine_glow_value[2];		//element 0 is for engine glow, 1 for headlight
+
+	light = compute_object_light(obj, NULL);
+
+	//	If option set for bright players in netgame, brighten them!
+#ifdef NETWORK
+	if (Game_mode & GM_MULTI)
+		if (Netgame.BrightPlayers)
+			light = F1_0;
+#endif
+
+	//make robots brighter according to robot glow field
+	if (obj->type == OBJ_ROBOT)
+		light += (Robot_info[obj->id].glow << 12);		//convert 4:4 to 16:16
+
+	if (obj->type == OBJ_WEAPON)
+		if (obj->id == FLARE_ID)
+			light += F1_0 * 2;
+
+	if (obj->type == OBJ_MARKER)
+		light += F1_0 * 2;
+
+
+	imsave = Interpolation_method;
+	if (Linear_tmap_polygon_objects)
+		Interpolation_method = 1;
+
+	get_engine_glow(obj, engine_glow_value);
+
 	if (obj->rtype.pobj_info.tmap_override != -1) 
 	{
 		polymodel* pm = &Polygon_models[obj->rtype.pobj_info.model_num];
@@ -784,6 +824,60 @@ void init_player_object()
 	reset_player_object();
 }
 
+static void obj_list_set(int index, int objnum)
+{
+	free_obj_list[index] = objnum;
+	obj_list_pos[objnum] = index;
+}
+
+//bits must not be 0
+static int lowest_bit_index(uint64_t bits)
+{
+	int n = 0;
+
+	if (!(bits & 0xffffffffull)) { n += 32; bits >>= 32; }
+	if (!(bits & 0xffff)) { n += 16; bits >>= 16; }
+	if (!(bits & 0xff)) { n += 8; bits >>= 8; }
+	if (!(bits & 0xf)) { n += 4; bits >>= 4; }
+	if (!(bits & 0x3)) { n += 2; bits >>= 2; }
+	if (!(bits & 0x1)) n += 1;
+
+	return n;
+}
+
+//sets the used bits from the first num_objects entries of free_obj_list
+static void obj_used_rebuild()
+{
+	int i;
+
+	memset(obj_used_bits, 0, sizeof(obj_used_bits));
+	for (i = 0; i < num_objects; i++)
+		obj_used_bits[free_obj_list[i] >> 6] |= 1ull << (free_obj_list[i] & 63);
+}
+
+//Returns the first allocated slot at or after objnum, or Highest_object_index+1 if there are none.
+//Walking the slots with this visits them in the same order as looping up to Highest_object_index,
+//including objects created along the way, but skips the free runs.
+static int obj_next_used(int objnum)
+{
+	int word = objnum >> 6;
+	uint64_t bits;
+
+	if (objnum > Highest_object_index)
+		return Highest_object_index + 1;
+
+	bits = obj_used_bits[word] & (~0ull << (objnum & 63));
+	while (!bits)
+	{
+		if (++word > (Highest_object_index >> 6))
+			return Highest_object_index + 1;
+		bits = obj_used_bits[word];
+	}
+
+	objnum = (word << 6) + lowest_bit_index(bits);
+	return std::min(objnum, Highest_object_index + 1);
+}
+
 //sets up the free list & init player & whatever else
 void init_objects()
 {
@@ -793,13 +887,15 @@ void init_objects()
 
 	for (i = 0; i < MAX_OBJECTS; i++) 
 	{
-		free_obj_list[i] = i;
+		if (i < Max_objects)
+			obj_list_set(i, i);
 		Objects[i].type = OBJ_NONE;
 		Objects[i].segnum = -1;
 	}
 
 	for (i = 0; i < MAX_SEGMENTS; i++)
 		Segments[i].objects = -1;
+	fvi_broadphase_reset();
 
 	ConsoleObject = Viewer = &Objects[0];
 
@@ -808,6 +904,8 @@ void init_objects()
 
 	num_objects = 1;						//just the player
 	Highest_object_index = 0;
+	obj_used_rebuild();
+	homing_index_reset();
 }
 
 //after calling init_object(), the network code has grabbed specific
@@ -815,19 +913,53 @@ void init_objects()
 //the free list, then set the apporpriate globals
 void special_reset_objects(void)
 {
-	int i;
+	int i, n;
 
-	num_objects = MAX_OBJECTS;
+	num_objects = 0;
 
 	Highest_object_index = 0;
 	Assert(Objects[0].type != OBJ_NONE);		//0 should be used
 
-	for (i = MAX_OBJECTS; i--;)
+	for (i = 0; i < Max_objects; i++)
+		if (Objects[i].type != OBJ_NONE)
+		{
+			obj_list_set(num_objects++, i);
+			Highest_object_index = i;
+		}
+
+	n = num_objects;
+	for (i = 0; i < Max_objects; i++)
 		if (Objects[i].type == OBJ_NONE)
-			free_obj_list[--num_objects] = i;
-		else
-			if (i > Highest_object_index)
-				Highest_object_index = i;
+			obj_list_set(n++, i);
+
+	obj_used_rebuild();
+	homing_index_reset();
+}
+
+int	Max_used_objects = MAX_OBJECTS_LEGACY - 20;
+
+void obj_set_max_objects(int max_objects)
+{
+	int i;
+
+	if (max_objects < MAX_OBJECTS_LEGACY)
+		max_objects = MAX_OBJECTS_LEGACY;
+	if (max_objects > MAX_OBJECTS)
+		max_objects = MAX_OBJECTS;
+
+	if (max_objects == Max_objects)
+		return;
+
+	for (i = max_objects; i < Max_objects; i++)
+	{
+		Objects[i].type = OBJ_NONE;
+		Objects[i].segnum = -1;
+	}
+
+	mprintf((0, "Object limit changed from %d to %d\n", Max_objects, max_objects));
+	Max_objects = max_objects;
+	Max_used_objects = Max_objects - 20;
+	special_reset_objects();
 }
 
 #ifndef NDEBUG
@@ -872,6 +1004,8 @@ void johns_obj_unlink(int segnum, int objnum)
 		Objects[obj->prev].next = obj->next;
 
 	if (obj->next != -1) Objects[obj->next].prev = obj->prev;
+
+	fvi_broadphase_unlink(objnum);
 }
 
 void remove_incorrect_objects()
@@ -979,6 +1113,8 @@ void obj_link(int objnum, int segnum)
 
 	if (obj->next != -1) Objects[obj->next].prev = objnum;
 
+	fvi_broadphase_link(objnum, segnum);
+
 	//list_seg_objects( segnum );
 	//check_duplicate_objects();
 
@@ -1005,6 +1141,8 @@ void obj_unlink(int objnum)
 
 	if (obj->next != -1) Objects[obj->next].prev = obj->prev;
 
+	fvi_broadphase_unlink(objnum);
+
 	obj->segnum = -1;
 
 	Assert(Objects[0].next != 0);
@@ -1028,15 +1166,15 @@ int obj_allocate(void)
 {
 	int objnum;
 
-	if (num_objects >= MAX_OBJECTS - 2) 
+	if (num_objects >= Max_objects - 2) 
 	{
 		int	num_freed;
 
-		num_freed = free_object_slots(MAX_OBJECTS - 10);
+		num_freed = free_object_slots(Max_objects - 10);
 		mprintf((0, " *** Freed %i objects in frame %i\n", num_freed, FrameCount));
 	}
 
-	if (num_objects >= MAX_OBJECTS) 
+	if (num_objects >= Max_objects) 
 	{
 #ifndef NDEBUG
 		mprintf((1, "Object creation failed - too many objects!\n"));
@@ -1045,6 +1183,7 @@ int obj_allocate(void)
 	}
 
 	objnum = free_obj_list[num_objects++];
+	obj_used_bits[objnum >> 6] |= 1ull << (objnum & 63);
 
 	if (objnum > Highest_object_index)
 	{
@@ -1053,13 +1192,7 @@ int obj_allocate(void)
 			Highest_ever_object_index = Highest_object_index;
 	}
 
-	{
-		int	i;
-		Unused_object_slots = 0;
-		for (i = 0; i <= Highest_object_index; i++)
-			if (Objects[i].type == OBJ_NONE)
-				Unused_object_slots++;
-	}
+	Unused_object_slots = Highest_object_index + 1 - num_objects;
 	return objnum;
 }
 
@@ -1068,11 +1201,21 @@ int obj_allocate(void)
 //the object has been unlinked
 void obj_free(int objnum)
 {
-	free_obj_list[--num_objects] = objnum;
+	int pos = obj_list_pos[objnum];
+
+	num_objects--;
 	Assert(num_objects >= 0);
+	Assert(pos <= num_objects);
+
+	//fill the hole with the last object in use, and make this the next slot to be allocated
+	obj_list_set(pos, free_obj_list[num_objects]);
+	obj_list_set(num_objects, objnum);
+	obj_used_bits[objnum >> 6] &= ~(1ull << (objnum & 63));
 
 	if (objnum == Highest_object_index)
 		while (Objects[--Highest_object_index].type == OBJ_NONE);
+
+	Unused_object_slots = Highest_object_index + 1 - num_objects;
 }
 
 //-----------------------------------------------------------------------------
@@ -1085,9 +1228,9 @@ int free_object_slots(int num_used)
 	int	num_already_free, num_to_free, original_num_to_free;
 
 	olind = 0;
-	num_already_free = MAX_OBJECTS - Highest_object_index - 1;
+	num_already_free = Max_objects - Highest_object_index - 1;
 
-	if (MAX_OBJECTS - num_already_free < num_used)
+	if (Max_objects - num_already_free < num_used)
 		return 0;
 
 	for (i = 0; i <= Highest_object_index; i++) 
@@ -1095,7 +1238,7 @@ int free_object_slots(int num_used)
 		if (Objects[i].flags & OF_SHOULD_BE_DEAD) 
 		{
 			num_already_free++;
-			if (MAX_OBJECTS - num_already_free < num_used)
+			if (Max_objects - num_already_free < num_used)
 				return num_already_free;
 		}
 		else
@@ -1103,7 +1246,7 @@ int free_object_slots(int num_used)
 			{
 			case OBJ_NONE:
 				num_already_free++;
-				if (MAX_OBJECTS - num_already_free < num_used)
+				if (Max_objects - num_already_free < num_used)
 					return 0;
 				break;
 			case OBJ_WALL:
@@ -1129,7 +1272,7 @@ int free_object_slots(int num_used)
 
 	}
 
-	num_to_free = MAX_OBJECTS - num_used - num_already_free;
+	num_to_free = Max_objects - num_used - num_already_free;
 	original_num_to_free = num_to_free;
 
 	if (num_to_free > olind)
@@ -1297,6 +1440,8 @@ int obj_create(uint8_t type, uint8_t id, int segnum, vms_vector* pos,
 	if (obj->type == OBJ_DEBRIS)
 		Debris_object_count++;
 
+	homing_index_add(objnum);
+
 	return objnum;
 }
 
@@ -1324,6 +1469,7 @@ int obj_create_copy(int objnum, vms_vector* new_pos, int newsegnum)
 	obj_link(newobjnum, newsegnum);
 
 	obj->signature = Object_next_signature++;
+	homing_index_add(newobjnum);
 
 	//we probably should initialize sub-structures here
 
@@ -1423,6 +1569,7 @@ void dead_player_end(void)
 	Viewer = Viewer_save;
 	ConsoleObject->type = OBJ_PLAYER;
 	ConsoleObject->flags = Player_flags_save;
+	fvi_broadphase_update(ConsoleObject - Objects);
 
 	Assert((Control_type_save == CT_FLYING) || (Control_type_save == CT_SLEW));
 
@@ -1595,6 +1742,7 @@ void dead_player_frame(void)
 				ConsoleObject->flags &= ~OF_SHOULD_BE_DEAD;		//don't really kill player
 				ConsoleObject->render_type = RT_NONE;				//..just make him disappear
 				ConsoleObject->type = OBJ_GHOST;						//..and kill intersections
+				fvi_broadphase_update(ConsoleObject - Objects);
 				Players[Player_num].flags &= ~PLAYER_FLAGS_HEADLIGHT_ON;
 					}
 				}
@@ -1739,10 +1887,8 @@ void obj_delete_all_that_should_be_dead()
 	object* objp;
 	int		local_dead_player_object = -1;
 
-	// Move all objects
-	objp = Objects;
-
-	for (i = 0; i <= Highest_object_index; i++) {
+	for (i = obj_next_used(0); i <= Highest_object_index; i = obj_next_used(i + 1)) {
+		objp = &Objects[i];
 		if ((objp->type != OBJ_NONE) && (objp->flags & OF_SHOULD_BE_DEAD)) {
 			Assert(!(objp->type == OBJ_FIREBALL && objp->ctype.expl_info.delete_time != -1));
 			if (objp->type == OBJ_PLAYER) {
@@ -1761,7 +1907,6 @@ void obj_delete_all_that_should_be_dead()
 				obj_delete(i);
 			}
 		}
-		objp++;
 	}
 }
 
@@ -2039,14 +2184,53 @@ void object_move_one(object* obj)
 #endif		//DEMO_ONLY
 }
 
-int	Max_used_objects = MAX_OBJECTS - 20;
+//--------------------------------------------------------------------
+//FNV-1a over the simulated state of the objects
+uint32_t object_state_checksum()
+{
+	uint32_t sum = 2166136261u;
+	int i;
+
+	auto add = [&sum](const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t j = 0; j < size; j++)
+			sum = (sum ^ bytes[j]) * 16777619u;
+	};
+
+	for (i = 0; i <= Highest_object_index; i++) {
+		object* objp = &Objects[i];
+
+		if (objp->type == OBJ_NONE)
+			continue;
+
+		add(&i, sizeof(i));
+		add(&objp->signature, sizeof(objp->signature));
+		add(&objp->type, sizeof(objp->type));
+		add(&objp->id, sizeof(objp->id));
+		add(&objp->flags, sizeof(objp->flags));
+		add(&objp->segnum, sizeof(objp->segnum));
+		add(&objp->pos, sizeof(objp->pos));
+		add(&objp->orient, sizeof(objp->orient));
+		add(&objp->size, sizeof(objp->size));
+		add(&objp->shields, sizeof(objp->shields));
+		add(&objp->lifeleft, sizeof(objp->lifeleft));
+		if (objp->movement_type == MT_PHYSICS) {
+			add(&objp->mtype.phys_info.velocity, sizeof(objp->mtype.phys_info.velocity));
+			add(&objp->mtype.phys_info.rotvel, sizeof(objp->mtype.phys_info.rotvel));
+		}
+	}
+
+	return sum;
+}
 
 //--------------------------------------------------------------------
 //move all objects for the current frame
 void object_move_all()
 {
-	int i;
+	int i, n;
 	object* objp;
+	short* move_list;
 
 	// -- mprintf((0, "Frame %i: %i/%i objects used.\n", FrameCount, num_objects, MAX_OBJECTS));
 
@@ -2058,21 +2242,38 @@ void object_move_all()
 
 	obj_delete_all_that_should_be_dead();
 
+	fvi_broadphase_new_frame();
+
 	if (Auto_leveling_on)
 		ConsoleObject->mtype.phys_info.flags |= PF_LEVELLING;
 	else
 		ConsoleObject->mtype.phys_info.flags &= ~PF_LEVELLING;
 
-	// Move all objects
-	objp = Objects;
-
 #ifndef DEMO_ONLY
-	for (i = 0; i <= Highest_object_index; i++) {
+	//	Move all objects in objnum order. Objects created as others move are moved this frame if
+	//	they get a higher objnum, so the order can't change without changing the game.
+	move_list = (short*)mem_frame_alloc(sizeof(short) * (Highest_object_index + 1));
+	n = 0;
+	for (i = obj_next_used(0); i <= Highest_object_index; i = obj_next_used(i + 1))
+		move_list[n++] = i;
+
+	//The sweeps of the weapons and debris are run ahead of time across threads, then everything
+	//moves in order as before, using the sweeps that are still right. See phys_compute_sweeps.
+	phys_compute_sweeps(move_list, n);
+
+	for (i = obj_next_used(0); i <= Highest_object_index; i = obj_next_used(i + 1)) {
+		objp = &Objects[i];
 		if ((objp->type != OBJ_NONE) && (!(objp->flags & OF_SHOULD_BE_DEAD))) {
 			object_move_one(objp);
+			fvi_broadphase_update(i);
 		}
-		objp++;
 	}
+
+	phys_end_sweeps();
+
+	if (Phys_sweep_check)
+		mprintf((0, "Tick %d: object checksum %08x, %d/%d sweeps used, %d mismatched\n", Tick_count, object_state_checksum(),
+			Phys_sweep_stats_last_frame.used, Phys_sweep_stats_last_frame.computed, Phys_sweep_stats_last_frame.mismatched));
 #else
 	i = 0;	//kill warning
 #endif
@@ -2144,15 +2345,25 @@ void reset_objects(int n_objs)
 	num_objects = n_objs;
 
 	Assert(num_objects > 0);
-
-	for (i = num_objects; i < MAX_OBJECTS; i++) {
-		free_obj_list[i] = i;
-		Objects[i].type = OBJ_NONE;
-		Objects[i].segnum = -1;
+	Assert(num_objects <= Max_objects);
+
+	for (i = 0; i < MAX_OBJECTS; i++) {
+		if (i < Max_objects)
+			obj_list_set(i, i);
+		if (i >= num_objects) {
+			Objects[i].type = OBJ_NONE;
+			Objects[i].segnum = -1;
+		}
 	}
 
 	Highest_object_index = num_objects - 1;
+	obj_used_rebuild();
+
+	reset_debris_count();
+}
 
+void reset_debris_count(void)
+{
 	Debris_object_count = 0;
 }
 
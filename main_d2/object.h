@@ -25,7 +25,8 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
  *		CONSTANTS
  */
 
-#define MAX_OBJECTS			350		//increased on 01/24/95 for multiplayer. --MK;  total number of objects in world
+#define MAX_OBJECTS_LEGACY	350		//increased on 01/24/95 for multiplayer. --MK;  savegames and the network protocol are built around this many
+#define MAX_OBJECTS			4000	//size of the object arrays. Max_objects says how many of them can be used
 
 //Object types
 #define OBJ_NONE		255	//unused object
@@ -291,6 +292,12 @@ extern uint8_t CollisionResult[MAX_OBJECT_TYPES][MAX_OBJECT_TYPES];
 extern object Objects[];
 extern int Highest_object_index;		//highest objnum
 
+extern int num_objects;					//number of objects in use
+extern short free_obj_list[];			//the first num_objects entries are the objects in use, in no particular order. The rest are free slots.
+
+extern int Max_objects;					//how many object slots can be in use right now
+extern int Max_objects_single;			//the limit for single player games, set with -maxobjects
+
 extern char *robot_names[];			//name of each robot
 
 extern int Num_robot_types;
@@ -312,6 +319,10 @@ extern int Player_fired_laser_this_frame;
 //do whatever setup needs to be done
 void init_objects();
 
+//sets how many object slots can be used, between MAX_OBJECTS_LEGACY and MAX_OBJECTS.
+//Only call this between levels, objects above a lowered limit are thrown away.
+void obj_set_max_objects(int max_objects);
+
 //returns segment number object is in.  Searches out from object's current
 //seg, so this shouldn't be called if the object has "jumped" to a new seg
 int obj_get_new_seg(object *obj);
@@ -345,6 +356,9 @@ void obj_delete(int objnum);
 //compressed
 void reset_objects(int n_objs);
 
+//forgets the debris count, for when a level replaces all the objects
+void reset_debris_count(void);
+
 //make object array non-sparse
 void compress_objects(void);
 
@@ -366,6 +380,9 @@ void object_toggle_lock_targets();
 //move all objects for the current frame
 void object_move_all();		// moves all objects
 
+//A hash of the simulated state of every object, for checking that two ways of moving them agree.
+uint32_t object_state_checksum();
+
 //set viewer object to next object in array
 void object_goto_next_viewer();
 
@@ -14,6 +14,8 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 //@@#include <malloc.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <vector>
 
 #include "platform/joy.h"
 #include "platform/mono.h"
@@ -31,11 +33,15 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "fvi.h"
 #include "newdemo.h"
 #include "platform/timer.h"
+#include "platform/jobs.h"
 #include "ai.h"
 #include "wall.h"
 #include "laser.h"
 #include "bm.h"
 #include "player.h"
+#include "gameseg.h"
+#include "gamesave.h"
+#include "platform/posixstub.h"
 
 #ifdef TACTILE
 #include "tactile.h"
@@ -328,6 +334,308 @@ void do_physics_sim_rot(object *obj)
 	check_and_fix_matrix(&obj->orient);
 }
 
+//	-----------------------------------------------------------------------------------------------------------
+//do thrust & drag
+static void do_physics_drag(physics_info *pi,fix sim_time)
+{
+	fix drag;
+
+	if ((drag = pi->drag) != 0) {
+
+		int count;
+		vms_vector accel;
+		fix r,k;
+
+		count = sim_time / FT;
+		r = sim_time % FT;
+		k = fixdiv(r,FT);
+
+		if (pi->flags & PF_USES_THRUST) {
+
+			vm_vec_copy_scale(&accel,&pi->thrust,fixdiv(f1_0,pi->mass));
+
+			while (count--) {
+
+				vm_vec_add2(&pi->velocity,&accel);
+
+				vm_vec_scale(&pi->velocity,f1_0-drag);
+			}
+
+			//do linear scale on remaining bit of time
+
+			vm_vec_scale_add2(&pi->velocity,&accel,k);
+
+			vm_vec_scale(&pi->velocity,f1_0-fixmul(k,drag));
+		}
+		else {
+			fix total_drag=f1_0;
+
+			while (count--)
+				total_drag = fixmul(total_drag,f1_0-drag);
+
+			//do linear scale on remaining bit of time
+
+			total_drag = fixmul(total_drag,f1_0-fixmul(k,drag));
+
+			vm_vec_scale(&pi->velocity,total_drag);
+		}
+	}
+}
+
+//	-----------------------------------------------------------------------------------------------------------
+//Parallel part of object_move_all.
+//Before any object moves, the first sweep do_physics_sim will make for each weapon and piece of debris is
+//worked out from the object as it is, and run ahead of time as jobs. Moving the objects stays serial
+//and in order. When do_physics_sim gets to the object, it only uses the precomputed answer if its sweep
+//turned out the same and nothing the answer depended on was changed by the objects that moved before it
+//(see fvi_speculate), so the results are the same as if every sweep was run in place.
+//Objects whose movement is changed before the sweep (homing weapons, bumps) just run their sweep as usual.
+
+int Phys_sweep_jobs = 1;
+int Phys_sweep_check = 0;
+phys_sweep_stats Phys_sweep_stats_last_frame;
+
+//don't bother with jobs for fewer objects than this
+#define PHYS_SWEEP_MIN_OBJECTS	16
+//sweeps per job
+#define PHYS_SWEEP_GRAIN		8
+
+typedef struct phys_sweep
+{
+	short objnum;
+	int valid;
+	fvi_speculative spec;
+} phys_sweep;
+
+static std::vector<phys_sweep> Phys_sweeps;
+static int Phys_sweep_num;
+static short Phys_sweep_index[MAX_OBJECTS];		//index+1 into Phys_sweeps for an object's sweep this frame, or 0
+static phys_sweep_stats Phys_sweep_stats;
+
+//Works out the first sweep do_physics_sim would make for the object if nothing changed it before then.
+//Returns 0 if it wouldn't make one.
+static int phys_predict_sweep(object *obj,vms_vector *new_pos,fvi_query *fq)
+{
+	physics_info pi = obj->mtype.phys_info;
+	vms_vector frame_vec;
+
+	if (!(pi.velocity.x || pi.velocity.y || pi.velocity.z || pi.thrust.x || pi.thrust.y || pi.thrust.z))
+		return 0;
+
+	do_physics_drag(&pi,FrameTime);
+
+	vm_vec_copy_scale(&frame_vec,&pi.velocity,FrameTime);
+	if ( (frame_vec.x==0) && (frame_vec.y==0) && (frame_vec.z==0) )
+		return 0;
+
+	vm_vec_add(new_pos,&obj->pos,&frame_vec);
+
+	fq->p0					= &obj->pos;
+	fq->startseg			= obj->segnum;
+	fq->p1					= new_pos;
+	fq->rad					= obj->size;
+	fq->thisobjnum			= obj-Objects;
+	fq->ignore_obj_list	= NULL;
+	fq->flags				= FQ_CHECK_OBJS;
+
+	if (obj->type == OBJ_WEAPON)
+		fq->flags |= FQ_TRANSPOINT;
+
+	return 1;
+}
+
+static void phys_run_sweep(phys_sweep *sweep)
+{
+	vms_vector new_pos;
+	fvi_query fq;
+
+	sweep->valid = phys_predict_sweep(&Objects[sweep->objnum],&new_pos,&fq) && fvi_speculate(&fq,&sweep->spec);
+}
+
+void phys_compute_sweeps(short *objlist,int n)
+{
+	int i;
+	int save_disable_new_fvi_stuff = disable_new_fvi_stuff;
+
+	Phys_sweep_stats_last_frame = Phys_sweep_stats;
+	memset(&Phys_sweep_stats, 0, sizeof(Phys_sweep_stats));
+	Phys_sweep_num = 0;
+
+	if (!Phys_sweep_jobs || job_num_threads() <= 1)
+		return;
+
+	for (i = 0; i < n; i++) {
+		object *obj = &Objects[objlist[i]];
+
+		if ((obj->type == OBJ_WEAPON || obj->type == OBJ_DEBRIS) && obj->movement_type == MT_PHYSICS && !(obj->flags & OF_SHOULD_BE_DEAD)) {
+			if (Phys_sweep_num == (int)Phys_sweeps.size())
+				Phys_sweeps.resize(Phys_sweep_num+1);
+			Phys_sweeps[Phys_sweep_num++].objnum = objlist[i];
+		}
+	}
+
+	if (Phys_sweep_num < PHYS_SWEEP_MIN_OBJECTS) {
+		Phys_sweep_num = 0;
+		return;
+	}
+
+	//the sweeps are only made for objects that aren't players
+	disable_new_fvi_stuff = 1;
+
+	job_parallel_for(0, Phys_sweep_num, PHYS_SWEEP_GRAIN, [](int start, int end)
+	{
+		for (int i = start; i < end; i++)
+			phys_run_sweep(&Phys_sweeps[i]);
+	});
+
+	disable_new_fvi_stuff = save_disable_new_fvi_stuff;
+
+	for (i = 0; i < Phys_sweep_num; i++) {
+		Phys_sweep_index[Phys_sweeps[i].objnum] = i+1;
+		if (Phys_sweeps[i].valid)
+			Phys_sweep_stats.computed++;
+	}
+}
+
+void phys_end_sweeps()
+{
+	for (int i = 0; i < Phys_sweep_num; i++)
+		Phys_sweep_index[Phys_sweeps[i].objnum] = 0;
+	Phys_sweep_num = 0;
+}
+
+//Returns the precomputed sweep for the object, once.
+static phys_sweep *phys_take_sweep(int objnum)
+{
+	int index = Phys_sweep_index[objnum];
+
+	if (!index)
+		return NULL;
+
+	Phys_sweep_index[objnum] = 0;
+	return Phys_sweeps[index-1].valid ? &Phys_sweeps[index-1] : NULL;
+}
+
+//	-----------------------------------------------------------------------------------------------------------
+//Checks the sweeps against running everything in place, with -moveverify <level>. The level is emptied
+//apart from the player, filled with bouncing debris, and has lasers fired through it every frame. It's run
+//twice from the same start, with the sweeps and without, and the objects must be the same after every frame.
+
+#define PHYS_VERIFY_FRAMES		600
+#define PHYS_VERIFY_DEBRIS		200
+#define PHYS_VERIFY_SHOTS		4		//lasers fired each frame
+
+static void phys_verify_random_start(vms_vector *pos,int *segnum,vms_vector *dir)
+{
+	*segnum = P_Rand() % Num_segments;
+	compute_segment_center(pos,&Segments[*segnum]);
+	make_random_vector(dir);
+}
+
+//Runs the level from its start, putting the object checksum after each frame in sums.
+//Returns nonzero if the level can't be loaded.
+static int phys_verify_run(char *filename,int sweeps,std::vector<uint32_t> &sums,int *used)
+{
+	int i, j, segnum, objnum;
+	vms_vector pos, dir;
+	object *obj;
+
+	if (load_level(filename))
+		return 1;
+
+	Phys_sweep_jobs = sweeps;
+	Phys_sweep_check = 0;		//falling back on a mismatch would hide it
+	Game_mode = GM_NORMAL;
+	GameTime = 0;
+	Tick_count = 0;
+	FrameTime = F1_0/30;
+	P_SRand(1);
+
+	ConsoleObject = Viewer = &Objects[0];
+	Players[Player_num].objnum = 0;
+	ConsoleObject->control_type = CT_NONE;
+	ConsoleObject->movement_type = MT_NONE;
+	for (i = 1; i <= Highest_object_index; i++)
+		if (Objects[i].type != OBJ_NONE)
+			obj_delete(i);
+
+	for (i = 0; i < PHYS_VERIFY_DEBRIS; i++) {
+		phys_verify_random_start(&pos,&segnum,&dir);
+		objnum = obj_create(OBJ_DEBRIS,0,segnum,&pos,&vmd_identity_matrix,F1_0 + P_Rand()*2,CT_DEBRIS,MT_PHYSICS,RT_NONE);
+		if (objnum < 0)
+			break;
+
+		obj = &Objects[objnum];
+		vm_vec_copy_scale(&obj->mtype.phys_info.velocity,&dir,i2f(10) + P_Rand()*100);
+		make_random_vector(&obj->mtype.phys_info.rotvel);
+		obj->mtype.phys_info.mass = F1_0;
+		obj->mtype.phys_info.drag = 0;
+		obj->mtype.phys_info.flags = PF_BOUNCE;
+		obj->lifeleft = IMMORTAL_TIME;
+	}
+
+	*used = 0;
+	sums.clear();
+	for (i = 0; i < PHYS_VERIFY_FRAMES; i++) {
+		for (j = 0; j < PHYS_VERIFY_SHOTS; j++) {
+			phys_verify_random_start(&pos,&segnum,&dir);
+			Laser_create_new(&dir,&pos,segnum,0,LASER_ID + P_Rand()%4,0);
+		}
+
+		object_move_all();
+		*used += Phys_sweep_stats_last_frame.used;		//the frame before
+
+		GameTime += FrameTime;
+		Tick_count++;
+		sums.push_back(object_state_checksum());
+	}
+
+	return 0;
+}
+
+int phys_sweep_verify(const char *levelname)
+{
+	char filename[128];
+	std::vector<uint32_t> with_sweeps, in_place;
+	int save_jobs = Phys_sweep_jobs, save_check = Phys_sweep_check;
+	int used, in_place_used, i, result;
+
+	if (job_num_threads() <= 1) {
+		printf("Checking the sweeps needs more than one job thread\n");
+		return 1;
+	}
+
+	//load_level looks for the name in upper case
+	strncpy(filename, levelname, sizeof(filename) - 1);
+	filename[sizeof(filename) - 1] = 0;
+	_strupr(filename);
+
+	result = phys_verify_run(filename,1,with_sweeps,&used) || phys_verify_run(filename,0,in_place,&in_place_used);
+
+	Phys_sweep_jobs = save_jobs;
+	Phys_sweep_check = save_check;
+
+	if (result) {
+		printf("Can't load %s\n", levelname);
+		return 1;
+	}
+
+	for (i = 0; i < PHYS_VERIFY_FRAMES; i++) {
+		if (with_sweeps[i] != in_place[i]) {
+			printf("Frame %d: object checksum %08x with the sweeps, %08x without\n", i, with_sweeps[i], in_place[i]);
+			return 1;
+		}
+	}
+
+	if (!used) {
+		printf("No sweeps were used, so nothing was checked\n");
+		return 1;
+	}
+
+	printf("%s: %d frames match with and without the sweeps, %d sweeps used\n", levelname, PHYS_VERIFY_FRAMES, used);
+	return 0;
+}
+
 //	-----------------------------------------------------------------------------------------------------------
 //Simulate a physics object for this frame
 void do_physics_sim(object *obj)
@@ -343,9 +651,9 @@ void do_physics_sim(object *obj)
 	int WallHitSeg, WallHitSide;
 	fvi_info hit_info;
 	fvi_query fq;
+	phys_sweep *sweep;
 	vms_vector save_pos;
 	int save_seg;
-	fix drag;
 	fix sim_time,old_sim_time;
 	vms_vector start_pos;
 	int obj_stopped=0;
@@ -418,47 +726,7 @@ if (Dont_move_ai_objects)
 //mprintf((0,"thrust=%x  speed=%x\n",vm_vec_mag(&obj->mtype.phys_info.thrust),vm_vec_mag(&obj->mtype.phys_info.velocity)));
 
 	//do thrust & drag
-	
-	if ((drag = obj->mtype.phys_info.drag) != 0) {
-
-		int count;
-		vms_vector accel;
-		fix r,k;
-
-		count = sim_time / FT;
-		r = sim_time % FT;
-		k = fixdiv(r,FT);
-
-		if (obj->mtype.phys_info.flags & PF_USES_THRUST) {
-
-			vm_vec_copy_scale(&accel,&obj->mtype.phys_info.thrust,fixdiv(f1_0,obj->mtype.phys_info.mass));
-
-			while (count--) {
-
-				vm_vec_add2(&obj->mtype.phys_info.velocity,&accel);
-
-				vm_vec_scale(&obj->mtype.phys_info.velocity,f1_0-drag);
-			}
-
-			//do linear scale on remaining bit of time
-
-			vm_vec_scale_add2(&obj->mtype.phys_info.velocity,&accel,k);
-
-			vm_vec_scale(&obj->mtype.phys_info.velocity,f1_0-fixmul(k,drag));
-		}
-		else {
-			fix total_drag=f1_0;
-
-			while (count--)
-				total_drag = fixmul(total_drag,f1_0-drag);
-
-			//do linear scale on remaining bit of time
-
-			total_drag = fixmul(total_drag,f1_0-fixmul(k,drag));
-
-			vm_vec_scale(&obj->mtype.phys_info.velocity,total_drag);
-		}
-	}
+	do_physics_drag(&obj->mtype.phys_info,sim_time);
 
 	#ifdef EXTRA_DEBUG
 	if (obj == debug_obj)
@@ -527,7 +795,21 @@ save_p0 = *fq.p0;
 save_p1 = *fq.p1;
 
 
-		fate = find_vector_intersection(&fq,&hit_info);
+		//With -movecheck a sweep that doesn't match running it in place is counted, and the answer
+		//from running it in place is used instead.
+		if ((sweep = phys_take_sweep(objnum)) != NULL && fvi_speculation_valid(&sweep->spec,&fq)) {
+			if (Phys_sweep_check && !fvi_check_speculation(&sweep->spec,&fq)) {
+				mprintf((0,"Warning: precomputed sweep for object %d doesn't match!\n",objnum));
+				Phys_sweep_stats.mismatched++;
+				fate = find_vector_intersection(&fq,&hit_info);
+			}
+			else {
+				fate = fvi_use_speculation(&sweep->spec,&hit_info);
+				Phys_sweep_stats.used++;
+			}
+		}
+		else
+			fate = find_vector_intersection(&fq,&hit_info);
 		//	Matt: Mike's hack.
 		if (fate == HIT_OBJECT) {
 			object	*objp = &Objects[hit_info.hit_object];
@@ -817,7 +1099,7 @@ save_p1 = *fq.p1;
 			}	
 			case HIT_NONE:		
 			#ifdef TACTILE
-				if (TactileStick && obj==ConsoleObject && !(FrameCount & 15))
+				if (TactileStick && obj==ConsoleObject && !(Tick_count & 15))
 				 Tactile_Xvibrate_clear ();
 			#endif
 				break;
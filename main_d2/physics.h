@@ -31,6 +31,30 @@ void read_flying_controls( object * obj );
 //Simulate a physics object for this frame
 void do_physics_sim(object *obj);
 
+//Runs the first sweep of each weapon and piece of debris in objlist ahead of time, on the job system.
+//do_physics_sim uses the answers where they're still right. Call before moving the objects, and
+//phys_end_sweeps once they've all moved.
+void phys_compute_sweeps(short *objlist,int n);
+void phys_end_sweeps();
+
+//Set to 0 to not precompute sweeps, with -nomovejobs.
+extern int Phys_sweep_jobs;
+//If set, every precomputed sweep is also run in place and checked against. Set with -movecheck.
+extern int Phys_sweep_check;
+
+typedef struct phys_sweep_stats
+{
+	int computed;		//sweeps run ahead of time
+	int used;			//sweeps do_physics_sim used
+	int mismatched;		//sweeps that didn't match running them in place, with Phys_sweep_check. They aren't used.
+} phys_sweep_stats;
+
+extern phys_sweep_stats Phys_sweep_stats_last_frame;
+
+//Runs the objects of a level for a while with the sweeps and without, and checks that they end up the
+//same after every frame. Prints the result. Returns nonzero if they don't match. Needs the job system.
+int phys_sweep_verify(const char *levelname);
+
 //tell us what the given object will do (as far as hiting walls) in
 //the given time (in seconds) t.  Igores acceleration (sorry) 
 //if check_objects is set, check with objects, else just with walls
@@ -51,6 +51,8 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "newmenu.h"
 #include "misc/byteswap.h"
 #include "platform/findfile.h"
+#include "platform/jobs.h"
+#include "platform/timeline.h"
 
 //#include "unarj.h" //[ISB] goddamnit
 
@@ -83,6 +85,8 @@ int Num_sound_files = 0;
 
 digi_sound GameSounds[MAX_SOUND_FILES];
 int SoundOffset[MAX_SOUND_FILES];
+static uint8_t SoundPagedOut[MAX_SOUND_FILES];	//sounds that have memory set aside but haven't been read yet
+static CFILE* Sound_fp = NULL;					//kept open to page sounds in from
 grs_bitmap GameBitmaps[MAX_BITMAP_FILES];
 
 alias alias_list[MAX_ALIASES];
@@ -417,7 +421,7 @@ void piggy_init_pigfile(const char* filename)
 #else
 	Piggy_bitmap_cache_size = PIGGY_BUFFER_SIZE;
 #endif
-	BitmapBits = (uint8_t*)mem_malloc(Piggy_bitmap_cache_size);
+	BitmapBits = (uint8_t*)mem_malloc_tag(Piggy_bitmap_cache_size, MEM_TAG_BITMAP);
 	if (BitmapBits == NULL)
 		Error("Not enough memory to load bitmaps\n");
 	Piggy_bitmap_cache_data = BitmapBits;
@@ -648,7 +652,7 @@ void piggy_new_pigfile(const char* pigname)
 				char bbmname[FILENAME_LEN];
 				int SuperX;
 
-				MALLOC(newbm, grs_bitmap, 1);
+				MALLOC_TAG(newbm, grs_bitmap, 1, MEM_TAG_BITMAP);
 
 				sprintf(bbmname, "%s.bbm", AllBitmaps[i].name);
 				iff_error = iff_read_bitmap(bbmname, newbm, BM_LINEAR, newpal);
@@ -876,7 +880,7 @@ int read_sndfile()
 		//mprintf(( 0, "%d bytes of sound\n", sbytes ));
 	}
 
-	SoundBits = (uint8_t*)mem_malloc(sbytes + 16);
+	SoundBits = (uint8_t*)mem_malloc_tag(sbytes + 16, MEM_TAG_SOUND);
 	if (SoundBits == NULL)
 		Error("Not enough memory to load sounds\n");
 
@@ -945,19 +949,37 @@ int piggy_init(void)
 	if ((i = FindArg("-piggy")))
 		Error("-piggy no longer supported");
 
-	WIN(DDGRLOCK(dd_grd_curcanv));
-	gr_set_curfont(SMALL_FONT);
-	gr_set_fontcolor(gr_find_closest_color_current(20, 20, 20), -1);
-	gr_printf(0x8000, grd_curcanv->cv_h - 20, "%s...", TXT_LOADING_DATA);
-	WIN(DDGRUNLOCK(dd_grd_curcanv));
+	if (grd_curcanv)	//no screen when baking lighting
+	{
+		WIN(DDGRLOCK(dd_grd_curcanv));
+		gr_set_curfont(SMALL_FONT);
+		gr_set_fontcolor(gr_find_closest_color_current(20, 20, 20), -1);
+		gr_printf(0x8000, grd_curcanv->cv_h - 20, "%s...", TXT_LOADING_DATA);
+		WIN(DDGRUNLOCK(dd_grd_curcanv));
+	}
 
 #ifdef EDITOR
 	piggy_init_pigfile(DEFAULT_PIGFILE);
 #endif
 
-	ham_ok = read_hamfile();
+	//The sound file's directory doesn't depend on the HAM, so read it on another thread meanwhile.
+	{
+		job_counter snd_done;
+		int phase;
+
+		job_run([&snd_ok]()
+			{
+				int phase = timeline_begin("Sound directory");
+				snd_ok = read_sndfile();
+				timeline_end(phase);
+			}, &snd_done);
 
-	snd_ok = read_sndfile();
+		phase = timeline_begin("HAM");
+		ham_ok = read_hamfile();
+		timeline_end(phase);
+
+		job_wait(&snd_done);
+	}
 
 	atexit(piggy_close);
 
@@ -980,6 +1002,8 @@ int piggy_is_needed(int soundnum)
 }
 
 
+//Doesn't actually read the sounds anymore. It sets aside memory for each needed sound and
+//keeps the sound file open, and piggy_sound_page_in reads each sound the first time it's played.
 void piggy_read_sounds(void)
 {
 	CFILE* fp = NULL;
@@ -1015,7 +1039,9 @@ void piggy_read_sounds(void)
 		strcpy(name, DEFAULT_SNDFILE);
 #endif
 
-	fp = cfopen(name, "rb");
+	if (Sound_fp)
+		cfclose(Sound_fp);
+	Sound_fp = fp = cfopen(name, "rb");
 
 	if (fp == NULL)
 		return;
@@ -1028,23 +1054,33 @@ void piggy_read_sounds(void)
 		{
 			if (piggy_is_needed(i))
 			{
-				cfseek(fp, SoundOffset[i], SEEK_SET);
-
-				// Read in the sound data!!!
 				snd->data = ptr;
 				ptr += snd->length;
 				sbytes += snd->length;
-				cfread(snd->data, snd->length, 1, fp);
+				SoundPagedOut[i] = 1;
 			}
 			else
 				snd->data = (uint8_t*)-1;
 		}
 	}
 
-	cfclose(fp);
+	mprintf((0, "\nSound memory set aside: %d KB\n", sbytes / 1024));
 
-	mprintf((0, "\nActual Sound usage: %d KB\n", sbytes / 1024));
+}
 
+void piggy_sound_page_in(int soundnum)
+{
+	digi_sound* snd;
+
+	if (soundnum < 0 || soundnum >= MAX_SOUND_FILES || !SoundPagedOut[soundnum])
+		return;
+
+	snd = &GameSounds[soundnum];
+	SoundPagedOut[soundnum] = 0;
+
+	cfseek(Sound_fp, SoundOffset[soundnum], SEEK_SET);
+	if (cfread(snd->data, snd->length, 1, Sound_fp) != 1)
+		memset(snd->data, 128, snd->length);		//silence rather than garbage
 }
 
 
@@ -1454,6 +1490,7 @@ void piggy_dump_all()
 		for (i = 0; i < Num_sound_files; i++) {
 			digi_sound* snd;
 
+			piggy_sound_page_in(i);
 			snd = &GameSounds[i];
 			strcpy(sndh.name, AllSounds[i].name);
 			sndh.length = GameSounds[i].length;
@@ -1494,6 +1531,12 @@ void piggy_close()
 {
 	piggy_close_file();
 
+	if (Sound_fp)
+	{
+		cfclose(Sound_fp);
+		Sound_fp = NULL;
+	}
+
 	if (BitmapBits)
 		mem_free(BitmapBits);
 
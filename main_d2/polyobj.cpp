@@ -173,7 +173,7 @@ polymodel* read_model_file(polymodel* pm, char* filename, robot_info* r)
 	int anim_flag = 0;
 	uint8_t* model_buf;
 
-	model_buf = (uint8_t*)mem_malloc(MODEL_BUF_SIZE * sizeof(uint8_t));
+	model_buf = (uint8_t*)mem_malloc_tag(MODEL_BUF_SIZE * sizeof(uint8_t), MEM_TAG_MODEL);
 	if (!model_buf)
 		Error("Can't allocate space to read model %s\n", filename);
 
@@ -347,7 +347,7 @@ polymodel* read_model_file(polymodel* pm, char* filename, robot_info* r)
 		case ID_IDTA:		//Interpreter data
 			//mprintf(0,"Got chunk IDTA, len=%d\n",len);
 
-			pm->model_data = (uint8_t*)mem_malloc(len);
+			pm->model_data = (uint8_t*)mem_malloc_tag(len, MEM_TAG_MODEL);
 			pm->model_data_size = len;
 
 			pof_cfread(pm->model_data, 1, len, model_buf);
@@ -394,7 +394,7 @@ int read_model_guns(char* filename, vms_vector* gun_points, vms_vector* gun_dirs
 	int n_guns = 0;
 	uint8_t* model_buf;
 
-	model_buf = (uint8_t*)mem_malloc(MODEL_BUF_SIZE * sizeof(uint8_t));
+	model_buf = (uint8_t*)mem_malloc_tag(MODEL_BUF_SIZE * sizeof(uint8_t), MEM_TAG_MODEL);
 	if (!model_buf)
 		Error("Can't allocate space to read model %s\n", filename);
 
@@ -34,6 +34,8 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "main_shared/texmerge.h"
 #include "physics.h"
 #include "3d/3d.h"
+#include "3d/globvars.h"
+#include "3d/objsort.h"
 #include "gameseg.h"
 #include "vclip.h"
 #include "lighting.h"
@@ -42,6 +44,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "automap.h"
 #include "endlevel.h"
 #include "platform/key.h"
+#include "platform/timer.h"
 #include "newmenu.h"
 #include "mem/mem.h"
 #include "main_shared/piggy.h"
@@ -61,7 +64,19 @@ int	Clear_window_color = -1;
 int	Clear_window = 2;			//	1 = Clear whole background window, 2 = clear view portals into rest of world, 0 = no clear
 
 int RL_framecount = -1;
-short Rotated_last[MAX_VERTICES];
+int Rotated_last[MAX_VERTICES];		//was short, which stopped matching RL_framecount past 32767
+
+//The view the points in Segment_points were last rotated for. Windows rendered from the same
+//view in the same frame reuse those rotations instead of redoing them.
+static int RL_view_frame = -1;
+static vms_vector RL_view_position;
+static vms_matrix RL_view_matrix;
+static fix RL_view_w2, RL_view_h2;
+
+render_list_stats Render_list_stats;
+render_list_stats Render_list_stats_last_frame;
+render_view_stats Render_view_stats[MAX_RENDERED_WINDOWS];
+render_view_stats Render_view_stats_last_frame[MAX_RENDERED_WINDOWS];
 
 // When any render function needs to know what's looking at it, it should 
 // access Viewer members.
@@ -757,6 +772,17 @@ int check_window_check = 0;
 //This must be called at the start of the frame if rotate_list() will be used
 void render_start_frame()
 {
+	//same frame, view and canvas size as the last window: its rotated and projected points still hold
+	if (RL_view_frame == FrameCount && RL_view_w2 == Canv_w2 && RL_view_h2 == Canv_h2 &&
+		!memcmp(&RL_view_position, &View_position, sizeof(View_position)) && !memcmp(&RL_view_matrix, &View_matrix, sizeof(View_matrix)))
+		return;
+
+	RL_view_frame = FrameCount;
+	RL_view_position = View_position;
+	RL_view_matrix = View_matrix;
+	RL_view_w2 = Canv_w2;
+	RL_view_h2 = Canv_h2;
+
 	RL_framecount++;
 
 	if (RL_framecount == 0) //wrap!
@@ -784,7 +810,10 @@ g3s_codes rotate_list(int nv, short* pointnumlist)
 		{
 			g3_rotate_point(pnt, &Vertices[pnum]);
 			Rotated_last[pnum] = RL_framecount;
+			Render_list_stats.rotated++;
 		}
+		else
+			Render_list_stats.reused++;
 
 		cc.high &= pnt->p3_codes;
 		cc.low |= pnt->p3_codes;
@@ -793,6 +822,14 @@ g3s_codes rotate_list(int nv, short* pointnumlist)
 	return cc;
 }
 
+void render_end_frame()
+{
+	Render_list_stats_last_frame = Render_list_stats;
+	memset(&Render_list_stats, 0, sizeof(Render_list_stats));
+	memcpy(Render_view_stats_last_frame, Render_view_stats, sizeof(Render_view_stats));
+	memset(Render_view_stats, 0, sizeof(Render_view_stats));
+}
+
 //Given a lit of point numbers, project any that haven't been projected
 void project_list(int nv, short* pointnumlist)
 {
@@ -899,19 +936,6 @@ typedef struct window
 	short left, top, right, bot;
 } window;
 
-uint8_t code_window_point(fix x, fix y, window* w)
-{
-	uint8_t code = 0;
-
-	if (x <= w->left)  code |= 1;
-	if (x >= w->right) code |= 2;
-
-	if (y <= w->top) code |= 4;
-	if (y >= w->bot) code |= 8;
-
-	return code;
-}
-
 #ifndef NDEBUG
 void draw_window_box(int color, short left, short top, short right, short bot)
 {
@@ -943,7 +967,10 @@ int matt_find_connect_side(int seg0, int seg1);
 char visited2[MAX_SEGMENTS];
 #endif
 
-char visited[MAX_SEGMENTS];
+//visited is stamped instead of cleared: a segment is in the current list when its entry is
+//Visited_gen, and has been drawn when it's Visited_gen + 1. render_pos is only valid for listed segments.
+uint32_t visited[MAX_SEGMENTS];
+uint32_t Visited_gen;
 short Render_list[MAX_RENDER_SEGS];
 short Seg_depth[MAX_RENDER_SEGS];		//depth for each seg in Render_list
 uint8_t processed[MAX_RENDER_SEGS];		//whether each entry has been processed
@@ -1139,10 +1166,12 @@ int sort_seg_children(segment* seg, int n_children, short* child_list)
 	int i, j;
 	int r;
 	int made_swaps, count;
+	int8_t order[MAX_SIDES_PER_SEGMENT][MAX_SIDES_PER_SEGMENT];	//compare_children results, 2 = not compared yet
 
 	if (n_children == 0) return 0;
 
 	ssc_total++;
+	memset(order, 2, sizeof(order));
 
 	//for each child,  compare with other children and see if order matters
 	//if order matters, fix if wrong
@@ -1157,7 +1186,9 @@ int sort_seg_children(segment* seg, int n_children, short* child_list)
 			for (j = i + 1; child_list[i] != -1 && j < n_children; j++)
 				if (child_list[j] != -1)
 				{
-					r = compare_children(seg, child_list[i], child_list[j]);
+					r = order[child_list[i]][child_list[j]];
+					if (r == 2)
+						r = order[child_list[i]][child_list[j]] = compare_children(seg, child_list[i], child_list[j]);
 
 					if (r == 1)
 					{
@@ -1239,45 +1270,15 @@ void add_obj_to_seglist(int objnum, int listnum)
 
 #define SORT_LIST_SIZE 100
 
-typedef struct sort_item
-{
-	int objnum;
-	fix dist;
-} sort_item;
-
 sort_item sort_list[SORT_LIST_SIZE];
 int n_sort_items;
 
-//compare function for object sort. 
-int sort_func(const void* ai, const void* bi)
+static void set_sort_item(sort_item* item, int objnum)
 {
-	sort_item* a = (sort_item*)ai; sort_item* b = (sort_item*)bi;
-	fix delta_dist;
-	object* obj_a, * obj_b;
-
-	delta_dist = a->dist - b->dist;
-
-	obj_a = &Objects[a->objnum];
-	obj_b = &Objects[b->objnum];
-
-	if (abs(delta_dist) < (obj_a->size + obj_b->size)) //same position
-	{
-		//these two objects are in the same position.  see if one is a fireball
-		//or laser or something that should plot on top.  Don't do this for
-		//the afterburner blobs, though.
-
-		if (obj_a->type == OBJ_WEAPON || (obj_a->type == OBJ_FIREBALL && obj_a->id != VCLIP_AFTERBURNER_BLOB))
-			if (!(obj_b->type == OBJ_WEAPON || obj_b->type == OBJ_FIREBALL))
-				return -1;	//a is weapon, b is not, so say a is closer
-			else;				//both are weapons 
-		else
-			if (obj_b->type == OBJ_WEAPON || (obj_b->type == OBJ_FIREBALL && obj_b->id != VCLIP_AFTERBURNER_BLOB))
-				return 1;	//b is weapon, a is not, so say a is farther
-
-		//no special case, fall through to normal return
-	}
+	object* obj = &Objects[objnum];
 
-	return delta_dist;	//return distance
+	sort_item_set(item, objnum, &obj->pos, &Viewer_eye, obj->size, obj->type == OBJ_WEAPON || obj->type == OBJ_FIREBALL,
+		obj->type == OBJ_WEAPON || (obj->type == OBJ_FIREBALL && obj->id != VCLIP_AFTERBURNER_BLOB));
 }
 
 void build_object_lists(int n_segs)
@@ -1383,12 +1384,7 @@ void build_object_lists(int n_segs)
 				}
 				else
 					if (n_sort_items < SORT_LIST_SIZE - 1) //add if room
-					{
-						sort_list[n_sort_items].objnum = t;
-						//NOTE: maybe use depth, not dist - quicker computation
-						sort_list[n_sort_items].dist = vm_vec_dist_quick(&Objects[t].pos, &Viewer_eye);
-						n_sort_items++;
-					}
+						set_sort_item(&sort_list[n_sort_items++], t);
 					else //no room for object
 					{
 						int ii;
@@ -1432,8 +1428,7 @@ void build_object_lists(int n_segs)
 
 								if (Objects[t].type != type || dist < sort_list[ii].dist)
 								{
-									sort_list[ii].objnum = t;
-									sort_list[ii].dist = dist;
+									set_sort_item(&sort_list[ii], t);
 									break;
 								}
 							}
@@ -1443,8 +1438,8 @@ void build_object_lists(int n_segs)
 					}
 
 
-			//now call qsort
-			qsort(sort_list, n_sort_items, sizeof(*sort_list), sort_func);
+			//now sort them
+			sort_objects(sort_list, n_sort_items);
 
 			//now copy back into list
 
@@ -1612,19 +1607,26 @@ int build_segment_list(int start_seg_num, int window_num)
 	int	l, c;
 	int	ch;
 
-	memset(visited, 0, sizeof(visited[0]) * (Highest_segment_index + 1));
-	memset(render_pos, -1, sizeof(render_pos[0]) * (Highest_segment_index + 1));
+	//new stamp instead of clearing visited and render_pos, and processed is cleared as entries are added
+	Visited_gen += 2;
+	if (Visited_gen < 2) //wrap!
+	{
+		memset(visited, 0, sizeof(visited));
+		Visited_gen = 2;
+	}
 	//memset(no_render_flag, 0, sizeof(no_render_flag[0])*(MAX_RENDER_SEGS));
-	memset(processed, 0, sizeof(processed));
 
 #ifndef NDEBUG
 	memset(visited2, 0, sizeof(visited2[0]) * (Highest_segment_index + 1));
 #endif
 
+	Render_list_stats.lists++;
+
 	lcnt = scnt = 0;
 
-	Render_list[lcnt] = start_seg_num; visited[start_seg_num] = 1;
+	Render_list[lcnt] = start_seg_num; visited[start_seg_num] = Visited_gen;
 	Seg_depth[lcnt] = 0;
+	processed[lcnt] = 0;
 	lcnt++;
 	ecnt = lcnt;
 	render_pos[start_seg_num] = 0;
@@ -1670,6 +1672,7 @@ int build_segment_list(int start_seg_num, int window_num)
 
 			seg = &Segments[segnum];
 			rotated = 0;
+			Render_list_stats.segments++;
 
 			//look at all sides of this segment.
 			//tricky code to look at sides in correct order follows
@@ -1682,22 +1685,27 @@ int build_segment_list(int start_seg_num, int window_num)
 
 				ch = seg->children[c];
 
-				if ((window_check || !visited[ch]) && (wid & WID_RENDPAST_FLAG))
+				if ((window_check || visited[ch] != Visited_gen) && (wid & WID_RENDPAST_FLAG))
 				{
 					if (behind_check)
 					{
 						int8_t* sv = Side_to_verts[c];
-						uint8_t codes_and = 0xff;
-						int i;
+						uint8_t codes_and;
 
-						rotate_list(8, seg->verts);
-						rotated = 1;
-
-						for (i = 0; i < 4; i++)
-							codes_and &= Segment_points[seg->verts[sv[i]]].p3_codes;
+						if (!rotated)
+						{
+							rotate_list(8, seg->verts);
+							rotated = 1;
+						}
 
-						if (codes_and & CC_BEHIND) continue;
+						codes_and = Segment_points[seg->verts[sv[0]]].p3_codes & Segment_points[seg->verts[sv[1]]].p3_codes &
+							Segment_points[seg->verts[sv[2]]].p3_codes & Segment_points[seg->verts[sv[3]]].p3_codes;
 
+						if (codes_and & CC_BEHIND)
+						{
+							Render_list_stats.behind++;
+							continue;
+						}
 					}
 					child_list[n_children++] = c;
 				}
@@ -1722,7 +1730,8 @@ int build_segment_list(int start_seg_num, int window_num)
 					if (window_check)
 					{
 						int i;
-						uint8_t codes_and_3d, codes_and_2d;
+						uint8_t codes_and_3d;
+						int8_t* sv = Side_to_verts[siden];
 						short _x, _y, min_x = 32767, max_x = -32767, min_y = 32767, max_y = -32767;
 						int no_proj_flag = 0;	//a point wasn't projected
 
@@ -1734,10 +1743,13 @@ int build_segment_list(int start_seg_num, int window_num)
 							rotated = 2;
 						}
 
-						for (i = 0, codes_and_3d = codes_and_2d = 0xff; i < 4; i++)
+						Render_list_stats.portals++;
+
+						//the window codes of the four points and together to the bounding box being
+						//outside the window, so just the box is kept and tested after
+						for (i = 0, codes_and_3d = 0xff; i < 4; i++)
 						{
-							int p = seg->verts[Side_to_verts[siden][i]];
-							g3s_point* pnt = &Segment_points[p];
+							g3s_point* pnt = &Segment_points[seg->verts[sv[i]]];
 
 							if (!(pnt->p3_flags & PF_PROJECTED)) { no_proj_flag = 1; break; }
 
@@ -1745,7 +1757,6 @@ int build_segment_list(int start_seg_num, int window_num)
 							_y = f2i(pnt->p3_sy);
 
 							codes_and_3d &= pnt->p3_codes;
-							codes_and_2d &= code_window_point(_x, _y, check_w);
 
 #ifndef NDEBUG
 							if (draw_edges)
@@ -1770,8 +1781,9 @@ int build_segment_list(int start_seg_num, int window_num)
 							draw_window_box(WHITE, min_x, min_y, max_x, max_y);
 #endif
 
-						if (no_proj_flag || (!codes_and_3d && !codes_and_2d)) {	//maybe add this segment
-							int rp = render_pos[ch];
+						if (no_proj_flag || (!codes_and_3d && max_x > check_w->left && min_x < check_w->right &&
+							max_y > check_w->top && min_y < check_w->bot)) {	//maybe add this segment
+							int rp = visited[ch] == Visited_gen ? render_pos[ch] : -1;
 							window* new_w = &render_windows[lcnt];
 
 							if (no_proj_flag)* new_w = *check_w;
@@ -1794,6 +1806,7 @@ int build_segment_list(int start_seg_num, int window_num)
 									new_w->right = std::max(new_w->right, render_windows[rp].right);
 									new_w->top = std::min(new_w->top, render_windows[rp].top);
 									new_w->bot = std::max(new_w->bot, render_windows[rp].bot);
+									Render_list_stats.regrown++;
 
 									if (no_migrate_segs)
 									{
@@ -1817,9 +1830,10 @@ int build_segment_list(int start_seg_num, int window_num)
 							render_pos[ch] = lcnt;
 							Render_list[lcnt] = ch;
 							Seg_depth[lcnt] = l;
+							processed[lcnt] = 0;
 							lcnt++;
 							if (lcnt >= MAX_RENDER_SEGS) { mprintf((0, "Too many segs in render list!!\n")); goto done_list; }
-							visited[ch] = 1;
+							visited[ch] = Visited_gen;
 
 #ifndef NDEBUG
 							if (pre_draw_segs)
@@ -1834,9 +1848,10 @@ int build_segment_list(int start_seg_num, int window_num)
 					{
 						Render_list[lcnt] = ch;
 						Seg_depth[lcnt] = l;
+						processed[lcnt] = 0;
 						lcnt++;
 						if (lcnt >= MAX_RENDER_SEGS) { mprintf((0, "Too many segs in render list!!\n")); goto done_list; }
-						visited[ch] = 1;
+						visited[ch] = Visited_gen;
 					}
 				}
 			}
@@ -1862,6 +1877,8 @@ void render_mine(int start_seg_num, fix eye_offset, int window_num)
 {
 	int		i;
 	int		nn;
+	uint64_t	start_us = I_GetUS();
+	render_view_stats* view_stats = &Render_view_stats[window_num];
 
 	//	Initialize number of objects (actually, robots!) rendered this frame.
 	Window_rendered_data[window_num].num_objects = 0;
@@ -1973,7 +1990,7 @@ void render_mine(int start_seg_num, fix eye_offset, int window_num)
 		Current_seg_depth = Seg_depth[nn];
 
 		//if (!no_render_flag[nn])
-		if (segnum != -1 && (_search_mode || visited[segnum] != 255))
+		if (segnum != -1 && (_search_mode || visited[segnum] != Visited_gen + 1))
 		{
 			//set global render window vars
 
@@ -1987,7 +2004,7 @@ void render_mine(int start_seg_num, fix eye_offset, int window_num)
 			//mprintf((0," %d",segnum));
 
 			render_segment(segnum, window_num);
-			visited[segnum] = 255;
+			visited[segnum] = Visited_gen + 1;
 
 			if (window_check) //reset for objects
 			{
@@ -2014,6 +2031,7 @@ void render_mine(int start_seg_num, fix eye_offset, int window_num)
 
 					if (ObjNumber >= 0)
 					{
+						view_stats->objects++;
 						//mprintf( (0, "Type: %d\n", Objects[ObjNumber].type ));
 
 						//if (Objects[ObjNumber].type == OBJ_FIREBALL && n_expl_objs<5)	{
@@ -2077,6 +2095,9 @@ done_rendering:
 
 #endif
 
+	view_stats->views++;
+	view_stats->segments += N_render_segs;
+	view_stats->us += (int)(I_GetUS() - start_us);
 }
 #ifdef EDITOR
 
@@ -53,7 +53,9 @@ extern fix Render_zoom;		//the player's zoom factor
 
 //This is used internally to render_frame(), but is included here so AI
 //can use it for its own purposes.
-extern char visited[MAX_SEGMENTS];
+//Segment n is in Render_list when visited[n] == Visited_gen.
+extern uint32_t visited[MAX_SEGMENTS];
+extern uint32_t Visited_gen;
 
 extern int N_render_segs;
 extern short Render_list[MAX_RENDER_SEGS];
@@ -81,6 +83,35 @@ g3s_codes rotate_list(int nv,short *pointnumlist);
 //Given a lit of point numbers, project any that haven't been projected
 void project_list(int nv,short *pointnumlist);
 
+//Render list building, summed over the windows rendered in a frame
+typedef struct render_list_stats
+{
+	int lists;			//times build_segment_list ran
+	int segments;		//segments whose sides were looked at
+	int behind;			//sides dropped for being behind the viewer
+	int portals;		//sides clipped against their segment's window
+	int regrown;		//already listed segments whose window grew
+	int rotated;		//points rotated by rotate_list
+	int reused;			//points rotate_list found already rotated for this view
+} render_list_stats;
+
+extern render_list_stats Render_list_stats_last_frame;
+
+//What each window cost to render. Work that doesn't depend on the view, like the dynamic light
+//of a vertex or an object's light ramp, is done by the first window that needs it in a frame.
+typedef struct render_view_stats
+{
+	int views;			//times rendered, 2 for stereo
+	int us;				//microseconds spent in render_mine
+	int segments;		//render list entries
+	int objects;		//objects drawn
+} render_view_stats;
+
+extern render_view_stats Render_view_stats_last_frame[MAX_RENDERED_WINDOWS];
+
+//Call once a frame to move the counters into Render_list_stats_last_frame and Render_view_stats_last_frame.
+void render_end_frame();
+
 extern void render_mine(int start_seg_num,fix eye_offset, int window_num);
 
 extern void update_rendered_data(int window_num, object *viewer, int rear_view_flag, int user);
@@ -21,6 +21,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include <math.h>
 #include <string.h>
 #include <errno.h>
+#include <thread>
 
 //#include "pa_enabl.h"                   //$$POLY_ACC
 #include "platform/platform_filesys.h"
@@ -31,6 +32,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "textures.h"
 #include "wall.h"
 #include "object.h"
+#include "fvi.h"
 #include "main_shared/digi.h"
 #include "gamemine.h"
 #include "misc/error.h"
@@ -68,12 +70,13 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "controls.h"
 #include "laser.h"
 #include "multibot.h"
+#include "state.h"
 
 #if defined(POLY_ACC)
 #include "poly_acc.h"
 #endif
 
-#define STATE_VERSION 22
+#define STATE_VERSION 23
 #define STATE_COMPATIBLE_VERSION 20
 // 0 - Put DGSS (Descent Game State Save) id at tof.
 // 1 - Added Difficulty level save
@@ -95,6 +98,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 // 19- Saved cheats_enabled flag
 // 20- First_secret_visit
 // 22- Omega_charge
+// 23- More than MAX_OBJECTS_LEGACY objects, with the AI info of each one
 
 #define NUM_SAVES 9
 #define THUMBNAIL_W 100
@@ -217,6 +221,8 @@ int state_get_save_file(char* fname, char* dsc, int multi)
 	char id[5];
 	int valid = 0;
 
+	state_wait_for_write();
+
 	for (i = 0; i < NUM_SAVES; i++)
 	{
 		sc_bmp[i] = NULL;
@@ -301,6 +307,8 @@ int state_get_restore_file(char* fname, int multi)
 	char id[5];
 	int valid;
 
+	state_wait_for_write();
+
 	nsaves = 0;
 	m[0].type = NM_TYPE_TEXT; m[0].text = const_cast<char*>("\n\n\n\n");
 	for (i = 0; i < NUM_SAVES + 1; i++)
@@ -499,6 +507,9 @@ int state_save_all(int between_levels, int secret_save, char* filename_override)
 	}
 #endif
 
+	//The save about to be renamed to the backup slot might still be in flight.
+	state_wait_for_write();
+
 	if ((Current_level_num < 0) && (secret_save == 0))
 	{
 		HUD_init_message("Can't save in secret level!");
@@ -682,10 +693,16 @@ int state_save_all(int between_levels, int secret_save, char* filename_override)
 
 extern	fix	Flash_effect, Time_flash_last_played;
 
-int state_save_all_sub(char* filename, char* desc, int between_levels)
+static int state_read_game(FILE* fp, const char* filename, int multi, int secret_restore);
+
+//Snapshot used by state_save_all_sub, kept around so its buffer is reused between saves.
+static state_snapshot State_write_snapshot;
+
+//Writes the full savegame to fp in the on-disk format. If thumbnail is 0 the screen shot
+//isn't rendered and a blank one is written instead, which keeps quick snapshots cheap.
+static int state_write_game(FILE* fp, char* desc, int between_levels, int thumbnail)
 {
 	int i, j;
-	FILE* fp;
 	grs_canvas* cnv;
 #ifdef POLY_ACC
 	grs_canvas cnv2, * save_cnv2;
@@ -696,29 +713,6 @@ int state_save_all_sub(char* filename, char* desc, int between_levels)
 	char* separator_pos;
 #endif
 
-	Assert(between_levels == 0);	//between levels save ripped out
-
-/*	if ( Game_mode & GM_MULTI )	{
-		{
-		start_time();
-		return 0;
-		}
-	}*/
-
-#if defined(MACINTOSH) && !defined(NDEBUG) 
-	if (strncmp(filename, ":Players:", 9))
-		Int3();
-#endif
-
-	fp = fopen(filename, "wb");
-	if (!fp)
-	{
-		if (!(Game_mode & GM_MULTI))
-			nm_messagebox(NULL, 1, TXT_OK, "Error writing savegame.\nPossibly out of disk\nspace.");
-		start_time();
-		return 0;
-	}
-
 	//Save id
 	fwrite(dgss_id, sizeof(char) * 4, 1, fp);
 
@@ -732,7 +726,7 @@ int state_save_all_sub(char* filename, char* desc, int between_levels)
 
 	// Save the current screen shot...
 
-	cnv = gr_create_canvas(THUMBNAIL_W, THUMBNAIL_H);
+	cnv = thumbnail ? gr_create_canvas(THUMBNAIL_W, THUMBNAIL_H) : NULL;
 	if (cnv)
 	{
 #ifdef WINDOWS
@@ -820,9 +814,10 @@ int state_save_all_sub(char* filename, char* desc, int between_levels)
 	}
 	else
 	{
-		uint8_t color = 0;
-		for (i = 0; i < THUMBNAIL_W * THUMBNAIL_H; i++)
-			fwrite(&color, sizeof(uint8_t), 1, fp);
+		uint8_t blank[THUMBNAIL_W * THUMBNAIL_H];
+		memset(blank, 0, sizeof(blank));
+		fwrite(blank, sizeof(blank), 1, fp);
+		fwrite(gr_palette, 3, 256, fp);
 	}
 
 	// Save the Between levels flag...
@@ -1037,7 +1032,7 @@ int state_save_all_sub(char* filename, char* desc, int between_levels)
 		fwrite(&Dead_controlcen_object_num, sizeof(int), 1, fp);*/
 
 		// Save the AI state
-		ai_save_state(fp);
+		ai_save_state(fp, Highest_object_index + 1);
 
 		// Save the automap visited info
 		fwrite(Automap_visited, sizeof(uint8_t) * MAX_SEGMENTS, 1, fp);
@@ -1090,24 +1085,41 @@ int state_save_all_sub(char* filename, char* desc, int between_levels)
 
 	//fwrite(&Omega_charge, sizeof(Omega_charge), 1, fp);
 
-	if (ferror(fp))
-	{
-		if (!(Game_mode & GM_MULTI))
+	return !ferror(fp);
+}
+
+int state_save_all_sub(char* filename, char* desc, int between_levels)
+{
+	Assert(between_levels == 0);	//between levels save ripped out
+
+/*	if ( Game_mode & GM_MULTI )	{
 		{
-			nm_messagebox(NULL, 1, TXT_OK, "Error writing savegame.\nPossibly out of disk\nspace.");
-			fclose(fp);
-			_unlink(filename);
+		start_time();
+		return 0;
 		}
-	}
-	else
+	}*/
+
+#if defined(MACINTOSH) && !defined(NDEBUG) 
+	if (strncmp(filename, ":Players:", 9))
+		Int3();
+#endif
+
+	//Don't start capturing until the last save has landed, since the snapshot buffer is reused.
+	state_wait_for_write();
+
+	if (!state_snapshot_capture(&State_write_snapshot, desc, between_levels, 1) || !state_snapshot_write(&State_write_snapshot, filename))
 	{
-		fclose(fp);
+		if (!(Game_mode & GM_MULTI))
+			nm_messagebox(NULL, 1, TXT_OK, "Error writing savegame.\nPossibly out of disk\nspace.");
+		start_time();
+		return 0;
 	}
 
 	start_time();
 
 	return 1;
 }
+
 void reset_player_object();
 
 //	-----------------------------------------------------------------------------------
@@ -1124,6 +1136,27 @@ void set_pos_from_return_segment(void)
 
 int state_restore_all_sub(char* filename, int multi, int secret_restore);
 
+//	-----------------------------------------------------------------------------------
+//	Checks shared by restoring a savegame and a quicksave. Stops recording a demo and waits for
+//	any save being written. Returns 0 if a game can't be restored now.
+static int state_restore_allowed(int in_game, int secret_restore)
+{
+	if (in_game && (Current_level_num < 0) && (secret_restore == 0))
+	{
+		HUD_init_message("Can't restore in secret level!");
+		return 0;
+	}
+
+	if (Newdemo_state == ND_STATE_RECORDING)
+		newdemo_stop_recording();
+
+	if (Newdemo_state != ND_STATE_NORMAL)
+		return 0;
+
+	state_wait_for_write();
+	return 1;
+}
+
 //	-----------------------------------------------------------------------------------
 int state_restore_all(int in_game, int secret_restore, char* filename_override)
 {
@@ -1146,16 +1179,7 @@ int state_restore_all(int in_game, int secret_restore, char* filename_override)
 		return 0;
 	}
 
-	if (in_game && (Current_level_num < 0) && (secret_restore == 0))
-	{
-		HUD_init_message("Can't restore in secret level!");
-		return 0;
-	}
-
-	if (Newdemo_state == ND_STATE_RECORDING)
-		newdemo_stop_recording();
-
-	if (Newdemo_state != ND_STATE_NORMAL)
+	if (!state_restore_allowed(in_game, secret_restore))
 		return 0;
 
 	stop_time();
@@ -1276,12 +1300,13 @@ extern void copy_defaults_to_robot(object* objp);
 
 void compute_all_static_light(void);
 
-int state_restore_all_sub(char* filename, int multi, int secret_restore)
+//Reads a savegame in the on-disk format from fp. The caller owns fp and closes it.
+static int state_read_game(FILE* fp, const char* filename, int multi, int secret_restore)
 {
 	int ObjectStartLocation;
 	int version, i, j, segnum, found;
+	int num_saved_objects = 0;
 	object* obj;
-	FILE* fp;
 	int current_level, next_level;
 	int between_levels;
 	char mission[16];
@@ -1292,14 +1317,10 @@ int state_restore_all_sub(char* filename, int multi, int secret_restore)
 	player restore_players[MAX_PLAYERS];
 	fix	old_gametime = GameTime;
 
-	fp = fopen(filename, "rb");
-	if (!fp) return 0;
-
 	//Read id
 	fread(id, sizeof(char) * 4, 1, fp);
 	if (memcmp(id, dgss_id, 4))
 	{
-		fclose(fp);
 		return 0;
 	}
 
@@ -1308,7 +1329,6 @@ int state_restore_all_sub(char* filename, int multi, int secret_restore)
 	version = file_read_int(fp);
 	if (version < STATE_COMPATIBLE_VERSION)
 	{
-		fclose(fp);
 		return 0;
 	}
 
@@ -1334,7 +1354,6 @@ int state_restore_all_sub(char* filename, int multi, int secret_restore)
 	if (!load_mission_by_name(mission))
 	{
 		nm_messagebox(NULL, 1, "Ok", "Error!\nUnable to load mission\n'%s'\n", mission);
-		fclose(fp);
 		return 0;
 	}
 
@@ -1489,12 +1508,22 @@ int state_restore_all_sub(char* filename, int multi, int secret_restore)
 		//Clear out all the objects from the lvl file
 		for (segnum = 0; segnum <= Highest_segment_index; segnum++)
 			Segments[segnum].objects = -1;
+		fvi_broadphase_reset();
 		reset_objects(1);
 
 		//Read objects, and pop 'em into their respective segments.
 		//fread(&i, sizeof(int), 1, fp);
-		i = file_read_int(fp);
-		Highest_object_index = i - 1;
+		num_saved_objects = file_read_int(fp);
+		if (num_saved_objects > ((version >= 23) ? MAX_OBJECTS : MAX_OBJECTS_LEGACY))
+		{
+			Error("state_restore_all_sub: Too many objects in save file.\n");
+			return 0;
+		}
+		//saved with a higher object limit, so raise ours to match
+		if (num_saved_objects > Max_objects)
+			obj_set_max_objects(num_saved_objects);
+
+		Highest_object_index = num_saved_objects - 1;
 		//fread(Objects, sizeof(object) * i, 1, fp);
 		for (i = 0; i <= Highest_object_index; i++)
 		{
@@ -1502,11 +1531,6 @@ int state_restore_all_sub(char* filename, int multi, int secret_restore)
 		}
 
 		Object_next_signature = 0;
-		if (Highest_object_index >= MAX_OBJECTS)
-		{
-			Error("state_restore_all_sub: Too many objects in save file.\n");
-			return 0;
-		}
 		for (i = 0; i <= Highest_object_index; i++)
 		{
 			obj = &Objects[i];
@@ -1680,7 +1704,7 @@ int state_restore_all_sub(char* filename, int multi, int secret_restore)
 		//fread(&Dead_controlcen_object_num, sizeof(int), 1, fp);
 
 		// Restore the AI state
-		ai_restore_state(fp, version);
+		ai_restore_state(fp, version, num_saved_objects);
 
 		// Restore the automap visited info
 		fread(Automap_visited, sizeof(uint8_t) * MAX_SEGMENTS, 1, fp);
@@ -1795,8 +1819,6 @@ int state_restore_all_sub(char* filename, int multi, int secret_restore)
 			fread(&dummy_fix, sizeof(fix), 1, fp);
 		}
 
-	fclose(fp);
-
 #ifdef NETWORK
 	if (Game_mode & GM_MULTI)   // Get rid of ships that aren't 
 	{									 // connected in the restored game
@@ -1820,6 +1842,291 @@ int state_restore_all_sub(char* filename, int multi, int secret_restore)
 	return 1;
 }
 
+int state_restore_all_sub(char* filename, int multi, int secret_restore)
+{
+	state_snapshot snap;
+
+	//Make sure a save still in flight is on disk before reading it back.
+	state_wait_for_write();
+
+	if (!state_snapshot_read(&snap, filename))
+		return 0;
+
+	return state_snapshot_restore(&snap, multi, secret_restore);
+}
+
+//-------------------------------------------------------------------
+//Savegame snapshots.
+//The savegame serializers all work on FILE*, so snapshots are built by pointing them at a
+//memory stream. Windows has no open_memstream/fmemopen, so a temp file stands in there.
+
+static FILE* state_mem_open_write(char** bufp, size_t* sizep)
+{
+#ifdef _WIN32
+	return tmpfile();
+#else
+	return open_memstream(bufp, sizep);
+#endif
+}
+
+static int state_mem_close_write(FILE* fp, char* buf, size_t size, std::vector<uint8_t>& out)
+{
+	int ok = !ferror(fp);
+#ifdef _WIN32
+	long len;
+	fflush(fp);
+	len = ftell(fp);
+	out.resize(len > 0 ? len : 0);
+	rewind(fp);
+	if (len > 0 && fread(out.data(), 1, len, fp) != (size_t)len)
+		ok = 0;
+	fclose(fp);
+#else
+	fclose(fp); //buf and size are only valid after the stream is closed
+	out.assign((uint8_t*)buf, (uint8_t*)buf + size);
+	free(buf);
+#endif
+	return ok;
+}
+
+static FILE* state_mem_open_read(std::vector<uint8_t>& data)
+{
+	if (data.empty())
+		return NULL;
+#ifdef _WIN32
+	FILE* fp = tmpfile();
+	if (fp)
+	{
+		fwrite(data.data(), 1, data.size(), fp);
+		rewind(fp);
+	}
+	return fp;
+#else
+	return fmemopen(data.data(), data.size(), "rb");
+#endif
+}
+
+int state_snapshot_capture(state_snapshot* snap, char* desc, int between_levels, int thumbnail)
+{
+	char* buf = NULL;
+	size_t size = 0;
+	int ok;
+	FILE* fp;
+
+	fp = state_mem_open_write(&buf, &size);
+	if (!fp)
+		return 0;
+
+	ok = state_write_game(fp, desc, between_levels, thumbnail);
+	ok &= state_mem_close_write(fp, buf, size, snap->data);
+
+	snap->level_num = Current_level_num;
+	snap->game_time = GameTime;
+
+	return ok;
+}
+
+int state_snapshot_read(state_snapshot* snap, const char* filename)
+{
+	FILE* fp;
+	long len;
+
+	fp = fopen(filename, "rb");
+	if (!fp) return 0;
+
+	fseek(fp, 0, SEEK_END);
+	len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	if (len <= 0)
+	{
+		fclose(fp);
+		return 0;
+	}
+
+	snap->data.resize(len);
+	if (fread(snap->data.data(), 1, len, fp) != (size_t)len)
+	{
+		fclose(fp);
+		snap->data.clear();
+		return 0;
+	}
+	fclose(fp);
+
+	snap->level_num = 0;
+	snap->game_time = 0;
+
+	return 1;
+}
+
+static std::thread State_write_thread;
+static volatile int State_write_failed = 0;
+static char State_write_filename[CHOCOLATE_MAX_FILE_PATH_SIZE];
+static char State_write_temp_filename[CHOCOLATE_MAX_FILE_PATH_SIZE + 4];
+
+static void state_write_thread_main(FILE* fp, const uint8_t* data, size_t size)
+{
+	int ok;
+
+	ok = fwrite(data, 1, size, fp) == size;
+	ok &= fflush(fp) == 0;
+	ok &= fclose(fp) == 0;
+
+	if (ok)
+		ok = replace_file(State_write_temp_filename, State_write_filename) == 0;
+
+	if (!ok)
+	{
+		_unlink(State_write_temp_filename);
+		State_write_failed = 1;
+	}
+}
+
+int state_snapshot_write(state_snapshot* snap, const char* filename)
+{
+	FILE* fp;
+
+	state_wait_for_write();
+
+	strncpy(State_write_filename, filename, CHOCOLATE_MAX_FILE_PATH_SIZE - 1);
+	State_write_filename[CHOCOLATE_MAX_FILE_PATH_SIZE - 1] = '\0';
+	snprintf(State_write_temp_filename, sizeof(State_write_temp_filename), "%s.tmp", State_write_filename);
+
+	//Open on this thread, so the usual failures (bad path, read only dir) are reported right away.
+	fp = fopen(State_write_temp_filename, "wb");
+	if (!fp)
+		return 0;
+
+	State_write_failed = 0;
+	State_write_thread = std::thread(state_write_thread_main, fp, snap->data.data(), snap->data.size());
+	return 1;
+}
+
+void state_wait_for_write()
+{
+	if (State_write_thread.joinable())
+		State_write_thread.join();
+
+	if (State_write_failed)
+	{
+		State_write_failed = 0;
+		mprintf((1, "Background write of savegame %s failed.\n", State_write_filename));
+		if (Function_mode == FMODE_GAME && !(Game_mode & GM_MULTI))
+			HUD_init_message("Error writing savegame!");
+	}
+}
+
+int state_snapshot_restore(state_snapshot* snap, int multi, int secret_restore)
+{
+	FILE* fp;
+	int rval;
+
+	fp = state_mem_open_read(snap->data);
+	if (!fp) return 0;
+
+	rval = state_read_game(fp, "[snapshot]", multi, secret_restore);
+	fclose(fp);
+
+	return rval;
+}
+
+//Ring of quick snapshots, Quick_snapshot_head is the newest.
+static state_snapshot Quick_snapshots[MAX_QUICK_SNAPSHOTS];
+static int Num_quick_snapshots = 0;
+static int Quick_snapshot_head = -1;
+static int Quick_snapshot_limit = -1;
+
+static int state_get_quick_snapshot_limit()
+{
+	int t;
+
+	if (Quick_snapshot_limit == -1)
+	{
+		Quick_snapshot_limit = 4;
+		if ((t = FindArg("-quicksnaps")) && t + 1 < Num_args)
+			Quick_snapshot_limit = atoi(Args[t + 1]);
+		if (Quick_snapshot_limit < 1)
+			Quick_snapshot_limit = 1;
+		else if (Quick_snapshot_limit > MAX_QUICK_SNAPSHOTS)
+			Quick_snapshot_limit = MAX_QUICK_SNAPSHOTS;
+	}
+	return Quick_snapshot_limit;
+}
+
+void state_quicksave()
+{
+	char desc[DESC_LENGTH + 1];
+	int limit = state_get_quick_snapshot_limit();
+	int slot;
+
+	if (Game_mode & GM_MULTI)
+		return;
+
+	if (Current_level_num < 0)
+	{
+		HUD_init_message("Can't save in secret level!");
+		return;
+	}
+
+	if (Final_boss_is_dead)
+		return;
+
+	memset(desc, 0, sizeof(desc));
+	snprintf(desc, sizeof(desc), "[quicksave]");
+
+	slot = (Quick_snapshot_head + 1) % limit;
+	if (!state_snapshot_capture(&Quick_snapshots[slot], desc, 0, 0))
+	{
+		Quick_snapshots[slot].data.clear();
+		HUD_init_message("Quicksave failed!");
+		return;
+	}
+
+	Quick_snapshot_head = slot;
+	if (Num_quick_snapshots < limit)
+		Num_quick_snapshots++;
+
+	HUD_init_message("Quicksave %d taken", Num_quick_snapshots);
+}
+
+int state_quickload(int age)
+{
+	int limit = state_get_quick_snapshot_limit();
+	int slot, rval;
+
+	if (Game_mode & GM_MULTI)
+		return 0;
+
+	if (age < 0 || age >= Num_quick_snapshots)
+	{
+		HUD_init_message("No quicksave to restore!");
+		return 0;
+	}
+
+	if (!state_restore_allowed(1, 0))
+		return 0;
+
+	stop_time();
+	slot = (Quick_snapshot_head - age + limit) % limit;
+	rval = state_snapshot_restore(&Quick_snapshots[slot], 0, 0);
+	start_time();
+
+	return rval;
+}
+
+void state_free_quick_snapshots()
+{
+	int i;
+
+	for (i = 0; i < MAX_QUICK_SNAPSHOTS; i++)
+	{
+		Quick_snapshots[i].data.clear();
+		Quick_snapshots[i].data.shrink_to_fit();
+	}
+	Num_quick_snapshots = 0;
+	Quick_snapshot_head = -1;
+}
+
 //	When loading a saved game, segp->static_light is bogus.
 //	This is because apply_all_changed_light, which is supposed to properly update this value,
 //	cannot do so because it needs the original light cast from a light which is no longer there.
@@ -1863,6 +2170,8 @@ int state_get_game_id(char* filename)
 
 	mprintf((0, "Restoring multigame from [%s]\n", filename));
 
+	state_wait_for_write();
+
 	fp = fopen(filename, "rb");
 	if (!fp) return 0;
 
@@ -13,6 +13,10 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 
 #pragma once
 
+#include <vector>
+#include "misc/types.h"
+#include "fix/fix.h"
+
 int state_save_all(int between_levels, int secret_save, char *filename_override);
 int state_restore_all(int in_game, int secret_restore, char *filename_override);
 
@@ -24,3 +28,32 @@ extern uint32_t state_game_id;
 int state_get_save_file(char * fname, char * dsc, int multi );
 int state_get_restore_file(char * fname, int multi );
 
+//Savegame snapshots. A snapshot is a complete savegame serialized into memory in the
+//same format as the .sgX files, so it can be written to disk off the game thread or kept
+//in RAM for instant quickloads.
+typedef struct state_snapshot
+{
+	std::vector<uint8_t> data;
+	int level_num;
+	fix game_time;
+} state_snapshot;
+
+//Serializes the current game into snap. Returns 1 on success.
+int state_snapshot_capture(state_snapshot* snap, char* desc, int between_levels, int thumbnail);
+//Loads a savegame file into snap with a single read. Returns 1 on success.
+int state_snapshot_read(state_snapshot* snap, const char* filename);
+//Writes snap to filename on a background thread. The data is written to a temp file first and
+//then renamed over filename, so a crash never leaves a half written save. snap must stay
+//untouched until state_wait_for_write returns. Returns 0 if the temp file can't be created.
+int state_snapshot_write(state_snapshot* snap, const char* filename);
+//Restores the game from snap, same as state_restore_all_sub.
+int state_snapshot_restore(state_snapshot* snap, int multi, int secret_restore);
+//Blocks until any background savegame write has finished.
+void state_wait_for_write();
+
+//Quick snapshots kept in RAM, newest first. The count is set with -quicksnaps <n>.
+#define MAX_QUICK_SNAPSHOTS 16
+void state_quicksave();
+//age 0 restores the newest snapshot, 1 the one before that, etc.
+int state_quickload(int age);
+void state_free_quick_snapshots();
@@ -14,6 +14,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 
 #include "3d/3d.h"
 #include "misc/error.h"
@@ -28,6 +29,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "object.h"
 #include "endlevel.h"
 #include "fireball.h"
+#include "terrain.h"
 
 #define GRID_MAX_SIZE	64
 #define GRID_SCALE	i2f(2*20)
@@ -49,8 +51,6 @@ uint8_t *light_array;
 
 #define LIGHTVAL(_i,_j) (((fix) LIGHT(_i,_j))<<8)
 
-g3s_point save_row[GRID_MAX_SIZE];
-
 vms_vector start_point;
 
 grs_bitmap *terrain_bm;
@@ -72,11 +72,58 @@ void build_light_table(void);
 void free_light_table(void);
 
 
+//Rotated grid points, with their heights added, for the half of the grid being drawn
+static g3s_point terrain_points[GRID_MAX_SIZE][GRID_MAX_SIZE];
+
+//Draw cells further than this from the viewer merged into blocks, 0 for full detail everywhere
+int Terrain_lod_distance = 0;
+
+#define TERRAIN_LOD_MAX	4		//largest block, in cells on a side
+
+static terrain_stats Terrain_stats;
+terrain_stats Terrain_stats_last_frame;
+
+static int viewer_i,viewer_j;
+
+static void mark_mine_tile(int i,int j)
+{
+	if (i==org_i && j==org_j)
+		mine_tiles_drawn |= 1;
+	if (i==org_i-1 && j==org_j)
+		mine_tiles_drawn |= 2;
+	if (i==org_i && j==org_j-1)
+		mine_tiles_drawn |= 4;
+	if (i==org_i-1 && j==org_j-1)
+		mine_tiles_drawn |= 8;
+	
+	if (mine_tiles_drawn == 0xf) 
+	{
+		render_mine(exit_segnum,0, 0);
+		//draw_exit_model();
+		mine_tiles_drawn=-1;
+		//if (ext_expl_playing)
+		//	draw_fireball(&external_explosion);
+	}
+}
+
 // ------------------------------------------------------------------------
-void draw_cell(int i,int j,g3s_point *p0,g3s_point *p1,g3s_point *p2,g3s_point *p3)
+void draw_cell(int i,int j)
 {
+	g3s_point *p0,*p1,*p2,*p3;
 	g3s_point *pointlist[3];
 
+	p0 = &terrain_points[i][j];
+	p1 = &terrain_points[i][j+1];
+	p2 = &terrain_points[i+1][j+1];
+	p3 = &terrain_points[i+1][j];
+
+	//neither triangle would draw anything
+	if (p0->p3_codes & p1->p3_codes & p2->p3_codes & p3->p3_codes) {
+		Terrain_stats.culled++;
+		mark_mine_tile(i,j);
+		return;
+	}
+
 	pointlist[0] = p0;
 	pointlist[1] = p1;
 	pointlist[2] = p3;
@@ -119,24 +166,156 @@ void draw_cell(int i,int j,g3s_point *p0,g3s_point *p1,g3s_point *p2,g3s_point *
 		Lighting_on=lsave;
 	}
 
-	if (i==org_i && j==org_j)
-		mine_tiles_drawn |= 1;
-	if (i==org_i-1 && j==org_j)
-		mine_tiles_drawn |= 2;
-	if (i==org_i && j==org_j-1)
-		mine_tiles_drawn |= 4;
-	if (i==org_i-1 && j==org_j-1)
-		mine_tiles_drawn |= 8;
-	
-	if (mine_tiles_drawn == 0xf) 
-	{
-		render_mine(exit_segnum,0, 0);
-		//draw_exit_model();
-		mine_tiles_drawn=-1;
-		//if (ext_expl_playing)
-		//	draw_fireball(&external_explosion);
+	Terrain_stats.cells++;
+	Terrain_stats.triangles += 2;
+
+	mark_mine_tile(i,j);
+}
+
+//True if cells first..first+size-1 along one axis are on the grid and on the same side of the viewer
+static int lod_block_fits(int first,int size,int viewer,int num_cells)
+{
+	if (first < 0 || first+size > num_cells)
+		return 0;
+
+	return first+size <= viewer || first >= viewer;
+}
+
+//Cells from the viewer to the nearest cell of a block along one axis
+static int lod_block_dist(int first,int size,int viewer)
+{
+	if (first > viewer)
+		return first - viewer;
+	if (first+size-1 < viewer)
+		return viewer - (first+size-1);
+	return 0;
+}
+
+//Size of the level of detail block cell i,j is drawn in, 1 at full detail.
+//Blocks are aligned to their size, stay in one quarter of the grid around the viewer and
+//never hold the tiles under the mine, so every cell of a block gives the same answer.
+static int cell_lod(int i,int j)
+{
+	int size,bi,bj,dist;
+
+	if (!Terrain_lod_distance)
+		return 1;
+
+	for (size=TERRAIN_LOD_MAX;size>1;size>>=1) {
+
+		bi = i & ~(size-1);
+		bj = j & ~(size-1);
+
+		if (!lod_block_fits(bi,size,viewer_i,grid_w-1) || !lod_block_fits(bj,size,viewer_j,grid_h-1))
+			continue;
+
+		if (bi <= org_i && bi+size > org_i-1 && bj <= org_j && bj+size > org_j-1)
+			continue;
+
+		dist = std::max(lod_block_dist(bi,size,viewer_i),lod_block_dist(bj,size,viewer_j));
+
+		if (dist >= Terrain_lod_distance*size/2)
+			return size;
+	}
+
+	return 1;
+}
+
+//True if the grid point at along on a block's edge is a corner of the block holding
+//neighbouring cell ni,nj, which starts there
+static int lod_edge_point(int ni,int nj,int along)
+{
+	if (ni < 0 || nj < 0 || ni >= grid_w-1 || nj >= grid_h-1)
+		return 0;
+
+	return (along & (cell_lod(ni,nj)-1)) == 0;
+}
+
+static void set_uvl(g3s_uvl *uvl,int i,int j)
+{
+	uvl->u = i*f1_0/4;
+	uvl->v = j*f1_0/4;
+	uvl->l = LIGHTVAL(i,j);
+}
+
+//Draws a block of cells as a fan around its centre point. Edges pick up the grid
+//points of smaller neighbouring blocks, so there are no cracks where the detail changes.
+static void draw_block(int bi,int bj,int size)
+{
+	int ring_i[TERRAIN_LOD_MAX*4],ring_j[TERRAIN_LOD_MAX*4];
+	int n=0,k,m,ci,cj;
+	uint8_t codes;
+	g3s_point *pointlist[3];
+	g3s_uvl uvl[3];
+
+	//corners and edge points, wound the same way as the triangles of draw_cell
+	for (k=0;k<size;k++)
+		if (k==0 || lod_edge_point(bi-1,bj+k,bj+k))
+			{ring_i[n] = bi; ring_j[n++] = bj+k;}
+	for (k=0;k<size;k++)
+		if (k==0 || lod_edge_point(bi+k,bj+size,bi+k))
+			{ring_i[n] = bi+k; ring_j[n++] = bj+size;}
+	for (k=0;k<size;k++)
+		if (k==0 || lod_edge_point(bi+size,bj+size-k,bj+size-k))
+			{ring_i[n] = bi+size; ring_j[n++] = bj+size-k;}
+	for (k=0;k<size;k++)
+		if (k==0 || lod_edge_point(bi+size-k,bj-1,bi+size-k))
+			{ring_i[n] = bi+size-k; ring_j[n++] = bj;}
+
+	ci = bi+size/2;
+	cj = bj+size/2;
+
+	codes = terrain_points[ci][cj].p3_codes;
+	for (m=0;m<n;m++)
+		codes &= terrain_points[ring_i[m]][ring_j[m]].p3_codes;
+
+	if (codes) {
+		Terrain_stats.culled++;
+		return;
+	}
+
+	pointlist[0] = &terrain_points[ci][cj];
+	set_uvl(&uvl[0],ci,cj);
+
+	for (m=0;m<n;m++) {
+		int next = (m+1 == n) ? 0 : m+1;
+
+		pointlist[1] = &terrain_points[ring_i[m]][ring_j[m]];
+		pointlist[2] = &terrain_points[ring_i[next]][ring_j[next]];
+		set_uvl(&uvl[1],ring_i[m],ring_j[m]);
+		set_uvl(&uvl[2],ring_i[next],ring_j[next]);
+
+		g3_check_and_draw_tmap(3,pointlist,uvl,terrain_bm,NULL,NULL);
+		if (terrain_outline) {
+			int lsave=Lighting_on;
+			Lighting_on=0;
+			gr_setcolor(BM_XRGB(31,0,0));
+			g3_draw_line(pointlist[1],pointlist[2]);
+			Lighting_on=lsave;
+		}
 	}
 
+	Terrain_stats.blocks += size*size;
+	Terrain_stats.triangles += n;
+}
+
+//Draws cell i,j, or the block it's in if this is the first of the block's cells
+//reached going step_i, step_j
+static void draw_lod_cell(int i,int j,int step_i,int step_j)
+{
+	int size,bi,bj;
+
+	size = cell_lod(i,j);
+	if (size == 1) {
+		draw_cell(i,j);
+		return;
+	}
+
+	bi = i & ~(size-1);
+	bj = j & ~(size-1);
+
+	if (i == (step_i > 0 ? bi : bi+size-1) && j == (step_j > 0 ? bj : bj+size-1))
+		draw_block(bi,bj,size);
 }
 
 vms_vector y_cache[256];
@@ -165,16 +344,43 @@ vms_vector *get_dy_vec(int h)
 
 }
 
+//Fills rows from_i to to_i of terrain_points, starting from the rotated point at from_i,0
+//and stepping by delta_i and delta_j. Only exact adds, so a point is the same whichever way
+//it's reached.
+static void rotate_terrain_rows(g3s_point *start,int from_i,int to_i,vms_vector *delta_i,vms_vector *delta_j)
+{
+	g3s_point row_p,p;
+	int i,j;
+
+	row_p = *start;
+
+	for (i=from_i;;i+=(to_i>from_i)?1:-1) {
+
+		p = row_p;
+
+		for (j=0;j<grid_h;j++) {
+			g3_add_delta_vec(&terrain_points[i][j],&p,get_dy_vec(HEIGHT(i,j)));
+			if (j < grid_h-1)
+				g3_add_delta_vec(&p,&p,delta_j);
+		}
+
+		if (i==to_i)
+			break;
+
+		g3_add_delta_vec(&row_p,&row_p,delta_i);
+	}
+}
+
 int im=1;
 
+//Cells are drawn back to front, from each edge of the grid toward the viewer.
+//The grid points for each half are rotated once up front instead of a row at a time.
 void render_terrain(vms_vector *org_point,int org_2dx,int org_2dy)
 {
 	vms_vector delta_i,delta_j;		//delta_y;
-	g3s_point p,last_p,save_p_low,save_p_high;
-	g3s_point last_p2;
+	g3s_point p;
 	int i,j;
 	int low_i,high_i,low_j,high_j;
-	int viewer_i,viewer_j;
 	vms_vector tv;
 
 	mine_tiles_drawn = 0;	//clear flags
@@ -206,63 +412,25 @@ void render_terrain(vms_vector *org_point,int org_2dx,int org_2dy)
 	viewer_i = vm_vec_dot(&tv,&surface_orient.rvec) / GRID_SCALE;
 	viewer_j = vm_vec_dot(&tv,&surface_orient.fvec) / GRID_SCALE;
 
-//mprintf((0,"viewer_i,j = %d,%d\n",viewer_i,viewer_j));
-
-	g3_rotate_point(&last_p,&start_point);
-	save_p_low = last_p;
-
-	for (j=low_j;j<=high_j;j++) {
-		g3_add_delta_vec(&save_row[j],&last_p,get_dy_vec(HEIGHT(low_i,j)));
-		if (j==high_j)
-			save_p_high = last_p;
-		else
-			g3_add_delta_vec(&last_p,&last_p,&delta_j);
-	}
-
-	for (i=low_i;i<viewer_i;i++) {
-
-		g3_add_delta_vec(&save_p_low,&save_p_low,&delta_i);
-		last_p = save_p_low;
-		g3_add_delta_vec(&last_p2,&last_p,get_dy_vec(HEIGHT(i+1,low_j)));
-		
-		for (j=low_j;j<viewer_j;j++) {
-			g3s_point p2;
+	//keep the walk on the grid when the viewer is off its edge
+	viewer_i = std::max(low_i,std::min(viewer_i,high_i));
+	viewer_j = std::max(low_j,std::min(viewer_j,high_j));
 
-			g3_add_delta_vec(&p,&last_p,&delta_j);
-			g3_add_delta_vec(&p2,&p,get_dy_vec(HEIGHT(i+1,j+1)));
-
-			draw_cell(i,j,&save_row[j],&save_row[j+1],&p2,&last_p2);
-
-			last_p = p;
-			save_row[j] = last_p2;
-			last_p2 = p2;
-
-		}
-
-		vm_vec_negate(&delta_j);			//don't have a delta sub...
+//mprintf((0,"viewer_i,j = %d,%d\n",viewer_i,viewer_j));
 
-		g3_add_delta_vec(&save_p_high,&save_p_high,&delta_i);
-		last_p = save_p_high;
-		g3_add_delta_vec(&last_p2,&last_p,get_dy_vec(HEIGHT(i+1,high_j)));
-		
-		for (j=high_j-1;j>=viewer_j;j--) {
-			g3s_point p2;
+	if (viewer_i > low_i) {
 
-			g3_add_delta_vec(&p,&last_p,&delta_j);
-			g3_add_delta_vec(&p2,&p,get_dy_vec(HEIGHT(i+1,j)));
+		g3_rotate_point(&p,&start_point);
+		rotate_terrain_rows(&p,low_i,viewer_i,&delta_i,&delta_j);
 
-			draw_cell(i,j,&save_row[j],&save_row[j+1],&last_p2,&p2);
+		for (i=low_i;i<viewer_i;i++) {
 
-			last_p = p;
-			save_row[j+1] = last_p2;
-			last_p2 = p2;
+			for (j=low_j;j<viewer_j;j++)
+				draw_lod_cell(i,j,1,1);
 
+			for (j=high_j-1;j>=viewer_j;j--)
+				draw_lod_cell(i,j,1,-1);
 		}
-
-		save_row[j+1] = last_p2;
-
-		vm_vec_negate(&delta_j);		//restore sign of j
-
 	}
 
 	//now do i from other end
@@ -271,65 +439,30 @@ void render_terrain(vms_vector *org_point,int org_2dx,int org_2dy)
 
 	//@@start_point.x += (high_i-low_i)*GRID_SCALE;
 	vm_vec_scale_add2(&start_point,&surface_orient.rvec,(high_i-low_i)*GRID_SCALE);
-	g3_rotate_point(&last_p,&start_point);
-	save_p_low = last_p;
-
-	for (j=low_j;j<=high_j;j++) {
-		g3_add_delta_vec(&save_row[j],&last_p,get_dy_vec(HEIGHT(high_i,j)));
-		if (j==high_j)
-			save_p_high = last_p;
-		else
-			g3_add_delta_vec(&last_p,&last_p,&delta_j);
-	}
-
-	for (i=high_i-1;i>=viewer_i;i--) {
-
-		g3_add_delta_vec(&save_p_low,&save_p_low,&delta_i);
-		last_p = save_p_low;
-		g3_add_delta_vec(&last_p2,&last_p,get_dy_vec(HEIGHT(i,low_j)));
-		
-		for (j=low_j;j<viewer_j;j++) {
-			g3s_point p2;
-
-			g3_add_delta_vec(&p,&last_p,&delta_j);
-			g3_add_delta_vec(&p2,&p,get_dy_vec(HEIGHT(i,j+1)));
-
-			draw_cell(i,j,&last_p2,&p2,&save_row[j+1],&save_row[j]);
-
-			last_p = p;
-			save_row[j] = last_p2;
-			last_p2 = p2;
-
-		}
-
-		vm_vec_negate(&delta_j);			//don't have a delta sub...
 
-		g3_add_delta_vec(&save_p_high,&save_p_high,&delta_i);
-		last_p = save_p_high;
-		g3_add_delta_vec(&last_p2,&last_p,get_dy_vec(HEIGHT(i,high_j)));
-		
-		for (j=high_j-1;j>=viewer_j;j--) {
-			g3s_point p2;
+	if (viewer_i < high_i) {
 
-			g3_add_delta_vec(&p,&last_p,&delta_j);
-			g3_add_delta_vec(&p2,&p,get_dy_vec(HEIGHT(i,j)));
+		g3_rotate_point(&p,&start_point);
+		rotate_terrain_rows(&p,high_i,viewer_i,&delta_i,&delta_j);
 
-			draw_cell(i,j,&p2,&last_p2,&save_row[j+1],&save_row[j]);
+		for (i=high_i-1;i>=viewer_i;i--) {
 
-			last_p = p;
-			save_row[j+1] = last_p2;
-			last_p2 = p2;
+			for (j=low_j;j<viewer_j;j++)
+				draw_lod_cell(i,j,-1,1);
 
+			for (j=high_j-1;j>=viewer_j;j--)
+				draw_lod_cell(i,j,-1,-1);
 		}
-
-		save_row[j+1] = last_p2;
-
-		vm_vec_negate(&delta_j);		//restore sign of j
-
 	}
 
 }
 
+void terrain_end_frame()
+{
+	Terrain_stats_last_frame = Terrain_stats;
+	memset(&Terrain_stats, 0, sizeof(Terrain_stats));
+}
+
 void free_height_array()
 {
 	mem_free(height_array);
@@ -436,6 +569,7 @@ void free_light_table()
 
 void build_light_table()
 {
+	static fix avg_light[GRID_MAX_SIZE*GRID_MAX_SIZE];		//so get_avg_light runs once a point
 	int i,j;
 	fix l,l2,min_l=0x7fffffff,max_l=0;
 
@@ -445,11 +579,11 @@ void build_light_table()
 	else
 		atexit(free_light_table);		//first time
 
-	MALLOC(light_array,uint8_t,grid_w*grid_h);
+	MALLOC_TAG(light_array,uint8_t,grid_w*grid_h, MEM_TAG_LEVEL);
 
 	for (i=1;i<grid_w;i++)
 		for (j=1;j<grid_h;j++) {
-			l = get_avg_light(i,j);
+			l = avg_light[i*grid_w+j] = get_avg_light(i,j);
 
 			if (l > max_l)
 				max_l = l;
@@ -463,7 +597,7 @@ void build_light_table()
 	for (i=1;i<grid_w;i++)
 		for (j=1;j<grid_h;j++) {
 
-			l = get_avg_light(i,j);
+			l = avg_light[i*grid_w+j];
 
 			if (min_l == max_l) {
 				LIGHT(i,j) = l>>8;
@@ -15,3 +15,21 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 
 void load_terrain(char *filename);
 void render_terrain(vms_vector *org,int org_i,int org_j);
+
+//Draw cells this many cells or more from the viewer merged into 2x2 blocks, and twice as far
+//into 4x4 blocks. 0, the default, draws every cell.
+extern int Terrain_lod_distance;
+
+//Terrain drawn in the exit sequence last frame
+typedef struct terrain_stats
+{
+	int cells;			//cells drawn at full detail
+	int blocks;			//cells drawn as part of a merged block
+	int culled;			//cells and blocks entirely off screen
+	int triangles;		//triangles sent to the 3d code
+} terrain_stats;
+
+extern terrain_stats Terrain_stats_last_frame;
+
+//Call once a frame to move the counters into Terrain_stats_last_frame.
+void terrain_end_frame();
@@ -363,7 +363,7 @@ void show_bitmap_frame(void)
 			dd_grd_curcanv = curcanv_save,
 			grd_curcanv = curcanv_save
 		);
-		mem_free(bitmap_canv);
+		gr_free_sub_canvas(bitmap_canv);
 
 		switch (Animating_bitmap_type) 
 		{
@@ -409,7 +409,7 @@ void show_briefing_bitmap(grs_bitmap* bmp)
 	gr_set_current_canvas(curcanv_save);
 #endif
 
-	mem_free(bitmap_canv);
+	gr_free_sub_canvas(bitmap_canv);
 }
 
 #ifndef WINDOWS
@@ -724,7 +724,7 @@ int show_briefing_message(int screen_num, char* message)
 			{
 				if (Robot_canv != NULL)
 				{
-					mem_free(Robot_canv);
+					gr_free_sub_canvas(Robot_canv);
 					Robot_canv = NULL;
 				}
 				if (RobotPlaying)
@@ -753,7 +753,7 @@ int show_briefing_message(int screen_num, char* message)
 				//--grs_bitmap	*bitmap_ptr;
 				if (Robot_canv != NULL)
 				{
-					mem_free(Robot_canv); Robot_canv = NULL;
+					gr_free_sub_canvas(Robot_canv); Robot_canv = NULL;
 				}
 
 				get_message_name(&message, Bitmap_name);
@@ -765,7 +765,7 @@ int show_briefing_message(int screen_num, char* message)
 			{
 				if (Robot_canv != NULL)
 				{
-					mem_free(Robot_canv); Robot_canv = NULL;
+					gr_free_sub_canvas(Robot_canv); Robot_canv = NULL;
 				}
 
 				get_message_name(&message, Bitmap_name);
@@ -826,7 +826,7 @@ int show_briefing_message(int screen_num, char* message)
 
 				if (Robot_canv != NULL)
 				{
-					mem_free(Robot_canv); Robot_canv = NULL;
+					gr_free_sub_canvas(Robot_canv); Robot_canv = NULL;
 				}
 
 				get_message_name(&message, bitmap_name);
@@ -1064,7 +1064,7 @@ int show_briefing_message(int screen_num, char* message)
 
 	if (Robot_canv != NULL)
 	{
-		mem_free(Robot_canv); Robot_canv = NULL;
+		gr_free_sub_canvas(Robot_canv); Robot_canv = NULL;
 	}
 
 	if (hum_channel > -1)
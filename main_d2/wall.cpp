@@ -1367,7 +1367,7 @@ void remove_obsolete_stuck_objects(void)
 	if (!Num_stuck_objects)
 		return;
 
-	objnum = FrameCount % MAX_STUCK_OBJECTS;
+	objnum = Tick_count % MAX_STUCK_OBJECTS;
 
 	if (Stuck_objects[objnum].wallnum != -1)
 		if ((Walls[Stuck_objects[objnum].wallnum].state != WALL_DOOR_CLOSED) || (Objects[Stuck_objects[objnum].objnum].signature != Stuck_objects[objnum].signature)) {
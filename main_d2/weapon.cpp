@@ -1004,7 +1004,7 @@ void process_super_mines_frame(void)
 	//	check every 8th object each frame.
 	if (Super_mines_yes == 0)
 	{
-		start = FrameCount & 7;
+		start = Tick_count & 7;
 		add = 8;
 	}
 	else
@@ -1047,7 +1047,7 @@ void process_super_mines_frame(void)
 								{
 									//	Object which is close enough to detonate smart mine is not in same segment as smart mine.
 									//	Need to do a more expensive check to make sure there isn't an obstruction.
-									if (((FrameCount ^ (i + j)) % 4) == 0)
+									if (((Tick_count ^ (i + j)) % 4) == 0)
 									{
 										fvi_query	fq;
 										fvi_info		hit_data;
@@ -77,6 +77,9 @@ extern grs_bitmap GameBitmaps[MAX_BITMAP_FILES];
 
 void piggy_read_sounds();
 
+//Reads a sound's data if it hasn't been yet. Call before using GameSounds[soundnum].data.
+void piggy_sound_page_in(int soundnum);
+
 //reads in a new pigfile (for new palette)
 //returns the size of all the bitmap data
 void piggy_new_pigfile(const char *pigname);
@@ -79,7 +79,7 @@ void load_text(int total_strings)
 
 		len = cfilelength(ifile);
 
-		MALLOC(text,char,len);
+		MALLOC_TAG(text,char,len, MEM_TAG_TEXT);
 
 		atexit(free_text);
 
@@ -94,7 +94,7 @@ void load_text(int total_strings)
 
 		len = cfilelength(tfile);
 
-		MALLOC(text,char,len);
+		MALLOC_TAG(text,char,len, MEM_TAG_TEXT);
 
 		atexit(free_text);
 
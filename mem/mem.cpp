@@ -29,9 +29,26 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #endif
 
 #include <inttypes.h>
+#include <mutex>
+#include <vector>
+
+//Tracking heap blocks by tag keeps every block in a map behind a lock, so it's only done in debug
+//builds. Define MEM_TRACK_TAGS to have it in a release build too.
+#if !defined(NDEBUG) && !defined(MEM_TRACK_TAGS)
+#define MEM_TRACK_TAGS
+#endif
+
+#ifdef MEM_TRACK_TAGS
+#include <unordered_map>
+#endif
 
 #include "platform/mono.h"
 #include "misc/error.h"
+#include "mem/mem.h"
+
+//Stats tracking, shared by all the allocators below.
+static void mem_track_alloc(void* ptr, size_t size, int tag);
+static void mem_track_free(void* ptr);
 
 //#define FULL_MEM_CHECKING
 
@@ -96,7 +113,7 @@ void PrintInfo(int id)
 }
 
 
-void* mem_malloc_(unsigned int size, const char* var, const char* filename, int line, int fill_zero)
+void* mem_malloc_(unsigned int size, const char* var, const char* filename, int line, int fill_zero, int tag)
 {
 	int i, j, id;
 	void* ptr;
@@ -175,6 +192,8 @@ void* mem_malloc_(unsigned int size, const char* var, const char* filename, int
 
 	pc += CHECKSIZE;
 
+	mem_track_alloc(pc, size, tag);
+
 	return (void*)pc;
 
 }
@@ -267,8 +286,8 @@ void mem_free_(void* buffer)
 
 	BytesMalloced -= MallocSize[id];
 
-	//free(buffer);
-	mem_free(pc);
+	mem_track_free(buffer);
+	free(pc);
 
 	Present[id] = 0;
 	MallocBase[id] = 0;
@@ -339,7 +358,6 @@ void mem_print_all()
 #else
 
 static int Initialized = 0;
-static uint64_t BytesMalloced = 0;
 
 void mem_display_blocks(void);
 
@@ -355,14 +373,18 @@ void mem_init()
 	atexit(mem_display_blocks);
 }
 
-void* mem_malloc_(unsigned int size, const char* var, const char* filename, int line, int fill_zero)
+#ifndef NDEBUG
+void* mem_malloc_(unsigned int size, const char* var, const char* filename, int line, int fill_zero, int tag)
+#else
+void* mem_malloc_(unsigned int size, int fill_zero, int tag)
+#endif
 {
-	unsigned int base;
 	void* ptr;
 
 	if (Initialized == 0)
 		mem_init();
 
+#ifndef NDEBUG
 	//fprintf(stderr, "Allocation: Var %s, file %s, line %d. Amount %d\n", var, filename, line, size);
 
 	if (size == 0) {
@@ -384,37 +406,37 @@ void* mem_malloc_(unsigned int size, const char* var, const char* filename, int
 
 		return NULL; //[ISB] solve C6011
 	}
+#else
+	ptr = malloc(size);
+
+	if (ptr == NULL)
+		return NULL;
+#endif
 
 	if (fill_zero)
 		memset(ptr, 0, size);
 
+	mem_track_alloc(ptr, size, tag);
+
 	return ptr;
 }
 
 void mem_free_(void* buffer)
 {
-	int ErrorCount;
-
 	if (Initialized == 0)
 		mem_init();
 
 	if (buffer == NULL)
 	{
+#ifndef NDEBUG
 		fprintf(stderr, "\nMEM_FREE_NULL: An attempt was made to free the null pointer.\n");
 		Warning("MEM: Freeing the NULL pointer!");
 		Int3();
+#endif
 		return;
 	}
 
-	ErrorCount = 0;
-
-	if (ErrorCount) 
-	{
-		fprintf(stderr, "\nMEM_OVERWRITE: Memory after the end of allocated block overwritten.\n");
-		fprintf(stderr, "\tBlock at 0x%p\n", buffer); //[ISB] trying %p
-		fprintf(stderr, "\t%d/%d check bytes were overwritten.\n", ErrorCount, CHECKSIZE);
-	}
-
+	mem_track_free(buffer);
 	free(buffer);
 }
 
@@ -422,10 +444,8 @@ void mem_display_blocks(void)
 {
 	if (Initialized == 0) return;
 
-	if (BytesMalloced != 0)
-	{
-		fprintf(stderr, "\nMEM_LEAKAGE: %lld bytes of memory have not been freed.\n", BytesMalloced);
-	}
+	if (show_mem_info)
+		mem_print_stats(stderr, "at exit");
 }
 
 void mem_validate_heap()
@@ -438,4 +458,307 @@ void mem_print_all()
 
 #endif
 
+//-------------------------------------------------------------------------
+//Stats tracking. Blocks are kept in a map instead of a header in front of the block,
+//so memory from mem_malloc that gets handed to free() (or the other way) doesn't break anything.
+//Such blocks just aren't counted right.
+
+static const char* Mem_tag_names[NUM_MEM_TAGS] =
+{
+	"misc", "bitmap", "font", "model", "sound", "movie", "level", "text", "network", "ui", "frame", "pool"
+};
+
+static std::mutex Mem_lock;		//guards the tracked blocks, the stats and the pools
+static mem_tag_stats Mem_stats[NUM_MEM_TAGS];
+static mem_tag_stats Frame_stats;	//the frame arena's, kept apart since it's main thread only and takes no lock
+
+int Mem_stats_dump = 0;
+
+static void mem_stats_add(int tag, size_t size)
+{
+	mem_tag_stats* stats = &Mem_stats[tag];
+	stats->live_bytes += size;
+	stats->live_blocks++;
+	stats->allocs++;
+	if (stats->live_bytes > stats->peak_bytes)
+		stats->peak_bytes = stats->live_bytes;
+}
+
+static void mem_stats_remove(int tag, size_t size)
+{
+	mem_tag_stats* stats = &Mem_stats[tag];
+	stats->live_bytes -= size;
+	stats->live_blocks--;
+	stats->frees++;
+}
+
+#ifdef MEM_TRACK_TAGS
+
+typedef struct mem_block_info
+{
+	size_t size;
+	int tag;
+} mem_block_info;
+
+//Never freed, so blocks can still be freed while the program shuts down.
+static std::unordered_map<void*, mem_block_info>* Mem_blocks;
+
+static void mem_track_alloc(void* ptr, size_t size, int tag)
+{
+	if (tag < 0 || tag >= NUM_MEM_TAGS)
+		tag = MEM_TAG_MISC;
+
+	std::lock_guard<std::mutex> lock(Mem_lock);
+	if (!Mem_blocks)
+		Mem_blocks = new std::unordered_map<void*, mem_block_info>;
+
+	//If the address is still in the map, its block was released with free() behind our back
+	auto it = Mem_blocks->find(ptr);
+	if (it != Mem_blocks->end())
+	{
+		mem_stats_remove(it->second.tag, it->second.size);
+		it->second.size = size;
+		it->second.tag = tag;
+	}
+	else
+		Mem_blocks->emplace(ptr, mem_block_info{ size, tag });
+
+	mem_stats_add(tag, size);
+}
+
+static void mem_track_free(void* ptr)
+{
+	std::lock_guard<std::mutex> lock(Mem_lock);
+	if (!Mem_blocks)
+		return;
+
+	auto it = Mem_blocks->find(ptr);
+	if (it == Mem_blocks->end())
+		return;
+
+	mem_stats_remove(it->second.tag, it->second.size);
+	Mem_blocks->erase(it);
+}
+
+#else
+
+static void mem_track_alloc(void* ptr, size_t size, int tag)
+{
+}
+
+static void mem_track_free(void* ptr)
+{
+}
+
+#endif
+
+void mem_get_stats(mem_tag_stats* stats)
+{
+	std::lock_guard<std::mutex> lock(Mem_lock);
+	memcpy(stats, Mem_stats, sizeof(Mem_stats));
+	stats[MEM_TAG_FRAME] = Frame_stats;
+}
+
+void mem_stats_reset_period()
+{
+	std::lock_guard<std::mutex> lock(Mem_lock);
+	for (int i = 0; i < NUM_MEM_TAGS; i++)
+	{
+		Mem_stats[i].allocs = Mem_stats[i].frees = 0;
+		Mem_stats[i].peak_bytes = Mem_stats[i].live_bytes;
+	}
+	Frame_stats.allocs = Frame_stats.frees = 0;
+	Frame_stats.peak_bytes = Frame_stats.live_bytes;
+}
+
+//-------------------------------------------------------------------------
+//The frame arena. One block, bumped through. When a frame needs more than the block holds,
+//the rest comes from the heap, and the next reset grows the block so it fits next time.
 
+#define FRAME_ARENA_MIN_SIZE	(64 * 1024)
+
+static uint8_t* Frame_arena;
+static size_t Frame_arena_size, Frame_arena_used;
+static std::vector<void*> Frame_overflow;
+static size_t Frame_overflow_bytes;
+static size_t Frame_peak_used;		//most bytes any frame has used
+
+void* mem_frame_alloc(size_t size)
+{
+	void* ptr;
+
+	if (Frame_arena == NULL)
+		mem_frame_reset();
+
+	size = (size + 15) & ~(size_t)15;
+
+	if (Frame_arena_used + size <= Frame_arena_size)
+	{
+		ptr = Frame_arena + Frame_arena_used;
+		Frame_arena_used += size;
+	}
+	else
+	{
+		ptr = malloc(size);
+		if (ptr == NULL)
+			Error("mem_frame_alloc: Out of memory allocating %u bytes", (unsigned int)size);
+		Frame_overflow.push_back(ptr);
+		Frame_overflow_bytes += size;
+	}
+
+	Frame_stats.live_bytes += size;
+	Frame_stats.live_blocks++;
+	Frame_stats.allocs++;
+	if (Frame_stats.live_bytes > Frame_stats.peak_bytes)
+		Frame_stats.peak_bytes = Frame_stats.live_bytes;
+	if (Frame_arena_used + Frame_overflow_bytes > Frame_peak_used)
+		Frame_peak_used = Frame_arena_used + Frame_overflow_bytes;
+
+	return ptr;
+}
+
+void mem_frame_reset()
+{
+	size_t needed = Frame_arena_used + Frame_overflow_bytes;
+
+	if (Frame_overflow_bytes > 0 || Frame_arena == NULL)
+	{
+		for (void* ptr : Frame_overflow)
+			free(ptr);
+		Frame_overflow.clear();
+
+		//Leave room to grow, so a frame that's a little bigger doesn't overflow again
+		size_t newsize = needed * 2;
+		if (newsize < FRAME_ARENA_MIN_SIZE)
+			newsize = FRAME_ARENA_MIN_SIZE;
+		if (newsize > Frame_arena_size)
+		{
+			free(Frame_arena);
+			Frame_arena = (uint8_t*)malloc(newsize);
+			if (Frame_arena == NULL)
+				Error("mem_frame_reset: Out of memory growing the frame arena to %u bytes", (unsigned int)newsize);
+			Frame_arena_size = newsize;
+		}
+	}
+
+	Frame_arena_used = 0;
+	Frame_overflow_bytes = 0;
+
+	Frame_stats.frees += Frame_stats.live_blocks;
+	Frame_stats.live_blocks = 0;
+	Frame_stats.live_bytes = 0;
+}
+
+//-------------------------------------------------------------------------
+//Size-class pools. Each class carves chunks into slots of its size, and keeps the free
+//slots in a list threaded through the slots themselves.
+
+#define NUM_POOL_CLASSES	5
+#define POOL_CHUNK_SIZE		(16 * 1024)
+
+typedef struct mem_pool_class
+{
+	size_t size;
+	void* free_list;
+	std::vector<void*> chunks;
+	int live, peak;
+} mem_pool_class;
+
+static mem_pool_class Mem_pools[NUM_POOL_CLASSES] = { { 16 }, { 32 }, { 64 }, { 128 }, { 256 } };
+
+static int mem_pool_class_for(size_t size)
+{
+	int i;
+	for (i = 0; i < NUM_POOL_CLASSES - 1; i++)
+		if (size <= Mem_pools[i].size)
+			break;
+	return i;
+}
+
+void* mem_pool_alloc(size_t size)
+{
+	if (size > MEM_POOL_MAX_SIZE)
+		return mem_malloc_tag(size, MEM_TAG_POOL);
+
+	std::lock_guard<std::mutex> lock(Mem_lock);
+	mem_pool_class* pool = &Mem_pools[mem_pool_class_for(size)];
+
+	if (pool->free_list == NULL)
+	{
+		uint8_t* chunk = (uint8_t*)malloc(POOL_CHUNK_SIZE);
+		if (chunk == NULL)
+			Error("mem_pool_alloc: Out of memory allocating a chunk for %u byte objects", (unsigned int)pool->size);
+		pool->chunks.push_back(chunk);
+
+		for (size_t offset = 0; offset + pool->size <= POOL_CHUNK_SIZE; offset += pool->size)
+		{
+			*(void**)(chunk + offset) = pool->free_list;
+			pool->free_list = chunk + offset;
+		}
+	}
+
+	void* ptr = pool->free_list;
+	pool->free_list = *(void**)ptr;
+
+	pool->live++;
+	if (pool->live > pool->peak)
+		pool->peak = pool->live;
+	mem_stats_add(MEM_TAG_POOL, pool->size);
+
+	return ptr;
+}
+
+void mem_pool_free(void* ptr, size_t size)
+{
+	if (ptr == NULL)
+		return;
+
+	if (size > MEM_POOL_MAX_SIZE)
+	{
+		mem_free(ptr);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(Mem_lock);
+	mem_pool_class* pool = &Mem_pools[mem_pool_class_for(size)];
+
+	*(void**)ptr = pool->free_list;
+	pool->free_list = ptr;
+
+	pool->live--;
+	mem_stats_remove(MEM_TAG_POOL, pool->size);
+}
+
+//-------------------------------------------------------------------------
+
+void mem_print_stats(FILE* fp, const char* title)
+{
+	mem_tag_stats stats[NUM_MEM_TAGS];
+	size_t live = 0, peak = 0;
+	int i;
+
+	mem_get_stats(stats);
+
+	fprintf(fp, "\nMemory %s:\n", title);
+	fprintf(fp, "%-10s %10s %10s %8s %8s %8s\n", "tag", "live KB", "peak KB", "blocks", "allocs", "frees");
+	for (i = 0; i < NUM_MEM_TAGS; i++)
+	{
+		fprintf(fp, "%-10s %10u %10u %8d %8d %8d\n", Mem_tag_names[i], (unsigned int)(stats[i].live_bytes / 1024),
+			(unsigned int)(stats[i].peak_bytes / 1024), stats[i].live_blocks, stats[i].allocs, stats[i].frees);
+		live += stats[i].live_bytes;
+		peak += stats[i].peak_bytes;
+	}
+	fprintf(fp, "%-10s %10u %10u\n", "total", (unsigned int)(live / 1024), (unsigned int)(peak / 1024));
+#ifndef MEM_TRACK_TAGS
+	fprintf(fp, "(heap blocks aren't tracked in this build, only the frame arena and pools)\n");
+#endif
+
+	std::lock_guard<std::mutex> lock(Mem_lock);
+	fprintf(fp, "Frame arena: %u KB reserved, biggest frame %u KB\n", (unsigned int)(Frame_arena_size / 1024),
+		(unsigned int)(Frame_peak_used / 1024));
+	for (i = 0; i < NUM_POOL_CLASSES; i++)
+	{
+		fprintf(fp, "Pool %3u bytes: %6d live, %6d peak, %4d KB reserved\n", (unsigned int)Mem_pools[i].size,
+			Mem_pools[i].live, Mem_pools[i].peak, (int)(Mem_pools[i].chunks.size() * POOL_CHUNK_SIZE / 1024));
+	}
+}
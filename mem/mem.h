@@ -13,31 +13,99 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 
 #pragma once
 
+#include <stddef.h>
+#include <stdio.h>
+
 extern int show_mem_info;
 
+//Allocations are tagged by the subsystem that made them, so the stats can say where memory goes.
+//mem_malloc and friends use MEM_TAG_MISC.
+enum
+{
+	MEM_TAG_MISC,
+	MEM_TAG_BITMAP,
+	MEM_TAG_FONT,
+	MEM_TAG_MODEL,
+	MEM_TAG_SOUND,
+	MEM_TAG_MOVIE,
+	MEM_TAG_LEVEL,
+	MEM_TAG_TEXT,
+	MEM_TAG_NETWORK,
+	MEM_TAG_UI,
+	MEM_TAG_FRAME,		//the frame arena
+	MEM_TAG_POOL,		//the size-class pools
+	NUM_MEM_TAGS
+};
+
 #ifndef NDEBUG
 
 //extern int show_mem_info;
 
-void* mem_display_blocks(void);
-extern void* mem_malloc_(unsigned int size, const char* var, const char* file, int line, int fill_zero);
+void mem_display_blocks(void);
+extern void* mem_malloc_(unsigned int size, const char* var, const char* file, int line, int fill_zero, int tag);
 extern void mem_free_(void* buffer);
 
-#define mem_malloc(size)    mem_malloc_((size),"Unknown", __FILE__,__LINE__, 0 )
-#define mem_calloc(n,size)  mem_malloc_((n*size),"Unknown", __FILE__,__LINE__, 1 )
+#define mem_malloc(size)    mem_malloc_((size),"Unknown", __FILE__,__LINE__, 0, MEM_TAG_MISC )
+#define mem_calloc(n,size)  mem_malloc_((n*size),"Unknown", __FILE__,__LINE__, 1, MEM_TAG_MISC )
+#define mem_malloc_tag(size,tag)	mem_malloc_((size),"Unknown", __FILE__,__LINE__, 0, (tag) )
 #define mem_free(ptr)       do{ mem_free_(ptr); ptr=NULL; } while(0)
 
-#define MALLOC( var, type, count )   (var=(type *)mem_malloc_((count)*sizeof(type),#var, __FILE__,__LINE__,0 ))
+#define MALLOC( var, type, count )   (var=(type *)mem_malloc_((count)*sizeof(type),#var, __FILE__,__LINE__,0, MEM_TAG_MISC ))
+#define MALLOC_TAG( var, type, count, tag )   (var=(type *)mem_malloc_((count)*sizeof(type),#var, __FILE__,__LINE__,0, (tag) ))
 
 // Checks to see if any blocks are overwritten
 void mem_validate_heap();
 
 #else
 
-#define mem_malloc(size)	malloc(size)
-#define mem_calloc(n,size)	calloc(n,size)
-#define mem_free(ptr)       do{ free(ptr); ptr=NULL; } while(0)
+extern void* mem_malloc_(unsigned int size, int fill_zero, int tag);
+extern void mem_free_(void* buffer);
 
-#define MALLOC( var, type, count )   (var=(type *)malloc((count)*sizeof(type)))
+#define mem_malloc(size)	mem_malloc_((size), 0, MEM_TAG_MISC)
+#define mem_calloc(n,size)	mem_malloc_((n)*(size), 1, MEM_TAG_MISC)
+#define mem_malloc_tag(size,tag)	mem_malloc_((size), 0, (tag))
+#define mem_free(ptr)       do{ mem_free_(ptr); ptr=NULL; } while(0)
+
+#define MALLOC( var, type, count )   (var=(type *)mem_malloc_((count)*sizeof(type), 0, MEM_TAG_MISC))
+#define MALLOC_TAG( var, type, count, tag )   (var=(type *)mem_malloc_((count)*sizeof(type), 0, (tag)))
 
 #endif
+
+//Per tag counters. Bytes are the requested sizes. allocs and frees count since the last
+//mem_stats_reset_period, so a dump made at the end of a level shows the traffic during that level.
+//Heap blocks are only counted in debug builds, or with MEM_TRACK_TAGS defined, release builds
+//count the frame arena and the pools.
+typedef struct mem_tag_stats
+{
+	size_t live_bytes;
+	size_t peak_bytes;			//highest live_bytes this period
+	int live_blocks;
+	int allocs;
+	int frees;
+} mem_tag_stats;
+
+//Copies the counters of all NUM_MEM_TAGS tags into stats.
+void mem_get_stats(mem_tag_stats* stats);
+
+//Starts a new period: zeroes allocs and frees and drops the peaks to the current live sizes.
+void mem_stats_reset_period();
+
+//Prints a table of the counters, with the frame arena and pools, under title.
+void mem_print_stats(FILE* fp, const char* title);
+
+//Set by -memstats, dumps the stats to stderr at the end of every level.
+extern int Mem_stats_dump;
+
+//The frame arena. A linear allocator for data that only lives until the end of the frame.
+//mem_frame_reset, called once a frame, frees everything at once. Allocations are 16 byte aligned.
+//Main thread only, workers use their job scratch memory.
+void* mem_frame_alloc(size_t size);
+void mem_frame_reset();
+
+//Size-class pools for small fixed size objects, up to MEM_POOL_MAX_SIZE bytes.
+//The size has to be given back when freeing, bigger sizes go to the heap under MEM_TAG_POOL.
+//These may be called from any thread.
+#define MEM_POOL_MAX_SIZE 256
+
+void* mem_pool_alloc(size_t size);
+void mem_pool_free(void* ptr, size_t size);
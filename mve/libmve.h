@@ -10,6 +10,10 @@ int  MVE_rmStepMovie();
 void MVE_rmHoldMovie();
 void MVE_rmEndMovie();
 
+//Decodes a whole movie as fast as it can, without showing it or playing the sound.
+//Returns 0 on success, with the number of frames and the time it took.
+int  MVE_rmBenchmark(int filehandle, int* frames, uint64_t* microseconds);
+
 void MVE_sndInit(int x);
 
 void MVE_sfCallbacks(mve_cb_ShowFrame *func);
@@ -6,6 +6,10 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
 
 #include "mvelib.h"
 #include "mve_audio.h"
@@ -24,6 +28,9 @@
 #ifndef MIN
 #define MIN(a,b) ((a)<(b)?(a):(b))
 #endif
+#ifndef MAX
+#define MAX(a,b) ((a)>(b)?(a):(b))
+#endif
 
 #define MVE_OPCODE_ENDOFSTREAM          0x00
 #define MVE_OPCODE_ENDOFCHUNK           0x01
@@ -52,6 +59,42 @@ int g_spdFactorNum=0;
 static int g_spdFactorDenom=10;
 static int g_frameUpdated = 0;
 
+/*************************
+ * decode-ahead
+ *************************/
+//Chunks are normally parsed and decoded on a separate thread, a few frames ahead of the one on screen.
+//Each frame is copied into a slot, along with the palette changes and audio that came before it.
+//MVE_rmStepMovie takes the slots in order on the main thread, and shows each when the audio clock says it's due.
+//Robot movies in the briefings hand us their own video buffers and read them directly, so they're decoded in step instead.
+#define MVE_NUM_SLOTS 4
+
+typedef struct
+{
+	int has_frame;
+	int end_of_stream;
+	int width, height, truecolor;
+	int screen_width, screen_height;
+	int frame_delay;
+	std::vector<uint8_t> pixels;
+	unsigned char palette[768];
+	int pal_start, pal_end; //range of colors that changed, pal_end is exclusive
+	int audio_init, audio_format, audio_rate, audio_stereo;
+	std::vector<uint8_t> audio_data; //audio buffers, one after another
+	std::vector<int> audio_lengths;
+} mve_slot;
+
+static mve_slot mve_slots[MVE_NUM_SLOTS];
+static int mve_slot_head, mve_slot_count;
+static std::mutex mve_slot_mutex;
+static std::condition_variable mve_slot_cv;
+static std::thread mve_decode_thread;
+static bool mve_decode_running = false;
+static bool mve_decode_stop = false;
+static int mve_threaded = 0;
+
+//Only touched by the decoding thread. When set, the handlers record into it instead of playing.
+static mve_slot* mve_record_slot = NULL;
+
 static short get_short(unsigned char *data)
 {
 	short value;
@@ -210,8 +253,19 @@ static int create_audiobuf_handler(unsigned char major, unsigned char minor, uns
 		format = MVESND_U8;
 	}
 
-	mvesnd_init_audio(format, sample_rate, stereo);
-	mve_audio_canplay = 1;
+	audiobuf_created = 1;
+	if (mve_record_slot)
+	{
+		mve_record_slot->audio_init = 1;
+		mve_record_slot->audio_format = format;
+		mve_record_slot->audio_rate = sample_rate;
+		mve_record_slot->audio_stereo = stereo;
+	}
+	else
+	{
+		mvesnd_init_audio(format, sample_rate, stereo);
+		mve_audio_canplay = 1;
+	}
 
 	return 1;
 }
@@ -228,7 +282,7 @@ static int audio_data_handler(unsigned char major, unsigned char minor, unsigned
 	int chan;
 	int nsamp;
 	short* buf = NULL;
-	if (mve_audio_canplay)
+	if (audiobuf_created)
 	{
 		chan = get_ushort(data + 2);
 		nsamp = get_ushort(data + 4);
@@ -240,22 +294,28 @@ static int audio_data_handler(unsigned char major, unsigned char minor, unsigned
 				{
 					nsamp += 4;
 
-					buf = (short*)mem_malloc(nsamp);
+					buf = (short*)mem_malloc_tag(nsamp, MEM_TAG_MOVIE);
 					mveaudio_uncompress(buf, data, -1);
 				} 
 				else 
 				{
-					buf = (short*)mem_malloc(nsamp);
+					buf = (short*)mem_malloc_tag(nsamp, MEM_TAG_MOVIE);
 					memcpy(buf, data + 6, nsamp);
 				}
 			} 
 			else 
 			{
-				buf = (short*)mem_malloc(nsamp);
+				buf = (short*)mem_malloc_tag(nsamp, MEM_TAG_MOVIE);
 				memset(buf, 0, nsamp);
 			}
 
-			mvesnd_queue_audio_buffer(nsamp, buf);
+			if (mve_record_slot)
+			{
+				mve_record_slot->audio_data.insert(mve_record_slot->audio_data.end(), (uint8_t*)buf, (uint8_t*)buf + nsamp);
+				mve_record_slot->audio_lengths.push_back(nsamp);
+			}
+			else
+				mvesnd_queue_audio_buffer(nsamp, buf);
 		}
 	}
 
@@ -321,7 +381,7 @@ static int create_videobuf_handler(unsigned char major, unsigned char minor, uns
 	if (hackBuf1 == NULL && hackBuf2 == NULL)
 	{
 		/* TODO: * 4 causes crashes on some files */
-		g_vBackBuf1 = g_vBuffers = (uint8_t*)mem_malloc(g_width * g_height * 8);
+		g_vBackBuf1 = g_vBuffers = (uint8_t*)mem_malloc_tag(g_width * g_height * 8, MEM_TAG_MOVIE);
 		if (truecolor)
 		{
 			g_vBackBuf2 = (unsigned short*)g_vBackBuf1 + (g_width * g_height);
@@ -347,33 +407,47 @@ static int create_videobuf_handler(unsigned char major, unsigned char minor, uns
 static mve_cb_ShowFrame* ShowFrameCallback = NULL;
 static mve_cb_SetPalette* SetPaletteCallback = NULL;
 
-static int display_video_handler(unsigned char major, unsigned char minor, unsigned char *data, int len, void *context)
+static void show_frame(uint8_t* pixels, int width, int height, int screen_width, int screen_height, unsigned char* palette)
 {
+	if (g_destX == -1) // center it
+		g_destX = (screen_width - width) >> 1;
+	if (g_destY == -1) // center it
+		g_destY = (screen_height - height) >> 1;
+
 	if (ShowFrameCallback == NULL)
 	{
 		grs_bitmap* bitmap;
 
-		bitmap = gr_create_bitmap_raw(g_width, g_height, (uint8_t*)g_vBackBuf1);
-
-		if (g_destX == -1) // center it
-			g_destX = (g_screenWidth - g_width) >> 1;
-		if (g_destY == -1) // center it
-			g_destY = (g_screenHeight - g_height) >> 1;
+		bitmap = gr_create_bitmap_raw(width, height, pixels);
 
-		gr_palette_load(g_palette);
+		gr_palette_load(palette);
 
 		gr_bitmap(g_destX, g_destY, bitmap);
 
 		gr_free_sub_bitmap(bitmap);
 	}
 	else
+		(*ShowFrameCallback)(pixels, width, height, 0, 0, width, height, g_destX, g_destY);
+}
+
+static int display_video_handler(unsigned char major, unsigned char minor, unsigned char *data, int len, void *context)
+{
+	if (mve_record_slot)
 	{
-		if (g_destX == -1) // center it
-			g_destX = (g_screenWidth - g_width) >> 1;
-		if (g_destY == -1) // center it
-			g_destY = (g_screenHeight - g_height) >> 1;
-		(*ShowFrameCallback)((uint8_t*)g_vBackBuf1, g_width, g_height, 0, 0, g_width, g_height, g_destX, g_destY);
+		mve_slot* slot = mve_record_slot;
+		int size = g_width * g_height * (g_truecolor ? 2 : 1);
+
+		slot->pixels.assign((uint8_t*)g_vBackBuf1, (uint8_t*)g_vBackBuf1 + size);
+		slot->width = g_width;
+		slot->height = g_height;
+		slot->truecolor = g_truecolor;
+		slot->screen_width = g_screenWidth;
+		slot->screen_height = g_screenHeight;
+		slot->frame_delay = micro_frame_delay;
+		slot->has_frame = 1;
 	}
+	else
+		show_frame((uint8_t*)g_vBackBuf1, g_width, g_height, g_screenWidth, g_screenHeight, g_palette);
 	g_frameUpdated = 1;
 
 	return 1;
@@ -407,7 +481,22 @@ static int video_palette_handler(unsigned char major, unsigned char minor, unsig
 	short start, count;
 	start = get_short(data);
 	count = get_short(data+2);
-	if (SetPaletteCallback == NULL)
+	if (mve_record_slot)
+	{
+		//g_palette belongs to the decoding thread now, and is copied into the slot when it's done
+		memcpy(g_palette + 3 * start, data + 4, 3 * count);
+		if (mve_record_slot->pal_end == mve_record_slot->pal_start)
+		{
+			mve_record_slot->pal_start = start;
+			mve_record_slot->pal_end = start + count;
+		}
+		else
+		{
+			mve_record_slot->pal_start = MIN(mve_record_slot->pal_start, start);
+			mve_record_slot->pal_end = MAX(mve_record_slot->pal_end, start + count);
+		}
+	}
+	else if (SetPaletteCallback == NULL)
 		memcpy(g_palette + 3 * start, data + 4, 3 * count);
 	else
 	{
@@ -466,10 +555,228 @@ static int end_chunk_handler(unsigned char major, unsigned char minor, unsigned
 
 static MVESTREAM *mve = NULL;
 
-int MVE_rmPrepMovie(int filehandle, int x, int y, int track)
+static void mve_set_handlers(MVESTREAM* stream)
 {
 	int i;
 
+	for (i = 0; i < 32; i++)
+		mve_set_handler(stream, i, default_seg_handler);
+
+	mve_set_handler(stream, MVE_OPCODE_ENDOFSTREAM,          end_movie_handler);
+	mve_set_handler(stream, MVE_OPCODE_ENDOFCHUNK,           end_chunk_handler);
+	mve_set_handler(stream, MVE_OPCODE_CREATETIMER,          create_timer_handler);
+	mve_set_handler(stream, MVE_OPCODE_INITAUDIOBUFFERS,     create_audiobuf_handler);
+	mve_set_handler(stream, MVE_OPCODE_STARTSTOPAUDIO,       play_audio_handler);
+	mve_set_handler(stream, MVE_OPCODE_INITVIDEOBUFFERS,     create_videobuf_handler);
+
+	mve_set_handler(stream, MVE_OPCODE_DISPLAYVIDEO,         display_video_handler);
+	mve_set_handler(stream, MVE_OPCODE_AUDIOFRAMEDATA,       audio_data_handler);
+	mve_set_handler(stream, MVE_OPCODE_AUDIOFRAMESILENCE,    audio_data_handler);
+	mve_set_handler(stream, MVE_OPCODE_INITVIDEOMODE,        init_video_handler);
+
+	mve_set_handler(stream, MVE_OPCODE_SETPALETTE,           video_palette_handler);
+	mve_set_handler(stream, MVE_OPCODE_SETPALETTECOMPRESSED, default_seg_handler);
+
+	mve_set_handler(stream, MVE_OPCODE_SETDECODINGMAP,       video_codemap_handler);
+
+	mve_set_handler(stream, MVE_OPCODE_VIDEODATA,            video_data_handler);
+}
+
+/*************************
+ * decoding thread
+ *************************/
+static void decode_thread_main()
+{
+	mve_slot* slot;
+	int cont = 1;
+
+	while (cont)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mve_slot_mutex);
+			mve_slot_cv.wait(lock, [] { return mve_decode_stop || mve_slot_count < MVE_NUM_SLOTS; });
+			if (mve_decode_stop)
+				return;
+			slot = &mve_slots[(mve_slot_head + mve_slot_count) % MVE_NUM_SLOTS];
+		}
+
+		slot->has_frame = slot->end_of_stream = 0;
+		slot->pal_start = slot->pal_end = 0;
+		slot->audio_init = 0;
+		slot->audio_data.clear();
+		slot->audio_lengths.clear();
+
+		mve_record_slot = slot;
+		while (cont && !g_frameUpdated) // a slot is a frame, same as a step
+			cont = mve_play_next_chunk(mve);
+		mve_record_slot = NULL;
+		g_frameUpdated = 0;
+
+		memcpy(slot->palette, g_palette, sizeof(slot->palette));
+		slot->end_of_stream = !cont;
+
+		{
+			std::unique_lock<std::mutex> lock(mve_slot_mutex);
+			mve_slot_count++;
+		}
+		mve_slot_cv.notify_all();
+	}
+}
+
+static void start_decoding()
+{
+	mve_slot_head = mve_slot_count = 0;
+	mve_decode_stop = false;
+	mve_decode_thread = std::thread(decode_thread_main);
+	mve_decode_running = true;
+}
+
+static void stop_decoding()
+{
+	if (!mve_decode_running)
+		return;
+
+	{
+		std::unique_lock<std::mutex> lock(mve_slot_mutex);
+		mve_decode_stop = true;
+	}
+	mve_slot_cv.notify_all();
+	mve_decode_thread.join();
+	mve_decode_running = false;
+	mve_slot_head = mve_slot_count = 0;
+}
+
+//Waits for the decoding thread to fill the next slot, and returns it. Call release_slot when done with it.
+static mve_slot* next_slot()
+{
+	std::unique_lock<std::mutex> lock(mve_slot_mutex);
+	mve_slot_cv.wait(lock, [] { return mve_slot_count > 0; });
+	return &mve_slots[mve_slot_head];
+}
+
+static void release_slot()
+{
+	{
+		std::unique_lock<std::mutex> lock(mve_slot_mutex);
+		mve_slot_head = (mve_slot_head + 1) % MVE_NUM_SLOTS;
+		mve_slot_count--;
+	}
+	mve_slot_cv.notify_all();
+}
+
+/*************************
+ * movie clock
+ *************************/
+//How far the clock can drift from the audio before it's pulled back in step.
+//The backends only update their position once per mix, so following it exactly would make frames jitter.
+#define MVE_CLOCK_SLOP 10000
+
+static int clock_started = 0;
+static uint64_t clock_base; //wall clock time when the movie clock was at 0
+static int64_t clock_last_audio;
+static uint64_t clock_hold_time;
+static int frames_shown;
+
+//Returns the time into the movie, in microseconds. This follows the audio while it's playing, and the wall clock when there is none.
+static uint64_t movie_clock()
+{
+	uint64_t now = GetClockTimeUS();
+
+	//The speed factor stretches the frame delay but not the audio, so the audio can't be the clock then.
+	if (mve_audio_canplay && g_spdFactorNum == 0)
+	{
+		int64_t audio = mvesnd_get_position();
+		if (audio >= 0 && audio != clock_last_audio)
+		{
+			int64_t drift = (int64_t)(now - clock_base) - audio;
+			if (drift > MVE_CLOCK_SLOP || drift < -MVE_CLOCK_SLOP)
+				clock_base = now - audio;
+			clock_last_audio = audio;
+		}
+	}
+
+	return now - clock_base;
+}
+
+static void wait_for_clock(uint64_t time)
+{
+	uint64_t now;
+	while ((now = movie_clock()) < time)
+	{
+		if (time - now > 2000) //[ISB] again inspired by dpJudas, with 2000 US number from GZDoom
+			I_DelayUS(time - now - 2000);
+	}
+}
+
+static int step_threaded()
+{
+	mve_slot* slot;
+	unsigned char* audio;
+	int i, end_of_stream;
+
+	if (!mve_decode_running)
+		start_decoding();
+
+	slot = next_slot();
+
+	if (slot->audio_init && !mve_audio_canplay)
+	{
+		mvesnd_init_audio(slot->audio_format, slot->audio_rate, slot->audio_stereo);
+		mve_audio_canplay = 1;
+	}
+	if (mve_audio_canplay)
+	{
+		audio = slot->audio_data.data();
+		for (i = 0; i < (int)slot->audio_lengths.size(); i++)
+		{
+			mvesnd_queue_audio_buffer(slot->audio_lengths[i], (short*)audio);
+			audio += slot->audio_lengths[i];
+		}
+	}
+
+	if (slot->pal_end > slot->pal_start && SetPaletteCallback != NULL)
+		(*SetPaletteCallback)(slot->palette, slot->pal_start, slot->pal_end - slot->pal_start);
+
+	if (mve_audio_paused)
+	{
+		mve_audio_paused = 0;
+		mvesnd_resume();
+		if (clock_started)
+			clock_base += GetClockTimeUS() - clock_hold_time;
+	}
+
+	if (slot->has_frame)
+	{
+		if (!clock_started)
+		{
+			clock_base = GetClockTimeUS();
+			clock_last_audio = -1;
+			frames_shown = 0;
+			clock_started = 1;
+		}
+
+		wait_for_clock((uint64_t)frames_shown * slot->frame_delay);
+		show_frame(slot->pixels.data(), slot->width, slot->height, slot->screen_width, slot->screen_height, slot->palette);
+		frames_shown++;
+	}
+
+	end_of_stream = slot->end_of_stream;
+	release_slot();
+
+	if (end_of_stream)
+	{
+		//Join the thread now, so the caller can rewind the file and play it again
+		stop_decoding();
+		return MVE_ERR_EOF;
+	}
+	return 0;
+}
+
+int MVE_rmPrepMovie(int filehandle, int x, int y, int track)
+{
+	stop_decoding();
+	clock_started = 0;
+
 	if (mve) 
 	{
 		mve_reset(mve);
@@ -477,6 +784,7 @@ int MVE_rmPrepMovie(int filehandle, int x, int y, int track)
 	}
 	//[ISB] make sure it doesn't try to play sound if the previous movie had sound but this one doesn't
 	mve_audio_canplay = 0;
+	audiobuf_created = 0;
 
 	mve = mve_open_filehandle(filehandle);
 
@@ -486,27 +794,8 @@ int MVE_rmPrepMovie(int filehandle, int x, int y, int track)
 	g_destX = x;
 	g_destY = y;
 
-	for (i = 0; i < 32; i++)
-		mve_set_handler(mve, i, default_seg_handler);
-
-	mve_set_handler(mve, MVE_OPCODE_ENDOFSTREAM,          end_movie_handler);
-	mve_set_handler(mve, MVE_OPCODE_ENDOFCHUNK,           end_chunk_handler);
-	mve_set_handler(mve, MVE_OPCODE_CREATETIMER,          create_timer_handler);
-	mve_set_handler(mve, MVE_OPCODE_INITAUDIOBUFFERS,     create_audiobuf_handler);
-	mve_set_handler(mve, MVE_OPCODE_STARTSTOPAUDIO,       play_audio_handler);
-	mve_set_handler(mve, MVE_OPCODE_INITVIDEOBUFFERS,     create_videobuf_handler);
-
-	mve_set_handler(mve, MVE_OPCODE_DISPLAYVIDEO,         display_video_handler);
-	mve_set_handler(mve, MVE_OPCODE_AUDIOFRAMEDATA,       audio_data_handler);
-	mve_set_handler(mve, MVE_OPCODE_AUDIOFRAMESILENCE,    audio_data_handler);
-	mve_set_handler(mve, MVE_OPCODE_INITVIDEOMODE,        init_video_handler);
-
-	mve_set_handler(mve, MVE_OPCODE_SETPALETTE,           video_palette_handler);
-	mve_set_handler(mve, MVE_OPCODE_SETPALETTECOMPRESSED, default_seg_handler);
-
-	mve_set_handler(mve, MVE_OPCODE_SETDECODINGMAP,       video_codemap_handler);
-
-	mve_set_handler(mve, MVE_OPCODE_VIDEODATA,            video_data_handler);
+	mve_threaded = hackBuf1 == NULL && hackBuf2 == NULL;
+	mve_set_handlers(mve);
 
 	return 0;
 }
@@ -516,6 +805,9 @@ int MVE_rmStepMovie()
 	static int init_timer=0;
 	int cont=1;
 
+	if (mve_threaded)
+		return step_threaded();
+
 	if (!timer_started)
 		timer_start();
 
@@ -544,7 +836,7 @@ int MVE_rmStepMovie()
 		return MVE_ERR_EOF;
 }
 
-void MVE_rmEndMovie()
+static void free_movie()
 {
 	timer_stop();
 	timer_created = 0;
@@ -556,9 +848,17 @@ void MVE_rmEndMovie()
 	g_nMapLength=0;
 	videobuf_created = 0;
 	video_initialized = 0;
+	audiobuf_created = 0;
+	clock_started = 0;
 
 	mve_close_filehandle(mve);
 	mve = NULL;
+}
+
+void MVE_rmEndMovie()
+{
+	stop_decoding();
+	free_movie();
 
 	if (mve_audio_canplay)
 		mvesnd_close();
@@ -568,10 +868,48 @@ void MVE_rmEndMovie()
 void MVE_rmHoldMovie()
 {
 	timer_started = 0;
+	clock_hold_time = GetClockTimeUS();
 	mvesnd_pause();
 	mve_audio_paused = 1;
 }
 
+int MVE_rmBenchmark(int filehandle, int* frames, uint64_t* microseconds)
+{
+	mve_slot* slot;
+	uint64_t start;
+	int end_of_stream;
+
+	*frames = 0;
+	*microseconds = 0;
+
+	if (mve)
+		return 1;
+
+	mve = mve_open_filehandle(filehandle);
+	if (!mve)
+		return 1;
+
+	mve_audio_canplay = 0;
+	mve_set_handlers(mve);
+
+	//Run the same decode-ahead as playback, but take the frames as soon as they're ready and throw them away
+	start = GetClockTimeUS();
+	start_decoding();
+	do
+	{
+		slot = next_slot();
+		if (slot->has_frame)
+			(*frames)++;
+		end_of_stream = slot->end_of_stream;
+		release_slot();
+	} while (!end_of_stream);
+	stop_decoding();
+	*microseconds = GetClockTimeUS() - start;
+
+	free_movie();
+	return 0;
+}
+
 void MVE_memVID(void* first, void* second, size_t len)
 {
 	hackBuf1 = first;
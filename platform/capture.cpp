@@ -0,0 +1,685 @@
+/*
+The code contained in this file is not the property of Parallax Software,
+and is not under the terms of the Parallax Software Source license.
+Instead, it is released under the terms of the MIT License,
+as described in copying.txt
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "platform/capture.h"
+#include "platform/timer.h"
+#include "platform/mono.h"
+#include "platform/posixstub.h"
+
+//Raw capture file layout, all little endian:
+//	"DCAP", uint32 version, uint32 fps, uint32 audio sample rate (0 if no audio)
+//	followed by chunks of a fourcc, a uint32 size and then the data:
+//	"PAL " 768 bytes of 8-bit RGB, whenever the palette changes
+//	"FRAM" uint16 width, uint16 height, then width * height palette indices
+//	"AUDI" interleaved stereo signed 16-bit samples
+#define CAPTURE_RAW_VERSION 1
+
+#define CAPTURE_QUEUE_FRAMES 32
+#define CAPTURE_AUDIO_BUFFER (1 << 18)		//in samples, a bit over two seconds of stereo at 48khz
+
+//RIFF sizes are 32-bit, and a lot of readers treat them as signed.
+#define AVI_MAX_SIZE 0x7F000000u
+
+namespace
+{
+	struct CaptureFrame
+	{
+		std::vector<uint8_t> pixels;
+		int width, height;
+		uint8_t palette[768];
+		uint64_t timestamp;
+	};
+
+	struct AviIndexEntry
+	{
+		uint32_t id;
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	//Both queues have a single producer and a single consumer. The producer owns head, the consumer owns tail.
+	CaptureFrame frame_queue[CAPTURE_QUEUE_FRAMES];
+	std::atomic<uint32_t> frame_head, frame_tail;
+
+	float audio_queue[CAPTURE_AUDIO_BUFFER];
+	std::atomic<uint32_t> audio_head, audio_tail;
+
+	std::atomic<bool> capturing;
+	std::atomic<bool> stop_flag;
+	std::atomic<int> audio_rate;
+	std::thread encoder_thread;
+
+	int dropped_frames, dropped_audio;
+
+	//Encoder state, only touched by the encoder thread once it's running
+	FILE* fp;
+	FILE* wav_fp;
+	int format;
+	int out_width, out_height;
+	int out_fps;
+	int out_audio_rate;
+	uint64_t first_timestamp;
+	uint32_t frames_written;
+	uint32_t audio_samples_written;
+	uint8_t last_palette[768];
+	bool have_palette;
+	bool write_error;
+	std::vector<uint8_t> out_buffer;
+	std::vector<int16_t> audio_buffer;
+
+	//AVI
+	long avi_riff_size_pos, avi_total_frames_pos, avi_video_length_pos, avi_audio_length_pos, avi_movi_size_pos, avi_movi_start;
+	std::vector<AviIndexEntry> avi_index;
+
+	//WAV, for Y4M
+	long wav_riff_size_pos, wav_data_size_pos;
+
+	void write_le32(FILE* f, uint32_t v)
+	{
+		uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+		fwrite(b, 1, 4, f);
+	}
+
+	void write_le16(FILE* f, uint16_t v)
+	{
+		uint8_t b[2] = { (uint8_t)v, (uint8_t)(v >> 8) };
+		fwrite(b, 1, 2, f);
+	}
+
+	void write_fourcc(FILE* f, const char* id)
+	{
+		fwrite(id, 1, 4, f);
+	}
+
+	uint32_t fourcc(const char* id)
+	{
+		return (uint32_t)id[0] | ((uint32_t)id[1] << 8) | ((uint32_t)id[2] << 16) | ((uint32_t)id[3] << 24);
+	}
+
+	void patch_le32(FILE* f, long pos, uint32_t v)
+	{
+		long cur = ftell(f);
+		fseek(f, pos, SEEK_SET);
+		write_le32(f, v);
+		fseek(f, cur, SEEK_SET);
+	}
+
+	inline uint8_t expand6(uint8_t v)
+	{
+		return (v << 2) | (v >> 4);
+	}
+
+	//-----------------------------------------------------------------------------
+	// Raw
+	//-----------------------------------------------------------------------------
+
+	void raw_write_header()
+	{
+		write_fourcc(fp, "DCAP");
+		write_le32(fp, CAPTURE_RAW_VERSION);
+		write_le32(fp, out_fps);
+		write_le32(fp, out_audio_rate);
+	}
+
+	void raw_write_frame(CaptureFrame& frame)
+	{
+		int i;
+		if (!have_palette || memcmp(last_palette, frame.palette, 768))
+		{
+			uint8_t pal[768];
+			for (i = 0; i < 768; i++)
+				pal[i] = expand6(frame.palette[i]);
+
+			write_fourcc(fp, "PAL ");
+			write_le32(fp, 768);
+			fwrite(pal, 1, 768, fp);
+		}
+
+		write_fourcc(fp, "FRAM");
+		write_le32(fp, 4 + frame.width * frame.height);
+		write_le16(fp, frame.width);
+		write_le16(fp, frame.height);
+		fwrite(frame.pixels.data(), 1, frame.width * frame.height, fp);
+	}
+
+	void raw_write_audio(const int16_t* samples, int count)
+	{
+		write_fourcc(fp, "AUDI");
+		write_le32(fp, count * 2);
+		fwrite(samples, 2, count, fp);
+	}
+
+	//-----------------------------------------------------------------------------
+	// AVI
+	//-----------------------------------------------------------------------------
+
+	void avi_write_header()
+	{
+		long list_pos;
+		uint32_t frame_size = out_width * out_height * 3;
+
+		write_fourcc(fp, "RIFF");
+		avi_riff_size_pos = ftell(fp);
+		write_le32(fp, 0);
+		write_fourcc(fp, "AVI ");
+
+		write_fourcc(fp, "LIST");
+		list_pos = ftell(fp);
+		write_le32(fp, 0);
+		write_fourcc(fp, "hdrl");
+
+		write_fourcc(fp, "avih");
+		write_le32(fp, 56);
+		write_le32(fp, 1000000 / out_fps);		//microseconds per frame
+		write_le32(fp, frame_size * out_fps + out_audio_rate * 4);
+		write_le32(fp, 0);						//padding granularity
+		write_le32(fp, 0x10);					//AVIF_HASINDEX
+		avi_total_frames_pos = ftell(fp);
+		write_le32(fp, 0);
+		write_le32(fp, 0);						//initial frames
+		write_le32(fp, out_audio_rate ? 2 : 1);
+		write_le32(fp, frame_size);
+		write_le32(fp, out_width);
+		write_le32(fp, out_height);
+		write_le32(fp, 0); write_le32(fp, 0); write_le32(fp, 0); write_le32(fp, 0);
+
+		//video stream
+		write_fourcc(fp, "LIST");
+		write_le32(fp, 4 + 8 + 56 + 8 + 40);
+		write_fourcc(fp, "strl");
+
+		write_fourcc(fp, "strh");
+		write_le32(fp, 56);
+		write_fourcc(fp, "vids");
+		write_fourcc(fp, "DIB ");
+		write_le32(fp, 0);						//flags
+		write_le16(fp, 0); write_le16(fp, 0);	//priority, language
+		write_le32(fp, 0);						//initial frames
+		write_le32(fp, 1);						//scale
+		write_le32(fp, out_fps);				//rate
+		write_le32(fp, 0);						//start
+		avi_video_length_pos = ftell(fp);
+		write_le32(fp, 0);
+		write_le32(fp, frame_size);
+		write_le32(fp, 0xFFFFFFFF);				//quality
+		write_le32(fp, 0);						//sample size
+		write_le16(fp, 0); write_le16(fp, 0); write_le16(fp, out_width); write_le16(fp, out_height);
+
+		write_fourcc(fp, "strf");
+		write_le32(fp, 40);
+		write_le32(fp, 40);
+		write_le32(fp, out_width);
+		write_le32(fp, out_height);				//positive height, so rows go bottom up
+		write_le16(fp, 1);
+		write_le16(fp, 24);
+		write_le32(fp, 0);						//BI_RGB
+		write_le32(fp, frame_size);
+		write_le32(fp, 0); write_le32(fp, 0); write_le32(fp, 0); write_le32(fp, 0);
+
+		//audio stream
+		if (out_audio_rate)
+		{
+			write_fourcc(fp, "LIST");
+			write_le32(fp, 4 + 8 + 56 + 8 + 16);
+			write_fourcc(fp, "strl");
+
+			write_fourcc(fp, "strh");
+			write_le32(fp, 56);
+			write_fourcc(fp, "auds");
+			write_le32(fp, 0);
+			write_le32(fp, 0);
+			write_le16(fp, 0); write_le16(fp, 0);
+			write_le32(fp, 0);
+			write_le32(fp, 4);						//scale, the block size
+			write_le32(fp, out_audio_rate * 4);		//rate, bytes per second
+			write_le32(fp, 0);
+			avi_audio_length_pos = ftell(fp);
+			write_le32(fp, 0);
+			write_le32(fp, out_audio_rate);
+			write_le32(fp, 0xFFFFFFFF);
+			write_le32(fp, 4);
+			write_le16(fp, 0); write_le16(fp, 0); write_le16(fp, 0); write_le16(fp, 0);
+
+			write_fourcc(fp, "strf");
+			write_le32(fp, 16);
+			write_le16(fp, 1);						//WAVE_FORMAT_PCM
+			write_le16(fp, 2);
+			write_le32(fp, out_audio_rate);
+			write_le32(fp, out_audio_rate * 4);
+			write_le16(fp, 4);
+			write_le16(fp, 16);
+		}
+
+		patch_le32(fp, list_pos, ftell(fp) - list_pos - 4);
+
+		write_fourcc(fp, "LIST");
+		avi_movi_size_pos = ftell(fp);
+		write_le32(fp, 0);
+		avi_movi_start = ftell(fp);
+		write_fourcc(fp, "movi");
+	}
+
+	bool avi_write_chunk(const char* id, const void* data, uint32_t size)
+	{
+		AviIndexEntry entry;
+
+		if ((uint32_t)ftell(fp) + size + 8 + (avi_index.size() + 1) * 16 > AVI_MAX_SIZE)
+		{
+			if (!write_error)
+				mprintf((1, "capture: AVI file is full, no longer writing\n"));
+			write_error = true;
+			return false;
+		}
+
+		entry.id = fourcc(id);
+		entry.offset = ftell(fp) - avi_movi_start;
+		entry.size = size;
+		avi_index.push_back(entry);
+
+		write_fourcc(fp, id);
+		write_le32(fp, size);
+		fwrite(data, 1, size, fp);
+		if (size & 1)
+			fputc(0, fp);
+
+		return true;
+	}
+
+	void avi_write_frame(CaptureFrame& frame)
+	{
+		int x, y;
+		int w = std::min(frame.width, out_width), h = std::min(frame.height, out_height);
+		uint8_t pal[768];
+		uint8_t* dest;
+		const uint8_t* src;
+
+		for (x = 0; x < 768; x++)
+			pal[x] = expand6(frame.palette[x]);
+
+		out_buffer.assign(out_width * out_height * 3, 0);
+		for (y = 0; y < h; y++)
+		{
+			src = &frame.pixels[y * frame.width];
+			dest = &out_buffer[(out_height - 1 - y) * out_width * 3];
+			for (x = 0; x < w; x++)
+			{
+				const uint8_t* c = &pal[src[x] * 3];
+				*dest++ = c[2];
+				*dest++ = c[1];
+				*dest++ = c[0];
+			}
+		}
+
+		avi_write_chunk("00db", out_buffer.data(), out_buffer.size());
+	}
+
+	void avi_write_audio(const int16_t* samples, int count)
+	{
+		avi_write_chunk("01wb", samples, count * 2);
+	}
+
+	void avi_finish()
+	{
+		uint32_t video_frames = 0, audio_bytes = 0;
+
+		patch_le32(fp, avi_movi_size_pos, ftell(fp) - avi_movi_size_pos - 4);
+
+		write_fourcc(fp, "idx1");
+		write_le32(fp, avi_index.size() * 16);
+		for (AviIndexEntry& entry : avi_index)
+		{
+			write_le32(fp, entry.id);
+			write_le32(fp, entry.id == fourcc("00db") ? 0x10 : 0);		//video frames are all keyframes
+			write_le32(fp, entry.offset);
+			write_le32(fp, entry.size);
+
+			if (entry.id == fourcc("00db"))
+				video_frames++;
+			else
+				audio_bytes += entry.size;
+		}
+
+		patch_le32(fp, avi_riff_size_pos, ftell(fp) - 8);
+		patch_le32(fp, avi_total_frames_pos, video_frames);
+		patch_le32(fp, avi_video_length_pos, video_frames);
+		if (out_audio_rate)
+			patch_le32(fp, avi_audio_length_pos, audio_bytes / 4);
+	}
+
+	//-----------------------------------------------------------------------------
+	// Y4M, and a WAV for its audio
+	//-----------------------------------------------------------------------------
+
+	void y4m_write_header()
+	{
+		fprintf(fp, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", out_width, out_height, out_fps);
+	}
+
+	void y4m_write_frame(CaptureFrame& frame)
+	{
+		int x, y, i;
+		int w = std::min(frame.width, out_width), h = std::min(frame.height, out_height);
+		int lum[256], cb[256], cr[256];
+		uint8_t* yplane, * uplane, * vplane;
+
+		//Full range BT.601, in 16.16
+		for (i = 0; i < 256; i++)
+		{
+			int r = expand6(frame.palette[i * 3]), g = expand6(frame.palette[i * 3 + 1]), b = expand6(frame.palette[i * 3 + 2]);
+			lum[i] = 19595 * r + 38470 * g + 7471 * b;
+			cb[i] = (128 << 16) - 11059 * r - 21709 * g + 32768 * b;
+			cr[i] = (128 << 16) + 32768 * r - 27439 * g - 5329 * b;
+		}
+
+		out_buffer.assign(out_width * out_height * 3 / 2, 0);
+		yplane = out_buffer.data();
+		uplane = yplane + out_width * out_height;
+		vplane = uplane + (out_width / 2) * (out_height / 2);
+		memset(uplane, 128, (out_width / 2) * (out_height / 2) * 2);
+
+		for (y = 0; y < h; y++)
+		{
+			const uint8_t* src = &frame.pixels[y * frame.width];
+			for (x = 0; x < w; x++)
+				yplane[y * out_width + x] = (uint8_t)(lum[src[x]] >> 16);
+		}
+
+		for (y = 0; y < h / 2; y++)
+		{
+			const uint8_t* src0 = &frame.pixels[y * 2 * frame.width];
+			const uint8_t* src1 = src0 + frame.width;
+			for (x = 0; x < w / 2; x++)
+			{
+				int p0 = src0[x * 2], p1 = src0[x * 2 + 1], p2 = src1[x * 2], p3 = src1[x * 2 + 1];
+				uplane[y * (out_width / 2) + x] = (uint8_t)std::min(std::max((cb[p0] + cb[p1] + cb[p2] + cb[p3]) >> 18, 0), 255);
+				vplane[y * (out_width / 2) + x] = (uint8_t)std::min(std::max((cr[p0] + cr[p1] + cr[p2] + cr[p3]) >> 18, 0), 255);
+			}
+		}
+
+		fputs("FRAME\n", fp);
+		fwrite(out_buffer.data(), 1, out_buffer.size(), fp);
+	}
+
+	void wav_write_header()
+	{
+		write_fourcc(wav_fp, "RIFF");
+		wav_riff_size_pos = ftell(wav_fp);
+		write_le32(wav_fp, 0);
+		write_fourcc(wav_fp, "WAVE");
+		write_fourcc(wav_fp, "fmt ");
+		write_le32(wav_fp, 16);
+		write_le16(wav_fp, 1);
+		write_le16(wav_fp, 2);
+		write_le32(wav_fp, out_audio_rate);
+		write_le32(wav_fp, out_audio_rate * 4);
+		write_le16(wav_fp, 4);
+		write_le16(wav_fp, 16);
+		write_fourcc(wav_fp, "data");
+		wav_data_size_pos = ftell(wav_fp);
+		write_le32(wav_fp, 0);
+	}
+
+	void wav_finish()
+	{
+		patch_le32(wav_fp, wav_data_size_pos, audio_samples_written * 2);
+		patch_le32(wav_fp, wav_riff_size_pos, ftell(wav_fp) - 8);
+	}
+
+	//-----------------------------------------------------------------------------
+	// Encoder thread
+	//-----------------------------------------------------------------------------
+
+	void write_frame(CaptureFrame& frame)
+	{
+		switch (format)
+		{
+		case CAPTURE_FORMAT_AVI: avi_write_frame(frame); break;
+		case CAPTURE_FORMAT_Y4M: y4m_write_frame(frame); break;
+		default: raw_write_frame(frame); break;
+		}
+
+		memcpy(last_palette, frame.palette, 768);
+		have_palette = true;
+		frames_written++;
+	}
+
+	//The file runs at a fixed rate, but the game doesn't. Frames get repeated or skipped to keep in step
+	//with when they were captured. After a long gap, such as sitting in a menu, the clock is moved up instead.
+	void encode_frame(CaptureFrame& frame)
+	{
+		uint64_t target;
+
+		if (frames_written == 0)
+			first_timestamp = frame.timestamp;
+
+		target = (frame.timestamp - first_timestamp) * out_fps / 1000000 + 1;
+		if (target > frames_written + out_fps)
+		{
+			first_timestamp = frame.timestamp - (uint64_t)frames_written * 1000000 / out_fps;
+			target = frames_written + 1;
+		}
+
+		while (frames_written < target && !write_error)
+			write_frame(frame);
+	}
+
+	bool encode_audio()
+	{
+		uint32_t head = audio_head.load(std::memory_order_acquire);
+		uint32_t tail = audio_tail.load(std::memory_order_relaxed);
+		uint32_t count = head - tail, i;
+
+		if (count == 0)
+			return false;
+
+		audio_buffer.resize(count);
+		for (i = 0; i < count; i++)
+		{
+			float sample = audio_queue[(tail + i) & (CAPTURE_AUDIO_BUFFER - 1)];
+			sample = std::max(sample, -1.0f);
+			sample = std::min(sample, 1.0f);
+			audio_buffer[i] = (int16_t)(sample * 32767.0f);
+		}
+		audio_tail.store(head, std::memory_order_release);
+
+		if (!out_audio_rate)
+			return true;
+
+		switch (format)
+		{
+		case CAPTURE_FORMAT_AVI: avi_write_audio(audio_buffer.data(), count); break;
+		case CAPTURE_FORMAT_Y4M: if (wav_fp) fwrite(audio_buffer.data(), 2, count, wav_fp); break;
+		default: raw_write_audio(audio_buffer.data(), count); break;
+		}
+		audio_samples_written += count;
+
+		return true;
+	}
+
+	void encoder_main()
+	{
+		for (;;)
+		{
+			bool did_work = encode_audio();
+
+			uint32_t tail = frame_tail.load(std::memory_order_relaxed);
+			if (tail != frame_head.load(std::memory_order_acquire))
+			{
+				encode_frame(frame_queue[tail % CAPTURE_QUEUE_FRAMES]);
+				frame_tail.store(tail + 1, std::memory_order_release);
+				did_work = true;
+			}
+
+			if (!did_work)
+			{
+				if (stop_flag.load(std::memory_order_acquire))
+					break;
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			}
+		}
+
+		if (format == CAPTURE_FORMAT_AVI)
+			avi_finish();
+		if (wav_fp)
+		{
+			wav_finish();
+			fclose(wav_fp);
+			wav_fp = nullptr;
+		}
+
+		if (ferror(fp))
+			mprintf((1, "capture: error writing file\n"));
+		fclose(fp);
+		fp = nullptr;
+	}
+}
+
+int capture_format_from_filename(const char* filename)
+{
+	const char* ext = strrchr(filename, '.');
+
+	if (ext && !_stricmp(ext, ".avi"))
+		return CAPTURE_FORMAT_AVI;
+	if (ext && !_stricmp(ext, ".y4m"))
+		return CAPTURE_FORMAT_Y4M;
+	return CAPTURE_FORMAT_RAW;
+}
+
+int capture_start(const char* filename, int fmt, int width, int height, int fps)
+{
+	if (capturing || encoder_thread.joinable())
+		return 1;
+
+	fp = fopen(filename, "wb");
+	if (!fp)
+		return 1;
+
+	format = fmt;
+	out_width = width;
+	out_height = height;
+	out_fps = std::max(fps, 1);
+	out_audio_rate = audio_rate;
+	frames_written = 0;
+	audio_samples_written = 0;
+	have_palette = false;
+	write_error = false;
+	dropped_frames = dropped_audio = 0;
+	avi_index.clear();
+
+	frame_head = frame_tail = 0;
+	audio_head = audio_tail = 0;
+	stop_flag = false;
+
+	switch (format)
+	{
+	case CAPTURE_FORMAT_AVI:
+		avi_write_header();
+		break;
+	case CAPTURE_FORMAT_Y4M:
+		//4:2:0 needs even dimensions
+		out_width &= ~1;
+		out_height &= ~1;
+		y4m_write_header();
+		if (out_audio_rate)
+		{
+			char wavname[260];
+			snprintf(wavname, sizeof(wavname), "%s.wav", filename);
+			wav_fp = fopen(wavname, "wb");
+			if (wav_fp)
+				wav_write_header();
+		}
+		break;
+	default:
+		format = CAPTURE_FORMAT_RAW;
+		raw_write_header();
+		break;
+	}
+
+	capturing = true;
+	encoder_thread = std::thread(encoder_main);
+
+	mprintf((0, "capture: started %s, %dx%d at %d fps, audio at %d hz\n", filename, out_width, out_height, out_fps, out_audio_rate));
+	return 0;
+}
+
+void capture_stop()
+{
+	if (!encoder_thread.joinable())
+		return;
+
+	capturing = false;
+	stop_flag.store(true, std::memory_order_release);
+	encoder_thread.join();
+
+	mprintf((0, "capture: stopped, %u frames written, %d frames and %d audio samples dropped\n", frames_written, dropped_frames, dropped_audio));
+}
+
+int capture_active()
+{
+	return capturing;
+}
+
+void capture_frame(const uint8_t* pixels, int width, int height, int pitch, const uint8_t* palette)
+{
+	uint32_t head, y;
+	CaptureFrame* frame;
+
+	if (!capturing)
+		return;
+
+	head = frame_head.load(std::memory_order_relaxed);
+	if (head - frame_tail.load(std::memory_order_acquire) >= CAPTURE_QUEUE_FRAMES)
+	{
+		dropped_frames++;
+		return;
+	}
+
+	frame = &frame_queue[head % CAPTURE_QUEUE_FRAMES];
+	frame->width = width;
+	frame->height = height;
+	frame->timestamp = I_GetUS();
+	frame->pixels.resize(width * height);
+	for (y = 0; y < (uint32_t)height; y++)
+		memcpy(&frame->pixels[y * width], &pixels[y * pitch], width);
+	memcpy(frame->palette, palette, 768);
+
+	frame_head.store(head + 1, std::memory_order_release);
+}
+
+void capture_set_audio_rate(int samplerate)
+{
+	audio_rate = samplerate;
+}
+
+void capture_audio(const float* samples, int num_frames)
+{
+	uint32_t head, count, i;
+
+	if (!capturing || !out_audio_rate)
+		return;
+
+	count = num_frames * 2;
+	head = audio_head.load(std::memory_order_relaxed);
+	if (CAPTURE_AUDIO_BUFFER - (head - audio_tail.load(std::memory_order_acquire)) < count)
+	{
+		dropped_audio += count;
+		return;
+	}
+
+	for (i = 0; i < count; i++)
+		audio_queue[(head + i) & (CAPTURE_AUDIO_BUFFER - 1)] = samples[i];
+
+	audio_head.store(head + count, std::memory_order_release);
+}
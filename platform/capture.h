@@ -0,0 +1,43 @@
+/*
+The code contained in this file is not the property of Parallax Software,
+and is not under the terms of the Parallax Software Source license.
+Instead, it is released under the terms of the MIT License,
+as described in copying.txt
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Movie capture
+// Frames are handed over from the game thread and audio from the mixer,
+// through lock-free queues. A separate encoder thread writes the file,
+// so capturing never holds up the game. When the queue is full the frame
+// is dropped instead of waiting.
+//-----------------------------------------------------------------------------
+
+#define CAPTURE_FORMAT_RAW 0	//8-bit frames plus palette changes and PCM audio, see capture.cpp
+#define CAPTURE_FORMAT_AVI 1	//uncompressed 24-bit AVI with PCM audio
+#define CAPTURE_FORMAT_Y4M 2	//YUV4MPEG2 4:2:0, audio goes to a .wav next to it
+
+//Picks a format from the extension of a filename. Unknown extensions are raw.
+int capture_format_from_filename(const char* filename);
+
+//Starts capturing to filename. The AVI and Y4M formats have a fixed frame size, so frames of other sizes are cropped or padded.
+//Returns 0 on success, 1 if the file can't be opened or a capture is already running.
+int capture_start(const char* filename, int format, int width, int height, int fps);
+
+//Finishes writing everything queued, and closes the file.
+void capture_stop();
+
+int capture_active();
+
+//Queues a frame. pixels is an 8-bit paletted image, palette is 256 6-bit RGB triplets.
+void capture_frame(const uint8_t* pixels, int width, int height, int pitch, const uint8_t* palette);
+
+//Called by the audio backend when it knows the rate it mixes at. Without this, captures have no audio.
+void capture_set_audio_rate(int samplerate);
+
+//Called by the audio backend with each block of mixed, interleaved stereo samples.
+void capture_audio(const float* samples, int num_frames);
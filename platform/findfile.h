@@ -29,6 +29,7 @@ typedef struct FILEFINDSTRUCT
 {
 	uint32_t size;
 	uint32_t type;
+	uint32_t time;		//last modified, only good for telling whether a file has changed
 	char name[FF_PATHSIZE];
 } FILEFINDSTRUCT;
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdint.h>
 #include <vector>
 
 #include "s_midi.h"
@@ -112,3 +113,7 @@ void mvesnd_close();
 
 void mvesnd_pause();
 void mvesnd_resume();
+
+//Returns how far into the queued movie audio playback has got, in microseconds, or -1 if no movie audio has been set up.
+//The movie player uses this as its clock, so frames stay in step with the sound.
+int64_t mvesnd_get_position();
@@ -0,0 +1,355 @@
+/*
+The code contained in this file is not the property of Parallax Software,
+and is not under the terms of the Parallax Software Source license.
+Instead, it is released under the terms of the MIT License,
+as described in copying.txt
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include "platform/jobs.h"
+#include "platform/timer.h"
+#include "platform/mono.h"
+#include "misc/error.h"
+
+#define JOB_SCRATCH_BLOCK_SIZE	(256 * 1024)
+
+typedef struct job
+{
+	std::function<void()> fn;
+	job_counter* counter;
+} job;
+
+typedef struct job_scratch
+{
+	std::vector<uint8_t*> blocks;
+	std::vector<size_t> sizes;
+	int block;
+	size_t used;
+} job_scratch;
+
+typedef struct job_thread
+{
+	std::mutex lock;
+	std::deque<job> queue;
+	job_scratch scratch;
+	std::atomic<int> jobs;
+	std::atomic<uint64_t> busy_us;
+} job_thread;
+
+static job_thread* Job_threads[MAX_JOB_THREADS];
+static std::vector<std::thread> Job_workers;
+static int Job_num_threads = 0;
+static thread_local int Job_thread_index = 0;
+
+static std::mutex Job_sleep_lock;
+static std::condition_variable Job_wake;
+static std::atomic<int> Job_queued(0);
+static std::atomic<int> Job_steals(0);
+static std::atomic<bool> Job_quit(false);
+
+static job_scratch Job_scratch_no_init;		//the main thread's arena before job_init
+static uint64_t Job_frame_start;
+job_stats Job_stats_last_frame;
+
+static void job_execute(job_thread* self, job* j)
+{
+	uint64_t start = I_GetUS();
+
+	j->fn();
+
+	//The counter can be gone as soon as it reaches 0, once its job_wait sees that.
+	if (--j->counter->count == 0)
+	{
+		//Take the lock so job_wait can't miss the wakeup between checking the counter and going to sleep.
+		{
+			std::lock_guard<std::mutex> guard(Job_sleep_lock);
+		}
+		Job_wake.notify_all();
+	}
+
+	self->busy_us += I_GetUS() - start;
+	self->jobs++;
+}
+
+//Takes a job from the thread's own queue, newest first, or steals the oldest one from another queue.
+static int job_take(int index, job* j)
+{
+	job_thread* self = Job_threads[index];
+	int i;
+
+	{
+		std::lock_guard<std::mutex> guard(self->lock);
+		if (!self->queue.empty())
+		{
+			*j = std::move(self->queue.back());
+			self->queue.pop_back();
+			Job_queued--;
+			return 1;
+		}
+	}
+
+	for (i = 1; i < Job_num_threads; i++)
+	{
+		job_thread* victim = Job_threads[(index + i) % Job_num_threads];
+		std::lock_guard<std::mutex> guard(victim->lock);
+		if (!victim->queue.empty())
+		{
+			*j = std::move(victim->queue.front());
+			victim->queue.pop_front();
+			Job_queued--;
+			Job_steals++;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void job_worker_main(int index)
+{
+	job j;
+
+	Job_thread_index = index;
+
+	for (;;)
+	{
+		if (job_take(index, &j))
+		{
+			job_execute(Job_threads[index], &j);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(Job_sleep_lock);
+		Job_wake.wait(lock, [] { return Job_queued > 0 || Job_quit; });
+		if (Job_quit)
+			return;
+	}
+}
+
+void job_init(int num_threads)
+{
+	int i;
+
+	if (Job_num_threads)
+		return;
+
+	if (num_threads <= 0)
+		num_threads = std::thread::hardware_concurrency();
+	if (num_threads < 1)
+		num_threads = 1;
+	if (num_threads > MAX_JOB_THREADS)
+		num_threads = MAX_JOB_THREADS;
+
+	for (i = 0; i < num_threads; i++)
+	{
+		Job_threads[i] = new job_thread;
+		Job_threads[i]->jobs = 0;
+		Job_threads[i]->busy_us = 0;
+		Job_threads[i]->scratch.block = 0;
+		Job_threads[i]->scratch.used = 0;
+	}
+	Job_threads[0]->scratch = Job_scratch_no_init;
+	Job_num_threads = num_threads;
+	Job_frame_start = I_GetUS();
+
+	for (i = 1; i < num_threads; i++)
+		Job_workers.push_back(std::thread(job_worker_main, i));
+
+	atexit(job_shutdown);
+	mprintf((0, "Job system: %d threads\n", num_threads));
+}
+
+void job_shutdown()
+{
+	int i;
+
+	if (Job_workers.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> guard(Job_sleep_lock);
+		Job_quit = true;
+	}
+	Job_wake.notify_all();
+
+	for (auto& worker : Job_workers)
+		worker.join();
+	Job_workers.clear();
+
+	//Run whatever the workers left queued here, so nothing waiting on it hangs. From now on jobs
+	//run on the calling thread.
+	for (i = 1; i < Job_num_threads; i++)
+	{
+		job_thread* thread = Job_threads[i];
+
+		while (!thread->queue.empty())
+		{
+			job j = std::move(thread->queue.front());
+			thread->queue.pop_front();
+			Job_queued--;
+			job_execute(Job_threads[0], &j);
+		}
+	}
+	Job_num_threads = 1;
+}
+
+int job_num_threads()
+{
+	return Job_num_threads > 0 ? Job_num_threads : 1;
+}
+
+int job_thread_index()
+{
+	return Job_thread_index;
+}
+
+void job_run(std::function<void()> fn, job_counter* counter)
+{
+	counter->count++;
+
+	if (Job_num_threads <= 1)
+	{
+		fn();
+		counter->count--;
+		return;
+	}
+
+	{
+		job_thread* self = Job_threads[Job_thread_index];
+		std::lock_guard<std::mutex> guard(self->lock);
+		self->queue.push_back({ std::move(fn), counter });
+		Job_queued++;
+	}
+
+	//Take the lock so a worker can't miss the wakeup between checking the queue and going to sleep.
+	{
+		std::lock_guard<std::mutex> guard(Job_sleep_lock);
+	}
+	Job_wake.notify_one();
+}
+
+void job_wait(job_counter* counter)
+{
+	job j;
+
+	while (counter->count > 0)
+	{
+		if (job_take(Job_thread_index, &j))
+		{
+			job_execute(Job_threads[Job_thread_index], &j);
+			continue;
+		}
+
+		//Nothing to run here, so sleep until the rest finish or more are queued.
+		std::unique_lock<std::mutex> lock(Job_sleep_lock);
+		Job_wake.wait(lock, [counter] { return counter->count <= 0 || Job_queued > 0; });
+	}
+}
+
+void job_parallel_for(int first, int last, int grain, const std::function<void(int start, int end)>& fn)
+{
+	job_counter counter;
+	int start;
+
+	if (last <= first)
+		return;
+
+	if (grain <= 0)
+		grain = std::max((last - first) / (job_num_threads() * 4), 1);
+
+	if (Job_num_threads <= 1 || last - first <= grain)
+	{
+		fn(first, last);
+		return;
+	}
+
+	for (start = first; start < last; start += grain)
+	{
+		int end = std::min(start + grain, last);
+		job_run([&fn, start, end]() { fn(start, end); }, &counter);
+	}
+
+	job_wait(&counter);
+}
+
+static job_scratch* job_get_scratch()
+{
+	if (Job_num_threads == 0)
+		return &Job_scratch_no_init;
+	return &Job_threads[Job_thread_index]->scratch;
+}
+
+void* job_scratch_alloc(size_t size)
+{
+	job_scratch* scratch = job_get_scratch();
+	void* ptr;
+
+	size = (size + 15) & ~(size_t)15;
+
+	//Move on to the next block that has room, making one if needed.
+	while (scratch->block < (int)scratch->blocks.size() && scratch->used + size > scratch->sizes[scratch->block])
+	{
+		scratch->block++;
+		scratch->used = 0;
+	}
+
+	if (scratch->block == (int)scratch->blocks.size())
+	{
+		size_t block_size = std::max(size, (size_t)JOB_SCRATCH_BLOCK_SIZE);
+		uint8_t* block = (uint8_t*)malloc(block_size);
+		if (!block)
+			Error("job_scratch_alloc: out of memory allocating %d bytes", (int)block_size);
+		scratch->blocks.push_back(block);
+		scratch->sizes.push_back(block_size);
+		scratch->used = 0;
+	}
+
+	ptr = scratch->blocks[scratch->block] + scratch->used;
+	scratch->used += size;
+	return ptr;
+}
+
+job_scratch_mark job_scratch_get_mark()
+{
+	job_scratch* scratch = job_get_scratch();
+	job_scratch_mark mark;
+
+	mark.block = scratch->block;
+	mark.used = scratch->used;
+	return mark;
+}
+
+void job_scratch_release(job_scratch_mark mark)
+{
+	job_scratch* scratch = job_get_scratch();
+
+	scratch->block = mark.block;
+	scratch->used = mark.used;
+}
+
+void job_end_frame()
+{
+	uint64_t now = I_GetUS();
+	uint64_t frame_us = now - Job_frame_start;
+	int i;
+
+	Job_frame_start = now;
+	Job_stats_last_frame.num_threads = Job_num_threads;
+	Job_stats_last_frame.steals = Job_steals.exchange(0);
+
+	for (i = 0; i < Job_num_threads; i++)
+	{
+		job_thread* thread = Job_threads[i];
+		uint64_t busy = thread->busy_us.exchange(0);
+
+		Job_stats_last_frame.jobs[i] = thread->jobs.exchange(0);
+		Job_stats_last_frame.busy_percent[i] = frame_us ? (int)(busy * 100 / frame_us) : 0;
+	}
+}
@@ -0,0 +1,76 @@
+/*
+The code contained in this file is not the property of Parallax Software,
+and is not under the terms of the Parallax Software Source license.
+Instead, it is released under the terms of the MIT License,
+as described in copying.txt
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <atomic>
+#include <functional>
+
+//The engine's job system. A fixed set of worker threads, started once, that run small jobs.
+//Each thread has its own queue. A thread runs the newest job in its own queue first, and when that's
+//empty it steals the oldest job from another thread's queue. The main thread is thread 0 and runs
+//jobs too while it waits for them.
+//Only the main thread and the workers may use these. Before job_init, or with one thread, jobs
+//just run on the calling thread.
+
+#define MAX_JOB_THREADS			64
+
+//Counts the jobs of a fork that haven't finished. job_wait joins on it.
+typedef struct job_counter
+{
+	std::atomic<int> count{ 0 };
+} job_counter;
+
+//Starts the workers. num_threads counts the main thread, <= 0 picks one per core.
+void job_init(int num_threads);
+
+//Stops the workers and runs any jobs still queued. job_init registers this to run at exit.
+void job_shutdown();
+
+//How many threads run jobs, including the main thread.
+int job_num_threads();
+
+//Which of them the calling thread is, 0 for the main thread.
+int job_thread_index();
+
+//Queues fn to run on some thread. counter is incremented now and decremented when fn returns.
+void job_run(std::function<void()> fn, job_counter* counter);
+
+//Runs queued jobs until every job counted by counter has finished, and sleeps while there are none
+//to run but some of them are still running elsewhere.
+void job_wait(job_counter* counter);
+
+//Calls fn(start, end) over [first, last) split into pieces of grain indices, across threads,
+//and returns when all of them are done. grain <= 0 picks a size that gives every thread a few pieces.
+void job_parallel_for(int first, int last, int grain, const std::function<void(int start, int end)>& fn);
+
+//Per-thread scratch memory, for temporary data of a job. Allocations are 16 byte aligned and
+//live until the thread's arena is released back past them. A job should release what it allocates.
+typedef struct job_scratch_mark
+{
+	int block;
+	size_t used;
+} job_scratch_mark;
+
+void* job_scratch_alloc(size_t size);
+job_scratch_mark job_scratch_get_mark();
+void job_scratch_release(job_scratch_mark mark);
+
+//Utilization of each thread over the last frame.
+typedef struct job_stats
+{
+	int num_threads;
+	int jobs[MAX_JOB_THREADS];			//jobs run
+	int busy_percent[MAX_JOB_THREADS];	//time spent running jobs
+	int steals;							//jobs taken from another thread's queue
+} job_stats;
+
+extern job_stats Job_stats_last_frame;
+
+//Call once a frame to move the counters into Job_stats_last_frame.
+void job_end_frame();
@@ -12,6 +12,7 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 */
 
 #include <stdio.h>
+#include <string.h>
 #include "platform/key.h"
 #include "platform/timer.h"
 
@@ -259,14 +260,19 @@ unsigned int key_up_count(int scancode) {
 }
 
 void KeyPressed(int scancode)
+{
+	KeyPressedAt(scancode, timer_get_fixed_seconds());
+}
+
+void KeyPressedAt(int scancode, fix time)
 {
 	// Key going down
 	keyd_last_pressed = scancode;
-	keyd_time_when_last_pressed = timer_get_fixed_seconds();
+	keyd_time_when_last_pressed = time;
 	if (!keyd_pressed[scancode]) 
 	{
 		// First time down
-		key_data.TimeKeyWentDown[scancode] = timer_get_fixed_seconds();
+		key_data.TimeKeyWentDown[scancode] = time;
 		keyd_pressed[scancode] = 1;
 		key_data.NumDowns[scancode]++;
 #ifndef NDEBUG
@@ -315,6 +321,13 @@ void KeyPressed(int scancode)
 
 void KeyReleased(int scancode)
 {
+	KeyReleasedAt(scancode, timer_get_fixed_seconds());
+}
+
+void KeyReleasedAt(int scancode, fix time)
+{
+	fix held;
+
 	// Key going up
 	keyd_last_released = scancode;
 	keyd_pressed[scancode] = 0;
@@ -323,15 +336,41 @@ void KeyReleased(int scancode)
 	temp |= keyd_pressed[KEY_LSHIFT] || keyd_pressed[KEY_RSHIFT];
 	temp |= keyd_pressed[KEY_LALT] || keyd_pressed[KEY_RALT];
 	temp |= keyd_pressed[KEY_LCTRL] || keyd_pressed[KEY_RCTRL];
+	//key_down_time or key_flush may have moved the down time past when the release happened
+	held = time - key_data.TimeKeyWentDown[scancode];
+	if (held < 0)
+		held = 0;
 #ifndef NDEBUG
 	temp |= keyd_pressed[KEY_DELETE];
 	if (!(keyd_editor_mode && temp))
-		key_data.TimeKeyHeldDown[scancode] += timer_get_fixed_seconds() - key_data.TimeKeyWentDown[scancode];
+		key_data.TimeKeyHeldDown[scancode] += held;
 #else
-	key_data.TimeKeyHeldDown[scancode] += timer_get_fixed_seconds() - key_data.TimeKeyWentDown[scancode];
+	key_data.TimeKeyHeldDown[scancode] += held;
 #endif
 }
 
+input_latency_stats Input_latency_stats_last_frame;
+static input_latency_stats input_latency;
+static int64_t input_delay_total;
+
+void input_note_event_delay(fix delay)
+{
+	input_latency.events++;
+	input_delay_total += delay;
+	if (delay > input_latency.max_delay)
+		input_latency.max_delay = delay;
+}
+
+void input_end_frame()
+{
+	if (input_latency.events)
+		input_latency.avg_delay = (fix)(input_delay_total / input_latency.events);
+	Input_latency_stats_last_frame = input_latency;
+
+	memset(&input_latency, 0, sizeof(input_latency));
+	input_delay_total = 0;
+}
+
 void key_init()
 {
 	// Initialize queue
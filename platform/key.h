@@ -73,12 +73,33 @@ extern unsigned int key_up_count(int scancode);
 //void key_clear_times();
 //void key_clear_counts();
 
-//[ISB] new key handler
-void I_KeyHandler(int sc, dbool down);
+//[ISB] new key handler. time is when the event happened, on the timer_get_fixed_seconds clock.
+void I_KeyHandler(int sc, dbool down, fix time);
 
 void KeyPressed(int scancode);
 void KeyReleased(int scancode);
 
+//Same, for a key event that happened at time rather than now, so down times aren't rounded to when
+//the events were read.
+void KeyPressedAt(int scancode, fix time);
+void KeyReleasedAt(int scancode, fix time);
+
+//Input latency: how long input events waited between happening and being read, over the last frame.
+//Only platforms that know when their events happened report them.
+typedef struct input_latency_stats
+{
+	int		events;
+	fix		avg_delay;
+	fix		max_delay;
+} input_latency_stats;
+
+extern input_latency_stats Input_latency_stats_last_frame;
+
+void input_note_event_delay(fix delay);
+
+//Call once a frame to move the counters into Input_latency_stats_last_frame.
+void input_end_frame();
+
 #define KEY_SHIFTED     0x100
 #define KEY_ALTED       0x200
 #define KEY_CTRLED      0x400
@@ -112,7 +112,12 @@ void mouse_flush()
 
 void MousePressed(int button)
 {
-	Mouse.ctime = timer_get_fixed_seconds();
+	MousePressedAt(button, timer_get_fixed_seconds());
+}
+
+void MousePressedAt(int button, fix time)
+{
+	Mouse.ctime = time;
 	if (!Mouse.pressed[button])
 	{
 		Mouse.pressed[button] = 1;
@@ -123,11 +128,18 @@ void MousePressed(int button)
 
 void MouseReleased(int button)
 {
-	Mouse.ctime = timer_get_fixed_seconds();
+	MouseReleasedAt(button, timer_get_fixed_seconds());
+}
+
+void MouseReleasedAt(int button, fix time)
+{
+	Mouse.ctime = time;
 	if (Mouse.pressed[button])
 	{
 		Mouse.pressed[button] = 0;
-		Mouse.time_held_down[button] += Mouse.ctime - Mouse.time_went_down[button];
+		//mouse_button_down_time may have moved the down time past when the release happened
+		if (Mouse.ctime > Mouse.time_went_down[button])
+			Mouse.time_held_down[button] += Mouse.ctime - Mouse.time_went_down[button];
 	}
 	Mouse.num_ups[button]++;
 }
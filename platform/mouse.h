@@ -69,7 +69,10 @@ extern int mouse_button_state(int button);
 //[ISB] new things
 
 //Replace the interrupt callback with a proper handler. 
-void I_MouseHandler(uint32_t button, dbool down);
+//time is when the event happened, on the timer_get_fixed_seconds clock.
+void I_MouseHandler(uint32_t button, dbool down, fix time);
 
 void MousePressed(int button);
 void MouseReleased(int button);
+void MousePressedAt(int button, fix time);
+void MouseReleasedAt(int button, fix time);
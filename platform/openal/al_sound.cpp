@@ -518,6 +518,10 @@ ALenum mveSndFormat;
 ALint mveSndSampleRate;
 ALuint mveSndSourceName;
 ALboolean mveSndPlaying;
+ALboolean mveSndPaused;
+//Bytes per sample frame, and how many sample frames were in buffers that have already been dequeued
+int mveSndFrameSize;
+uint64_t mveSndSamplesDone;
 
 void I_CreateMovieSource()
 {
@@ -537,30 +541,35 @@ void mvesnd_init_audio(int format, int samplerate, int stereo)
 			mveSndFormat = AL_FORMAT_STEREO8;
 		else
 			mveSndFormat = AL_FORMAT_MONO8;
+		mveSndFrameSize = stereo ? 2 : 1;
 		break;
 	case MVESND_S16LSB:
 		if (stereo)
 			mveSndFormat = AL_FORMAT_STEREO16;
 		else
 			mveSndFormat = AL_FORMAT_MONO16;
+		mveSndFrameSize = stereo ? 4 : 2;
 		break;
 	}
 	mveSndSampleRate = samplerate;
 
 	mveSndBufferHead = 0; mveSndBufferTail = 0;
-	mveSndPlaying = AL_FALSE;
+	mveSndPlaying = mveSndPaused = AL_FALSE;
+	mveSndSamplesDone = 0;
 
 	I_CreateMovieSource();
 }
 
 void I_DequeueMovieAudioBuffers(int all)
 {
-	int i, n;
+	int i, n, size;
 	//Dequeue processed buffers in the ring buffer
 	alGetSourcei(mveSndSourceName, AL_BUFFERS_PROCESSED, &n);
 	for (i = 0; i < n; i++)
 	{
 		alSourceUnqueueBuffers(mveSndSourceName, 1, &mveSndRingBuffer[mveSndBufferTail]);
+		alGetBufferi(mveSndRingBuffer[mveSndBufferTail], AL_SIZE, &size);
+		mveSndSamplesDone += size / mveSndFrameSize;
 		alDeleteBuffers(1, &mveSndRingBuffer[mveSndBufferTail]);
 
 		mveSndBufferTail++;
@@ -602,6 +611,14 @@ void mvesnd_queue_audio_buffer(int len, short* data)
 		alSourcePlay(mveSndSourceName);
 		mveSndPlaying = AL_TRUE;
 	}
+	else if (!mveSndPaused)
+	{
+		//If the source ran dry it stops by itself, so kick it off again
+		ALint state;
+		alGetSourcei(mveSndSourceName, AL_SOURCE_STATE, &state);
+		if (state == AL_STOPPED)
+			alSourcePlay(mveSndSourceName);
+	}
 
 	mveSndBufferHead++;
 	if (mveSndBufferHead == NUMMVESNDBUFFERS)
@@ -618,16 +635,32 @@ void mvesnd_close()
 	I_DequeueMovieAudioBuffers(1);
 
 	alDeleteSources(1, &mveSndSourceName);
+	mveSndPlaying = AL_FALSE;
 }
 
 void mvesnd_pause()
 {
 	alSourcePause(mveSndSourceName);
+	mveSndPaused = AL_TRUE;
 }
 
 void mvesnd_resume()
 {
 	alSourcePlay(mveSndSourceName);
+	mveSndPaused = AL_FALSE;
+}
+
+int64_t mvesnd_get_position()
+{
+	ALint offset = 0;
+	if (!mveSndPlaying)
+		return -1;
+
+	//Buffers that have finished are counted when they're dequeued. The offset covers the ones still queued.
+	I_DequeueMovieAudioBuffers(0);
+	alGetSourcei(mveSndSourceName, AL_SAMPLE_OFFSET, &offset);
+
+	return (int64_t)((mveSndSamplesDone + offset) * 1000000 / mveSndSampleRate);
 }
 
 #endif
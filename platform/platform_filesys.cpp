@@ -14,6 +14,10 @@ Instead, it is released under the terms of the MIT License.
 
 #include "platform/posixstub.h"
 
+#if defined(_WIN32) || defined(_WIN64)
+#include <Windows.h>
+#endif
+
 static char local_file_path_prefix[CHOCOLATE_MAX_FILE_PATH_SIZE] = {0};
 
 void get_missing_file_locations(char* missing_file_string, const char* missing_file_list);
@@ -540,4 +544,13 @@ void get_temp_file_full_path(char* filename_full_path, const char* filename)
 
 	snprintf(filename_full_path, CHOCOLATE_MAX_FILE_PATH_SIZE, ".%c%s", PLATFORM_PATH_SEPARATOR, filename);
 	return;
-}
\ No newline at end of file
+}
+int replace_file(const char* src, const char* dest)
+{
+#if defined(_WIN32) || defined(_WIN64)
+	//rename won't overwrite an existing file on Windows
+	return MoveFileExA(src, dest, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ? 0 : -1;
+#else
+	return rename(src, dest);
+#endif
+}
@@ -88,4 +88,7 @@ void get_platform_localized_query_string(char* platform_localized_query_string,
 void get_full_file_path(char* filename_full_path, const char* filename, const char* additional_path = NULL);
 
 //Get full path to files in an OS-specific temp directory
-void get_temp_file_full_path(char* filename_full_path, const char* filename);
\ No newline at end of file
+void get_temp_file_full_path(char* filename_full_path, const char* filename);
+//Rename src over dest, replacing dest if it exists. Atomic where the OS allows it.
+//Returns 0 on success.
+int replace_file(const char* src, const char* dest);
@@ -337,9 +337,29 @@ void I_ScaleMouseToWindow(int* x, int* y)
 	//printf("out: (%d, %d)\n", *x, *y);
 }
 
+//Converts the time an event happened from SDL ticks to the timer_get_fixed_seconds clock, and counts how
+//long it waited to be read.
+static fix I_EventTime(SDL_Event* ev, uint32_t now_ticks, fix now)
+{
+	uint32_t age = now_ticks - ev->common.timestamp;
+	fix delay;
+
+	//Pushed events can have no timestamp, and a minute is plenty for anything real
+	if (!ev->common.timestamp || age > 60000)
+		age = 0;
+
+	delay = (fix)((int64_t)age * F1_0 / 1000);
+	input_note_event_delay(delay);
+
+	return now - delay;
+}
+
 void plat_do_events()
 {
 	SDL_Event ev;
+	uint32_t now_ticks = SDL_GetTicks();
+	fix now = timer_get_fixed_seconds();
+
 	while (SDL_PollEvent(&ev))
 	{
 		switch (ev.type)
@@ -357,7 +377,7 @@ void plat_do_events()
 		}
 		case SDL_MOUSEBUTTONDOWN:
 		case SDL_MOUSEBUTTONUP:
-			I_MouseHandler(ev.button.button, ev.button.state);
+			I_MouseHandler(ev.button.button, ev.button.state, I_EventTime(&ev, now_ticks, now));
 			break;
 		case SDL_KEYDOWN:
 		case SDL_KEYUP:
@@ -367,7 +387,7 @@ void plat_do_events()
 				plat_toggle_fullscreen();
 			}
 			else
-				I_KeyHandler(ev.key.keysym.scancode, ev.key.state);
+				I_KeyHandler(ev.key.keysym.scancode, ev.key.state, I_EventTime(&ev, now_ticks, now));
 			break;
 			//[ISB] kill this. Descent's joystick code expects buttons to report that they're constantly being held down, and these button events only fire when the state changes
 /*
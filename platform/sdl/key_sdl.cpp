@@ -23,7 +23,7 @@ KEY_PADENTER, KEY_PAD1, KEY_PAD2, KEY_PAD3, KEY_PAD4, KEY_PAD5, KEY_PAD6, KEY_PA
 KEY_PAD8, KEY_PAD9, KEY_PAD0, KEY_PADPERIOD, -1, -1, -1, KEY_EQUAL, -1, -1, -1, -1, -1
 -1, -1, -1, -1, -1 ,-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
 
-void I_KeyHandler(int sc, dbool down)
+void I_KeyHandler(int sc, dbool down, fix time)
 {
 	int scancode;
 
@@ -51,9 +51,9 @@ void I_KeyHandler(int sc, dbool down)
 	}
 
 	if (down == SDL_PRESSED)
-		KeyPressed(scancode);
+		KeyPressedAt(scancode, time);
 	else if (down == SDL_RELEASED)
-		KeyReleased(scancode);
+		KeyReleasedAt(scancode, time);
 }
 
 #endif
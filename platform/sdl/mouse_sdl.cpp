@@ -71,18 +71,25 @@ void mouse_set_pos(int x, int y)
 	SDL_WarpMouseInWindow(gameWindow, x, y);
 }
 
-void I_MouseHandler(uint32_t button, dbool down)
+void I_MouseHandler(uint32_t button, dbool down, fix time)
 {
-	if (down && (button == SDL_BUTTON_LEFT)) MousePressed(MBUTTON_LEFT);
-	else if (!down && (button == SDL_BUTTON_LEFT)) MouseReleased(MBUTTON_LEFT);
-	else if (down && (button == SDL_BUTTON_RIGHT)) MousePressed(MBUTTON_RIGHT);
-	else if (!down && (button == SDL_BUTTON_RIGHT)) MouseReleased(MBUTTON_RIGHT);
-	else if (down && (button == SDL_BUTTON_MIDDLE)) MousePressed(MBUTTON_MIDDLE);
-	else if (!down && (button == SDL_BUTTON_MIDDLE)) MouseReleased(MBUTTON_MIDDLE);
-	else if (down && (button == SDL_BUTTON_X1)) MousePressed(MBUTTON_4);
-	else if (!down && (button == SDL_BUTTON_X1)) MouseReleased(MBUTTON_4);
-	else if (down && (button == SDL_BUTTON_X2)) MousePressed(MBUTTON_5);
-	else if (!down && (button == SDL_BUTTON_X2)) MouseReleased(MBUTTON_5);
+	int btn;
+
+	switch (button)
+	{
+	case SDL_BUTTON_LEFT:	btn = MBUTTON_LEFT; break;
+	case SDL_BUTTON_RIGHT:	btn = MBUTTON_RIGHT; break;
+	case SDL_BUTTON_MIDDLE:	btn = MBUTTON_MIDDLE; break;
+	case SDL_BUTTON_X1:		btn = MBUTTON_4; break;
+	case SDL_BUTTON_X2:		btn = MBUTTON_5; break;
+	default:
+		return;
+	}
+
+	if (down)
+		MousePressedAt(btn, time);
+	else
+		MouseReleasedAt(btn, time);
 }
 
 #endif
@@ -0,0 +1,76 @@
+/*
+The code contained in this file is not the property of Parallax Software,
+and is not under the terms of the Parallax Software Source license.
+Instead, it is released under the terms of the MIT License,
+as described in copying.txt
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include "platform/timeline.h"
+#include "platform/timer.h"
+#include "platform/mono.h"
+#include "cfile/cfile.h"
+
+typedef struct timeline_phase
+{
+	const char* name;
+	uint64_t start_us, end_us;
+	int64_t start_bytes, bytes;
+	std::atomic<int> done;
+} timeline_phase;
+
+static timeline_phase Timeline_phases[MAX_TIMELINE_PHASES];
+static std::atomic<int> Timeline_num_phases(0);
+static std::atomic<uint64_t> Timeline_origin(0);
+
+int timeline_begin(const char* name)
+{
+	uint64_t now = I_GetUS();
+	uint64_t zero = 0;
+	int phase = Timeline_num_phases++;
+
+	Timeline_origin.compare_exchange_strong(zero, now);
+	if (phase >= MAX_TIMELINE_PHASES)
+		return -1;
+
+	Timeline_phases[phase].name = name;
+	Timeline_phases[phase].start_us = now;
+	Timeline_phases[phase].start_bytes = cfile_bytes_read();
+	return phase;
+}
+
+void timeline_end(int phase)
+{
+	timeline_phase* p;
+
+	if (phase < 0 || phase >= MAX_TIMELINE_PHASES)
+		return;
+
+	p = &Timeline_phases[phase];
+	p->end_us = I_GetUS();
+	p->bytes = cfile_bytes_read() - p->start_bytes;
+	p->done = 1;
+}
+
+void timeline_print(int to_stdout)
+{
+	char line[128];
+	int i, num_phases = Timeline_num_phases < MAX_TIMELINE_PHASES ? (int)Timeline_num_phases : MAX_TIMELINE_PHASES;
+	uint64_t origin = Timeline_origin;
+
+	snprintf(line, sizeof(line), "%-20s %9s %9s %9s\n", "Startup phase", "start ms", "ms", "KB read");
+	if (to_stdout) fputs(line, stdout); else mprintf((0, "%s", line));
+
+	for (i = 0; i < num_phases; i++)
+	{
+		timeline_phase* p = &Timeline_phases[i];
+
+		if (!p->done)
+			continue;
+		snprintf(line, sizeof(line), "%-20s %9.1f %9.1f %9lld\n", p->name, (p->start_us - origin) / 1000.0,
+			(p->end_us - p->start_us) / 1000.0, (long long)(p->bytes / 1024));
+		if (to_stdout) fputs(line, stdout); else mprintf((0, "%s", line));
+	}
+}
@@ -0,0 +1,24 @@
+/*
+The code contained in this file is not the property of Parallax Software,
+and is not under the terms of the Parallax Software Source license.
+Instead, it is released under the terms of the MIT License,
+as described in copying.txt
+*/
+
+#pragma once
+
+//Startup timeline. Records when each phase of startup began and ended and how much it read
+//through cfile, so the time from launch to the main menu can be broken down.
+//Phases may overlap and may run on any thread, but a phase has to end on the thread that began it.
+
+#define MAX_TIMELINE_PHASES		64
+
+//Begins a phase and returns its handle. name must stay valid, a string literal is best.
+//Times are measured from the first phase.
+int timeline_begin(const char* name);
+
+//Ends the phase.
+void timeline_end(int phase);
+
+//Prints all the phases, to stdout if to_stdout is set or with mprintf otherwise.
+void timeline_print(int to_stdout);
@@ -22,6 +22,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 
 char searchStr[13];
 DIR *currentDir;
+char currentDirName[CHOCOLATE_MAX_FILE_PATH_SIZE];
 
 int	FileFindFirst(const char* search_str, FILEFINDSTRUCT* ffstruct)
 {
@@ -66,6 +67,7 @@ int	FileFindFirst(const char* search_str, FILEFINDSTRUCT* ffstruct)
 	//mprintf((0, "FindFileFirst: Opening %s\n", dir));
 	currentDir = opendir(dir);
 	if (!currentDir) return 1;
+	strncpy(currentDirName, dir, CHOCOLATE_MAX_FILE_PATH_SIZE - 1);
 	//It opened, so get search string
 	search = strrchr(search_str, '*');
 	strncpy(searchStr, search+2, 12);
@@ -84,8 +86,10 @@ int	FileFindNext(FILEFINDSTRUCT* ffstruct)
 	char fname[256];
 	char ext[256];
 #endif
+	char path[CHOCOLATE_MAX_FILE_PATH_SIZE];
 	struct dirent *entry;
 	struct stat stats;
+	size_t dirlen;
 	if (!currentDir) return 1;
 	entry = readdir(currentDir);
 	while (entry != NULL)
@@ -104,8 +108,16 @@ int	FileFindNext(FILEFINDSTRUCT* ffstruct)
 			if (!strncmp(ext, searchStr, 3))
 			{
 				//mprintf((0, "got %s (%s, %s)\n", entry->d_name, fname, ext));
-				stat(entry->d_name, &stats);
+				//stat the file in the directory being searched, not the current one
+				dirlen = strlen(currentDirName);
+				if (dirlen > 0 && currentDirName[dirlen - 1] != '/' && currentDirName[dirlen - 1] != '\\')
+					snprintf(path, CHOCOLATE_MAX_FILE_PATH_SIZE, "%s/%s", currentDirName, entry->d_name);
+				else
+					snprintf(path, CHOCOLATE_MAX_FILE_PATH_SIZE, "%s%s", currentDirName, entry->d_name);
+				if (stat(path, &stats) != 0)
+					memset(&stats, 0, sizeof(stats));
 				ffstruct->size = static_cast<uint32_t>(stats.st_size);
+				ffstruct->time = static_cast<uint32_t>(stats.st_mtime);
 				strncpy(ffstruct->name, entry->d_name, FF_PATHSIZE);
 				return 0;
 			}
@@ -26,6 +26,7 @@ int	FileFindFirst(const char* search_str, FILEFINDSTRUCT* ffstruct)
 	else
 	{
 		ffstruct->size = find.nFileSizeLow;
+		ffstruct->time = find.ftLastWriteTime.dwLowDateTime;
 		if (find.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
 			ffstruct->type = FF_TYPE_DIR;
 		else
@@ -48,6 +49,7 @@ int	FileFindNext(FILEFINDSTRUCT* ffstruct)
 	{
 		//printf("%s, shortname len %d\n", find.cFileName, strlen(find.cAlternateFileName));
 		ffstruct->size = find.nFileSizeLow;
+		ffstruct->time = find.ftLastWriteTime.dwLowDateTime;
 		if (find.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
 			ffstruct->type = FF_TYPE_DIR;
 		else
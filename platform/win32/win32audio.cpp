@@ -2,6 +2,7 @@
 #ifndef USE_OPENAL
 
 #include "platform/i_sound.h"
+#include "platform/capture.h"
 #include "platform/s_sequencer.h"
 #include "misc/error.h"
 #include <Windows.h>
@@ -83,6 +84,7 @@ namespace
 		int last_queued_buffer = 0;
 		int current_buffer = 0;
 		int sample_rate = 0;
+		uint64_t samples_done = 0; //samples in buffers that have finished playing
 
 		moviesource_t buffers[NUMMVESNDBUFFERS];
 	} moviebuffer;
@@ -255,6 +257,7 @@ namespace
 					while (pos >= length) //[ISB] this is annoyingly complex as I need to be able to switch between multiple sources
 					{
 						moviebuffer.buffers[moviebuffer.current_buffer].live = false; //no longer a valid buffer
+						moviebuffer.samples_done += length;
 						delete[] moviebuffer.buffers[moviebuffer.current_buffer].data; //kill data
 						moviebuffer.current_buffer = (moviebuffer.current_buffer + 1) % NUMMVESNDBUFFERS;
 						pos = pos % length;
@@ -328,6 +331,7 @@ namespace
 		{
 			lock.unlock();
 			mix_fragment();
+			capture_audio(next_fragment, fragment_size);
 			write_fragment();
 			lock.lock();
 		}
@@ -479,6 +483,7 @@ int plat_init_audio()
 
 	next_fragment = new float[2 * fragment_size];
 	midi_buffer = new unsigned short[4 * fragment_size];
+	capture_set_audio_rate(mixing_frequency);
 	start_mixer_thread();
 
 	return 0;
@@ -709,6 +714,7 @@ void mvesnd_init_audio(int format, int samplerate, int stereo)
 	moviebuffer.sample_rate = samplerate;
 	moviebuffer.current_buffer = 0;
 	moviebuffer.last_queued_buffer = 0;
+	moviebuffer.samples_done = 0;
 }
 
 void mvesnd_queue_audio_buffer(int len, short* data)
@@ -736,6 +742,7 @@ void mvesnd_close()
 {
 	std::unique_lock<std::mutex> lock(mixer_mutex);
 	moviebuffer.playing = false;
+	moviebuffer.sample_rate = 0;
 	for (int i = 0; i < NUMMVESNDBUFFERS; i++)
 	{
 		if (moviebuffer.buffers[i].live)
@@ -759,4 +766,17 @@ void mvesnd_resume()
 	moviebuffer.playing = true;
 }
 
+int64_t mvesnd_get_position()
+{
+	std::unique_lock<std::mutex> lock(mixer_mutex);
+	if (moviebuffer.sample_rate == 0)
+		return -1;
+
+	uint64_t samples = moviebuffer.samples_done;
+	if (moviebuffer.buffers[moviebuffer.current_buffer].live)
+		samples += moviebuffer.buffers[moviebuffer.current_buffer].pos;
+
+	return static_cast<int64_t>(samples * 1000000 / moviebuffer.sample_rate);
+}
+
 #endif
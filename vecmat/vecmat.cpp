@@ -22,215 +22,6 @@ vms_matrix vmd_identity_matrix = { f1_0,0,0,
 												0,f1_0,0,
 												0,0,f1_0 };
 
-//adds two vectors, fills in dest, returns ptr to dest
-//ok for dest to equal either source, but should use vm_vec_add2() if so
-vms_vector* vm_vec_add(vms_vector* dest, vms_vector* src0, vms_vector* src1)
-{
-	dest->x = src0->x + src1->x;
-	dest->y = src0->y + src1->y;
-	dest->z = src0->z + src1->z;
-
-	return dest;
-}
-
-//subs two vectors, fills in dest, returns ptr to dest
-//ok for dest to equal either source, but should use vm_vec_sub2() if so
-vms_vector* vm_vec_sub(vms_vector* dest, vms_vector* src0, vms_vector* src1)
-{
-	dest->x = src0->x - src1->x;
-	dest->y = src0->y - src1->y;
-	dest->z = src0->z - src1->z;
-
-	return dest;
-}
-
-//adds one vector to another. returns ptr to dest
-//dest can equal source
-vms_vector* vm_vec_add2(vms_vector* dest, vms_vector* src)
-{
-	dest->x += src->x;
-	dest->y += src->y;
-	dest->z += src->z;
-
-	return dest;
-}
-
-//subs one vector from another, returns ptr to dest
-//dest can equal source
-vms_vector* vm_vec_sub2(vms_vector* dest, vms_vector* src)
-{
-	dest->x -= src->x;
-	dest->y -= src->y;
-	dest->z -= src->z;
-
-	return dest;
-}
-
-//averages two vectors. returns ptr to dest
-//dest can equal either source
-vms_vector* vm_vec_avg(vms_vector* dest, vms_vector* src0, vms_vector* src1)
-{
-	dest->x = (src0->x + src1->x) / 2;
-	dest->y = (src0->y + src1->y) / 2;
-	dest->z = (src0->z + src1->z) / 2;
-
-	return dest;
-}
-
-//averages four vectors. returns ptr to dest
-//dest can equal any source
-vms_vector* vm_vec_avg4(vms_vector* dest, vms_vector* src0, vms_vector* src1, vms_vector* src2, vms_vector* src3)
-{
-	dest->x = (src0->x + src1->x + src2->x + src3->x) / 4;
-	dest->y = (src0->y + src1->y + src2->y + src3->y) / 4;
-	dest->z = (src0->z + src1->z + src2->z + src3->z) / 4;
-
-	return dest;
-}
-
-//scales a vector in place.  returns ptr to vector
-vms_vector* vm_vec_scale(vms_vector* dest, fix s)
-{
-	dest->x = fixmul(dest->x, s);
-	dest->y = fixmul(dest->y, s);
-	dest->z = fixmul(dest->z, s);
-
-	return dest;
-}
-
-//scales and copies a vector.  returns ptr to dest
-vms_vector* vm_vec_copy_scale(vms_vector* dest, vms_vector* src, fix s)
-{
-	dest->x = fixmul(src->x, s);
-	dest->y = fixmul(src->y, s);
-	dest->z = fixmul(src->z, s);
-
-	return dest;
-}
-
-//scales a vector, adds it to another, and stores in a 3rd vector
-//dest = src1 + k * src2
-vms_vector* vm_vec_scale_add(vms_vector* dest, vms_vector* src1, vms_vector* src2, fix k)
-{
-	dest->x = src1->x + fixmul(src2->x, k);
-	dest->y = src1->y + fixmul(src2->y, k);
-	dest->z = src1->z + fixmul(src2->z, k);
-
-	return dest;
-}
-
-//scales a vector and adds it to another
-//dest += k * src
-vms_vector* vm_vec_scale_add2(vms_vector* dest, vms_vector* src, fix k)
-{
-	dest->x += fixmul(src->x, k);
-	dest->y += fixmul(src->y, k);
-	dest->z += fixmul(src->z, k);
-
-	return dest;
-}
-
-//scales a vector in place, taking n/d for scale.  returns ptr to vector
-//dest *= n/d
-vms_vector* vm_vec_scale2(vms_vector* dest, fix n, fix d)
-{
-	if (d == 0) return dest;
-	dest->x = fixmuldiv(dest->x, n, d);
-	dest->y = fixmuldiv(dest->y, n, d);
-	dest->z = fixmuldiv(dest->z, n, d);
-
-	return dest;
-}
-
-//returns dot product of 2 vectors
-fix vm_vec_dotprod(vms_vector* v0, vms_vector* v1)
-{
-	int64_t q;
-
-	q= 0;
-
-	fixmulaccum(&q, v0->x, v1->x);
-	fixmulaccum(&q, v0->y, v1->y);
-	fixmulaccum(&q, v0->z, v1->z);
-
-	return fixquadadjust(q);
-}
-
-fix vm_vec_dot3(fix x, fix y, fix z, vms_vector* v)
-{
-	int64_t q;
-
-	q = 0;
-
-	fixmulaccum(&q, x, v->x);
-	fixmulaccum(&q, y, v->y);
-	fixmulaccum(&q, z, v->z);
-
-	return fixquadadjust(q);
-}
-
-//returns magnitude of a vector
-fix vm_vec_mag(vms_vector* v)
-{
-	int64_t q;
-
-	q = 0;
-
-	fixmulaccum(&q, v->x, v->x);
-	fixmulaccum(&q, v->y, v->y);
-	fixmulaccum(&q, v->z, v->z);
-
-	return quad_sqrt(q);
-}
-
-//computes the distance between two points. (does sub and mag)
-fix vm_vec_dist(vms_vector* v0, vms_vector* v1)
-{
-	vms_vector t;
-	vm_vec_sub(&t, v0, v1);
-	return vm_vec_mag(&t);
-}
-
-
-//computes an approximation of the magnitude of the vector
-//uses dist = largest + next_largest*3/8 + smallest*3/16
-fix vm_vec_mag_quick(vms_vector* v)
-{
-	fix a, b, c, bc;
-
-	a = labs(v->x);
-	b = labs(v->y);
-	c = labs(v->z);
-
-	if (a < b) {
-		fix t = a; a = b; b = t;
-	}
-
-	if (b < c) {
-		fix t = b; b = c; c = t;
-
-		if (a < b) {
-			fix t = a; a = b; b = t;
-		}
-	}
-
-	bc = (b >> 2) + (c >> 3);
-
-	return a + bc + (bc >> 1);
-}
-
-
-//computes an approximation of the distance between two points.
-//uses dist = largest + next_largest*3/8 + smallest*3/16
-fix vm_vec_dist_quick(vms_vector* v0, vms_vector* v1)
-{
-	vms_vector t;
-
-	vm_vec_sub(&t, v0, v1);
-
-	return vm_vec_mag_quick(&t);
-}
-
 //normalize a vector. returns mag of source vec
 fix vm_vec_copy_normalize(vms_vector* dest, vms_vector* src)
 {
@@ -361,35 +152,6 @@ void check_vec(vms_vector* v)
 		}
 }
 
-//computes cross product of two vectors. 
-//Note: this magnitude of the resultant vector is the
-//product of the magnitudes of the two source vectors.  This means it is
-//quite easy for this routine to overflow and underflow.  Be careful that
-//your inputs are ok.
-vms_vector * vm_vec_crossprod(vms_vector * dest, vms_vector * src0, vms_vector * src1)
-{
-	int64_t q;
-
-	Assert(dest != src0 && dest != src1);
-
-	q = 0;
-	fixmulaccum(&q, src0->y, src1->z);
-	fixmulaccum(&q, -src0->z, src1->y);
-	dest->x = fixquadadjust(q);
-
-	q = 0;
-	fixmulaccum(&q, src0->z, src1->x);
-	fixmulaccum(&q, -src0->x, src1->z);
-	dest->y = fixquadadjust(q);
-
-	q = 0;
-	fixmulaccum(&q, src0->x, src1->y);
-	fixmulaccum(&q, -src0->y, src1->x);
-	dest->z = fixquadadjust(q);
-
-	return dest;
-}
-
 //computes non-normalized surface normal from three points. 
 //returns ptr to dest
 //dest CANNOT equal either source
@@ -646,75 +408,6 @@ vms_matrix* vm_vector_2_matrix_norm(vms_matrix* m, vms_vector* fvec, vms_vector*
 }
 
 
-//rotates a vector through a matrix. returns ptr to dest vector
-//dest CANNOT equal source
-vms_vector* vm_vec_rotate(vms_vector* dest, vms_vector* src, vms_matrix* m)
-{
-	Assert(dest != src);
-
-	dest->x = vm_vec_dot(src, &m->rvec);
-	dest->y = vm_vec_dot(src, &m->uvec);
-	dest->z = vm_vec_dot(src, &m->fvec);
-
-	return dest;
-}
-
-
-//transpose a matrix in place. returns ptr to matrix
-vms_matrix* vm_transpose_matrix(vms_matrix* m)
-{
-	fix t;
-
-	t = m->uvec.x;  m->uvec.x = m->rvec.y;  m->rvec.y = t;
-	t = m->fvec.x;  m->fvec.x = m->rvec.z;  m->rvec.z = t;
-	t = m->fvec.y;  m->fvec.y = m->uvec.z;  m->uvec.z = t;
-
-	return m;
-}
-
-//copy and transpose a matrix. returns ptr to matrix
-//dest CANNOT equal source. use vm_transpose_matrix() if this is the case
-vms_matrix* vm_copy_transpose_matrix(vms_matrix* dest, vms_matrix* src)
-{
-	Assert(dest != src);
-
-	dest->rvec.x = src->rvec.x;
-	dest->rvec.y = src->uvec.x;
-	dest->rvec.z = src->fvec.x;
-
-	dest->uvec.x = src->rvec.y;
-	dest->uvec.y = src->uvec.y;
-	dest->uvec.z = src->fvec.y;
-
-	dest->fvec.x = src->rvec.z;
-	dest->fvec.y = src->uvec.z;
-	dest->fvec.z = src->fvec.z;
-
-	return dest;
-}
-
-//mulitply 2 matrices, fill in dest.  returns ptr to dest
-//dest CANNOT equal either source
-vms_matrix* vm_matrix_x_matrix(vms_matrix* dest, vms_matrix* src0, vms_matrix* src1)
-{
-	Assert(dest != src0 && dest != src1);
-
-	dest->rvec.x = vm_vec_dot3(src0->rvec.x, src0->uvec.x, src0->fvec.x, &src1->rvec);
-	dest->uvec.x = vm_vec_dot3(src0->rvec.x, src0->uvec.x, src0->fvec.x, &src1->uvec);
-	dest->fvec.x = vm_vec_dot3(src0->rvec.x, src0->uvec.x, src0->fvec.x, &src1->fvec);
-
-	dest->rvec.y = vm_vec_dot3(src0->rvec.y, src0->uvec.y, src0->fvec.y, &src1->rvec);
-	dest->uvec.y = vm_vec_dot3(src0->rvec.y, src0->uvec.y, src0->fvec.y, &src1->uvec);
-	dest->fvec.y = vm_vec_dot3(src0->rvec.y, src0->uvec.y, src0->fvec.y, &src1->fvec);
-
-	dest->rvec.z = vm_vec_dot3(src0->rvec.z, src0->uvec.z, src0->fvec.z, &src1->rvec);
-	dest->uvec.z = vm_vec_dot3(src0->rvec.z, src0->uvec.z, src0->fvec.z, &src1->uvec);
-	dest->fvec.z = vm_vec_dot3(src0->rvec.z, src0->uvec.z, src0->fvec.z, &src1->fvec);
-
-	return dest;
-}
-
-
 //extract angles from a matrix 
 vms_angvec* vm_extract_angles_matrix(vms_angvec* a, vms_matrix* m)
 {
@@ -786,17 +479,6 @@ vms_angvec* vm_extract_angles_vector(vms_angvec* a, vms_vector* v)
 
 }
 
-//compute the distance from a point to a plane.  takes the normalized normal
-//of the plane (ebx), a point on the plane (edi), and the point to check (esi).
-//returns distance in eax
-//distance is signed, so negative dist is on the back of the plane
-fix vm_dist_to_plane(vms_vector* checkp, vms_vector* norm, vms_vector* planep)
-{
-	vms_vector t;
-	vm_vec_sub(&t, checkp, planep);
-	return vm_vec_dot(&t, norm);
-}
-
 //[ISB] neglected funcs
 vms_vector* vm_vec_make(vms_vector* v, fix x, fix y, fix z)
 {
@@ -809,3 +491,162 @@ vms_angvec* vm_angvec_make(vms_angvec* v, fixang p, fixang b, fixang h)
 	v->p = p; v->b = b; v->h = h;
 	return v;
 }
+
+//Batch versions. The products are 64 bits, so the vector units only do two at a time, one source vector
+//per 64-bit lane. Whatever is left over after the pairs goes through the single versions.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VECMAT_SSE2
+#include <emmintrin.h>
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define VECMAT_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef VECMAT_SSE2
+//64-bit products of the signed dwords 0 and 2 of a and b. Before SSE4.1 there's only the unsigned
+//multiply, so correct it for the signs.
+static inline __m128i vm_sse_mul(__m128i a, __m128i b)
+{
+#ifdef __SSE4_1__
+	return _mm_mul_epi32(a, b);
+#else
+	__m128i p = _mm_mul_epu32(a, b);
+	__m128i c = _mm_add_epi32(_mm_and_si128(_mm_srai_epi32(a, 31), b), _mm_and_si128(_mm_srai_epi32(b, 31), a));
+
+	return _mm_sub_epi64(p, _mm_slli_epi64(c, 32));
+#endif
+}
+
+//fixquadadjust on both 64-bit lanes. The results are in dwords 0 and 2.
+static inline __m128i vm_sse_quadadjust(__m128i q)
+{
+	__m128i v = _mm_srli_epi64(q, 16);
+	__m128i signb = _mm_shuffle_epi32(_mm_srai_epi32(q, 31), _MM_SHUFFLE(3, 3, 1, 1));
+	__m128i over = _mm_xor_si128(signb, _mm_srai_epi32(v, 31));
+	__m128i sat = _mm_sub_epi32(_mm_xor_si128(_mm_set1_epi32(0x7FFFFFFF), signb), signb);
+
+	return _mm_or_si128(_mm_and_si128(over, sat), _mm_andnot_si128(over, v));
+}
+
+static inline __m128i vm_sse_dot(__m128i x, __m128i y, __m128i z, __m128i vx, __m128i vy, __m128i vz)
+{
+	return _mm_add_epi64(_mm_add_epi64(vm_sse_mul(x, vx), vm_sse_mul(y, vy)), vm_sse_mul(z, vz));
+}
+
+#define VM_SSE_LOAD_PAIR(v, i, c) _mm_set_epi32(0, (v)[(i) + 1].c, 0, (v)[i].c)
+#define VM_SSE_LANE0(r) _mm_cvtsi128_si32(r)
+#define VM_SSE_LANE1(r) _mm_cvtsi128_si32(_mm_srli_si128(r, 8))
+#endif
+
+#ifdef VECMAT_NEON
+//fixquadadjust on both lanes
+static inline int32x2_t vm_neon_quadadjust(int64x2_t q)
+{
+	int32x2_t v = vmovn_s64(vshrq_n_s64(q, 16));
+	int32x2_t signb = vmovn_s64(vshrq_n_s64(q, 63));
+	uint32x2_t over = vreinterpret_u32_s32(veor_s32(signb, vshr_n_s32(v, 31)));
+	int32x2_t sat = vsub_s32(veor_s32(vdup_n_s32(0x7FFFFFFF), signb), signb);
+
+	return vbsl_s32(over, sat, v);
+}
+
+static inline int64x2_t vm_neon_dot(int32x2x3_t a, int32x2_t vx, int32x2_t vy, int32x2_t vz)
+{
+	return vmlal_s32(vmlal_s32(vmull_s32(a.val[0], vx), a.val[1], vy), a.val[2], vz);
+}
+#endif
+
+void vm_vec_rotate_n(vms_vector* dest, const vms_vector* src, int n, const vms_matrix* m)
+{
+	int i = 0;
+
+	//No SSE2 version, since packing pairs of vectors into lanes and back out costs more than the
+	//three scalar 64-bit multiplies it saves.
+#if defined(VECMAT_NEON)
+	int32x2_t rx = vdup_n_s32(m->rvec.x), ry = vdup_n_s32(m->rvec.y), rz = vdup_n_s32(m->rvec.z);
+	int32x2_t ux = vdup_n_s32(m->uvec.x), uy = vdup_n_s32(m->uvec.y), uz = vdup_n_s32(m->uvec.z);
+	int32x2_t fx = vdup_n_s32(m->fvec.x), fy = vdup_n_s32(m->fvec.y), fz = vdup_n_s32(m->fvec.z);
+
+	for (; i + 2 <= n; i += 2)
+	{
+		int32x2x3_t a = vld3_s32((const int32_t*)&src[i]);
+		int32x2x3_t o;
+
+		o.val[0] = vm_neon_quadadjust(vm_neon_dot(a, rx, ry, rz));
+		o.val[1] = vm_neon_quadadjust(vm_neon_dot(a, ux, uy, uz));
+		o.val[2] = vm_neon_quadadjust(vm_neon_dot(a, fx, fy, fz));
+		vst3_s32((int32_t*)&dest[i], o);
+	}
+#endif
+
+	for (; i < n; i++)
+		dest[i] = vmv_rotate(src[i], *m);
+}
+
+void vm_vec_dot_n(fix* dest, const vms_vector* src, int n, const vms_vector* v)
+{
+	int i = 0;
+
+#if defined(VECMAT_SSE2)
+	__m128i vx = _mm_set1_epi32(v->x), vy = _mm_set1_epi32(v->y), vz = _mm_set1_epi32(v->z);
+
+	for (; i + 2 <= n; i += 2)
+	{
+		__m128i x = VM_SSE_LOAD_PAIR(src, i, x), y = VM_SSE_LOAD_PAIR(src, i, y), z = VM_SSE_LOAD_PAIR(src, i, z);
+		__m128i o = vm_sse_quadadjust(vm_sse_dot(x, y, z, vx, vy, vz));
+
+		dest[i] = VM_SSE_LANE0(o);
+		dest[i + 1] = VM_SSE_LANE1(o);
+	}
+#elif defined(VECMAT_NEON)
+	int32x2_t vx = vdup_n_s32(v->x), vy = vdup_n_s32(v->y), vz = vdup_n_s32(v->z);
+
+	for (; i + 2 <= n; i += 2)
+		vst1_s32((int32_t*)&dest[i], vm_neon_quadadjust(vm_neon_dot(vld3_s32((const int32_t*)&src[i]), vx, vy, vz)));
+#endif
+
+	for (; i < n; i++)
+		dest[i] = vmv_dot(src[i], *v);
+}
+
+void vm_vec_dist_n(fix* dest, const vms_vector* src, int n, const vms_vector* p)
+{
+	int i = 0;
+
+#if defined(VECMAT_SSE2)
+	__m128i px = _mm_set1_epi32(p->x), py = _mm_set1_epi32(p->y), pz = _mm_set1_epi32(p->z);
+	int64_t q[2];
+
+	for (; i + 2 <= n; i += 2)
+	{
+		__m128i x = _mm_sub_epi32(VM_SSE_LOAD_PAIR(src, i, x), px);
+		__m128i y = _mm_sub_epi32(VM_SSE_LOAD_PAIR(src, i, y), py);
+		__m128i z = _mm_sub_epi32(VM_SSE_LOAD_PAIR(src, i, z), pz);
+
+		_mm_storeu_si128((__m128i*)q, vm_sse_dot(x, y, z, x, y, z));
+		dest[i] = quad_sqrt(q[0]);
+		dest[i + 1] = quad_sqrt(q[1]);
+	}
+#elif defined(VECMAT_NEON)
+	int32x2_t px = vdup_n_s32(p->x), py = vdup_n_s32(p->y), pz = vdup_n_s32(p->z);
+
+	for (; i + 2 <= n; i += 2)
+	{
+		int32x2x3_t a = vld3_s32((const int32_t*)&src[i]);
+		int64x2_t q;
+
+		a.val[0] = vsub_s32(a.val[0], px);
+		a.val[1] = vsub_s32(a.val[1], py);
+		a.val[2] = vsub_s32(a.val[2], pz);
+		q = vm_neon_dot(a, a.val[0], a.val[1], a.val[2]);
+		dest[i] = quad_sqrt(vgetq_lane_s64(q, 0));
+		dest[i + 1] = quad_sqrt(vgetq_lane_s64(q, 1));
+	}
+#endif
+
+	for (; i < n; i++)
+		dest[i] = vmv_dist(src[i], *p);
+}
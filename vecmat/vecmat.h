@@ -78,63 +78,255 @@ extern vms_matrix vmd_identity_matrix;
 //negate a vector
 #define vm_vec_negate(v) do {(v)->x = - (v)->x; (v)->y = - (v)->y; (v)->z = - (v)->z;} while (0);
 
+//Value versions of the simple operations. They take and return vectors and matrices by value and live
+//here so they inline, and can be used in constant expressions. They round exactly like the pointer versions
+//below, which are now wrappers around them.
+
+constexpr vms_vector vmv_make(fix x, fix y, fix z)
+{
+	return vms_vector{ x, y, z };
+}
+
+constexpr vms_vector vmv_add(vms_vector a, vms_vector b)
+{
+	return vms_vector{ a.x + b.x, a.y + b.y, a.z + b.z };
+}
+
+constexpr vms_vector vmv_sub(vms_vector a, vms_vector b)
+{
+	return vms_vector{ a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+constexpr vms_vector vmv_avg(vms_vector a, vms_vector b)
+{
+	return vms_vector{ (a.x + b.x) / 2, (a.y + b.y) / 2, (a.z + b.z) / 2 };
+}
+
+constexpr vms_vector vmv_avg4(vms_vector a, vms_vector b, vms_vector c, vms_vector d)
+{
+	return vms_vector{ (a.x + b.x + c.x + d.x) / 4, (a.y + b.y + c.y + d.y) / 4, (a.z + b.z + c.z + d.z) / 4 };
+}
+
+//v * s
+constexpr vms_vector vmv_scale(vms_vector v, fix s)
+{
+	return vms_vector{ fixmul(v.x, s), fixmul(v.y, s), fixmul(v.z, s) };
+}
+
+//a + b * k
+constexpr vms_vector vmv_scale_add(vms_vector a, vms_vector b, fix k)
+{
+	return vms_vector{ a.x + fixmul(b.x, k), a.y + fixmul(b.y, k), a.z + fixmul(b.z, k) };
+}
+
+//v * n / d, or v if d is 0
+constexpr vms_vector vmv_scale2(vms_vector v, fix n, fix d)
+{
+	return d == 0 ? v : vms_vector{ fixmuldiv(v.x, n, d), fixmuldiv(v.y, n, d), fixmuldiv(v.z, n, d) };
+}
+
+constexpr fix vmv_dot3(fix x, fix y, fix z, vms_vector v)
+{
+	return fixquadadjust((int64_t)x * v.x + (int64_t)y * v.y + (int64_t)z * v.z);
+}
+
+constexpr fix vmv_dot(vms_vector a, vms_vector b)
+{
+	return vmv_dot3(a.x, a.y, a.z, b);
+}
+
+//The magnitude of the result is the product of the magnitudes of a and b, so it's easy to overflow.
+constexpr vms_vector vmv_cross(vms_vector a, vms_vector b)
+{
+	return vms_vector{
+		fixquadadjust((int64_t)a.y * b.z + (int64_t)(-a.z) * b.y),
+		fixquadadjust((int64_t)a.z * b.x + (int64_t)(-a.x) * b.z),
+		fixquadadjust((int64_t)a.x * b.y + (int64_t)(-a.y) * b.x) };
+}
+
+//uses dist = largest + next_largest*3/8 + smallest*3/16
+constexpr fix vmv_mag_quick(vms_vector v)
+{
+	fix a = v.x < 0 ? -v.x : v.x;
+	fix b = v.y < 0 ? -v.y : v.y;
+	fix c = v.z < 0 ? -v.z : v.z;
+	fix t = 0, bc = 0;
+
+	if (a < b)
+	{
+		t = a; a = b; b = t;
+	}
+
+	if (b < c)
+	{
+		t = b; b = c; c = t;
+
+		if (a < b)
+		{
+			t = a; a = b; b = t;
+		}
+	}
+
+	bc = (b >> 2) + (c >> 3);
+
+	return a + bc + (bc >> 1);
+}
+
+constexpr fix vmv_dist_quick(vms_vector a, vms_vector b)
+{
+	return vmv_mag_quick(vmv_sub(a, b));
+}
+
+inline fix vmv_mag(vms_vector v)
+{
+	return quad_sqrt((int64_t)v.x * v.x + (int64_t)v.y * v.y + (int64_t)v.z * v.z);
+}
+
+inline fix vmv_dist(vms_vector a, vms_vector b)
+{
+	return vmv_mag(vmv_sub(a, b));
+}
+
+constexpr vms_vector vmv_rotate(vms_vector v, vms_matrix m)
+{
+	return vms_vector{ vmv_dot(v, m.rvec), vmv_dot(v, m.uvec), vmv_dot(v, m.fvec) };
+}
+
+constexpr vms_matrix vmv_transpose(vms_matrix m)
+{
+	return vms_matrix{
+		vms_vector{ m.rvec.x, m.uvec.x, m.fvec.x },
+		vms_vector{ m.rvec.y, m.uvec.y, m.fvec.y },
+		vms_vector{ m.rvec.z, m.uvec.z, m.fvec.z } };
+}
+
+constexpr vms_matrix vmv_matrix_x_matrix(vms_matrix a, vms_matrix b)
+{
+	return vms_matrix{
+		vms_vector{ vmv_dot3(a.rvec.x, a.uvec.x, a.fvec.x, b.rvec), vmv_dot3(a.rvec.y, a.uvec.y, a.fvec.y, b.rvec), vmv_dot3(a.rvec.z, a.uvec.z, a.fvec.z, b.rvec) },
+		vms_vector{ vmv_dot3(a.rvec.x, a.uvec.x, a.fvec.x, b.uvec), vmv_dot3(a.rvec.y, a.uvec.y, a.fvec.y, b.uvec), vmv_dot3(a.rvec.z, a.uvec.z, a.fvec.z, b.uvec) },
+		vms_vector{ vmv_dot3(a.rvec.x, a.uvec.x, a.fvec.x, b.fvec), vmv_dot3(a.rvec.y, a.uvec.y, a.fvec.y, b.fvec), vmv_dot3(a.rvec.z, a.uvec.z, a.fvec.z, b.fvec) } };
+}
+
+//signed distance from checkp to the plane through planep with the normalized normal norm
+constexpr fix vmv_dist_to_plane(vms_vector checkp, vms_vector norm, vms_vector planep)
+{
+	return vmv_dot(vmv_sub(checkp, planep), norm);
+}
+
 //Functions in library
 
 //adds two vectors, fills in dest, returns ptr to dest
 //ok for dest to equal either source, but should use vm_vec_add2() if so
-vms_vector* vm_vec_add(vms_vector* dest, vms_vector* src0, vms_vector* src1);
+inline vms_vector* vm_vec_add(vms_vector* dest, vms_vector* src0, vms_vector* src1)
+{
+	*dest = vmv_add(*src0, *src1);
+	return dest;
+}
 
 //subs two vectors, fills in dest, returns ptr to dest
 //ok for dest to equal either source, but should use vm_vec_sub2() if so
-vms_vector* vm_vec_sub(vms_vector* dest, vms_vector* src0, vms_vector* src1);
+inline vms_vector* vm_vec_sub(vms_vector* dest, vms_vector* src0, vms_vector* src1)
+{
+	*dest = vmv_sub(*src0, *src1);
+	return dest;
+}
 
 //adds one vector to another. returns ptr to dest
 //dest can equal source
-vms_vector* vm_vec_add2(vms_vector* dest, vms_vector* src);
+inline vms_vector* vm_vec_add2(vms_vector* dest, vms_vector* src)
+{
+	*dest = vmv_add(*dest, *src);
+	return dest;
+}
 
 //subs one vector from another, returns ptr to dest
 //dest can equal source
-vms_vector* vm_vec_sub2(vms_vector* dest, vms_vector* src);
+inline vms_vector* vm_vec_sub2(vms_vector* dest, vms_vector* src)
+{
+	*dest = vmv_sub(*dest, *src);
+	return dest;
+}
 
 //averages two vectors. returns ptr to dest
 //dest can equal either source
-vms_vector* vm_vec_avg(vms_vector* dest, vms_vector* src0, vms_vector* src1);
+inline vms_vector* vm_vec_avg(vms_vector* dest, vms_vector* src0, vms_vector* src1)
+{
+	*dest = vmv_avg(*src0, *src1);
+	return dest;
+}
 
 //averages four vectors. returns ptr to dest
 //dest can equal any source
-vms_vector* vm_vec_avg4(vms_vector* dest, vms_vector* src0, vms_vector* src1, vms_vector* src2, vms_vector* src3);
+inline vms_vector* vm_vec_avg4(vms_vector* dest, vms_vector* src0, vms_vector* src1, vms_vector* src2, vms_vector* src3)
+{
+	*dest = vmv_avg4(*src0, *src1, *src2, *src3);
+	return dest;
+}
 
 //scales a vector in place.  returns ptr to vector
-vms_vector* vm_vec_scale(vms_vector* dest, fix s);
+inline vms_vector* vm_vec_scale(vms_vector* dest, fix s)
+{
+	*dest = vmv_scale(*dest, s);
+	return dest;
+}
 
 //scales and copies a vector.  returns ptr to dest
-vms_vector* vm_vec_copy_scale(vms_vector* dest, vms_vector* src, fix s);
+inline vms_vector* vm_vec_copy_scale(vms_vector* dest, vms_vector* src, fix s)
+{
+	*dest = vmv_scale(*src, s);
+	return dest;
+}
 
 //scales a vector, adds it to another, and stores in a 3rd vector
 //dest = src1 + k * src2
-vms_vector* vm_vec_scale_add(vms_vector* dest, vms_vector* src1, vms_vector* src2, fix k);
+inline vms_vector* vm_vec_scale_add(vms_vector* dest, vms_vector* src1, vms_vector* src2, fix k)
+{
+	*dest = vmv_scale_add(*src1, *src2, k);
+	return dest;
+}
 
 //scales a vector and adds it to another
 //dest += k * src
-vms_vector* vm_vec_scale_add2(vms_vector* dest, vms_vector* src, fix k);
+inline vms_vector* vm_vec_scale_add2(vms_vector* dest, vms_vector* src, fix k)
+{
+	*dest = vmv_scale_add(*dest, *src, k);
+	return dest;
+}
 
 //scales a vector in place, taking n/d for scale.  returns ptr to vector
 //dest *= n/d
-vms_vector* vm_vec_scale2(vms_vector* dest, fix n, fix d);
+inline vms_vector* vm_vec_scale2(vms_vector* dest, fix n, fix d)
+{
+	*dest = vmv_scale2(*dest, n, d);
+	return dest;
+}
 
 //returns magnitude of a vector
-fix vm_vec_mag(vms_vector* v);
+inline fix vm_vec_mag(vms_vector* v)
+{
+	return vmv_mag(*v);
+}
 
 //computes the distance between two points. (does sub and mag)
-fix vm_vec_dist(vms_vector* v0, vms_vector* v1);
+inline fix vm_vec_dist(vms_vector* v0, vms_vector* v1)
+{
+	return vmv_dist(*v0, *v1);
+}
 
 //computes an approximation of the magnitude of the vector
 //uses dist = largest + next_largest*3/8 + smallest*3/16
-fix vm_vec_mag_quick(vms_vector* v);
+inline fix vm_vec_mag_quick(vms_vector* v)
+{
+	return vmv_mag_quick(*v);
+}
 
 //computes an approximation of the distance between two points.
 //uses dist = largest + next_largest*3/8 + smallest*3/16
-fix vm_vec_dist_quick(vms_vector* v0, vms_vector* v1);
+inline fix vm_vec_dist_quick(vms_vector* v0, vms_vector* v1)
+{
+	return vmv_dist_quick(*v0, *v1);
+}
 
 
 //normalize a vector. returns mag of source vec
@@ -152,12 +344,18 @@ fix vm_vec_normalized_dir(vms_vector* dest, vms_vector* end, vms_vector* start);
 fix vm_vec_normalized_dir_quick(vms_vector* dest, vms_vector* end, vms_vector* start);
 
 ////returns dot product of two vectors
-fix vm_vec_dotprod(vms_vector* v0, vms_vector* v1);
+inline fix vm_vec_dotprod(vms_vector* v0, vms_vector* v1)
+{
+	return vmv_dot(*v0, *v1);
+}
 #define vm_vec_dot(v0,v1) vm_vec_dotprod((v0),(v1))
 
 //computes cross product of two vectors. returns ptr to dest
-//dest CANNOT equal either source
-vms_vector* vm_vec_crossprod(vms_vector* dest, vms_vector* src0, vms_vector* src1);
+inline vms_vector* vm_vec_crossprod(vms_vector* dest, vms_vector* src0, vms_vector* src1)
+{
+	*dest = vmv_cross(*src0, *src1);
+	return dest;
+}
 #define vm_vec_cross(dest,src0,src1) vm_vec_crossprod((dest),(src0),(src1))
 
 //computes surface normal from three points. result is normalized
@@ -198,21 +396,34 @@ vms_matrix* vm_vector_2_matrix(vms_matrix* m, vms_vector* fvec, vms_vector* uvec
 vms_matrix* vm_vector_2_matrix_norm(vms_matrix* m, vms_vector* fvec, vms_vector* uvec, vms_vector* rvec);
 
 //rotates a vector through a matrix. returns ptr to dest vector
-//dest CANNOT equal either source
-vms_vector* vm_vec_rotate(vms_vector* dest, vms_vector* src, vms_matrix* m);
+inline vms_vector* vm_vec_rotate(vms_vector* dest, vms_vector* src, vms_matrix* m)
+{
+	*dest = vmv_rotate(*src, *m);
+	return dest;
+}
 
 //transpose a matrix in place. returns ptr to matrix
-vms_matrix* vm_transpose_matrix(vms_matrix* m);
+inline vms_matrix* vm_transpose_matrix(vms_matrix* m)
+{
+	*m = vmv_transpose(*m);
+	return m;
+}
 #define vm_transpose(m) vm_transpose_matrix(m)
 
 //copy and transpose a matrix. returns ptr to matrix
-//dest CANNOT equal source. use vm_transpose_matrix() if this is the case
-vms_matrix* vm_copy_transpose_matrix(vms_matrix* dest, vms_matrix* src);
+inline vms_matrix* vm_copy_transpose_matrix(vms_matrix* dest, vms_matrix* src)
+{
+	*dest = vmv_transpose(*src);
+	return dest;
+}
 #define vm_copy_transpose(dest,src) vm_copy_transpose_matrix((dest),(src))
 
 //mulitply 2 matrices, fill in dest.  returns ptr to dest
-//dest CANNOT equal either source
-vms_matrix* vm_matrix_x_matrix(vms_matrix* dest, vms_matrix* src0, vms_matrix* src1);
+inline vms_matrix* vm_matrix_x_matrix(vms_matrix* dest, vms_matrix* src0, vms_matrix* src1)
+{
+	*dest = vmv_matrix_x_matrix(*src0, *src1);
+	return dest;
+}
 
 //extract angles from a matrix 
 vms_angvec* vm_extract_angles_matrix(vms_angvec* a, vms_matrix* m);
@@ -224,4 +435,19 @@ vms_angvec* vm_extract_angles_vector(vms_angvec* a, vms_vector* v);
 //of the plane (ebx), a point on the plane (edi), and the point to check (esi).
 //returns distance in eax
 //distance is signed, so negative dist is on the back of the plane
-fix vm_dist_to_plane(vms_vector* checkp, vms_vector* norm, vms_vector* planep);
+inline fix vm_dist_to_plane(vms_vector* checkp, vms_vector* norm, vms_vector* planep)
+{
+	return vmv_dist_to_plane(*checkp, *norm, *planep);
+}
+
+//Batch versions, for running one operation over many vectors. These use SSE2 or NEON where available,
+//and give exactly the same results as calling the single versions in a loop.
+
+//dest[i] = src[i] rotated by m. dest can't overlap src.
+void vm_vec_rotate_n(vms_vector* dest, const vms_vector* src, int n, const vms_matrix* m);
+
+//dest[i] = dot product of src[i] and v.
+void vm_vec_dot_n(fix* dest, const vms_vector* src, int n, const vms_vector* v);
+
+//dest[i] = distance between src[i] and p.
+void vm_vec_dist_n(fix* dest, const vms_vector* src, int n, const vms_vector* p);